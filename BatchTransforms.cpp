@@ -0,0 +1,674 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchtransforms.cpp
+// ============
+// compose the model and normal matrices of many objects at once from their
+// scale, rotation and position values, with SIMD kernels where available
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchTransforms.h"
+
+#include <cmath>
+
+// the kernels this build has, x86 always has SSE2 in 64 bit and the
+// AVX2 kernel is compiled for it and only run on CPUs that have it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define BATCH_TRANSFORMS_SSE2
+	#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+		#define BATCH_TRANSFORMS_AVX2
+	#endif
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+	#define BATCH_TRANSFORMS_NEON
+#endif
+
+#if defined(BATCH_TRANSFORMS_SSE2)
+	#include <emmintrin.h>
+	#include <xmmintrin.h>
+#endif
+#if defined(BATCH_TRANSFORMS_AVX2)
+	#include <immintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+	#endif
+#endif
+#if defined(BATCH_TRANSFORMS_NEON)
+	#include <arm_neon.h>
+#endif
+
+// the AVX2 functions are compiled for AVX2 without the whole file
+#if defined(BATCH_TRANSFORMS_AVX2) && !defined(_MSC_VER)
+	#define BATCH_TRANSFORMS_AVX2_TARGET __attribute__((target("avx2")))
+#else
+	#define BATCH_TRANSFORMS_AVX2_TARGET
+#endif
+
+// declaration of global variables
+namespace
+{
+	const char* g_KernelNames[BatchTransforms::KERNEL_COUNT] =
+	{
+		"scalar",
+		"sse2",
+		"avx2",
+		"neon"
+	};
+
+	// the angles are reduced by quarter turns in degrees, which keeps
+	// multiples of 90 degrees exact
+	const float g_QuarterTurn = 90.0f;
+	const float g_InverseQuarterTurn = 1.0f / 90.0f;
+	const float g_DegreesToRadians = 0.01745329251994329577f;
+
+	// minimax polynomials for sine and cosine on [-pi/4, pi/4]
+	const float g_Sin1 = -1.6666654611E-1f;
+	const float g_Sin2 = 8.3321608736E-3f;
+	const float g_Sin3 = -1.9515295891E-4f;
+	const float g_Cos1 = 4.166664568298827E-2f;
+	const float g_Cos2 = -1.388731625493765E-3f;
+	const float g_Cos3 = 2.443315711809948E-5f;
+
+	/***********************************************************
+	 *  SinCosDegrees()
+	 *
+	 *  This function is used for computing the sine and cosine
+	 *  of an angle in degrees.  The angle is split into whole
+	 *  quarter turns and a rest of at most 45 degrees, the
+	 *  polynomials give the sine and cosine of the rest, and
+	 *  the quarter turns swap them and flip their signs.
+	 ***********************************************************/
+	void SinCosDegrees(float degrees, float& sine, float& cosine)
+	{
+		int quadrant = (int)std::nearbyint(degrees * g_InverseQuarterTurn);
+		float r = (degrees - (float)quadrant * g_QuarterTurn) * g_DegreesToRadians;
+		float r2 = r * r;
+
+		float sinR = r + r * r2 * (g_Sin1 + r2 * (g_Sin2 + r2 * g_Sin3));
+		float cosR = 1.0f - 0.5f * r2 + r2 * r2 * (g_Cos1 + r2 * (g_Cos2 + r2 * g_Cos3));
+
+		if ((quadrant & 1) != 0)
+		{
+			float swap = sinR;
+			sinR = cosR;
+			cosR = swap;
+		}
+		sine = ((quadrant & 2) != 0) ? -sinR : sinR;
+		cosine = (((quadrant + 1) & 2) != 0) ? -cosR : cosR;
+	}
+
+	/***********************************************************
+	 *  ComposeScalar()
+	 *
+	 *  This function is used for composing the matrices of the
+	 *  objects one at a time.  The SIMD kernels use it for the
+	 *  objects left over after their last full group.
+	 ***********************************************************/
+	void ComposeScalar(const BatchTransforms::TRANSFORM_ARRAYS& t, int begin, int end, glm::mat4* pModels, glm::mat3* pNormals)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			float sx, cx, sy, cy, sz, cz;
+			SinCosDegrees(t.rotationX[i], sx, cx);
+			SinCosDegrees(t.rotationY[i], sy, cy);
+			SinCosDegrees(t.rotationZ[i], sz, cz);
+
+			// columns of rotationZ * rotationY * rotationX
+			float r00 = cz * cy;
+			float r10 = sz * cy;
+			float r20 = -sy;
+			float r01 = cz * sy * sx - sz * cx;
+			float r11 = sz * sy * sx + cz * cx;
+			float r21 = cy * sx;
+			float r02 = cz * sy * cx + sz * sx;
+			float r12 = sz * sy * cx - cz * sx;
+			float r22 = cy * cx;
+
+			float scaleX = t.scaleX[i];
+			float scaleY = t.scaleY[i];
+			float scaleZ = t.scaleZ[i];
+
+			glm::mat4& model = pModels[i];
+			model[0] = glm::vec4(r00 * scaleX, r10 * scaleX, r20 * scaleX, 0.0f);
+			model[1] = glm::vec4(r01 * scaleY, r11 * scaleY, r21 * scaleY, 0.0f);
+			model[2] = glm::vec4(r02 * scaleZ, r12 * scaleZ, r22 * scaleZ, 0.0f);
+			model[3] = glm::vec4(t.positionX[i], t.positionY[i], t.positionZ[i], 1.0f);
+
+			if (NULL != pNormals)
+			{
+				float inverseX = 1.0f / scaleX;
+				float inverseY = 1.0f / scaleY;
+				float inverseZ = 1.0f / scaleZ;
+
+				glm::mat3& normal = pNormals[i];
+				normal[0] = glm::vec3(r00 * inverseX, r10 * inverseX, r20 * inverseX);
+				normal[1] = glm::vec3(r01 * inverseY, r11 * inverseY, r21 * inverseY);
+				normal[2] = glm::vec3(r02 * inverseZ, r12 * inverseZ, r22 * inverseZ);
+			}
+		}
+	}
+
+#if defined(BATCH_TRANSFORMS_SSE2)
+	/***********************************************************
+	 *  SinCosDegrees4()
+	 *
+	 *  This function is used for computing the sines and
+	 *  cosines of 4 angles, the same way as SinCosDegrees().
+	 *  The swap and the signs come from the bits of the
+	 *  quadrant, so there are no branches.
+	 ***********************************************************/
+	inline void SinCosDegrees4(__m128 degrees, __m128& sine, __m128& cosine)
+	{
+		__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(degrees, _mm_set1_ps(g_InverseQuarterTurn)));
+		__m128 r = _mm_sub_ps(degrees, _mm_mul_ps(_mm_cvtepi32_ps(quadrant), _mm_set1_ps(g_QuarterTurn)));
+		r = _mm_mul_ps(r, _mm_set1_ps(g_DegreesToRadians));
+		__m128 r2 = _mm_mul_ps(r, r);
+
+		__m128 sinR = _mm_add_ps(_mm_set1_ps(g_Sin2), _mm_mul_ps(r2, _mm_set1_ps(g_Sin3)));
+		sinR = _mm_add_ps(_mm_set1_ps(g_Sin1), _mm_mul_ps(r2, sinR));
+		sinR = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), sinR));
+		__m128 cosR = _mm_add_ps(_mm_set1_ps(g_Cos2), _mm_mul_ps(r2, _mm_set1_ps(g_Cos3)));
+		cosR = _mm_add_ps(_mm_set1_ps(g_Cos1), _mm_mul_ps(r2, cosR));
+		cosR = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), cosR));
+
+		// all bits set in the lanes with an odd quadrant
+		__m128 swap = _mm_castsi128_ps(_mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(quadrant, _mm_set1_epi32(1))));
+		__m128 sinSwapped = _mm_or_ps(_mm_and_ps(swap, cosR), _mm_andnot_ps(swap, sinR));
+		__m128 cosSwapped = _mm_or_ps(_mm_and_ps(swap, sinR), _mm_andnot_ps(swap, cosR));
+
+		// bit 1 of the quadrant moved into the sign bit
+		__m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+		sine = _mm_xor_ps(sinSwapped, sinSign);
+		cosine = _mm_xor_ps(cosSwapped, cosSign);
+	}
+
+	/***********************************************************
+	 *  StoreColumns4()
+	 *
+	 *  This function is used for writing one column of the
+	 *  model matrices of 4 objects.  The registers hold a row
+	 *  each for the 4 objects, the transpose turns them into a
+	 *  column per object.
+	 ***********************************************************/
+	inline void StoreColumns4(float* pFirst, __m128 row0, __m128 row1, __m128 row2, __m128 row3)
+	{
+		_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+		_mm_storeu_ps(pFirst, row0);
+		_mm_storeu_ps(pFirst + 16, row1);
+		_mm_storeu_ps(pFirst + 32, row2);
+		_mm_storeu_ps(pFirst + 48, row3);
+	}
+
+	/***********************************************************
+	 *  StoreModels4()
+	 *
+	 *  This function is used for writing the model matrices and
+	 *  the normal matrices of 4 objects from the rotation terms
+	 *  and the transformation values of the 4 objects.
+	 ***********************************************************/
+	inline void StoreModels4(
+		const __m128 r[9],
+		__m128 scaleX,
+		__m128 scaleY,
+		__m128 scaleZ,
+		__m128 positionX,
+		__m128 positionY,
+		__m128 positionZ,
+		glm::mat4* pModels,
+		glm::mat3* pNormals)
+	{
+		__m128 zero = _mm_setzero_ps();
+		float* pFirst = &pModels[0][0][0];
+
+		StoreColumns4(pFirst, _mm_mul_ps(r[0], scaleX), _mm_mul_ps(r[1], scaleX), _mm_mul_ps(r[2], scaleX), zero);
+		StoreColumns4(pFirst + 4, _mm_mul_ps(r[3], scaleY), _mm_mul_ps(r[4], scaleY), _mm_mul_ps(r[5], scaleY), zero);
+		StoreColumns4(pFirst + 8, _mm_mul_ps(r[6], scaleZ), _mm_mul_ps(r[7], scaleZ), _mm_mul_ps(r[8], scaleZ), zero);
+		StoreColumns4(pFirst + 12, positionX, positionY, positionZ, _mm_set1_ps(1.0f));
+
+		if (NULL != pNormals)
+		{
+			__m128 one = _mm_set1_ps(1.0f);
+			__m128 inverse[3] = { _mm_div_ps(one, scaleX), _mm_div_ps(one, scaleY), _mm_div_ps(one, scaleZ) };
+
+			// the 9 values of the 4 normal matrices follow each other
+			// without padding, so they are written from a table
+			float values[9][4];
+			for (int element = 0; element < 9; element++)
+			{
+				_mm_storeu_ps(values[element], _mm_mul_ps(r[element], inverse[element / 3]));
+			}
+			float* pNormal = &pNormals[0][0][0];
+			for (int object = 0; object < 4; object++)
+			{
+				for (int element = 0; element < 9; element++)
+				{
+					pNormal[object * 9 + element] = values[element][object];
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  RotationTerms4()
+	 *
+	 *  This function is used for computing the 9 terms of the
+	 *  rotations of 4 objects, column by column.
+	 ***********************************************************/
+	inline void RotationTerms4(__m128 sx, __m128 cx, __m128 sy, __m128 cy, __m128 sz, __m128 cz, __m128 r[9])
+	{
+		__m128 czsy = _mm_mul_ps(cz, sy);
+		__m128 szsy = _mm_mul_ps(sz, sy);
+
+		r[0] = _mm_mul_ps(cz, cy);
+		r[1] = _mm_mul_ps(sz, cy);
+		r[2] = _mm_sub_ps(_mm_setzero_ps(), sy);
+		r[3] = _mm_sub_ps(_mm_mul_ps(czsy, sx), _mm_mul_ps(sz, cx));
+		r[4] = _mm_add_ps(_mm_mul_ps(szsy, sx), _mm_mul_ps(cz, cx));
+		r[5] = _mm_mul_ps(cy, sx);
+		r[6] = _mm_add_ps(_mm_mul_ps(czsy, cx), _mm_mul_ps(sz, sx));
+		r[7] = _mm_sub_ps(_mm_mul_ps(szsy, cx), _mm_mul_ps(cz, sx));
+		r[8] = _mm_mul_ps(cy, cx);
+	}
+
+	/***********************************************************
+	 *  ComposeSSE2()
+	 *
+	 *  This function is used for composing the matrices of 4
+	 *  objects at a time.
+	 ***********************************************************/
+	void ComposeSSE2(const BatchTransforms::TRANSFORM_ARRAYS& t, int count, glm::mat4* pModels, glm::mat3* pNormals)
+	{
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 sx, cx, sy, cy, sz, cz;
+			SinCosDegrees4(_mm_loadu_ps(t.rotationX + i), sx, cx);
+			SinCosDegrees4(_mm_loadu_ps(t.rotationY + i), sy, cy);
+			SinCosDegrees4(_mm_loadu_ps(t.rotationZ + i), sz, cz);
+
+			__m128 r[9];
+			RotationTerms4(sx, cx, sy, cy, sz, cz, r);
+			StoreModels4(r,
+				_mm_loadu_ps(t.scaleX + i), _mm_loadu_ps(t.scaleY + i), _mm_loadu_ps(t.scaleZ + i),
+				_mm_loadu_ps(t.positionX + i), _mm_loadu_ps(t.positionY + i), _mm_loadu_ps(t.positionZ + i),
+				pModels + i, (NULL != pNormals) ? pNormals + i : NULL);
+		}
+		ComposeScalar(t, i, count, pModels, pNormals);
+	}
+#endif
+
+#if defined(BATCH_TRANSFORMS_AVX2)
+	/***********************************************************
+	 *  SinCosDegrees8()
+	 *
+	 *  This function is used for computing the sines and
+	 *  cosines of 8 angles, the same way as SinCosDegrees4().
+	 ***********************************************************/
+	BATCH_TRANSFORMS_AVX2_TARGET inline void SinCosDegrees8(__m256 degrees, __m256& sine, __m256& cosine)
+	{
+		__m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(degrees, _mm256_set1_ps(g_InverseQuarterTurn)));
+		__m256 r = _mm256_sub_ps(degrees, _mm256_mul_ps(_mm256_cvtepi32_ps(quadrant), _mm256_set1_ps(g_QuarterTurn)));
+		r = _mm256_mul_ps(r, _mm256_set1_ps(g_DegreesToRadians));
+		__m256 r2 = _mm256_mul_ps(r, r);
+
+		__m256 sinR = _mm256_add_ps(_mm256_set1_ps(g_Sin2), _mm256_mul_ps(r2, _mm256_set1_ps(g_Sin3)));
+		sinR = _mm256_add_ps(_mm256_set1_ps(g_Sin1), _mm256_mul_ps(r2, sinR));
+		sinR = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), sinR));
+		__m256 cosR = _mm256_add_ps(_mm256_set1_ps(g_Cos2), _mm256_mul_ps(r2, _mm256_set1_ps(g_Cos3)));
+		cosR = _mm256_add_ps(_mm256_set1_ps(g_Cos1), _mm256_mul_ps(r2, cosR));
+		cosR = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)), _mm256_mul_ps(_mm256_mul_ps(r2, r2), cosR));
+
+		__m256 swap = _mm256_castsi256_ps(_mm256_sub_epi32(_mm256_setzero_si256(), _mm256_and_si256(quadrant, _mm256_set1_epi32(1))));
+		__m256 sinSwapped = _mm256_blendv_ps(sinR, cosR, swap);
+		__m256 cosSwapped = _mm256_blendv_ps(cosR, sinR, swap);
+
+		__m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+		__m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+		sine = _mm256_xor_ps(sinSwapped, sinSign);
+		cosine = _mm256_xor_ps(cosSwapped, cosSign);
+	}
+
+	/***********************************************************
+	 *  StoreColumns8()
+	 *
+	 *  This function is used for writing one column of the
+	 *  model matrices of 8 objects.  The transpose works on the
+	 *  two halves of the registers separately, so each result
+	 *  holds the column of an object in its low half and of
+	 *  the object 4 places further in its high half.
+	 ***********************************************************/
+	BATCH_TRANSFORMS_AVX2_TARGET inline void StoreColumns8(float* pFirst, __m256 row0, __m256 row1, __m256 row2, __m256 row3)
+	{
+		__m256 low01 = _mm256_unpacklo_ps(row0, row1);
+		__m256 high01 = _mm256_unpackhi_ps(row0, row1);
+		__m256 low23 = _mm256_unpacklo_ps(row2, row3);
+		__m256 high23 = _mm256_unpackhi_ps(row2, row3);
+
+		__m256 columns[4];
+		columns[0] = _mm256_shuffle_ps(low01, low23, _MM_SHUFFLE(1, 0, 1, 0));
+		columns[1] = _mm256_shuffle_ps(low01, low23, _MM_SHUFFLE(3, 2, 3, 2));
+		columns[2] = _mm256_shuffle_ps(high01, high23, _MM_SHUFFLE(1, 0, 1, 0));
+		columns[3] = _mm256_shuffle_ps(high01, high23, _MM_SHUFFLE(3, 2, 3, 2));
+
+		for (int object = 0; object < 4; object++)
+		{
+			_mm_storeu_ps(pFirst + object * 16, _mm256_castps256_ps128(columns[object]));
+			_mm_storeu_ps(pFirst + (object + 4) * 16, _mm256_extractf128_ps(columns[object], 1));
+		}
+	}
+
+	/***********************************************************
+	 *  ComposeAVX2()
+	 *
+	 *  This function is used for composing the matrices of 8
+	 *  objects at a time.  Everything it calls is compiled for
+	 *  AVX2 as well, since mixing in SSE code would cost a
+	 *  state transition on every call.
+	 ***********************************************************/
+	BATCH_TRANSFORMS_AVX2_TARGET void ComposeAVX2(const BatchTransforms::TRANSFORM_ARRAYS& t, int count, glm::mat4* pModels, glm::mat3* pNormals)
+	{
+		int i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 sx, cx, sy, cy, sz, cz;
+			SinCosDegrees8(_mm256_loadu_ps(t.rotationX + i), sx, cx);
+			SinCosDegrees8(_mm256_loadu_ps(t.rotationY + i), sy, cy);
+			SinCosDegrees8(_mm256_loadu_ps(t.rotationZ + i), sz, cz);
+
+			__m256 czsy = _mm256_mul_ps(cz, sy);
+			__m256 szsy = _mm256_mul_ps(sz, sy);
+			__m256 r[9];
+			r[0] = _mm256_mul_ps(cz, cy);
+			r[1] = _mm256_mul_ps(sz, cy);
+			r[2] = _mm256_sub_ps(_mm256_setzero_ps(), sy);
+			r[3] = _mm256_sub_ps(_mm256_mul_ps(czsy, sx), _mm256_mul_ps(sz, cx));
+			r[4] = _mm256_add_ps(_mm256_mul_ps(szsy, sx), _mm256_mul_ps(cz, cx));
+			r[5] = _mm256_mul_ps(cy, sx);
+			r[6] = _mm256_add_ps(_mm256_mul_ps(czsy, cx), _mm256_mul_ps(sz, sx));
+			r[7] = _mm256_sub_ps(_mm256_mul_ps(szsy, cx), _mm256_mul_ps(cz, sx));
+			r[8] = _mm256_mul_ps(cy, cx);
+
+			__m256 scale[3] = { _mm256_loadu_ps(t.scaleX + i), _mm256_loadu_ps(t.scaleY + i), _mm256_loadu_ps(t.scaleZ + i) };
+			__m256 zero = _mm256_setzero_ps();
+			float* pFirst = &pModels[i][0][0];
+
+			StoreColumns8(pFirst, _mm256_mul_ps(r[0], scale[0]), _mm256_mul_ps(r[1], scale[0]), _mm256_mul_ps(r[2], scale[0]), zero);
+			StoreColumns8(pFirst + 4, _mm256_mul_ps(r[3], scale[1]), _mm256_mul_ps(r[4], scale[1]), _mm256_mul_ps(r[5], scale[1]), zero);
+			StoreColumns8(pFirst + 8, _mm256_mul_ps(r[6], scale[2]), _mm256_mul_ps(r[7], scale[2]), _mm256_mul_ps(r[8], scale[2]), zero);
+			StoreColumns8(pFirst + 12, _mm256_loadu_ps(t.positionX + i), _mm256_loadu_ps(t.positionY + i), _mm256_loadu_ps(t.positionZ + i), _mm256_set1_ps(1.0f));
+
+			if (NULL != pNormals)
+			{
+				// written from a table, like StoreModels4()
+				float* pNormal = &pNormals[i][0][0];
+				float values[9][8];
+				for (int element = 0; element < 9; element++)
+				{
+					_mm256_storeu_ps(values[element], _mm256_div_ps(r[element], scale[element / 3]));
+				}
+				for (int object = 0; object < 8; object++)
+				{
+					for (int element = 0; element < 9; element++)
+					{
+						pNormal[object * 9 + element] = values[element][object];
+					}
+				}
+			}
+		}
+		ComposeScalar(t, i, count, pModels, pNormals);
+	}
+
+	/***********************************************************
+	 *  HasAVX2()
+	 *
+	 *  This function is used for checking whether the CPU has
+	 *  AVX2 and the operating system saves the AVX registers.
+	 ***********************************************************/
+	bool HasAVX2()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return(false);
+		}
+		// OSXSAVE and AVX, then the YMM state enabled by the system
+		__cpuid(info, 1);
+		if (((info[2] & (1 << 27)) == 0) || ((info[2] & (1 << 28)) == 0))
+		{
+			return(false);
+		}
+		if ((_xgetbv(0) & 0x6) != 0x6)
+		{
+			return(false);
+		}
+		__cpuidex(info, 7, 0);
+		return((info[1] & (1 << 5)) != 0);
+#else
+		// also checks that the system saves the AVX registers
+		return(__builtin_cpu_supports("avx2") != 0);
+#endif
+	}
+#endif
+
+#if defined(BATCH_TRANSFORMS_NEON)
+	/***********************************************************
+	 *  SinCosDegreesNEON()
+	 *
+	 *  This function is used for computing the sines and
+	 *  cosines of 4 angles, the same way as SinCosDegrees().
+	 ***********************************************************/
+	inline void SinCosDegreesNEON(float32x4_t degrees, float32x4_t& sine, float32x4_t& cosine)
+	{
+		int32x4_t quadrant = vcvtnq_s32_f32(vmulq_n_f32(degrees, g_InverseQuarterTurn));
+		float32x4_t r = vsubq_f32(degrees, vmulq_n_f32(vcvtq_f32_s32(quadrant), g_QuarterTurn));
+		r = vmulq_n_f32(r, g_DegreesToRadians);
+		float32x4_t r2 = vmulq_f32(r, r);
+
+		float32x4_t sinR = vaddq_f32(vdupq_n_f32(g_Sin2), vmulq_n_f32(r2, g_Sin3));
+		sinR = vaddq_f32(vdupq_n_f32(g_Sin1), vmulq_f32(r2, sinR));
+		sinR = vaddq_f32(r, vmulq_f32(vmulq_f32(r, r2), sinR));
+		float32x4_t cosR = vaddq_f32(vdupq_n_f32(g_Cos2), vmulq_n_f32(r2, g_Cos3));
+		cosR = vaddq_f32(vdupq_n_f32(g_Cos1), vmulq_f32(r2, cosR));
+		cosR = vaddq_f32(vsubq_f32(vdupq_n_f32(1.0f), vmulq_n_f32(r2, 0.5f)), vmulq_f32(vmulq_f32(r2, r2), cosR));
+
+		uint32x4_t swap = vtstq_s32(quadrant, vdupq_n_s32(1));
+		float32x4_t sinSwapped = vbslq_f32(swap, cosR, sinR);
+		float32x4_t cosSwapped = vbslq_f32(swap, sinR, cosR);
+
+		uint32x4_t sinSign = vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(quadrant), vdupq_n_u32(2)), 30);
+		uint32x4_t cosSign = vshlq_n_u32(vandq_u32(vreinterpretq_u32_s32(vaddq_s32(quadrant, vdupq_n_s32(1))), vdupq_n_u32(2)), 30);
+		sine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(sinSwapped), sinSign));
+		cosine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(cosSwapped), cosSign));
+	}
+
+	/***********************************************************
+	 *  StoreColumnsNEON()
+	 *
+	 *  This function is used for writing one column of the
+	 *  model matrices of 4 objects, like StoreColumns4().
+	 ***********************************************************/
+	inline void StoreColumnsNEON(float* pFirst, float32x4_t row0, float32x4_t row1, float32x4_t row2, float32x4_t row3)
+	{
+		float32x4x2_t low = vzipq_f32(row0, row2);
+		float32x4x2_t high = vzipq_f32(row1, row3);
+		float32x4x2_t first = vzipq_f32(low.val[0], high.val[0]);
+		float32x4x2_t second = vzipq_f32(low.val[1], high.val[1]);
+
+		vst1q_f32(pFirst, first.val[0]);
+		vst1q_f32(pFirst + 16, first.val[1]);
+		vst1q_f32(pFirst + 32, second.val[0]);
+		vst1q_f32(pFirst + 48, second.val[1]);
+	}
+
+	/***********************************************************
+	 *  ComposeNEON()
+	 *
+	 *  This function is used for composing the matrices of 4
+	 *  objects at a time.
+	 ***********************************************************/
+	void ComposeNEON(const BatchTransforms::TRANSFORM_ARRAYS& t, int count, glm::mat4* pModels, glm::mat3* pNormals)
+	{
+		int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			float32x4_t sx, cx, sy, cy, sz, cz;
+			SinCosDegreesNEON(vld1q_f32(t.rotationX + i), sx, cx);
+			SinCosDegreesNEON(vld1q_f32(t.rotationY + i), sy, cy);
+			SinCosDegreesNEON(vld1q_f32(t.rotationZ + i), sz, cz);
+
+			float32x4_t czsy = vmulq_f32(cz, sy);
+			float32x4_t szsy = vmulq_f32(sz, sy);
+			float32x4_t r[9];
+			r[0] = vmulq_f32(cz, cy);
+			r[1] = vmulq_f32(sz, cy);
+			r[2] = vnegq_f32(sy);
+			r[3] = vsubq_f32(vmulq_f32(czsy, sx), vmulq_f32(sz, cx));
+			r[4] = vaddq_f32(vmulq_f32(szsy, sx), vmulq_f32(cz, cx));
+			r[5] = vmulq_f32(cy, sx);
+			r[6] = vaddq_f32(vmulq_f32(czsy, cx), vmulq_f32(sz, sx));
+			r[7] = vsubq_f32(vmulq_f32(szsy, cx), vmulq_f32(cz, sx));
+			r[8] = vmulq_f32(cy, cx);
+
+			float32x4_t scale[3] = { vld1q_f32(t.scaleX + i), vld1q_f32(t.scaleY + i), vld1q_f32(t.scaleZ + i) };
+			float32x4_t zero = vdupq_n_f32(0.0f);
+			float* pFirst = &pModels[i][0][0];
+
+			StoreColumnsNEON(pFirst, vmulq_f32(r[0], scale[0]), vmulq_f32(r[1], scale[0]), vmulq_f32(r[2], scale[0]), zero);
+			StoreColumnsNEON(pFirst + 4, vmulq_f32(r[3], scale[1]), vmulq_f32(r[4], scale[1]), vmulq_f32(r[5], scale[1]), zero);
+			StoreColumnsNEON(pFirst + 8, vmulq_f32(r[6], scale[2]), vmulq_f32(r[7], scale[2]), vmulq_f32(r[8], scale[2]), zero);
+			StoreColumnsNEON(pFirst + 12, vld1q_f32(t.positionX + i), vld1q_f32(t.positionY + i), vld1q_f32(t.positionZ + i), vdupq_n_f32(1.0f));
+
+			if (NULL != pNormals)
+			{
+				// written from a table, like StoreModels4()
+				float* pNormal = &pNormals[i][0][0];
+				float values[9][4];
+				for (int element = 0; element < 9; element++)
+				{
+					vst1q_f32(values[element], vdivq_f32(r[element], scale[element / 3]));
+				}
+				for (int object = 0; object < 4; object++)
+				{
+					for (int element = 0; element < 9; element++)
+					{
+						pNormal[object * 9 + element] = values[element][object];
+					}
+				}
+			}
+		}
+		ComposeScalar(t, i, count, pModels, pNormals);
+	}
+#endif
+}
+
+/***********************************************************
+ *  IsKernelSupported()
+ *
+ *  This method is used for checking whether a kernel was
+ *  compiled into this build and can run on this CPU.
+ ***********************************************************/
+bool BatchTransforms::IsKernelSupported(KERNEL kernel)
+{
+	switch (kernel)
+	{
+	case KERNEL_SCALAR:
+		return(true);
+#if defined(BATCH_TRANSFORMS_SSE2)
+	case KERNEL_SSE2:
+		return(true);
+#endif
+#if defined(BATCH_TRANSFORMS_AVX2)
+	case KERNEL_AVX2:
+		return(HasAVX2());
+#endif
+#if defined(BATCH_TRANSFORMS_NEON)
+	case KERNEL_NEON:
+		return(true);
+#endif
+	default:
+		return(false);
+	}
+}
+
+/***********************************************************
+ *  GetBestKernel()
+ *
+ *  This method is used for choosing the widest kernel that
+ *  runs on this CPU.  The CPU is only asked once.
+ ***********************************************************/
+BatchTransforms::KERNEL BatchTransforms::GetBestKernel()
+{
+	static const KERNEL bestKernel =
+		(IsKernelSupported(KERNEL_AVX2) == true) ? KERNEL_AVX2 :
+		(IsKernelSupported(KERNEL_NEON) == true) ? KERNEL_NEON :
+		(IsKernelSupported(KERNEL_SSE2) == true) ? KERNEL_SSE2 :
+		KERNEL_SCALAR;
+
+	return(bestKernel);
+}
+
+/***********************************************************
+ *  GetKernelName()
+ *
+ *  This method is used for getting the name of a kernel for
+ *  reports.
+ ***********************************************************/
+const char* BatchTransforms::GetKernelName(KERNEL kernel)
+{
+	if ((kernel < 0) || (kernel >= KERNEL_COUNT))
+	{
+		return("unknown");
+	}
+
+	return(g_KernelNames[kernel]);
+}
+
+/***********************************************************
+ *  Compose()
+ *
+ *  This method is used for composing the matrices with the
+ *  best kernel of this CPU.
+ ***********************************************************/
+void BatchTransforms::Compose(const TRANSFORM_ARRAYS& transforms, int count, glm::mat4* pModels, glm::mat3* pNormals)
+{
+	Compose(GetBestKernel(), transforms, count, pModels, pNormals);
+}
+
+/***********************************************************
+ *  Compose()
+ *
+ *  This method is used for composing the matrices with the
+ *  passed in kernel, falling back to the scalar kernel when
+ *  the passed in one is not in this build.
+ ***********************************************************/
+void BatchTransforms::Compose(KERNEL kernel, const TRANSFORM_ARRAYS& transforms, int count, glm::mat4* pModels, glm::mat3* pNormals)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	switch (kernel)
+	{
+#if defined(BATCH_TRANSFORMS_SSE2)
+	case KERNEL_SSE2:
+		ComposeSSE2(transforms, count, pModels, pNormals);
+		break;
+#endif
+#if defined(BATCH_TRANSFORMS_AVX2)
+	case KERNEL_AVX2:
+		ComposeAVX2(transforms, count, pModels, pNormals);
+		break;
+#endif
+#if defined(BATCH_TRANSFORMS_NEON)
+	case KERNEL_NEON:
+		ComposeNEON(transforms, count, pModels, pNormals);
+		break;
+#endif
+	default:
+		ComposeScalar(transforms, 0, count, pModels, pNormals);
+		break;
+	}
+}
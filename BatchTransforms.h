@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchtransforms.h
+// ============
+// compose the model and normal matrices of many objects at once from their
+// scale, rotation and position values, with SIMD kernels where available
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  BatchTransforms
+ *
+ *  The model matrix translation * rotationZ * rotationY *
+ *  rotationX * scale is written out directly: the sines and
+ *  cosines of the three angles give the rotation, whose
+ *  columns are multiplied by the scale, with the position as
+ *  the last column.  The normal matrix is the rotation with
+ *  its columns divided by the scale instead, which is the
+ *  inverse transpose without inverting anything.
+ *
+ *  The inputs are separate arrays per value, so a kernel
+ *  loads the values of 4 or 8 objects with one load each.
+ *  Every kernel computes the sines and cosines with the same
+ *  polynomial after reducing the angles by quarter turns in
+ *  degrees, so the kernels agree with each other and stay
+ *  within float rounding of the glm composition, and angles
+ *  of whole quarter turns give exact zeros and ones.
+ ***********************************************************/
+class BatchTransforms
+{
+public:
+	// the transformation values of the objects, one array per value,
+	// the angles in degrees
+	struct TRANSFORM_ARRAYS
+	{
+		const float* scaleX;
+		const float* scaleY;
+		const float* scaleZ;
+		const float* rotationX;
+		const float* rotationY;
+		const float* rotationZ;
+		const float* positionX;
+		const float* positionY;
+		const float* positionZ;
+	};
+
+	// the instruction sets the matrices can be composed with
+	enum KERNEL
+	{
+		KERNEL_SCALAR = 0,
+		KERNEL_SSE2,		// 4 objects at once
+		KERNEL_AVX2,		// 8 objects at once
+		KERNEL_NEON,		// 4 objects at once
+		KERNEL_COUNT
+	};
+
+	// check whether this build and CPU can run a kernel
+	static bool IsKernelSupported(KERNEL kernel);
+	// the fastest kernel this build and CPU can run
+	static KERNEL GetBestKernel();
+	static const char* GetKernelName(KERNEL kernel);
+
+	// compose the model matrices of the passed in number of objects,
+	// and their normal matrices when an array for them is passed in.
+	// The scales must not be 0 when the normal matrices are written
+	static void Compose(const TRANSFORM_ARRAYS& transforms, int count, glm::mat4* pModels, glm::mat3* pNormals = NULL);
+	// the same with a chosen kernel, which has to be supported
+	static void Compose(KERNEL kernel, const TRANSFORM_ARRAYS& transforms, int count, glm::mat4* pModels, glm::mat3* pNormals = NULL);
+};
@@ -0,0 +1,511 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.cpp
+// ============
+// render a generated scene along a fixed camera path into an offscreen
+// framebuffer and report the frame time statistics
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Benchmark.h"
+#include "BatchTransforms.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	const int g_DefaultFrameCount = 600;
+	const int g_DefaultWarmupFrames = 60;
+
+	// object counts of the transform benchmark, each is composed
+	// often enough to add up to about the same number of matrices
+	const int g_TransformObjectCounts[] = { 1000, 10000, 100000, 1000000 };
+	const int g_TransformMatricesPerCount = 4000000;
+}
+
+/***********************************************************
+ *  Benchmark()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+Benchmark::Benchmark(const BENCHMARK_SETTINGS& settings)
+{
+	m_settings = settings;
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  ~Benchmark()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+Benchmark::~Benchmark()
+{
+	if (0 != m_framebuffer)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+	}
+}
+
+/***********************************************************
+ *  ParseArguments()
+ *
+ *  This method is used for reading the benchmark options from
+ *  the command line.  The benchmark only runs when an object
+ *  count is passed with --benchmark.
+ ***********************************************************/
+bool Benchmark::ParseArguments(int argc, char* argv[], BENCHMARK_SETTINGS& settings)
+{
+	bool bBenchmark = false;
+	bool bShadowsValid = true;
+	bool bVertexFormatValid = true;
+
+	settings.objectCount = 0;
+	settings.lightCount = 0;
+	settings.frameCount = g_DefaultFrameCount;
+	settings.warmupFrames = g_DefaultWarmupFrames;
+	settings.captureDirectory.clear();
+	settings.captureInterval = 1;
+	settings.bFrustumCulling = true;
+	settings.bOcclusionCulling = true;
+	settings.shadowQuality = ShadowMaps::FILTER_MEDIUM;
+	settings.bDepthPrepass = false;
+	settings.textureBudget = 0;
+	settings.anisotropy = TextureSamplers::DEFAULT_ANISOTROPY;
+	settings.vertexFormat = InstancedMeshes::VERTEX_COMPACT;
+
+	for (int i = 1; i < argc; i++)
+	{
+		// options without a value
+		if (strcmp(argv[i], "--no-culling") == 0)
+		{
+			settings.bFrustumCulling = false;
+			continue;
+		}
+		if (strcmp(argv[i], "--no-occlusion") == 0)
+		{
+			settings.bOcclusionCulling = false;
+			continue;
+		}
+		if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			settings.bDepthPrepass = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			break;
+		}
+
+		if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			settings.objectCount = atoi(argv[++i]);
+			bBenchmark = true;
+		}
+		else if (strcmp(argv[i], "--lights") == 0)
+		{
+			settings.lightCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--shadows") == 0)
+		{
+			bShadowsValid = ShadowMaps::ParseFilterQuality(argv[++i], settings.shadowQuality);
+		}
+		else if (strcmp(argv[i], "--texture-budget") == 0)
+		{
+			settings.textureBudget = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--anisotropy") == 0)
+		{
+			settings.anisotropy = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--vertex-format") == 0)
+		{
+			bVertexFormatValid = InstancedMeshes::ParseVertexFormat(argv[++i], settings.vertexFormat);
+		}
+		else if (strcmp(argv[i], "--frames") == 0)
+		{
+			settings.frameCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--capture") == 0)
+		{
+			settings.captureDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--capture-every") == 0)
+		{
+			settings.captureInterval = atoi(argv[++i]);
+		}
+	}
+
+	if ((bBenchmark == true) &&
+		((settings.objectCount <= 0) || (settings.frameCount <= 0) || (settings.captureInterval <= 0) || (settings.lightCount < 0) || (settings.textureBudget < 0) ||
+		 (settings.anisotropy <= 0) || (bShadowsValid == false) || (bVertexFormatValid == false)))
+	{
+		std::cout << "Usage: --benchmark <objects> [--frames <count>] [--capture <directory>] [--capture-every <n>] [--no-culling] [--no-occlusion] [--lights <count>] [--shadows <off|hard|low|medium|high>] [--depth-prepass] [--texture-budget <mb>] [--anisotropy <n>] [--vertex-format <full|compact>]" << std::endl;
+		return(false);
+	}
+
+	return(bBenchmark);
+}
+
+/***********************************************************
+ *  IsTransformBenchmark()
+ *
+ *  This method is used for checking the command line for the
+ *  transform benchmark, which runs before any window is made.
+ ***********************************************************/
+bool Benchmark::IsTransformBenchmark(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--transform-benchmark") == 0)
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RunTransformBenchmark()
+ *
+ *  This method is used for timing the batch transform kernels
+ *  against composing the matrices one object at a time with
+ *  glm, the way the scene graph did before.  Every count is
+ *  timed with and without the normal matrices, the fastest
+ *  repeat is reported, and the largest difference from the
+ *  glm matrices shows the kernels compute the same values.
+ ***********************************************************/
+void Benchmark::RunTransformBenchmark()
+{
+	std::cout << "Transform benchmark, best kernel " << BatchTransforms::GetKernelName(BatchTransforms::GetBestKernel()) << std::endl;
+
+	for (int countIndex = 0; countIndex < (int)(sizeof(g_TransformObjectCounts) / sizeof(g_TransformObjectCounts[0])); countIndex++)
+	{
+		int count = g_TransformObjectCounts[countIndex];
+		int repeats = std::max(1, g_TransformMatricesPerCount / count);
+
+		// the same values on every run, with scales that are never 0
+		std::mt19937 generator(12345);
+		std::uniform_real_distribution<float> scaleValues(0.25f, 4.0f);
+		std::uniform_real_distribution<float> angleValues(-360.0f, 360.0f);
+		std::uniform_real_distribution<float> positionValues(-500.0f, 500.0f);
+
+		std::vector<float> values[9];
+		for (int value = 0; value < 9; value++)
+		{
+			values[value].resize(count);
+		}
+		for (int i = 0; i < count; i++)
+		{
+			for (int value = 0; value < 3; value++)
+			{
+				values[value][i] = scaleValues(generator);
+				values[value + 3][i] = angleValues(generator);
+				values[value + 6][i] = positionValues(generator);
+			}
+		}
+
+		BatchTransforms::TRANSFORM_ARRAYS transforms;
+		transforms.scaleX = values[0].data();
+		transforms.scaleY = values[1].data();
+		transforms.scaleZ = values[2].data();
+		transforms.rotationX = values[3].data();
+		transforms.rotationY = values[4].data();
+		transforms.rotationZ = values[5].data();
+		transforms.positionX = values[6].data();
+		transforms.positionY = values[7].data();
+		transforms.positionZ = values[8].data();
+
+		std::vector<glm::mat4> glmModels(count);
+		std::vector<glm::mat3> glmNormals(count);
+		std::vector<glm::mat4> models(count);
+		std::vector<glm::mat3> normals(count);
+
+		std::cout << count << " objects, " << repeats << " repeats" << std::endl;
+
+		for (int pass = 0; pass < 2; pass++)
+		{
+			bool bNormals = (pass == 1);
+
+			// nanoseconds per object of the fastest repeat of a compose
+			auto timeCompose = [repeats, count](const std::function<void()>& compose)
+			{
+				double best = 0.0;
+				for (int repeat = 0; repeat < repeats; repeat++)
+				{
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					compose();
+					double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+					if ((repeat == 0) || (elapsed < best))
+					{
+						best = elapsed;
+					}
+				}
+				return(best / (double)count);
+			};
+
+			double glmTime = timeCompose([&]()
+			{
+				for (int i = 0; i < count; i++)
+				{
+					glmModels[i] = SceneGraph::ComposeModelMatrix(
+						glm::vec3(values[0][i], values[1][i], values[2][i]),
+						values[3][i],
+						values[4][i],
+						values[5][i],
+						glm::vec3(values[6][i], values[7][i], values[8][i]));
+					if (bNormals == true)
+					{
+						glmNormals[i] = glm::transpose(glm::inverse(glm::mat3(glmModels[i])));
+					}
+				}
+			});
+
+			const char* passName = (bNormals == true) ? "model+normal" : "model";
+			printf("  %-12s %-6s %8.2f ns per object\n", passName, "glm", glmTime);
+
+			for (int kernelIndex = 0; kernelIndex < BatchTransforms::KERNEL_COUNT; kernelIndex++)
+			{
+				BatchTransforms::KERNEL kernel = (BatchTransforms::KERNEL)kernelIndex;
+				if (BatchTransforms::IsKernelSupported(kernel) == false)
+				{
+					continue;
+				}
+
+				double kernelTime = timeCompose([&]()
+				{
+					BatchTransforms::Compose(kernel, transforms, count, models.data(), (bNormals == true) ? normals.data() : NULL);
+				});
+
+				float maxError = 0.0f;
+				for (int i = 0; i < count; i++)
+				{
+					for (int column = 0; column < 4; column++)
+					{
+						for (int row = 0; row < 4; row++)
+						{
+							maxError = std::max(maxError, std::fabs(models[i][column][row] - glmModels[i][column][row]));
+						}
+					}
+					for (int column = 0; (bNormals == true) && (column < 3); column++)
+					{
+						for (int row = 0; row < 3; row++)
+						{
+							maxError = std::max(maxError, std::fabs(normals[i][column][row] - glmNormals[i][column][row]));
+						}
+					}
+				}
+
+				printf("  %-12s %-6s %8.2f ns per object, %5.2fx, max error %g\n",
+					passName, BatchTransforms::GetKernelName(kernel), kernelTime, glmTime / kernelTime, maxError);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateFramebuffer()
+ *
+ *  This method is used for creating the framebuffer object
+ *  that the frames are drawn into, with a color and a depth
+ *  renderbuffer.
+ ***********************************************************/
+bool Benchmark::CreateFramebuffer(int width, int height)
+{
+	m_width = width;
+	m_height = height;
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Could not create the benchmark framebuffer" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method is used for writing the color buffer of the
+ *  framebuffer to a binary PPM image in the capture folder.
+ ***********************************************************/
+bool Benchmark::CaptureFrame(int frame) const
+{
+	std::vector<unsigned char> pixels((size_t)m_width * m_height * 3);
+	char filename[32];
+
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	snprintf(filename, sizeof(filename), "frame_%05d.ppm", frame);
+	std::string path = m_settings.captureDirectory + "/" + filename;
+	std::ofstream imageFile(path.c_str(), std::ios::binary | std::ios::trunc);
+	if (!imageFile)
+	{
+		std::cout << "Could not write frame " << path << std::endl;
+		return(false);
+	}
+
+	// the rows are read bottom up, PPM stores them top down
+	imageFile << "P6\n" << m_width << " " << m_height << "\n255\n";
+	for (int row = m_height - 1; row >= 0; row--)
+	{
+		imageFile.write((const char*)&pixels[(size_t)row * m_width * 3], (std::streamsize)m_width * 3);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for drawing the benchmark frames.  The
+ *  camera circles the grid once over the timed frames, and
+ *  each frame waits for the GPU so the frame time includes
+ *  the GPU work.  The frame time percentiles are printed and
+ *  the timings are written to benchmark_<objects>.csv.
+ ***********************************************************/
+bool Benchmark::Run(GLFWwindow* window, ViewManager* pViewManager, SceneManager* pSceneManager)
+{
+	int width = 0;
+	int height = 0;
+
+	glfwGetFramebufferSize(window, &width, &height);
+	if (CreateFramebuffer(width, height) == false)
+	{
+		return(false);
+	}
+
+	// start from the same state on every run
+	float halfSize = pSceneManager->BuildBenchmarkScene(m_settings.objectCount, m_settings.lightCount);
+	while (pSceneManager->AreTexturesLoaded() == false)
+	{
+		pSceneManager->ProcessLoadedTextures();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	pViewManager->SetFarPlane(4.0f * halfSize + 20.0f);
+	pSceneManager->SetFrustumCulling(m_settings.bFrustumCulling);
+	pSceneManager->SetOcclusionCulling(m_settings.bOcclusionCulling);
+	pSceneManager->SetShadowQuality(m_settings.shadowQuality);
+	pSceneManager->SetDepthPrepass(m_settings.bDepthPrepass);
+	if (m_settings.textureBudget > 0)
+	{
+		pSceneManager->SetTextureBudget(m_settings.textureBudget);
+	}
+	pSceneManager->SetAnisotropy(m_settings.anisotropy);
+	pSceneManager->SetVertexFormat(m_settings.vertexFormat);
+
+	std::cout << "Benchmark: " << m_settings.objectCount << " objects, " << m_settings.lightCount << " lights, " << m_settings.frameCount << " frames at " << width << "x" << height << std::endl;
+	// runs with each --vertex-format compare the draw times of the layouts
+	pSceneManager->PrintMeshMemory();
+
+	FrameProfiler* pProfiler = NULL;
+	int viewSection = -1;
+	int finishSection = -1;
+	int totalFrames = m_settings.warmupFrames + m_settings.frameCount;
+
+	for (int frame = 0; frame < totalFrames; frame++)
+	{
+		int timedFrame = frame - m_settings.warmupFrames;
+
+		// the warmup frames fill the caches before the timing starts
+		if (timedFrame == 0)
+		{
+			pProfiler = new FrameProfiler(m_settings.frameCount);
+			viewSection = pProfiler->AddSection("view");
+			pSceneManager->SetFrameProfiler(pProfiler);
+			finishSection = pProfiler->AddSection("finish");
+		}
+
+		// orbit the center of the grid, looking slightly down
+		float angle = glm::radians(360.0f * (float)timedFrame / (float)m_settings.frameCount);
+		glm::vec3 position = glm::vec3(
+			glm::cos(angle) * (halfSize + 5.0f),
+			0.5f * halfSize + 3.0f,
+			glm::sin(angle) * (halfSize + 5.0f));
+		pViewManager->SetCameraPose(position, glm::vec3(0.0f, 0.0f, 0.0f));
+
+		if (NULL != pProfiler)
+		{
+			pProfiler->BeginFrame();
+		}
+		pSceneManager->BeginFrame();
+
+		glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+		glViewport(0, 0, m_width, m_height);
+		glEnable(GL_DEPTH_TEST);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		{
+			FrameProfiler::ScopedSection section(pProfiler, viewSection);
+			pViewManager->PrepareSceneView();
+		}
+
+		pSceneManager->RenderScene();
+		pSceneManager->EndFrame();
+
+		{
+			FrameProfiler::ScopedSection section(pProfiler, finishSection);
+			glFinish();
+		}
+		if (NULL != pProfiler)
+		{
+			pProfiler->EndFrame(pSceneManager->GetRenderCounters());
+		}
+
+		if ((timedFrame >= 0) && (m_settings.captureDirectory.empty() == false) &&
+			((timedFrame % m_settings.captureInterval) == 0))
+		{
+			CaptureFrame(timedFrame);
+		}
+
+		glfwPollEvents();
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	std::string csvName = "benchmark_" + std::to_string(m_settings.objectCount) + ".csv";
+	pProfiler->PrintStats();
+	pProfiler->WriteCSV(csvName.c_str());
+	pSceneManager->PrintTextureResidency();
+
+	pSceneManager->SetFrameProfiler(NULL);
+	delete pProfiler;
+
+	return(true);
+}
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////
+// benchmark.h
+// ============
+// render a generated scene along a fixed camera path into an offscreen
+// framebuffer and report the frame time statistics
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "FrameProfiler.h"
+
+#include <string>
+
+/***********************************************************
+ *  Benchmark
+ *
+ *  The benchmark replaces the scene with a grid of generated
+ *  objects, waits for every texture to be resident, and then
+ *  draws a fixed number of frames while the camera orbits the
+ *  grid.  Every frame is drawn the same way on every run, so
+ *  the reported timings can be compared between builds.
+ *
+ *  Command line:
+ *    --benchmark <objects>   run with 1000, 10000, 100000, ... objects
+ *    --frames <count>        frames to time, 600 by default
+ *    --capture <directory>   write the frames as PPM images
+ *    --capture-every <n>     only write every n-th frame
+ *    --no-culling            draw the objects outside the view too
+ *    --no-occlusion          draw the instances hidden behind nearer
+ *                            objects too
+ *    --lights <count>        add point lights spread over the grid
+ *    --shadows <quality>     off, hard, low, medium or high shadow
+ *                            filtering, medium by default
+ *    --depth-prepass         draw the depth of the opaque objects
+ *                            before shading them
+ *    --texture-budget <mb>   video memory the textures may use
+ *    --anisotropy <n>        anisotropic filtering of the textures,
+ *                            1, 2, 4, 8 or 16, 4 by default
+ *    --vertex-format <name>  full or compact vertices of the
+ *                            instanced meshes, compact by default
+ *    --transform-benchmark   time the batch transform kernels
+ *                            against the glm matrices without
+ *                            a window, then exit
+ ***********************************************************/
+class Benchmark
+{
+public:
+	struct BENCHMARK_SETTINGS
+	{
+		int objectCount;
+		// generated point lights, binned into the light clusters
+		int lightCount;
+		int frameCount;
+		// frames drawn before the timing starts
+		int warmupFrames;
+		// empty when the frames are not written to disk
+		std::string captureDirectory;
+		int captureInterval;
+		bool bFrustumCulling;
+		bool bOcclusionCulling;
+		ShadowMaps::FILTER_QUALITY shadowQuality;
+		bool bDepthPrepass;
+		// megabytes, 0 keeps the default budget
+		int textureBudget;
+		int anisotropy;
+		InstancedMeshes::VERTEX_FORMAT vertexFormat;
+	};
+
+	// constructor
+	Benchmark(const BENCHMARK_SETTINGS& settings);
+	// destructor
+	~Benchmark();
+
+	// read the benchmark settings from the command line, false is
+	// returned when the application should run interactively
+	static bool ParseArguments(int argc, char* argv[], BENCHMARK_SETTINGS& settings);
+	// check whether the transform benchmark was asked for
+	static bool IsTransformBenchmark(int argc, char* argv[]);
+
+	// compose the model and normal matrices of 1000 up to 1000000
+	// generated objects with glm and with every batch transform
+	// kernel this CPU runs, and report the time per object
+	static void RunTransformBenchmark();
+
+	// draw the timed frames, the window must be the current context
+	bool Run(GLFWwindow* window, ViewManager* pViewManager, SceneManager* pSceneManager);
+
+private:
+	BENCHMARK_SETTINGS m_settings;
+	// offscreen framebuffer the frames are drawn into
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	int m_width;
+	int m_height;
+
+	// create the offscreen framebuffer at the passed in size
+	bool CreateFramebuffer(int width, int height);
+	// write the color buffer of the framebuffer to an image file
+	bool CaptureFrame(int frame) const;
+};
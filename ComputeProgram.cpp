@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////////////////////////////
+// computeprogram.cpp
+// ============
+// compile a compute shader file and link it into a program of its own
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ComputeProgram.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for compiling the compute shader file
+ *  and linking it into a program.  0 is returned, with the
+ *  compiler log written out, when that fails.
+ ***********************************************************/
+GLuint ComputeProgram::Load(const char* filename)
+{
+	std::ifstream shaderFile(filename);
+	if (!shaderFile)
+	{
+		std::cout << "Could not open compute shader " << filename << std::endl;
+		return(0);
+	}
+	std::stringstream source;
+	source << shaderFile.rdbuf();
+	std::string sourceText = source.str();
+	const char* pSource = sourceText.c_str();
+
+	GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(shader, 1, &pSource, NULL);
+	glCompileShader(shader);
+
+	GLint status = GL_FALSE;
+	char log[1024];
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cout << "Could not compile compute shader " << filename << std::endl << log << std::endl;
+		glDeleteShader(shader);
+		return(0);
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, shader);
+	glLinkProgram(program);
+	glDeleteShader(shader);
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		std::cout << "Could not link compute shader " << filename << std::endl << log << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
@@ -0,0 +1,24 @@
+///////////////////////////////////////////////////////////////////////////////
+// computeprogram.h
+// ============
+// compile a compute shader file and link it into a program of its own
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  ComputeProgram
+ *
+ *  The compute passes each own one program made from a
+ *  single shader file.  Load() writes the compiler or linker
+ *  log out when the file does not build, and returns 0.
+ ***********************************************************/
+class ComputeProgram
+{
+public:
+	// build the program of the passed in compute shader file
+	static GLuint Load(const char* filename);
+};
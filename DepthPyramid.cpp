@@ -0,0 +1,277 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthpyramid.cpp
+// ============
+// hierarchical depth of the last frame, each level holding the farthest depth
+// of the texels under it, for testing boxes against what hid them
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DepthPyramid.h"
+#include "ComputeProgram.h"
+
+#include <algorithm>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// texels across and down reduced by one compute work group, must
+	// match local_size_x and local_size_y in the compute shader
+	const int g_WorkGroupSize = 8;
+
+	// image units declared in the compute shader
+	const GLuint g_SourceImage = 0;
+	const GLuint g_TargetImage = 1;
+}
+
+/***********************************************************
+ *  DepthPyramid()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DepthPyramid::DepthPyramid(int textureUnit)
+{
+	m_textureUnit = textureUnit;
+	m_program = 0;
+	m_copyDepthLocation = -1;
+	m_sourceSizeLocation = -1;
+	m_targetSizeLocation = -1;
+	m_depthTexture = 0;
+	m_framebuffer = 0;
+	m_pyramidTexture = 0;
+	m_width = 0;
+	m_height = 0;
+	m_levelCount = 0;
+	m_viewProjection = glm::mat4(1.0f);
+	m_bValid = false;
+}
+
+/***********************************************************
+ *  ~DepthPyramid()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DepthPyramid::~DepthPyramid()
+{
+	DestroyTargets();
+	if (0 != m_program)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the GL context
+ *  can run compute shaders, which came with image load and
+ *  store and immutable texture storage.
+ ***********************************************************/
+bool DepthPyramid::IsSupported()
+{
+	return(GLEW_VERSION_4_3 == GL_TRUE);
+}
+
+/***********************************************************
+ *  LoadShader()
+ *
+ *  This method is used for compiling the compute shader file
+ *  and linking it into a program.  False is returned, with
+ *  the compiler log written out, when that fails.
+ ***********************************************************/
+bool DepthPyramid::LoadShader(const char* filename)
+{
+	GLuint program = ComputeProgram::Load(filename);
+	if (0 == program)
+	{
+		return(false);
+	}
+
+	if (0 != m_program)
+	{
+		glDeleteProgram(m_program);
+	}
+	m_program = program;
+	m_copyDepthLocation = glGetUniformLocation(m_program, "bCopyDepth");
+	m_sourceSizeLocation = glGetUniformLocation(m_program, "sourceSize");
+	m_targetSizeLocation = glGetUniformLocation(m_program, "targetSize");
+
+	// the depth copy is always read from the unit of the pyramid
+	glUseProgram(m_program);
+	glUniform1i(glGetUniformLocation(m_program, "depthTexture"), m_textureUnit);
+	glUseProgram(0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for creating the depth texture the
+ *  scene depth is copied into, with a framebuffer to copy it
+ *  through, and the float texture with every level of the
+ *  pyramid down to a single texel.
+ ***********************************************************/
+bool DepthPyramid::CreateTargets(int width, int height)
+{
+	DestroyTargets();
+	m_width = width;
+	m_height = height;
+	m_levelCount = 1;
+	while ((std::max(width, height) >> m_levelCount) > 0)
+	{
+		m_levelCount++;
+	}
+
+	glGenTextures(1, &m_depthTexture);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenTextures(1, &m_pyramidTexture);
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_levelCount, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	GLint targetFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+	if (bComplete == false)
+	{
+		std::cout << "Could not create the depth pyramid framebuffer" << std::endl;
+		DestroyTargets();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTargets()
+ *
+ *  This method is used for freeing the textures and the
+ *  framebuffer of the pyramid.
+ ***********************************************************/
+void DepthPyramid::DestroyTargets()
+{
+	if (0 != m_framebuffer)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (0 != m_depthTexture)
+	{
+		glDeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+	}
+	if (0 != m_pyramidTexture)
+	{
+		glDeleteTextures(1, &m_pyramidTexture);
+		m_pyramidTexture = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+	m_levelCount = 0;
+	m_bValid = false;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the pyramid from the
+ *  depth drawn so far.  The targets follow the size of the
+ *  viewport.  The first level is copied from the depth
+ *  texture and every level after it is reduced from the one
+ *  before, with a barrier between them.
+ ***********************************************************/
+void DepthPyramid::Build(const glm::mat4& viewProjection)
+{
+	if (0 == m_program)
+	{
+		return;
+	}
+
+	GLint targetFramebuffer = 0;
+	GLint viewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int width = viewport[2];
+	int height = viewport[3];
+	if ((width <= 0) || (height <= 0))
+	{
+		m_bValid = false;
+		return;
+	}
+	if ((0 == m_framebuffer) || (width != m_width) || (height != m_height))
+	{
+		if (CreateTargets(width, height) == false)
+		{
+			return;
+		}
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, targetFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glBlitFramebuffer(
+		viewport[0], viewport[1], viewport[0] + width, viewport[1] + height,
+		0, 0, width, height,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+
+	glUseProgram(m_program);
+	glActiveTexture(GL_TEXTURE0 + m_textureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+
+	int sourceWidth = width;
+	int sourceHeight = height;
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		int targetWidth = (level == 0) ? width : std::max(sourceWidth / 2, 1);
+		int targetHeight = (level == 0) ? height : std::max(sourceHeight / 2, 1);
+
+		glUniform1i(m_copyDepthLocation, (level == 0) ? 1 : 0);
+		glUniform2i(m_sourceSizeLocation, sourceWidth, sourceHeight);
+		glUniform2i(m_targetSizeLocation, targetWidth, targetHeight);
+		if (level > 0)
+		{
+			glBindImageTexture(g_SourceImage, m_pyramidTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+		}
+		glBindImageTexture(g_TargetImage, m_pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		glDispatchCompute(
+			(targetWidth + g_WorkGroupSize - 1) / g_WorkGroupSize,
+			(targetHeight + g_WorkGroupSize - 1) / g_WorkGroupSize, 1);
+		// the next level reads the texels this level wrote
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+		sourceWidth = targetWidth;
+		sourceHeight = targetHeight;
+	}
+
+	// the culling shader fetches the levels through a sampler
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	m_viewProjection = viewProjection;
+	m_bValid = true;
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the pyramid texture to
+ *  its texture unit.
+ ***********************************************************/
+void DepthPyramid::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + m_textureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+}
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthpyramid.h
+// ============
+// hierarchical depth of the last frame, each level holding the farthest depth
+// of the texels under it, for testing boxes against what hid them
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  DepthPyramid
+ *
+ *  Build() copies the depth of the opaque draws out of the
+ *  framebuffer they were drawn into, and a compute shader
+ *  reduces it into the levels of a single channel float
+ *  texture, every texel keeping the farthest depth of the
+ *  2 x 2 texels below it.  A level of odd size folds its last
+ *  row or column into the last texel above it, so each texel
+ *  always covers every pixel under it.
+ *
+ *  A box is hidden when its nearest depth is farther than the
+ *  farthest depth of the few texels of the level its screen
+ *  rectangle spans.  The pyramid holds the depth of the frame
+ *  it was built in, so the boxes are projected with the view
+ *  projection of that frame.
+ *
+ *  The depth is copied with a blit, so the depth buffer of
+ *  the framebuffer the scene is drawn into must be 24 bit
+ *  depth with 8 bit stencil, as for the transparency pass.
+ ***********************************************************/
+class DepthPyramid
+{
+public:
+	// constructor, the pyramid is sampled from the passed in unit
+	DepthPyramid(int textureUnit);
+	// destructor
+	~DepthPyramid();
+
+	// check whether the GL context has compute shaders
+	static bool IsSupported();
+
+	// compile and link the reduction compute shader
+	bool LoadShader(const char* filename);
+
+	// build the pyramid from the depth of the viewport of the bound
+	// draw framebuffer, drawn with the passed in view projection.  The
+	// compute program is left in use
+	void Build(const glm::mat4& viewProjection);
+	// forget the built pyramid, until the next Build()
+	void Invalidate() { m_bValid = false; }
+	// true once a pyramid was built since the last Invalidate()
+	bool IsValid() const { return(m_bValid); }
+
+	// bind the pyramid texture to its unit
+	void Bind() const;
+	int GetTextureUnit() const { return(m_textureUnit); }
+	int GetLevelCount() const { return(m_levelCount); }
+	// view projection the depth of the pyramid was drawn with
+	const glm::mat4& GetViewProjection() const { return(m_viewProjection); }
+
+private:
+	int m_textureUnit;
+	GLuint m_program;
+	GLint m_copyDepthLocation;
+	GLint m_sourceSizeLocation;
+	GLint m_targetSizeLocation;
+	// the depth copied out of the scene framebuffer
+	GLuint m_depthTexture;
+	GLuint m_framebuffer;
+	// the reduced levels
+	GLuint m_pyramidTexture;
+	int m_width;
+	int m_height;
+	int m_levelCount;
+	glm::mat4 m_viewProjection;
+	bool m_bValid;
+
+	// create the depth copy and the pyramid for a viewport size
+	bool CreateTargets(int width, int height);
+	void DestroyTargets();
+};
@@ -0,0 +1,193 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.cpp
+// ============
+// choose how the frames are synchronized with the display and hold the
+// frame rate at a cap, waiting before the input of a frame is read
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// the sleep wakes up this much early and the rest is spun, since
+	// sleeps can overshoot by about a scheduler tick
+	const std::chrono::microseconds g_SpinTime(1000);
+	// seconds an idle frame waits for events at most, so changes that
+	// come without an event, such as decoded textures and edited
+	// shader files, are still picked up
+	const double g_IdleWaitTime = 0.1;
+}
+
+/***********************************************************
+ *  FramePacer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePacer::FramePacer(const PACING_SETTINGS& settings)
+{
+	m_settings = settings;
+	m_nextFrame = std::chrono::steady_clock::now();
+	m_framePeriod = std::chrono::steady_clock::duration::zero();
+	if (m_settings.frameCap > 0)
+	{
+		m_framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+			std::chrono::duration<double>(1.0 / (double)m_settings.frameCap));
+	}
+}
+
+/***********************************************************
+ *  ParseArguments()
+ *
+ *  This method is used for reading the pacing options from
+ *  the command line.
+ ***********************************************************/
+bool FramePacer::ParseArguments(int argc, char* argv[], PACING_SETTINGS& settings)
+{
+	bool bValid = true;
+
+	settings.syncMode = SYNC_ON;
+	settings.frameCap = 0;
+	settings.bOnDemand = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		// options without a value
+		if (strcmp(argv[i], "--on-demand") == 0)
+		{
+			settings.bOnDemand = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			break;
+		}
+
+		if (strcmp(argv[i], "--vsync") == 0)
+		{
+			bValid = (ParseSyncMode(argv[++i], settings.syncMode) == true) && (bValid == true);
+		}
+		else if (strcmp(argv[i], "--frame-cap") == 0)
+		{
+			settings.frameCap = atoi(argv[++i]);
+		}
+	}
+
+	if ((bValid == false) || (settings.frameCap < 0))
+	{
+		std::cout << "Usage: [--vsync <off|on|adaptive>] [--frame-cap <fps>] [--on-demand]" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ParseSyncMode()
+ *
+ *  This method is used for finding the sync mode with the
+ *  passed in name.
+ ***********************************************************/
+bool FramePacer::ParseSyncMode(const char* name, SYNC_MODE& mode)
+{
+	const char* names[SYNC_COUNT] = { "off", "on", "adaptive" };
+
+	for (int i = 0; i < SYNC_COUNT; i++)
+	{
+		if (strcmp(name, names[i]) == 0)
+		{
+			mode = (SYNC_MODE)i;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  Apply()
+ *
+ *  This method is used for setting the swap interval.  A
+ *  negative interval swaps late frames right away instead of
+ *  waiting a whole refresh, which needs the swap tear
+ *  extension, without it the frames wait for every refresh.
+ ***********************************************************/
+void FramePacer::Apply()
+{
+	int interval = 1;
+
+	switch (m_settings.syncMode)
+	{
+	case SYNC_OFF:
+		interval = 0;
+		break;
+	case SYNC_ADAPTIVE:
+		if ((glfwExtensionSupported("WGL_EXT_swap_control_tear") == GLFW_TRUE) ||
+			(glfwExtensionSupported("GLX_EXT_swap_control_tear") == GLFW_TRUE))
+		{
+			interval = -1;
+		}
+		else
+		{
+			std::cout << "Adaptive sync is not supported, waiting for every refresh" << std::endl;
+		}
+		break;
+	default:
+		break;
+	}
+
+	glfwSwapInterval(interval);
+	m_nextFrame = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  WaitForNextFrame()
+ *
+ *  This method is used for holding the frame rate at the cap.
+ *  A frame that starts late does not make the next ones start
+ *  early to catch up, the schedule starts over from it.
+ ***********************************************************/
+void FramePacer::WaitForNextFrame()
+{
+	if (m_settings.frameCap <= 0)
+	{
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (m_nextFrame - now > g_SpinTime)
+	{
+		std::this_thread::sleep_for(m_nextFrame - now - g_SpinTime);
+	}
+	while (std::chrono::steady_clock::now() < m_nextFrame)
+	{
+		std::this_thread::yield();
+	}
+
+	now = std::chrono::steady_clock::now();
+	m_nextFrame += m_framePeriod;
+	if (m_nextFrame < now)
+	{
+		m_nextFrame = now;
+	}
+}
+
+/***********************************************************
+ *  WaitForEvents()
+ *
+ *  This method is used for sleeping after a frame that was
+ *  not drawn, until an event arrives or the idle wait runs
+ *  out.  The frame cap schedule starts over from the next
+ *  frame drawn.
+ ***********************************************************/
+void FramePacer::WaitForEvents()
+{
+	glfwWaitEventsTimeout(g_IdleWaitTime);
+	m_nextFrame = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.h
+// ============
+// choose how the frames are synchronized with the display and hold the
+// frame rate at a cap, waiting before the input of a frame is read
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "GLFW/glfw3.h"
+
+#include <chrono>
+
+/***********************************************************
+ *  FramePacer
+ *
+ *  The sync mode sets the swap interval of the window, and
+ *  the frame cap makes WaitForNextFrame() sleep until the
+ *  next frame is due.  The wait goes between the swap and
+ *  the polling of the events, so a capped frame reads its
+ *  input as late as it can, and the input is only as old as
+ *  the time it takes to draw one frame.
+ *
+ *  Command line:
+ *    --vsync <mode>          off, on or adaptive, on by default,
+ *                            adaptive tears only frames that are
+ *                            late for the display
+ *    --frame-cap <fps>       most frames per second, 0 for none
+ *    --on-demand             only draw the frames whose camera or
+ *                            scene changed, waiting for events
+ *                            between them
+ ***********************************************************/
+class FramePacer
+{
+public:
+	enum SYNC_MODE
+	{
+		SYNC_OFF = 0,
+		SYNC_ON,
+		SYNC_ADAPTIVE,
+		SYNC_COUNT
+	};
+
+	struct PACING_SETTINGS
+	{
+		SYNC_MODE syncMode;
+		// frames per second, 0 leaves the rate to the sync mode
+		int frameCap;
+		// true when unchanged frames are not drawn again
+		bool bOnDemand;
+	};
+
+	// constructor
+	FramePacer(const PACING_SETTINGS& settings);
+
+	// read the pacing settings from the command line, false is returned
+	// when they are not valid
+	static bool ParseArguments(int argc, char* argv[], PACING_SETTINGS& settings);
+	// find the sync mode with the passed in name
+	static bool ParseSyncMode(const char* name, SYNC_MODE& mode);
+
+	// set the swap interval of the current context's window
+	void Apply();
+	// sleep until the next frame is due under the frame cap
+	void WaitForNextFrame();
+	// with on-demand rendering, wait for events after a frame that
+	// did not change, instead of polling them
+	bool IsOnDemand() const { return(m_settings.bOnDemand); }
+	void WaitForEvents();
+
+private:
+	PACING_SETTINGS m_settings;
+	// time the next frame may start, under the frame cap
+	std::chrono::steady_clock::time_point m_nextFrame;
+	std::chrono::steady_clock::duration m_framePeriod;
+};
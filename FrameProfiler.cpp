@@ -0,0 +1,583 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// time the sections of every frame on the CPU and the GPU, keep a history of
+// the timings and show them as an overlay or write them to a CSV file
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// file written when the CSV dump key is pressed
+	const char* g_ProfileFileName = "frame_profile.csv";
+
+	// frame time of a 60 Hz display, marked on the overlay graph
+	const float g_TargetFrameMs = 1000.0f / 60.0f;
+	// frame time drawn across the full width or height of the overlay
+	const float g_OverlayScaleMs = 2.0f * g_TargetFrameMs;
+
+	// overlay layout, in pixels from the bottom left of the viewport
+	const int g_OverlayMargin = 10;
+	const int g_OverlayBarHeight = 8;
+	const int g_OverlayGraphHeight = 100;
+	const int g_OverlayColumnWidth = 3;
+
+	// colors the sections are drawn with, in the order they were added
+	const float g_SectionColors[][3] =
+	{
+		{ 0.90f, 0.30f, 0.30f },
+		{ 0.30f, 0.80f, 0.30f },
+		{ 0.30f, 0.50f, 0.95f },
+		{ 0.95f, 0.80f, 0.20f },
+		{ 0.80f, 0.35f, 0.90f },
+		{ 0.25f, 0.85f, 0.85f },
+		{ 0.95f, 0.55f, 0.20f },
+		{ 0.70f, 0.70f, 0.70f }
+	};
+	const int g_SectionColorCount = sizeof(g_SectionColors) / sizeof(g_SectionColors[0]);
+
+	/***********************************************************
+	 *  FillRect()
+	 *
+	 *  Fill a rectangle of the color buffer by clearing it with
+	 *  the scissor test enabled, no program or mesh is needed.
+	 ***********************************************************/
+	void FillRect(int x, int y, int width, int height, float red, float green, float blue)
+	{
+		if ((width <= 0) || (height <= 0))
+		{
+			return;
+		}
+		glScissor(x, y, width, height);
+		glClearColor(red, green, blue, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+	}
+
+	/***********************************************************
+	 *  ToMilliseconds()
+	 *
+	 *  Convert a CPU clock duration to milliseconds.
+	 ***********************************************************/
+	float ToMilliseconds(std::chrono::steady_clock::duration duration)
+	{
+		return(std::chrono::duration<float, std::milli>(duration).count());
+	}
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler(int historyFrames)
+{
+	FRAME_SAMPLE empty = FRAME_SAMPLE();
+
+	empty.frameMs = -1.0f;
+	for (int s = 0; s < MAX_SECTIONS; s++)
+	{
+		empty.cpuMs[s] = -1.0f;
+		empty.gpuMs[s] = -1.0f;
+	}
+	// the query results are written back into the history, so it
+	// must hold more frames than the queries wait for
+	m_history.resize(std::max(historyFrames, QUERY_LATENCY + 1), empty);
+	m_frameCount = 0;
+	m_idleFrames = 0;
+
+	m_bGPUTimers = (GLEW_ARB_timer_query ? true : false);
+	for (int q = 0; q < QUERY_LATENCY; q++)
+	{
+		if (m_bGPUTimers == true)
+		{
+			glGenQueries(MAX_SECTIONS, m_queries[q]);
+		}
+		for (int s = 0; s < MAX_SECTIONS; s++)
+		{
+			m_bQueryPending[q][s] = false;
+		}
+		m_queryFrame[q] = 0;
+	}
+
+	m_bOverlayVisible = false;
+	m_bOverlayKeyDown = false;
+	m_bDumpKeyDown = false;
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	if (m_bGPUTimers == true)
+	{
+		for (int q = 0; q < QUERY_LATENCY; q++)
+		{
+			glDeleteQueries(MAX_SECTIONS, m_queries[q]);
+		}
+	}
+}
+
+/***********************************************************
+ *  AddSection()
+ *
+ *  This method is used for adding a named section of the
+ *  frame to time.  -1 is returned when no more sections can
+ *  be added, and timing section -1 does nothing.
+ ***********************************************************/
+int FrameProfiler::AddSection(const char* name)
+{
+	if ((int)m_sectionNames.size() >= MAX_SECTIONS)
+	{
+		std::cout << "Could not add profiler section " << name << std::endl;
+		return(-1);
+	}
+
+	m_sectionNames.push_back(name);
+	return((int)m_sectionNames.size() - 1);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the timing of a frame.
+ *  The query results of the frame that last used this set of
+ *  queries are collected first, so the set can be reused.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	int querySet = m_frameCount % QUERY_LATENCY;
+
+	ReadQueries(querySet);
+	m_queryFrame[querySet] = m_frameCount;
+
+	FRAME_SAMPLE& sample = GetSample(m_frameCount);
+	sample.frameMs = -1.0f;
+	for (int s = 0; s < MAX_SECTIONS; s++)
+	{
+		sample.cpuMs[s] = -1.0f;
+		sample.gpuMs[s] = -1.0f;
+	}
+
+	m_frameStart = Clock::now();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the timing of a frame
+ *  and recording its draw and state change counters.
+ ***********************************************************/
+void FrameProfiler::EndFrame(const RenderQueue::FRAME_COUNTERS& counters)
+{
+	FRAME_SAMPLE& sample = GetSample(m_frameCount);
+
+	sample.frameMs = ToMilliseconds(Clock::now() - m_frameStart);
+	sample.counters = counters;
+	m_frameCount++;
+}
+
+/***********************************************************
+ *  BeginSection()
+ *
+ *  This method is used for starting the timing of a section
+ *  of the current frame.
+ ***********************************************************/
+void FrameProfiler::BeginSection(int section)
+{
+	if ((section < 0) || (section >= MAX_SECTIONS))
+	{
+		return;
+	}
+
+	if (m_bGPUTimers == true)
+	{
+		int querySet = m_frameCount % QUERY_LATENCY;
+		glBeginQuery(GL_TIME_ELAPSED, m_queries[querySet][section]);
+	}
+	m_sectionStart[section] = Clock::now();
+}
+
+/***********************************************************
+ *  EndSection()
+ *
+ *  This method is used for finishing the timing of a section
+ *  of the current frame.
+ ***********************************************************/
+void FrameProfiler::EndSection(int section)
+{
+	if ((section < 0) || (section >= MAX_SECTIONS))
+	{
+		return;
+	}
+
+	GetSample(m_frameCount).cpuMs[section] = ToMilliseconds(Clock::now() - m_sectionStart[section]);
+	if (m_bGPUTimers == true)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_bQueryPending[m_frameCount % QUERY_LATENCY][section] = true;
+	}
+}
+
+/***********************************************************
+ *  ReadQueries()
+ *
+ *  This method is used for copying the results of a set of
+ *  timer queries into the history.  A result that is still
+ *  not available is dropped rather than waited for.
+ ***********************************************************/
+void FrameProfiler::ReadQueries(int querySet)
+{
+	FRAME_SAMPLE& sample = GetSample(m_queryFrame[querySet]);
+
+	for (int s = 0; s < MAX_SECTIONS; s++)
+	{
+		if (m_bQueryPending[querySet][s] == false)
+		{
+			continue;
+		}
+		m_bQueryPending[querySet][s] = false;
+
+		GLint bAvailable = GL_FALSE;
+		glGetQueryObjectiv(m_queries[querySet][s], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable == GL_TRUE)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(m_queries[querySet][s], GL_QUERY_RESULT, &elapsed);
+			sample.gpuMs[s] = (float)((double)elapsed / 1000000.0);
+		}
+	}
+}
+
+/***********************************************************
+ *  ScopedSection()
+ *
+ *  The constructor starts timing the section.
+ ***********************************************************/
+FrameProfiler::ScopedSection::ScopedSection(FrameProfiler* pProfiler, int section)
+{
+	m_pProfiler = pProfiler;
+	m_section = section;
+	if (NULL != m_pProfiler)
+	{
+		m_pProfiler->BeginSection(m_section);
+	}
+}
+
+/***********************************************************
+ *  ~ScopedSection()
+ *
+ *  The destructor finishes timing the section.
+ ***********************************************************/
+FrameProfiler::ScopedSection::~ScopedSection()
+{
+	if (NULL != m_pProfiler)
+	{
+		m_pProfiler->EndSection(m_section);
+	}
+}
+
+/***********************************************************
+ *  GetHistoryCount()
+ *
+ *  This method is used for getting how many finished frames
+ *  the history holds.
+ ***********************************************************/
+int FrameProfiler::GetHistoryCount() const
+{
+	return((int)std::min(m_frameCount, (unsigned int)m_history.size()));
+}
+
+/***********************************************************
+ *  GetFramePercentile()
+ *
+ *  This method is used for getting a frame time percentile
+ *  over the frames in the history, by the nearest rank.
+ ***********************************************************/
+float FrameProfiler::GetFramePercentile(float percent) const
+{
+	int count = GetHistoryCount();
+	if (count == 0)
+	{
+		return(0.0f);
+	}
+
+	std::vector<float> frameTimes;
+	frameTimes.reserve(count);
+	for (int i = 0; i < count; i++)
+	{
+		frameTimes.push_back(GetSample(m_frameCount - 1 - i).frameMs);
+	}
+	std::sort(frameTimes.begin(), frameTimes.end());
+
+	int rank = (int)((percent / 100.0f) * count + 0.5f) - 1;
+	rank = std::max(0, std::min(rank, count - 1));
+
+	return(frameTimes[rank]);
+}
+
+/***********************************************************
+ *  HandleKeys()
+ *
+ *  This method is used for toggling the overlay when F3 is
+ *  pressed, and writing the history to the CSV file when F4
+ *  is pressed.
+ ***********************************************************/
+bool FrameProfiler::HandleKeys(GLFWwindow* window)
+{
+	bool bToggled = false;
+
+	bool bOverlayKey = (glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS);
+	bool bDumpKey = (glfwGetKey(window, GLFW_KEY_F4) == GLFW_PRESS);
+
+	if ((bOverlayKey == true) && (m_bOverlayKeyDown == false))
+	{
+		m_bOverlayVisible = !m_bOverlayVisible;
+		bToggled = true;
+	}
+	if ((bDumpKey == true) && (m_bDumpKeyDown == false))
+	{
+		WriteCSV(g_ProfileFileName);
+		PrintStats();
+	}
+
+	m_bOverlayKeyDown = bOverlayKey;
+	m_bDumpKeyDown = bDumpKey;
+
+	return(bToggled);
+}
+
+/***********************************************************
+ *  DrawOverlay()
+ *
+ *  This method is used for drawing the timings over the
+ *  frame with scissored clears.  The two bars stack the CPU
+ *  and the GPU time of each section, and the graph shows the
+ *  frame times of the history, with a line at 60 Hz.
+ ***********************************************************/
+void FrameProfiler::DrawOverlay()
+{
+	if ((m_bOverlayVisible == false) || (m_frameCount == 0))
+	{
+		return;
+	}
+
+	GLint viewport[4];
+	GLfloat clearColor[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+	glEnable(GL_SCISSOR_TEST);
+
+	int left = viewport[0] + g_OverlayMargin;
+	int bottom = viewport[1] + g_OverlayMargin;
+	int width = viewport[2] - 2 * g_OverlayMargin;
+	float pixelsPerMs = width / g_OverlayScaleMs;
+
+	// frame time graph, newest frame on the right
+	float graphPixelsPerMs = g_OverlayGraphHeight / g_OverlayScaleMs;
+	int columns = std::min(GetHistoryCount(), width / g_OverlayColumnWidth);
+	FillRect(left, bottom, width, g_OverlayGraphHeight, 0.1f, 0.1f, 0.1f);
+	for (int i = 0; i < columns; i++)
+	{
+		float frameMs = GetSample(m_frameCount - 1 - i).frameMs;
+		int height = std::min((int)(frameMs * graphPixelsPerMs), g_OverlayGraphHeight);
+		int x = left + width - (i + 1) * g_OverlayColumnWidth;
+
+		if (frameMs <= g_TargetFrameMs)
+		{
+			FillRect(x, bottom, g_OverlayColumnWidth - 1, height, 0.3f, 0.8f, 0.3f);
+		}
+		else if (frameMs <= g_OverlayScaleMs)
+		{
+			FillRect(x, bottom, g_OverlayColumnWidth - 1, height, 0.95f, 0.8f, 0.2f);
+		}
+		else
+		{
+			FillRect(x, bottom, g_OverlayColumnWidth - 1, height, 0.9f, 0.3f, 0.3f);
+		}
+	}
+	FillRect(left, bottom + (int)(g_TargetFrameMs * graphPixelsPerMs), width, 1, 1.0f, 1.0f, 1.0f);
+
+	// CPU sections of the last frame, then the GPU sections of the
+	// newest frame whose queries have been read
+	const FRAME_SAMPLE& cpuSample = GetSample(m_frameCount - 1);
+	const FRAME_SAMPLE& gpuSample = GetSample(m_frameCount - std::min(m_frameCount, (unsigned int)QUERY_LATENCY));
+	int cpuBottom = bottom + g_OverlayGraphHeight + g_OverlayMargin + g_OverlayBarHeight + 2;
+	int gpuBottom = bottom + g_OverlayGraphHeight + g_OverlayMargin;
+	FillRect(left, cpuBottom, width, g_OverlayBarHeight, 0.1f, 0.1f, 0.1f);
+	FillRect(left, gpuBottom, width, g_OverlayBarHeight, 0.1f, 0.1f, 0.1f);
+
+	int cpuX = left;
+	int gpuX = left;
+	for (int s = 0; s < (int)m_sectionNames.size(); s++)
+	{
+		const float* pColor = g_SectionColors[s % g_SectionColorCount];
+
+		if (cpuSample.cpuMs[s] > 0.0f)
+		{
+			int cpuWidth = std::min((int)(cpuSample.cpuMs[s] * pixelsPerMs), left + width - cpuX);
+			FillRect(cpuX, cpuBottom, cpuWidth, g_OverlayBarHeight, pColor[0], pColor[1], pColor[2]);
+			cpuX += std::max(cpuWidth, 0);
+		}
+		if (gpuSample.gpuMs[s] > 0.0f)
+		{
+			int gpuWidth = std::min((int)(gpuSample.gpuMs[s] * pixelsPerMs), left + width - gpuX);
+			FillRect(gpuX, gpuBottom, gpuWidth, g_OverlayBarHeight, pColor[0], pColor[1], pColor[2]);
+			gpuX += std::max(gpuWidth, 0);
+		}
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+}
+
+/***********************************************************
+ *  WriteCSV()
+ *
+ *  This method is used for writing the timing history to a
+ *  CSV file, one row per frame from the oldest.  Times that
+ *  are not known are left empty.
+ ***********************************************************/
+bool FrameProfiler::WriteCSV(const char* filename) const
+{
+	std::ofstream csvFile(filename, std::ios::trunc);
+	if (!csvFile)
+	{
+		std::cout << "Could not write frame profile " << filename << std::endl;
+		return(false);
+	}
+
+	csvFile << "frame,frame_ms";
+	for (size_t s = 0; s < m_sectionNames.size(); s++)
+	{
+		csvFile << "," << m_sectionNames[s] << "_cpu_ms," << m_sectionNames[s] << "_gpu_ms";
+	}
+	csvFile << ",draw_calls,culled,occluded,program_changes,program_elided,texture_changes,texture_elided"
+			<< ",sampler_changes,sampler_elided,material_changes,material_elided,uvscale_changes,uvscale_elided"
+			<< ",color_changes,color_elided,depth_samples,shaded_samples,view_pixels\n";
+
+	int count = GetHistoryCount();
+	for (int i = count; i > 0; i--)
+	{
+		unsigned int frame = m_frameCount - i;
+		const FRAME_SAMPLE& sample = GetSample(frame);
+		const RenderQueue::FRAME_COUNTERS& counters = sample.counters;
+
+		csvFile << frame << "," << sample.frameMs;
+		for (size_t s = 0; s < m_sectionNames.size(); s++)
+		{
+			csvFile << ",";
+			if (sample.cpuMs[s] >= 0.0f)
+			{
+				csvFile << sample.cpuMs[s];
+			}
+			csvFile << ",";
+			if (sample.gpuMs[s] >= 0.0f)
+			{
+				csvFile << sample.gpuMs[s];
+			}
+		}
+		csvFile << "," << counters.drawCalls << "," << counters.culled << "," << counters.occluded
+				<< "," << counters.program.changed << "," << counters.program.elided
+				<< "," << counters.texture.changed << "," << counters.texture.elided
+				<< "," << counters.sampler.changed << "," << counters.sampler.elided
+				<< "," << counters.material.changed << "," << counters.material.elided
+				<< "," << counters.UVscale.changed << "," << counters.UVscale.elided
+				<< "," << counters.color.changed << "," << counters.color.elided
+				<< "," << counters.depthSamples << "," << counters.shadedSamples << "," << counters.viewPixels << "\n";
+	}
+
+	std::cout << "Wrote frame profile " << filename << ", frames:" << count << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the frame time
+ *  percentiles, the average time of each section and the
+ *  average overdraw, and how many frames were drawn and
+ *  left idle.
+ ***********************************************************/
+void FrameProfiler::PrintStats() const
+{
+	int count = GetHistoryCount();
+
+	std::cout << "Frames drawn:" << m_frameCount << ", idle:" << m_idleFrames << std::endl;
+
+	std::cout << "Frame time over " << count << " frames - p50:" << GetFramePercentile(50.0f)
+			  << " ms, p95:" << GetFramePercentile(95.0f)
+			  << " ms, p99:" << GetFramePercentile(99.0f) << " ms" << std::endl;
+
+	for (size_t s = 0; s < m_sectionNames.size(); s++)
+	{
+		float cpuTotal = 0.0f;
+		float gpuTotal = 0.0f;
+		int cpuFrames = 0;
+		int gpuFrames = 0;
+
+		for (int i = 0; i < count; i++)
+		{
+			const FRAME_SAMPLE& sample = GetSample(m_frameCount - 1 - i);
+			if (sample.cpuMs[s] >= 0.0f)
+			{
+				cpuTotal += sample.cpuMs[s];
+				cpuFrames++;
+			}
+			if (sample.gpuMs[s] >= 0.0f)
+			{
+				gpuTotal += sample.gpuMs[s];
+				gpuFrames++;
+			}
+		}
+
+		std::cout << "  " << m_sectionNames[s] << " - cpu:" << ((cpuFrames > 0) ? cpuTotal / cpuFrames : 0.0f)
+				  << " ms, gpu:" << ((gpuFrames > 0) ? gpuTotal / gpuFrames : 0.0f) << " ms" << std::endl;
+	}
+
+	// objects left out by the frustum and by the depth of the frame
+	// before, the GPU counts of a frame arrive a few frames late
+	double culledTotal = 0.0;
+	double occludedTotal = 0.0;
+	for (int i = 0; i < count; i++)
+	{
+		const RenderQueue::FRAME_COUNTERS& counters = GetSample(m_frameCount - 1 - i).counters;
+		culledTotal += counters.culled;
+		occludedTotal += counters.occluded;
+	}
+	if (count > 0)
+	{
+		std::cout << "  culling - outside the view:" << culledTotal / count
+				  << " objects/frame, occluded:" << occludedTotal / count << " objects/frame" << std::endl;
+	}
+
+	// samples per pixel of the frames whose sample counts were read
+	double depthTotal = 0.0;
+	double shadedTotal = 0.0;
+	int sampledFrames = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const RenderQueue::FRAME_COUNTERS& counters = GetSample(m_frameCount - 1 - i).counters;
+		if ((counters.viewPixels > 0) && (counters.shadedSamples > 0))
+		{
+			depthTotal += (double)counters.depthSamples / counters.viewPixels;
+			shadedTotal += (double)counters.shadedSamples / counters.viewPixels;
+			sampledFrames++;
+		}
+	}
+	if (sampledFrames > 0)
+	{
+		std::cout << "  overdraw - shaded:" << shadedTotal / sampledFrames
+				  << " samples/pixel, depth pre-pass:" << depthTotal / sampledFrames << " samples/pixel" << std::endl;
+	}
+}
@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// time the sections of every frame on the CPU and the GPU, keep a history of
+// the timings and show them as an overlay or write them to a CSV file
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include "RenderQueue.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  Each frame is split into named sections that are timed
+ *  with the CPU clock and, when the context supports timer
+ *  queries, with a GL_TIME_ELAPSED query.  The query results
+ *  are read a few frames later so reading them never stalls
+ *  the pipeline.  Sections must not nest, since only one
+ *  elapsed time query can be active at a time.
+ *
+ *  The timings of the last few hundred frames are kept in
+ *  a ring buffer, for the percentile stats, the overlay and
+ *  the CSV dump.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor, keeping the timings of the passed in number of frames
+	FrameProfiler(int historyFrames = DEFAULT_HISTORY_FRAMES);
+	// destructor
+	~FrameProfiler();
+
+	// frames kept in the timing history unless told otherwise
+	static const int DEFAULT_HISTORY_FRAMES = 512;
+	// sections that can be added
+	static const int MAX_SECTIONS = 16;
+
+	// add a named section to time, returns its index
+	int AddSection(const char* name);
+
+	// mark the start and end of a frame, the end also records the
+	// draw and state change counters of the frame
+	void BeginFrame();
+	void EndFrame(const RenderQueue::FRAME_COUNTERS& counters);
+
+	// mark the start and end of a section in the current frame
+	void BeginSection(int section);
+	void EndSection(int section);
+
+	// times a section for as long as it is in scope, the profiler
+	// can be NULL to time nothing
+	class ScopedSection
+	{
+	public:
+		ScopedSection(FrameProfiler* pProfiler, int section);
+		~ScopedSection();
+
+	private:
+		FrameProfiler* m_pProfiler;
+		int m_section;
+	};
+
+	// count a frame that was not drawn, since nothing had changed and
+	// the last frame drawn is still shown
+	void CountIdleFrame() { m_idleFrames++; }
+	// frames drawn and frames left idle since the start
+	unsigned int GetActiveFrameCount() const { return(m_frameCount); }
+	unsigned int GetIdleFrameCount() const { return(m_idleFrames); }
+
+	// frame time in milliseconds below which the passed in percent
+	// of the frames in the history were
+	float GetFramePercentile(float percent) const;
+
+	// toggle the overlay with F3 and write the CSV file with F4, true
+	// is returned when the overlay was turned on or off
+	bool HandleKeys(GLFWwindow* window);
+	bool IsOverlayVisible() const { return(m_bOverlayVisible); }
+	// draw the timing bars over the frame when the overlay is on
+	void DrawOverlay();
+	// write the timing history to a CSV file
+	bool WriteCSV(const char* filename) const;
+	// print the frame time percentiles to the console
+	void PrintStats() const;
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// frames a timer query result is waited for before reading it
+	static const int QUERY_LATENCY = 4;
+
+	// timings of one frame, a negative time is not known
+	struct FRAME_SAMPLE
+	{
+		float frameMs;
+		float cpuMs[MAX_SECTIONS];
+		float gpuMs[MAX_SECTIONS];
+		RenderQueue::FRAME_COUNTERS counters;
+	};
+
+	std::vector<std::string> m_sectionNames;
+	std::vector<FRAME_SAMPLE> m_history;
+	// frames finished since the start, also the number of the
+	// frame being timed
+	unsigned int m_frameCount;
+	// frames that were not drawn since the start
+	unsigned int m_idleFrames;
+
+	Clock::time_point m_frameStart;
+	Clock::time_point m_sectionStart[MAX_SECTIONS];
+
+	// timer queries of the last QUERY_LATENCY frames
+	bool m_bGPUTimers;
+	GLuint m_queries[QUERY_LATENCY][MAX_SECTIONS];
+	bool m_bQueryPending[QUERY_LATENCY][MAX_SECTIONS];
+	unsigned int m_queryFrame[QUERY_LATENCY];
+
+	bool m_bOverlayVisible;
+	bool m_bOverlayKeyDown;
+	bool m_bDumpKeyDown;
+
+	// history sample of the passed in frame number
+	FRAME_SAMPLE& GetSample(unsigned int frame) { return(m_history[frame % m_history.size()]); }
+	const FRAME_SAMPLE& GetSample(unsigned int frame) const { return(m_history[frame % m_history.size()]); }
+	// number of finished frames in the history
+	int GetHistoryCount() const;
+	// copy the available query results into the history
+	void ReadQueries(int querySet);
+};
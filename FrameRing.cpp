@@ -0,0 +1,237 @@
+///////////////////////////////////////////////////////////////////////////////
+// framering.cpp
+// ============
+// persistently mapped buffer split into one region per frame in flight, so
+// the CPU writes the data of the next frame while the GPU reads the last
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameRing.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// the storage stays mapped for writing for the life of the buffer,
+	// and the writes are seen by the GPU without flushing
+	const GLbitfield g_StorageFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	// nanoseconds of one wait for a fence, waiting goes on after a
+	// timeout, it only keeps the wait from hanging on a lost context
+	const GLuint64 g_FenceTimeout = 1000000000;
+}
+
+/***********************************************************
+ *  FrameRing()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameRing::FrameRing(GLenum target, size_t frameSize)
+{
+	m_target = target;
+	m_buffer = 0;
+	m_pMapped = NULL;
+	m_frameSize = frameSize;
+	for (int i = 0; i < FRAME_COUNT; i++)
+	{
+		m_fences[i] = NULL;
+	}
+	m_frame = -1;
+	m_used = 0;
+	m_requested = 0;
+	m_waitCount = 0;
+
+	CreateBuffer();
+}
+
+/***********************************************************
+ *  ~FrameRing()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameRing::~FrameRing()
+{
+	for (int i = 0; i < FRAME_COUNT; i++)
+	{
+		if (NULL != m_fences[i])
+		{
+			glDeleteSync(m_fences[i]);
+			m_fences[i] = NULL;
+		}
+	}
+	DeleteBuffer();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether buffers can have
+ *  immutable storage that stays mapped while it is drawn
+ *  from.
+ ***********************************************************/
+bool FrameRing::IsSupported()
+{
+	return((GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) ? true : false);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating the buffer with a region
+ *  for every frame in flight and mapping all of it.
+ ***********************************************************/
+void FrameRing::CreateBuffer()
+{
+	GLsizeiptr size = (GLsizeiptr)(m_frameSize * FRAME_COUNT);
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(m_target, m_buffer);
+	glBufferStorage(m_target, size, NULL, g_StorageFlags);
+	m_pMapped = (unsigned char*)glMapBufferRange(m_target, 0, size, g_StorageFlags);
+	glBindBuffer(m_target, 0);
+
+	if (NULL == m_pMapped)
+	{
+		std::cout << "Could not map a frame ring buffer of " << size << " bytes" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  DeleteBuffer()
+ *
+ *  This method is used for unmapping and deleting the buffer.
+ ***********************************************************/
+void FrameRing::DeleteBuffer()
+{
+	if (0 == m_buffer)
+	{
+		return;
+	}
+
+	if (NULL != m_pMapped)
+	{
+		glBindBuffer(m_target, m_buffer);
+		glUnmapBuffer(m_target);
+		glBindBuffer(m_target, 0);
+		m_pMapped = NULL;
+	}
+	glDeleteBuffers(1, &m_buffer);
+	m_buffer = 0;
+}
+
+/***********************************************************
+ *  WaitForFrame()
+ *
+ *  This method is used for waiting until the GPU has passed
+ *  the fence placed after a frame.  The first check does not
+ *  wait, so a frame that is already done costs no flush.
+ ***********************************************************/
+void FrameRing::WaitForFrame(int frame)
+{
+	if (NULL == m_fences[frame])
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(m_fences[frame], 0, 0);
+	if (GL_TIMEOUT_EXPIRED == result)
+	{
+		m_waitCount++;
+		while (GL_TIMEOUT_EXPIRED == result)
+		{
+			result = glClientWaitSync(m_fences[frame], GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		}
+	}
+	if (GL_WAIT_FAILED == result)
+	{
+		std::cout << "Could not wait for the frame ring fence" << std::endl;
+	}
+
+	glDeleteSync(m_fences[frame]);
+	m_fences[frame] = NULL;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting to write the region of
+ *  the next frame.  When the last frame asked for more than
+ *  a region holds, every frame in flight is waited for and
+ *  the buffer is made again with larger regions.
+ ***********************************************************/
+bool FrameRing::BeginFrame()
+{
+	bool bRecreated = false;
+
+	if (m_requested > m_frameSize)
+	{
+		for (int i = 0; i < FRAME_COUNT; i++)
+		{
+			WaitForFrame(i);
+		}
+		while (m_frameSize < m_requested)
+		{
+			m_frameSize *= 2;
+		}
+		DeleteBuffer();
+		CreateBuffer();
+		bRecreated = true;
+	}
+
+	m_frame = (m_frame + 1) % FRAME_COUNT;
+	WaitForFrame(m_frame);
+	m_used = 0;
+	m_requested = 0;
+
+	return(bRecreated);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for placing the fence after the last
+ *  draw reading the region of the frame.
+ ***********************************************************/
+void FrameRing::EndFrame()
+{
+	if (m_frame < 0)
+	{
+		return;
+	}
+
+	if (NULL != m_fences[m_frame])
+	{
+		glDeleteSync(m_fences[m_frame]);
+	}
+	m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for reserving the next bytes of the
+ *  region of the frame.  Nothing can be reserved before the
+ *  first BeginFrame().
+ ***********************************************************/
+void* FrameRing::Allocate(size_t size, size_t alignment, GLintptr& offset)
+{
+	if ((NULL == m_pMapped) || (m_frame < 0) || (0 == alignment))
+	{
+		return(NULL);
+	}
+
+	size_t regionStart = (size_t)m_frame * m_frameSize;
+	size_t start = regionStart + m_used;
+	size_t aligned = ((start + alignment - 1) / alignment) * alignment;
+
+	m_requested += (aligned - start) + size;
+	if (aligned + size > regionStart + m_frameSize)
+	{
+		return(NULL);
+	}
+
+	m_used = aligned + size - regionStart;
+	offset = (GLintptr)aligned;
+
+	return(m_pMapped + aligned);
+}
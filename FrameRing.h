@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// framering.h
+// ============
+// persistently mapped buffer split into one region per frame in flight, so
+// the CPU writes the data of the next frame while the GPU reads the last
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  FrameRing
+ *
+ *  The buffer is created once with immutable storage and
+ *  stays mapped for writing with coherent access, so the
+ *  values copied into it are seen by the draws that follow
+ *  without any buffer calls.  Each frame writes into its own
+ *  region, and a fence placed after the frame tells when the
+ *  GPU is done reading it.  The CPU only waits when it gets
+ *  FRAME_COUNT frames ahead of the GPU.
+ *
+ *  A frame that asks for more than a region holds gets NULL
+ *  back, and the buffer is made larger at the start of the
+ *  next frame, after waiting for every frame in flight.
+ ***********************************************************/
+class FrameRing
+{
+public:
+	// constructor, with the starting size of a region in bytes
+	FrameRing(GLenum target, size_t frameSize);
+	// destructor
+	~FrameRing();
+
+	// frames the CPU may be ahead of the GPU
+	static const int FRAME_COUNT = 3;
+
+	// check whether the context can map buffers persistently
+	static bool IsSupported();
+
+	// move on to the region of the next frame, waiting for the GPU to
+	// finish with it.  True is returned when the buffer was made again,
+	// so the owner has to point everything at the new buffer
+	bool BeginFrame();
+	// place the fence of the frame after its last use of the region
+	void EndFrame();
+
+	// reserve bytes in the region of the frame, the returned pointer
+	// is written to and offset is where the bytes are in the buffer.
+	// The offset is a multiple of the alignment, which does not have to
+	// be a power of two.  NULL is returned when the region is full
+	void* Allocate(size_t size, size_t alignment, GLintptr& offset);
+
+	GLuint GetBuffer() const { return(m_buffer); }
+	// number of frames that had to wait for the GPU
+	int GetWaitCount() const { return(m_waitCount); }
+
+private:
+	GLenum m_target;
+	GLuint m_buffer;
+	// start of the mapped buffer, NULL when it could not be mapped
+	unsigned char* m_pMapped;
+	size_t m_frameSize;
+	// fence placed after each frame's draws, NULL when none is pending
+	GLsync m_fences[FRAME_COUNT];
+	// region of the frame being written, -1 before the first frame
+	int m_frame;
+	// bytes used in the region of the frame
+	size_t m_used;
+	// bytes the frame asked for, including what did not fit
+	size_t m_requested;
+	int m_waitCount;
+
+	// create and map the buffer at the current region size
+	void CreateBuffer();
+	void DeleteBuffer();
+	// wait until the GPU is done with the region of a frame
+	void WaitForFrame(int frame);
+};
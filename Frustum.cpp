@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.cpp
+// ============
+// the six clipping planes of a camera, for testing whether bounding volumes
+// can be seen
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Frustum.h"
+
+/***********************************************************
+ *  Frustum()
+ *
+ *  The constructor extracts the left, right, bottom, top,
+ *  near and far planes from the rows of the clip matrix.
+ ***********************************************************/
+Frustum::Frustum(const glm::mat4& projection, const glm::mat4& view)
+{
+	glm::mat4 clip = projection * view;
+	// glm matrices are column major, so row r is clip[c][r]
+	glm::vec4 row0 = glm::vec4(clip[0][0], clip[1][0], clip[2][0], clip[3][0]);
+	glm::vec4 row1 = glm::vec4(clip[0][1], clip[1][1], clip[2][1], clip[3][1]);
+	glm::vec4 row2 = glm::vec4(clip[0][2], clip[1][2], clip[2][2], clip[3][2]);
+	glm::vec4 row3 = glm::vec4(clip[0][3], clip[1][3], clip[2][3], clip[3][3]);
+
+	m_planes[0] = row3 + row0;
+	m_planes[1] = row3 - row0;
+	m_planes[2] = row3 + row1;
+	m_planes[3] = row3 - row1;
+	m_planes[4] = row3 + row2;
+	m_planes[5] = row3 - row2;
+
+	for (int i = 0; i < 6; i++)
+	{
+		m_planes[i] /= glm::length(glm::vec3(m_planes[i]));
+	}
+}
+
+/***********************************************************
+ *  TestBox()
+ *
+ *  This method is used for testing a box against the planes.
+ *  For each plane only the corners farthest along and
+ *  against its normal need to be checked.
+ ***********************************************************/
+Frustum::CULL_RESULT Frustum::TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	CULL_RESULT result = CULL_INSIDE;
+
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = m_planes[i];
+		glm::vec3 nearest;
+		glm::vec3 farthest;
+
+		nearest.x = (plane.x >= 0.0f) ? boxMin.x : boxMax.x;
+		nearest.y = (plane.y >= 0.0f) ? boxMin.y : boxMax.y;
+		nearest.z = (plane.z >= 0.0f) ? boxMin.z : boxMax.z;
+		farthest.x = (plane.x >= 0.0f) ? boxMax.x : boxMin.x;
+		farthest.y = (plane.y >= 0.0f) ? boxMax.y : boxMin.y;
+		farthest.z = (plane.z >= 0.0f) ? boxMax.z : boxMin.z;
+
+		if (glm::dot(glm::vec3(plane), farthest) + plane.w < 0.0f)
+		{
+			return(CULL_OUTSIDE);
+		}
+		if (glm::dot(glm::vec3(plane), nearest) + plane.w < 0.0f)
+		{
+			result = CULL_INTERSECTS;
+		}
+	}
+
+	return(result);
+}
+
+/***********************************************************
+ *  IsBoxVisible()
+ *
+ *  This method is used for checking whether any part of a
+ *  box may be inside the frustum.
+ ***********************************************************/
+bool Frustum::IsBoxVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+{
+	return(TestBox(boxMin, boxMax) != CULL_OUTSIDE);
+}
@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// frustum.h
+// ============
+// the six clipping planes of a camera, for testing whether bounding volumes
+// can be seen
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  Frustum
+ *
+ *  The planes are taken from the combined projection and
+ *  view matrix, and point into the frustum.  A box is only
+ *  reported outside when it is fully behind one plane, so
+ *  the tests never reject something that can be seen.
+ ***********************************************************/
+class Frustum
+{
+public:
+	// constructor, the frustum of the passed in camera matrices
+	Frustum(const glm::mat4& projection, const glm::mat4& view);
+
+	// where a bounding volume is against the frustum
+	enum CULL_RESULT
+	{
+		CULL_OUTSIDE = 0,
+		CULL_INTERSECTS,
+		CULL_INSIDE
+	};
+
+	// test a world space axis aligned box against the planes
+	CULL_RESULT TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+	bool IsBoxVisible(const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+	// the left, right, bottom, top, near and far planes, for passing
+	// to shaders
+	const glm::vec4* GetPlanes() const { return(m_planes); }
+
+private:
+	// xyz is the plane normal, w the distance from the origin
+	glm::vec4 m_planes[6];
+};
@@ -0,0 +1,273 @@
+///////////////////////////////////////////////////////////////////////////////
+// instanceculling.cpp
+// ============
+// cull the instanced objects against the view in a compute shader, which
+// writes the indirect draw commands of the visible instances
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InstanceCulling.h"
+#include "ComputeProgram.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// instances culled by one compute work group, must match
+	// local_size_x in the compute shader
+	const GLuint g_WorkGroupSize = 64;
+
+	// buffer bindings declared in the compute shader
+	const GLuint g_InstanceBinding = 0;
+	const GLuint g_BoundsBinding = 1;
+	const GLuint g_VisibleBinding = 2;
+	const GLuint g_CommandBinding = 3;
+	const GLuint g_LodBinding = 4;
+	const GLuint g_StatsBinding = 5;
+}
+
+/***********************************************************
+ *  InstanceCulling()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InstanceCulling::InstanceCulling()
+{
+	m_program = 0;
+	m_planesLocation = -1;
+	m_cullLocation = -1;
+	m_instanceCountLocation = -1;
+	m_viewPositionLocation = -1;
+	m_projectionScaleLocation = -1;
+	m_occlusionLocation = -1;
+	m_occlusionViewProjectionLocation = -1;
+	m_depthPyramidLocation = -1;
+	m_pyramidLevelsLocation = -1;
+	m_instanceCount = 0;
+	m_cullCount = 0;
+	m_stats.frustumCulled = 0;
+	m_stats.occluded = 0;
+
+	glGenBuffers(1, &m_instanceBuffer);
+	glGenBuffers(1, &m_boundsBuffer);
+	glGenBuffers(1, &m_visibleBuffer);
+	glGenBuffers(1, &m_commandBuffer);
+	glGenBuffers(1, &m_lodBuffer);
+	glGenBuffers(STATS_LATENCY, m_statsBuffers);
+	for (int s = 0; s < STATS_LATENCY; s++)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statsBuffers[s]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(CULL_STATS), NULL, GL_DYNAMIC_READ);
+		m_statsFences[s] = NULL;
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  ~InstanceCulling()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InstanceCulling::~InstanceCulling()
+{
+	glDeleteBuffers(1, &m_instanceBuffer);
+	glDeleteBuffers(1, &m_boundsBuffer);
+	glDeleteBuffers(1, &m_visibleBuffer);
+	glDeleteBuffers(1, &m_commandBuffer);
+	glDeleteBuffers(1, &m_lodBuffer);
+	glDeleteBuffers(STATS_LATENCY, m_statsBuffers);
+	for (int s = 0; s < STATS_LATENCY; s++)
+	{
+		if (NULL != m_statsFences[s])
+		{
+			glDeleteSync(m_statsFences[s]);
+			m_statsFences[s] = NULL;
+		}
+	}
+	if (0 != m_program)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the GL context
+ *  can run compute shaders and draw from indirect buffers.
+ *  glMultiDrawElementsIndirect() also needs the base instance
+ *  of each command, which came with the same version.
+ ***********************************************************/
+bool InstanceCulling::IsSupported()
+{
+	return(GLEW_VERSION_4_3 == GL_TRUE);
+}
+
+/***********************************************************
+ *  LoadShader()
+ *
+ *  This method is used for compiling the compute shader file
+ *  and linking it into a program.  False is returned, with
+ *  the compiler log written out, when that fails.
+ ***********************************************************/
+bool InstanceCulling::LoadShader(const char* filename)
+{
+	GLuint program = ComputeProgram::Load(filename);
+	if (0 == program)
+	{
+		return(false);
+	}
+
+	if (0 != m_program)
+	{
+		glDeleteProgram(m_program);
+	}
+	m_program = program;
+	m_planesLocation = glGetUniformLocation(m_program, "frustumPlanes");
+	m_cullLocation = glGetUniformLocation(m_program, "bCull");
+	m_instanceCountLocation = glGetUniformLocation(m_program, "instanceCount");
+	m_viewPositionLocation = glGetUniformLocation(m_program, "viewPosition");
+	m_projectionScaleLocation = glGetUniformLocation(m_program, "projectionScale");
+	m_occlusionLocation = glGetUniformLocation(m_program, "bOcclusion");
+	m_occlusionViewProjectionLocation = glGetUniformLocation(m_program, "occlusionViewProjection");
+	m_depthPyramidLocation = glGetUniformLocation(m_program, "depthPyramid");
+	m_pyramidLevelsLocation = glGetUniformLocation(m_program, "pyramidLevels");
+
+	// the level thresholds never change, so they are set once
+	GLfloat screenSizes[InstancedMeshes::LOD_COUNT - 1];
+	for (int lod = 0; lod < InstancedMeshes::LOD_COUNT - 1; lod++)
+	{
+		screenSizes[lod] = InstancedMeshes::GetLodScreenSize(lod);
+	}
+	glUseProgram(m_program);
+	glUniform1fv(glGetUniformLocation(m_program, "lodScreenSizes"), InstancedMeshes::LOD_COUNT - 1, screenSizes);
+	glUniform1f(glGetUniformLocation(m_program, "lodHysteresis"), InstancedMeshes::GetLodHysteresis());
+	glUseProgram(0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetInstances()
+ *
+ *  This method is used for uploading the instances, their
+ *  boxes and the commands drawing them.  The visible
+ *  instance buffer is sized for the largest range of the
+ *  commands, and every instance starts at the finest level.
+ ***********************************************************/
+void InstanceCulling::SetInstances(
+	const std::vector<InstancedMeshes::INSTANCE_DATA>& instances,
+	const std::vector<INSTANCE_BOUNDS>& bounds,
+	const std::vector<InstancedMeshes::DRAW_COMMAND>& commands)
+{
+	m_instanceCount = (int)instances.size();
+	m_commands = commands;
+	GLuint visibleCount = 0;
+	for (size_t i = 0; i < m_commands.size(); i++)
+	{
+		visibleCount = std::max(visibleCount, m_commands[i].baseInstance + m_commands[i].instanceCount);
+		m_commands[i].instanceCount = 0;
+	}
+	std::vector<GLuint> lods(instances.size(), 0);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(InstancedMeshes::INSTANCE_DATA), instances.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, bounds.size() * sizeof(INSTANCE_BOUNDS), bounds.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_visibleBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, visibleCount * sizeof(InstancedMeshes::INSTANCE_DATA), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_commands.size() * sizeof(InstancedMeshes::DRAW_COMMAND), m_commands.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lodBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, lods.size() * sizeof(GLuint), lods.data(), GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  ReadStats()
+ *
+ *  This method is used for reading the cull counts of the
+ *  frame that last used a set of counts.  Counts whose fence
+ *  has not passed yet are dropped rather than waited for.
+ ***********************************************************/
+void InstanceCulling::ReadStats(int statsSet)
+{
+	if (NULL == m_statsFences[statsSet])
+	{
+		return;
+	}
+
+	GLenum result = glClientWaitSync(m_statsFences[statsSet], 0, 0);
+	if ((GL_ALREADY_SIGNALED == result) || (GL_CONDITION_SATISFIED == result))
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statsBuffers[statsSet]);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CULL_STATS), &m_stats);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+	glDeleteSync(m_statsFences[statsSet]);
+	m_statsFences[statsSet] = NULL;
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for culling the instances on the GPU.
+ *  The compute program is left in use, so the caller has to
+ *  switch back to its own program before drawing.
+ ***********************************************************/
+void InstanceCulling::Cull(const Frustum& frustum, bool bCull, const glm::vec3& viewPosition, float projectionScale,
+	const DepthPyramid* pDepthPyramid)
+{
+	if ((0 == m_program) || (0 == m_instanceCount))
+	{
+		return;
+	}
+
+	// take the counts of the frame that last used this set, and
+	// start this frame's counts at zero
+	const CULL_STATS noStats = { 0, 0 };
+	int statsSet = (int)(m_cullCount % STATS_LATENCY);
+	m_cullCount++;
+	ReadStats(statsSet);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_statsBuffers[statsSet]);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(CULL_STATS), &noStats);
+
+	// start every command with no instances
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_commandBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_commands.size() * sizeof(InstancedMeshes::DRAW_COMMAND), m_commands.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glUseProgram(m_program);
+	glUniform4fv(m_planesLocation, 6, &frustum.GetPlanes()[0][0]);
+	glUniform1i(m_cullLocation, bCull);
+	glUniform1ui(m_instanceCountLocation, (GLuint)m_instanceCount);
+	glUniform3fv(m_viewPositionLocation, 1, &viewPosition[0]);
+	glUniform1f(m_projectionScaleLocation, projectionScale);
+
+	// the hidden instances are only tested for inside the frustum
+	bool bOcclusion = (bCull == true) && (NULL != pDepthPyramid) && (pDepthPyramid->IsValid() == true);
+	glUniform1i(m_occlusionLocation, bOcclusion);
+	if (bOcclusion == true)
+	{
+		pDepthPyramid->Bind();
+		glUniformMatrix4fv(m_occlusionViewProjectionLocation, 1, GL_FALSE, &pDepthPyramid->GetViewProjection()[0][0]);
+		glUniform1i(m_depthPyramidLocation, pDepthPyramid->GetTextureUnit());
+		glUniform1i(m_pyramidLevelsLocation, pDepthPyramid->GetLevelCount());
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_InstanceBinding, m_instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_BoundsBinding, m_boundsBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_VisibleBinding, m_visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CommandBinding, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_LodBinding, m_lodBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_StatsBinding, m_statsBuffers[statsSet]);
+
+	glDispatchCompute((m_instanceCount + g_WorkGroupSize - 1) / g_WorkGroupSize, 1, 1);
+
+	// the draws read the commands and the visible instances, and the
+	// counts are read back a few frames later
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	m_statsFences[statsSet] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
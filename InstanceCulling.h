@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// instanceculling.h
+// ============
+// cull the instanced objects against the view in a compute shader, which
+// writes the indirect draw commands of the visible instances
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "InstancedMeshes.h"
+#include "Frustum.h"
+#include "DepthPyramid.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  InstanceCulling
+ *
+ *  The instances of every batch, their world space boxes and
+ *  one indirect draw command per batch are uploaded when the
+ *  batches change.  Each frame Cull() clears the instance
+ *  counts of the commands and runs the compute shader over
+ *  all the instances.  Every instance inside the frustum
+ *  picks its level of detail the way InstancedMeshes does,
+ *  adds itself to the count of the command for that level,
+ *  and is copied to the range of the visible instance buffer
+ *  that starts at the base instance of the command.  The
+ *  commands can then be drawn with DrawIndirect() without
+ *  the CPU reading anything back.
+ *
+ *  The level of each instance is kept on the GPU between
+ *  frames, for the hysteresis of the level selection.
+ *
+ *  With a depth pyramid of the last frame, the instances
+ *  inside the frustum are also tested against the depth of
+ *  what was drawn in front of them, and the hidden ones are
+ *  left out as well.  The shader counts the instances each
+ *  test left out into a small buffer per frame, which is read
+ *  STATS_LATENCY frames later once its fence has passed, so
+ *  reading the counts never stalls the pipeline.
+ ***********************************************************/
+class InstanceCulling
+{
+public:
+	// constructor
+	InstanceCulling();
+	// destructor
+	~InstanceCulling();
+
+	// box of an instance, the command drawing its finest level and
+	// the number of levels, whose commands follow that one, laid out
+	// to match the std430 struct of the compute shader
+	struct INSTANCE_BOUNDS
+	{
+		glm::vec3 boundsMin;
+		int command;
+		glm::vec3 boundsMax;
+		int lodCount;
+	};
+
+	// frames the cull counts are read after
+	static const int STATS_LATENCY = 4;
+
+	// instances each test left out, laid out to match the buffer of
+	// the compute shader
+	struct CULL_STATS
+	{
+		GLuint frustumCulled;
+		GLuint occluded;
+	};
+
+	// check whether the GL context has compute shaders and multi
+	// draw indirect
+	static bool IsSupported();
+
+	// compile and link the culling compute shader
+	bool LoadShader(const char* filename);
+
+	// upload the instances to cull, the visible instances of each
+	// command are written from its base instance on, and its instance
+	// count is the most it has room for
+	void SetInstances(
+		const std::vector<InstancedMeshes::INSTANCE_DATA>& instances,
+		const std::vector<INSTANCE_BOUNDS>& bounds,
+		const std::vector<InstancedMeshes::DRAW_COMMAND>& commands);
+
+	// write the visible instances and the draw commands for this
+	// frame, every instance is kept when culling is turned off, the
+	// projection scale is 1 / tan(half the field of view).  The hidden
+	// instances are left out too when a built depth pyramid is passed
+	void Cull(const Frustum& frustum, bool bCull, const glm::vec3& viewPosition, float projectionScale,
+		const DepthPyramid* pDepthPyramid = NULL);
+	// counts of the newest frame whose counts were read
+	const CULL_STATS& GetStats() const { return(m_stats); }
+
+	int GetCommandCount() const { return((int)m_commands.size()); }
+	GLuint GetCommandBuffer() const { return(m_commandBuffer); }
+	GLuint GetVisibleInstanceBuffer() const { return(m_visibleBuffer); }
+
+private:
+	GLuint m_program;
+	GLint m_planesLocation;
+	GLint m_cullLocation;
+	GLint m_instanceCountLocation;
+	GLint m_viewPositionLocation;
+	GLint m_projectionScaleLocation;
+	GLint m_occlusionLocation;
+	GLint m_occlusionViewProjectionLocation;
+	GLint m_depthPyramidLocation;
+	GLint m_pyramidLevelsLocation;
+	// instances and boxes uploaded by SetInstances()
+	GLuint m_instanceBuffer;
+	GLuint m_boundsBuffer;
+	// instances that passed the culling, read by the draws
+	GLuint m_visibleBuffer;
+	GLuint m_commandBuffer;
+	// level of detail each instance was last drawn with
+	GLuint m_lodBuffer;
+	// the commands with their instance counts cleared, copied over
+	// the command buffer before every cull
+	std::vector<InstancedMeshes::DRAW_COMMAND> m_commands;
+	int m_instanceCount;
+	// cull counts of the last STATS_LATENCY frames, each with the
+	// fence placed after the cull that wrote it
+	GLuint m_statsBuffers[STATS_LATENCY];
+	GLsync m_statsFences[STATS_LATENCY];
+	// culls run, selects the counts of the current frame
+	unsigned int m_cullCount;
+	CULL_STATS m_stats;
+
+	// read the counts of a frame when the GPU is done with them
+	void ReadStats(int statsSet);
+};
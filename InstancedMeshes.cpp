@@ -0,0 +1,1156 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.cpp
+// ============
+// draw many copies of a basic shape mesh with a single instanced draw call
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InstancedMeshes.h"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// position, normal and texture coordinate - same as ShapeMeshes
+	const GLuint g_FloatsPerVertex = 8;
+
+	// attribute locations used by shaders/instancedVertexShader.glsl
+	const GLuint g_PositionAttribute = 0;
+	const GLuint g_NormalAttribute = 1;
+	const GLuint g_TexCoordAttribute = 2;
+	const GLuint g_ModelAttribute = 3;		// mat4, uses locations 3 to 6
+	const GLuint g_UVScaleAttribute = 7;
+	const GLuint g_MaterialAttribute = 8;
+	const GLuint g_TextureLayerAttribute = 9;
+
+	// starting size of the instances of one frame in the frame ring,
+	// it grows when a frame draws more
+	const size_t g_InstanceRingSize = 1024 * 1024;
+
+	// segments around the curved meshes at each level of detail, the
+	// spheres have half as many rings and the torus tubes half as many
+	// segments around them
+	const int g_LodSegments[InstancedMeshes::LOD_COUNT] = { 48, 24, 12 };
+	// screen size below which the next coarser level is picked
+	const float g_LodScreenSizes[InstancedMeshes::LOD_COUNT - 1] = { 0.2f, 0.05f };
+	// share of a threshold the size has to move past it before the
+	// level changes, so objects at a threshold do not flicker
+	const float g_LodHysteresis = 0.2f;
+
+	// radius of the tube of the torus, around a main radius of 1
+	const float g_TorusTubeRadius = 0.1f;
+	// radius of the top of the tapered cylinder, over a unit base
+	const float g_TaperedTopRadius = 0.5f;
+
+	const float g_TwoPi = 6.28318530718f;
+
+	// names of the vertex formats, in the order of the enum
+	const char* g_VertexFormatNames[InstancedMeshes::VERTEX_FORMAT_COUNT] = { "full", "compact" };
+
+	// cache files sit in the working directory, one per mesh kind
+	const char* g_CachePrefix = "instancedmesh_";
+	const char* g_CacheExtension = ".meshcache";
+	const char* g_MeshNames[InstancedMeshes::MESH_KIND_COUNT] =
+	{
+		"plane", "box", "pyramid4", "sphere", "cylinder", "taperedcylinder", "torus"
+	};
+
+	// identifies the cache file layout, bump the version when the
+	// layout or the code generating the meshes changes
+	const uint32_t g_CacheMagic = 0x3148534D;	// "MSH1"
+	const uint32_t g_CacheVersion = 1;
+
+	// fixed size header written at the start of every cache file, the
+	// tessellation values key the cache
+	struct CACHE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t meshKind;
+		uint32_t lodCount;
+		int32_t lodSegments[InstancedMeshes::LOD_COUNT];
+		float torusTubeRadius;
+		float taperedTopRadius;
+	};
+
+	// written before the vertices and indices of each level
+	struct LEVEL_HEADER
+	{
+		uint32_t vertexCount;
+		uint32_t indexCount;
+	};
+
+	// one vertex of the compact format.  The normal and the texture
+	// coordinate each hold two 16 bit values with x in the low half,
+	// which comes first in memory on little-endian machines
+	struct COMPACT_VERTEX
+	{
+		GLfloat position[3];
+		uint32_t normal;
+		uint32_t texCoord;
+	};
+
+	/***********************************************************
+	 *  AddVertex()
+	 *
+	 *  Append one interleaved vertex to the vertex list.
+	 ***********************************************************/
+	void AddVertex(
+		std::vector<GLfloat>& vertices,
+		glm::vec3 position,
+		glm::vec3 normal,
+		glm::vec2 texCoord)
+	{
+		vertices.push_back(position.x);
+		vertices.push_back(position.y);
+		vertices.push_back(position.z);
+		vertices.push_back(normal.x);
+		vertices.push_back(normal.y);
+		vertices.push_back(normal.z);
+		vertices.push_back(texCoord.x);
+		vertices.push_back(texCoord.y);
+	}
+
+	/***********************************************************
+	 *  AddQuad()
+	 *
+	 *  Append a quad spanning center +/- uAxis +/- vAxis.  The
+	 *  axes must be ordered so that cross(uAxis, vAxis) points
+	 *  along the normal, which makes the winding CCW.
+	 ***********************************************************/
+	void AddQuad(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		glm::vec3 center,
+		glm::vec3 uAxis,
+		glm::vec3 vAxis,
+		glm::vec3 normal)
+	{
+		GLuint first = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+		AddVertex(vertices, center - uAxis - vAxis, normal, glm::vec2(0.0f, 0.0f));
+		AddVertex(vertices, center + uAxis - vAxis, normal, glm::vec2(1.0f, 0.0f));
+		AddVertex(vertices, center + uAxis + vAxis, normal, glm::vec2(1.0f, 1.0f));
+		AddVertex(vertices, center - uAxis + vAxis, normal, glm::vec2(0.0f, 1.0f));
+
+		indices.push_back(first + 0);
+		indices.push_back(first + 1);
+		indices.push_back(first + 2);
+		indices.push_back(first + 0);
+		indices.push_back(first + 2);
+		indices.push_back(first + 3);
+	}
+
+	/***********************************************************
+	 *  AddTriangle()
+	 *
+	 *  Append a flat shaded triangle with CCW winding.
+	 ***********************************************************/
+	void AddTriangle(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		glm::vec3 a,
+		glm::vec3 b,
+		glm::vec3 c)
+	{
+		GLuint first = (GLuint)(vertices.size() / g_FloatsPerVertex);
+		glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+
+		AddVertex(vertices, a, normal, glm::vec2(0.0f, 0.0f));
+		AddVertex(vertices, b, normal, glm::vec2(1.0f, 0.0f));
+		AddVertex(vertices, c, normal, glm::vec2(0.5f, 1.0f));
+
+		indices.push_back(first + 0);
+		indices.push_back(first + 1);
+		indices.push_back(first + 2);
+	}
+
+	/***********************************************************
+	 *  AddGridIndices()
+	 *
+	 *  Append the triangles of a grid of vertices with rowLength
+	 *  vertices per row.  Going along a row and then to the next
+	 *  row must turn CCW around the outward normal.
+	 ***********************************************************/
+	void AddGridIndices(
+		std::vector<GLuint>& indices,
+		GLuint first,
+		int rows,
+		int rowLength)
+	{
+		for (int row = 0; row < rows; row++)
+		{
+			for (int column = 0; column < rowLength - 1; column++)
+			{
+				GLuint a = first + row * rowLength + column;
+				GLuint b = a + rowLength;
+
+				indices.push_back(a);
+				indices.push_back(a + 1);
+				indices.push_back(b);
+				indices.push_back(a + 1);
+				indices.push_back(b + 1);
+				indices.push_back(b);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  AddSphere()
+	 *
+	 *  Append a sphere of radius 1 centered at the origin, with
+	 *  rings from the top to the bottom.
+	 ***********************************************************/
+	void AddSphere(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		int segments,
+		int rings)
+	{
+		GLuint first = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+		for (int ring = 0; ring <= rings; ring++)
+		{
+			float phi = 0.5f * g_TwoPi * (float)ring / (float)rings;
+			for (int segment = 0; segment <= segments; segment++)
+			{
+				float theta = g_TwoPi * (float)segment / (float)segments;
+				glm::vec3 normal = glm::vec3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+
+				AddVertex(vertices, normal, normal,
+					glm::vec2((float)segment / (float)segments, 1.0f - (float)ring / (float)rings));
+			}
+		}
+		AddGridIndices(indices, first, rings, segments + 1);
+	}
+
+	/***********************************************************
+	 *  AddCylinder()
+	 *
+	 *  Append a closed cylinder standing 1 unit tall on the XZ
+	 *  axes, with a base of radius 1 and the passed in radius at
+	 *  the top.
+	 ***********************************************************/
+	void AddCylinder(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		int segments,
+		float topRadius)
+	{
+		// the sides, as a grid of the top and the bottom row
+		GLuint first = (GLuint)(vertices.size() / g_FloatsPerVertex);
+		for (int row = 0; row < 2; row++)
+		{
+			float radius = (row == 0) ? topRadius : 1.0f;
+			for (int segment = 0; segment <= segments; segment++)
+			{
+				float theta = g_TwoPi * (float)segment / (float)segments;
+				glm::vec3 around = glm::vec3(cosf(theta), 0.0f, sinf(theta));
+				glm::vec3 normal = glm::normalize(glm::vec3(around.x, 1.0f - topRadius, around.z));
+
+				AddVertex(vertices, around * radius + glm::vec3(0.0f, 1.0f - (float)row, 0.0f), normal,
+					glm::vec2((float)segment / (float)segments, 1.0f - (float)row));
+			}
+		}
+		AddGridIndices(indices, first, 1, segments + 1);
+
+		// the top and bottom caps, as fans around their centers
+		for (int cap = 0; cap < 2; cap++)
+		{
+			float height = (cap == 0) ? 1.0f : 0.0f;
+			float radius = (cap == 0) ? topRadius : 1.0f;
+			glm::vec3 normal = glm::vec3(0.0f, (cap == 0) ? 1.0f : -1.0f, 0.0f);
+			GLuint center = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+			AddVertex(vertices, glm::vec3(0.0f, height, 0.0f), normal, glm::vec2(0.5f, 0.5f));
+			for (int segment = 0; segment <= segments; segment++)
+			{
+				float theta = g_TwoPi * (float)segment / (float)segments;
+				AddVertex(vertices, glm::vec3(cosf(theta) * radius, height, sinf(theta) * radius), normal,
+					glm::vec2(0.5f + 0.5f * cosf(theta), 0.5f + 0.5f * sinf(theta)));
+			}
+			for (int segment = 0; segment < segments; segment++)
+			{
+				GLuint current = center + 1 + segment;
+				indices.push_back(center);
+				indices.push_back((cap == 0) ? current + 1 : current);
+				indices.push_back((cap == 0) ? current : current + 1);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  AddTorus()
+	 *
+	 *  Append a torus lying on the XY axes, with a main radius
+	 *  of 1 around the origin.
+	 ***********************************************************/
+	void AddTorus(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		int segments,
+		int tubeSegments)
+	{
+		GLuint first = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+		for (int segment = 0; segment <= segments; segment++)
+		{
+			float u = g_TwoPi * (float)segment / (float)segments;
+			glm::vec3 ringCenter = glm::vec3(cosf(u), sinf(u), 0.0f);
+			for (int tube = 0; tube <= tubeSegments; tube++)
+			{
+				float v = g_TwoPi * (float)tube / (float)tubeSegments;
+				glm::vec3 normal = glm::vec3(cosf(v) * cosf(u), cosf(v) * sinf(u), sinf(v));
+
+				AddVertex(vertices, ringCenter + normal * g_TorusTubeRadius, normal,
+					glm::vec2((float)segment / (float)segments, (float)tube / (float)tubeSegments));
+			}
+		}
+
+		// turning from along the ring to around the tube is CCW
+		// around the outward normal
+		for (int segment = 0; segment < segments; segment++)
+		{
+			for (int tube = 0; tube < tubeSegments; tube++)
+			{
+				GLuint a = first + segment * (tubeSegments + 1) + tube;
+				GLuint b = a + tubeSegments + 1;
+
+				indices.push_back(a);
+				indices.push_back(b);
+				indices.push_back(a + 1);
+				indices.push_back(b);
+				indices.push_back(b + 1);
+				indices.push_back(a + 1);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  EncodeOctahedral()
+	 *
+	 *  Project a unit normal onto the octahedron and unfold it
+	 *  into the square from -1 to 1, the lower half folded over
+	 *  the corners of the upper half.
+	 ***********************************************************/
+	glm::vec2 EncodeOctahedral(glm::vec3 normal)
+	{
+		float sum = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+		glm::vec2 folded = glm::vec2(normal.x / sum, normal.y / sum);
+
+		if (normal.z < 0.0f)
+		{
+			folded = glm::vec2(
+				(1.0f - fabsf(folded.y)) * ((folded.x >= 0.0f) ? 1.0f : -1.0f),
+				(1.0f - fabsf(folded.x)) * ((folded.y >= 0.0f) ? 1.0f : -1.0f));
+		}
+
+		return(folded);
+	}
+
+	/***********************************************************
+	 *  GetVertexStride()
+	 *
+	 *  Get the bytes of one vertex in a vertex format.
+	 ***********************************************************/
+	size_t GetVertexStride(InstancedMeshes::VERTEX_FORMAT format)
+	{
+		if (format == InstancedMeshes::VERTEX_COMPACT)
+		{
+			return(sizeof(COMPACT_VERTEX));
+		}
+		return(sizeof(GLfloat) * g_FloatsPerVertex);
+	}
+
+	/***********************************************************
+	 *  PackVertices()
+	 *
+	 *  Write generated vertices in the layout of a vertex format.
+	 ***********************************************************/
+	void PackVertices(
+		const std::vector<GLfloat>& vertices,
+		InstancedMeshes::VERTEX_FORMAT format,
+		std::vector<unsigned char>& data)
+	{
+		size_t vertexCount = vertices.size() / g_FloatsPerVertex;
+
+		data.resize(vertexCount * GetVertexStride(format));
+		if (format != InstancedMeshes::VERTEX_COMPACT)
+		{
+			memcpy(data.data(), vertices.data(), data.size());
+			return;
+		}
+
+		COMPACT_VERTEX* pVertex = (COMPACT_VERTEX*)data.data();
+		for (size_t i = 0; i < vertexCount; i++, pVertex++)
+		{
+			const GLfloat* pSource = &vertices[i * g_FloatsPerVertex];
+
+			pVertex->position[0] = pSource[0];
+			pVertex->position[1] = pSource[1];
+			pVertex->position[2] = pSource[2];
+			pVertex->normal = glm::packSnorm2x16(EncodeOctahedral(glm::vec3(pSource[3], pSource[4], pSource[5])));
+			pVertex->texCoord = glm::packHalf2x16(glm::vec2(pSource[6], pSource[7]));
+		}
+	}
+}
+
+/***********************************************************
+ *  InstancedMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InstancedMeshes::InstancedMeshes()
+{
+	for (int i = 0; i < MESH_KIND_COUNT; i++)
+	{
+		for (int lod = 0; lod < LOD_COUNT; lod++)
+		{
+			m_meshRanges[i][lod].firstIndex = 0;
+			m_meshRanges[i][lod].indexCount = 0;
+			m_meshRanges[i][lod].baseVertex = 0;
+		}
+	}
+	m_largestMesh = 0;
+	m_vertexFormat = VERTEX_COMPACT;
+	m_indexType = GL_UNSIGNED_INT;
+	m_indexSize = sizeof(GLuint);
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_vao = 0;
+	m_instanceBuffer = 0;
+	m_instanceCapacity = 0;
+	m_indirectVao = 0;
+	m_indirectInstanceBuffer = 0;
+	m_pInstanceRing = NULL;
+	m_ringVao = 0;
+	if (FrameRing::IsSupported() == true)
+	{
+		m_pInstanceRing = new FrameRing(GL_ARRAY_BUFFER, g_InstanceRingSize);
+	}
+}
+
+/***********************************************************
+ *  ~InstancedMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InstancedMeshes::~InstancedMeshes()
+{
+	if (0 != m_vao)
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		glDeleteBuffers(1, &m_vertexBuffer);
+		glDeleteBuffers(1, &m_indexBuffer);
+		m_vao = 0;
+	}
+	if (0 != m_indirectVao)
+	{
+		glDeleteVertexArrays(1, &m_indirectVao);
+		m_indirectVao = 0;
+	}
+	if (0 != m_instanceBuffer)
+	{
+		glDeleteBuffers(1, &m_instanceBuffer);
+		m_instanceBuffer = 0;
+	}
+	if (0 != m_ringVao)
+	{
+		glDeleteVertexArrays(1, &m_ringVao);
+		m_ringVao = 0;
+	}
+	if (NULL != m_pInstanceRing)
+	{
+		delete m_pInstanceRing;
+		m_pInstanceRing = NULL;
+	}
+}
+
+/***********************************************************
+ *  LoadMesh()
+ *
+ *  This method is used for generating the vertex data of a
+ *  shape mesh at each of its levels of detail.  The sizes
+ *  match the ShapeMeshes class, so the same scale, rotation
+ *  and position values can be used for both.  The data is
+ *  read from the cache file of the mesh when it is up to
+ *  date, otherwise it is generated and the file written.
+ ***********************************************************/
+void InstancedMeshes::LoadMesh(MESH_KIND meshKind)
+{
+	if (0 != m_meshRanges[meshKind][0].indexCount)
+	{
+		return;
+	}
+
+	std::vector<GLfloat> vertices[LOD_COUNT];
+	std::vector<GLuint> indices[LOD_COUNT];
+	if (LoadCache(meshKind, vertices, indices) == false)
+	{
+		for (int lod = 0; lod < GetLodCount(meshKind); lod++)
+		{
+			BuildMesh(meshKind, g_LodSegments[lod], vertices[lod], indices[lod]);
+		}
+		SaveCache(meshKind, vertices, indices);
+	}
+
+	for (int lod = 0; lod < GetLodCount(meshKind); lod++)
+	{
+		AddMesh(meshKind, lod, vertices[lod], indices[lod]);
+	}
+
+	// meshes with a single level draw it at every level
+	for (int lod = GetLodCount(meshKind); lod < LOD_COUNT; lod++)
+	{
+		m_meshRanges[meshKind][lod] = m_meshRanges[meshKind][0];
+	}
+
+	UploadMeshes();
+}
+
+/***********************************************************
+ *  BuildMesh()
+ *
+ *  This method is used for generating the vertex data of a
+ *  shape mesh, with the passed in number of segments around
+ *  the curved meshes.
+ ***********************************************************/
+void InstancedMeshes::BuildMesh(
+	MESH_KIND meshKind,
+	int segments,
+	std::vector<GLfloat>& vertices,
+	std::vector<GLuint>& indices)
+{
+	switch (meshKind)
+	{
+	case MESH_PLANE:
+		// 2x2 plane lying flat on the XZ axes
+		AddQuad(vertices, indices,
+			glm::vec3(0.0f, 0.0f, 0.0f),
+			glm::vec3(1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, -1.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f));
+		break;
+
+	case MESH_BOX:
+		// unit cube centered at the origin, one quad per face
+		AddQuad(vertices, indices, glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		AddQuad(vertices, indices, glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+		AddQuad(vertices, indices, glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+		AddQuad(vertices, indices, glm::vec3(-0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f));
+		AddQuad(vertices, indices, glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -0.5f), glm::vec3(0.0f, 1.0f, 0.0f));
+		AddQuad(vertices, indices, glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, -1.0f, 0.0f));
+		break;
+
+	case MESH_PYRAMID4:
+	{
+		// unit square base centered under an apex 1 unit above it
+		glm::vec3 apex = glm::vec3(0.0f, 0.5f, 0.0f);
+		glm::vec3 frontLeft = glm::vec3(-0.5f, -0.5f, 0.5f);
+		glm::vec3 frontRight = glm::vec3(0.5f, -0.5f, 0.5f);
+		glm::vec3 backRight = glm::vec3(0.5f, -0.5f, -0.5f);
+		glm::vec3 backLeft = glm::vec3(-0.5f, -0.5f, -0.5f);
+
+		AddQuad(vertices, indices, glm::vec3(0.0f, -0.5f, 0.0f), glm::vec3(0.5f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.5f), glm::vec3(0.0f, -1.0f, 0.0f));
+		AddTriangle(vertices, indices, frontLeft, frontRight, apex);
+		AddTriangle(vertices, indices, frontRight, backRight, apex);
+		AddTriangle(vertices, indices, backRight, backLeft, apex);
+		AddTriangle(vertices, indices, backLeft, frontLeft, apex);
+		break;
+	}
+
+	case MESH_SPHERE:
+		AddSphere(vertices, indices, segments, segments / 2);
+		break;
+
+	case MESH_CYLINDER:
+		AddCylinder(vertices, indices, segments, 1.0f);
+		break;
+
+	case MESH_TAPERED_CYLINDER:
+		AddCylinder(vertices, indices, segments, g_TaperedTopRadius);
+		break;
+
+	case MESH_TORUS:
+		AddTorus(vertices, indices, segments, segments / 2);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for appending generated vertex data
+ *  to the shared vertex and index buffers.  The indices stay
+ *  relative to the first vertex of the mesh, which is passed
+ *  to the draws as the base vertex.
+ ***********************************************************/
+void InstancedMeshes::AddMesh(
+	MESH_KIND meshKind,
+	int lod,
+	const std::vector<GLfloat>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	MESH_RANGE& range = m_meshRanges[meshKind][lod];
+
+	range.firstIndex = (GLuint)m_indices.size();
+	range.indexCount = (GLuint)indices.size();
+	range.baseVertex = (GLint)(m_vertices.size() / g_FloatsPerVertex);
+	m_vertices.insert(m_vertices.end(), vertices.begin(), vertices.end());
+	m_indices.insert(m_indices.end(), indices.begin(), indices.end());
+	m_largestMesh = std::max(m_largestMesh, (GLuint)(vertices.size() / g_FloatsPerVertex));
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for getting the cache file path for
+ *  the passed in mesh kind.
+ ***********************************************************/
+std::string InstancedMeshes::GetCachePath(MESH_KIND meshKind)
+{
+	return(std::string(g_CachePrefix) + g_MeshNames[meshKind] + g_CacheExtension);
+}
+
+/***********************************************************
+ *  LoadCache()
+ *
+ *  This method is used for reading the generated vertex data
+ *  of every level of a mesh from its cache file.  False is
+ *  returned if there is no cache file, if it was written
+ *  with another tessellation, or if its indices reach past
+ *  its vertices.
+ ***********************************************************/
+bool InstancedMeshes::LoadCache(
+	MESH_KIND meshKind,
+	std::vector<GLfloat> vertices[LOD_COUNT],
+	std::vector<GLuint> indices[LOD_COUNT])
+{
+	std::ifstream cacheFile(GetCachePath(meshKind).c_str(), std::ios::binary);
+	if (!cacheFile)
+	{
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	cacheFile.read((char*)&header, sizeof(header));
+	if (!cacheFile ||
+		(header.magic != g_CacheMagic) ||
+		(header.version != g_CacheVersion) ||
+		(header.meshKind != (uint32_t)meshKind) ||
+		(header.lodCount != (uint32_t)GetLodCount(meshKind)) ||
+		(header.torusTubeRadius != g_TorusTubeRadius) ||
+		(header.taperedTopRadius != g_TaperedTopRadius))
+	{
+		return(false);
+	}
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		if (header.lodSegments[lod] != g_LodSegments[lod])
+		{
+			return(false);
+		}
+	}
+
+	for (uint32_t lod = 0; lod < header.lodCount; lod++)
+	{
+		LEVEL_HEADER level;
+		cacheFile.read((char*)&level, sizeof(level));
+		if (!cacheFile || (level.vertexCount == 0) || (level.indexCount == 0))
+		{
+			return(false);
+		}
+
+		vertices[lod].resize((size_t)level.vertexCount * g_FloatsPerVertex);
+		indices[lod].resize(level.indexCount);
+		cacheFile.read((char*)vertices[lod].data(), vertices[lod].size() * sizeof(GLfloat));
+		cacheFile.read((char*)indices[lod].data(), indices[lod].size() * sizeof(GLuint));
+		if (!cacheFile ||
+			(*std::max_element(indices[lod].begin(), indices[lod].end()) >= level.vertexCount))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SaveCache()
+ *
+ *  This method is used for writing the generated vertex data
+ *  of every level of a mesh to its cache file.
+ ***********************************************************/
+bool InstancedMeshes::SaveCache(
+	MESH_KIND meshKind,
+	const std::vector<GLfloat> vertices[LOD_COUNT],
+	const std::vector<GLuint> indices[LOD_COUNT])
+{
+	std::ofstream cacheFile(GetCachePath(meshKind).c_str(), std::ios::binary | std::ios::trunc);
+	if (!cacheFile)
+	{
+		std::cout << "Could not write mesh cache:" << GetCachePath(meshKind) << std::endl;
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	header.magic = g_CacheMagic;
+	header.version = g_CacheVersion;
+	header.meshKind = (uint32_t)meshKind;
+	header.lodCount = (uint32_t)GetLodCount(meshKind);
+	for (int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		header.lodSegments[lod] = g_LodSegments[lod];
+	}
+	header.torusTubeRadius = g_TorusTubeRadius;
+	header.taperedTopRadius = g_TaperedTopRadius;
+	cacheFile.write((const char*)&header, sizeof(header));
+
+	for (uint32_t lod = 0; lod < header.lodCount; lod++)
+	{
+		LEVEL_HEADER level;
+		level.vertexCount = (uint32_t)(vertices[lod].size() / g_FloatsPerVertex);
+		level.indexCount = (uint32_t)indices[lod].size();
+		cacheFile.write((const char*)&level, sizeof(level));
+		cacheFile.write((const char*)vertices[lod].data(), vertices[lod].size() * sizeof(GLfloat));
+		cacheFile.write((const char*)indices[lod].data(), indices[lod].size() * sizeof(GLuint));
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ParseVertexFormat()
+ *
+ *  This method is used for finding the vertex format with
+ *  the passed in name.
+ ***********************************************************/
+bool InstancedMeshes::ParseVertexFormat(const char* name, VERTEX_FORMAT& format)
+{
+	for (int i = 0; i < VERTEX_FORMAT_COUNT; i++)
+	{
+		if (strcmp(name, g_VertexFormatNames[i]) == 0)
+		{
+			format = (VERTEX_FORMAT)i;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  SetVertexFormat()
+ *
+ *  This method is used for filling the shared buffers again
+ *  with the loaded meshes in another layout.  The attributes
+ *  of the vertex arrays are described again for it, and the
+ *  indirect one on its next draw.
+ ***********************************************************/
+void InstancedMeshes::SetVertexFormat(VERTEX_FORMAT format)
+{
+	if (format == m_vertexFormat)
+	{
+		return;
+	}
+
+	m_vertexFormat = format;
+	if (0 == m_vao)
+	{
+		return;
+	}
+
+	UploadMeshes();
+	SetupVertexArray(m_vao, m_instanceBuffer);
+	if (0 != m_ringVao)
+	{
+		SetupVertexArray(m_ringVao, m_pInstanceRing->GetBuffer());
+	}
+	m_indirectInstanceBuffer = 0;
+}
+
+/***********************************************************
+ *  GetVertexCount()
+ *
+ *  This method is used for getting how many vertices the
+ *  loaded meshes have, at all their levels of detail.
+ ***********************************************************/
+int InstancedMeshes::GetVertexCount() const
+{
+	return((int)(m_vertices.size() / g_FloatsPerVertex));
+}
+
+/***********************************************************
+ *  IsShortIndexed()
+ *
+ *  This method is used for checking whether the indices are
+ *  stored in 16 bits in a layout.  The compact one does when
+ *  no mesh has more vertices than 16 bits can index, since
+ *  the indices of a mesh start over at its base vertex.
+ ***********************************************************/
+bool InstancedMeshes::IsShortIndexed(VERTEX_FORMAT format) const
+{
+	return((format == VERTEX_COMPACT) && (m_largestMesh <= 65536));
+}
+
+/***********************************************************
+ *  GetMeshBytes()
+ *
+ *  This method is used for getting the bytes the vertices
+ *  and indices of the loaded meshes take in the buffers when
+ *  held in a layout, for comparing the layouts.
+ ***********************************************************/
+size_t InstancedMeshes::GetMeshBytes(VERTEX_FORMAT format) const
+{
+	size_t indexSize = (IsShortIndexed(format) == true) ? sizeof(GLushort) : sizeof(GLuint);
+
+	return(GetVertexCount() * GetVertexStride(format) + m_indices.size() * indexSize);
+}
+
+/***********************************************************
+ *  UploadMeshes()
+ *
+ *  This method is used for filling the shared vertex and
+ *  index buffers with the vertex data of every loaded mesh,
+ *  packed into the layout of the vertex format.
+ ***********************************************************/
+void InstancedMeshes::UploadMeshes()
+{
+	if (0 == m_vao)
+	{
+		glGenBuffers(1, &m_vertexBuffer);
+		glGenBuffers(1, &m_indexBuffer);
+		glGenBuffers(1, &m_instanceBuffer);
+		glGenVertexArrays(1, &m_vao);
+		SetupVertexArray(m_vao, m_instanceBuffer);
+		if (NULL != m_pInstanceRing)
+		{
+			glGenVertexArrays(1, &m_ringVao);
+			SetupVertexArray(m_ringVao, m_pInstanceRing->GetBuffer());
+		}
+	}
+
+	std::vector<unsigned char> vertexData;
+	PackVertices(m_vertices, m_vertexFormat, vertexData);
+	m_indexType = (IsShortIndexed(m_vertexFormat) == true) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	m_indexSize = (m_indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+
+	// the meshes are small, so the whole buffers are filled again,
+	// the index buffer through the own VAO so no other VAO changes
+	glBindVertexArray(m_vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexData.size(), vertexData.data(), GL_STATIC_DRAW);
+	if (m_indexType == GL_UNSIGNED_SHORT)
+	{
+		std::vector<GLushort> shortIndices(m_indices.begin(), m_indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(GLushort), shortIndices.data(), GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(GLuint), m_indices.data(), GL_STATIC_DRAW);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetupVertexArray()
+ *
+ *  This method is used for describing both the per-vertex
+ *  attributes of the shared buffers, in the layout of the
+ *  vertex format, and the per-instance attributes of the
+ *  passed in instance buffer in a VAO.  The packed normals
+ *  of the compact layout are read as two normalized values
+ *  that the vertex shader unfolds.
+ ***********************************************************/
+void InstancedMeshes::SetupVertexArray(GLuint vao, GLuint instanceBuffer)
+{
+	const GLsizei vertexStride = (GLsizei)GetVertexStride(m_vertexFormat);
+	const GLsizei instanceStride = sizeof(INSTANCE_DATA);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+
+	// per-vertex attributes
+	if (m_vertexFormat == VERTEX_COMPACT)
+	{
+		glVertexAttribPointer(g_PositionAttribute, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)offsetof(COMPACT_VERTEX, position));
+		glVertexAttribPointer(g_NormalAttribute, 2, GL_SHORT, GL_TRUE, vertexStride, (void*)offsetof(COMPACT_VERTEX, normal));
+		glVertexAttribPointer(g_TexCoordAttribute, 2, GL_HALF_FLOAT, GL_FALSE, vertexStride, (void*)offsetof(COMPACT_VERTEX, texCoord));
+	}
+	else
+	{
+		glVertexAttribPointer(g_PositionAttribute, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)0);
+		glVertexAttribPointer(g_NormalAttribute, 3, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(GLfloat) * 3));
+		glVertexAttribPointer(g_TexCoordAttribute, 2, GL_FLOAT, GL_FALSE, vertexStride, (void*)(sizeof(GLfloat) * 6));
+	}
+	glEnableVertexAttribArray(g_PositionAttribute);
+	glEnableVertexAttribArray(g_NormalAttribute);
+	glEnableVertexAttribArray(g_TexCoordAttribute);
+
+	// per-instance attributes, advanced once per drawn instance
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(g_ModelAttribute + column, 4, GL_FLOAT, GL_FALSE, instanceStride,
+			(void*)(offsetof(INSTANCE_DATA, model) + sizeof(glm::vec4) * column));
+		glEnableVertexAttribArray(g_ModelAttribute + column);
+		glVertexAttribDivisor(g_ModelAttribute + column, 1);
+	}
+	glVertexAttribPointer(g_UVScaleAttribute, 2, GL_FLOAT, GL_FALSE, instanceStride, (void*)offsetof(INSTANCE_DATA, UVscale));
+	glEnableVertexAttribArray(g_UVScaleAttribute);
+	glVertexAttribDivisor(g_UVScaleAttribute, 1);
+	glVertexAttribIPointer(g_MaterialAttribute, 1, GL_INT, instanceStride, (void*)offsetof(INSTANCE_DATA, materialIndex));
+	glEnableVertexAttribArray(g_MaterialAttribute);
+	glVertexAttribDivisor(g_MaterialAttribute, 1);
+	glVertexAttribIPointer(g_TextureLayerAttribute, 1, GL_INT, instanceStride, (void*)offsetof(INSTANCE_DATA, textureLayer));
+	glEnableVertexAttribArray(g_TextureLayerAttribute);
+	glVertexAttribDivisor(g_TextureLayerAttribute, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving the instance uploads to
+ *  the region of the next frame.  A ring buffer that had to
+ *  grow is a new buffer, so its vertex array is set up
+ *  again.
+ ***********************************************************/
+void InstancedMeshes::BeginFrame()
+{
+	if (NULL == m_pInstanceRing)
+	{
+		return;
+	}
+
+	if ((m_pInstanceRing->BeginFrame() == true) && (0 != m_ringVao))
+	{
+		SetupVertexArray(m_ringVao, m_pInstanceRing->GetBuffer());
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the instance uploads of
+ *  the frame after its last draw.
+ ***********************************************************/
+void InstancedMeshes::EndFrame()
+{
+	if (NULL != m_pInstanceRing)
+	{
+		m_pInstanceRing->EndFrame();
+	}
+}
+
+/***********************************************************
+ *  DrawInstanced()
+ *
+ *  This method is used for uploading the passed in instance
+ *  data with one buffer update and drawing every instance
+ *  of the shape mesh with one instanced draw call.  With a
+ *  frame ring the upload is a copy into mapped memory, and a
+ *  frame that does not fit its region uploads the rest the
+ *  old way until the ring grows.
+ ***********************************************************/
+void InstancedMeshes::DrawInstanced(
+	MESH_KIND meshKind,
+	const INSTANCE_DATA* pInstances,
+	size_t instanceCount,
+	int lod)
+{
+	const MESH_RANGE& range = m_meshRanges[meshKind][lod];
+
+	if ((0 == range.indexCount) || (0 == instanceCount))
+	{
+		return;
+	}
+
+	size_t size = instanceCount * sizeof(INSTANCE_DATA);
+	GLintptr offset = 0;
+	void* pRing = NULL;
+	if ((NULL != m_pInstanceRing) && (0 != m_ringVao))
+	{
+		pRing = m_pInstanceRing->Allocate(size, sizeof(INSTANCE_DATA), offset);
+	}
+	if (NULL != pRing)
+	{
+		memcpy(pRing, pInstances, size);
+
+		glBindVertexArray(m_ringVao);
+		glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.indexCount, m_indexType,
+			(void*)(m_indexSize * range.firstIndex), (GLsizei)instanceCount, range.baseVertex,
+			(GLuint)(offset / sizeof(INSTANCE_DATA)));
+		glBindVertexArray(0);
+		return;
+	}
+
+	// grow the buffer when needed, otherwise orphan the old storage so
+	// the upload does not wait on draws still reading last frame's data
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+	if (instanceCount > m_instanceCapacity)
+	{
+		m_instanceCapacity = instanceCount;
+	}
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(INSTANCE_DATA), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(INSTANCE_DATA), pInstances);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindVertexArray(m_vao);
+	glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.indexCount, m_indexType,
+		(void*)(m_indexSize * range.firstIndex), (GLsizei)instanceCount, range.baseVertex);
+	glBindVertexArray(0);
+}
+
+void InstancedMeshes::DrawInstanced(
+	MESH_KIND meshKind,
+	const std::vector<INSTANCE_DATA>& instances,
+	int lod)
+{
+	DrawInstanced(meshKind, instances.data(), instances.size(), lod);
+}
+
+/***********************************************************
+ *  GetLodCount()
+ *
+ *  This method is used for getting how many levels of detail
+ *  a mesh has.  The flat sided meshes only have one.
+ ***********************************************************/
+int InstancedMeshes::GetLodCount(MESH_KIND meshKind)
+{
+	switch (meshKind)
+	{
+	case MESH_SPHERE:
+	case MESH_CYLINDER:
+	case MESH_TAPERED_CYLINDER:
+	case MESH_TORUS:
+		return(LOD_COUNT);
+	default:
+		return(1);
+	}
+}
+
+/***********************************************************
+ *  SelectLod()
+ *
+ *  This method is used for picking the level of detail of
+ *  an object from its size on the screen.  A threshold is
+ *  moved away from the current level by the hysteresis
+ *  margin, so an object has to grow or shrink clearly past
+ *  it before its level changes.
+ ***********************************************************/
+int InstancedMeshes::SelectLod(MESH_KIND meshKind, float screenSize, int currentLod)
+{
+	int lodCount = GetLodCount(meshKind);
+	int lod = 0;
+
+	while (lod < lodCount - 1)
+	{
+		float margin = (currentLod > lod) ? (1.0f + g_LodHysteresis) : (1.0f - g_LodHysteresis);
+		if (screenSize >= g_LodScreenSizes[lod] * margin)
+		{
+			break;
+		}
+		lod++;
+	}
+
+	return(lod);
+}
+
+/***********************************************************
+ *  GetLodScreenSize()
+ *
+ *  This method is used for getting the screen size below
+ *  which the level after the passed in one is picked.
+ ***********************************************************/
+float InstancedMeshes::GetLodScreenSize(int lod)
+{
+	return(g_LodScreenSizes[lod]);
+}
+
+/***********************************************************
+ *  GetLodHysteresis()
+ *
+ *  This method is used for getting the share of a threshold
+ *  that sizes have to move past it to change the level.
+ ***********************************************************/
+float InstancedMeshes::GetLodHysteresis()
+{
+	return(g_LodHysteresis);
+}
+
+/***********************************************************
+ *  MakeDrawCommand()
+ *
+ *  This method is used for filling in the indirect command
+ *  that draws instances of a shape mesh.
+ ***********************************************************/
+InstancedMeshes::DRAW_COMMAND InstancedMeshes::MakeDrawCommand(
+	MESH_KIND meshKind,
+	GLuint baseInstance,
+	GLuint instanceCount,
+	int lod) const
+{
+	DRAW_COMMAND command;
+
+	command.count = m_meshRanges[meshKind][lod].indexCount;
+	command.instanceCount = instanceCount;
+	command.firstIndex = m_meshRanges[meshKind][lod].firstIndex;
+	command.baseVertex = m_meshRanges[meshKind][lod].baseVertex;
+	command.baseInstance = baseInstance;
+
+	return(command);
+}
+
+/***********************************************************
+ *  DrawIndirect()
+ *
+ *  This method is used for drawing a range of the commands
+ *  of a command buffer with one multi draw call.  The base
+ *  instance of each command offsets where its instance
+ *  attributes start in the instance buffer.
+ ***********************************************************/
+void InstancedMeshes::DrawIndirect(
+	GLuint instanceBuffer,
+	GLuint commandBuffer,
+	int firstCommand,
+	int commandCount)
+{
+	if ((0 == m_vao) || (commandCount <= 0))
+	{
+		return;
+	}
+
+	if (0 == m_indirectVao)
+	{
+		glGenVertexArrays(1, &m_indirectVao);
+	}
+	if (m_indirectInstanceBuffer != instanceBuffer)
+	{
+		SetupVertexArray(m_indirectVao, instanceBuffer);
+		m_indirectInstanceBuffer = instanceBuffer;
+	}
+
+	glBindVertexArray(m_indirectVao);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, m_indexType,
+		(void*)(sizeof(DRAW_COMMAND) * firstCommand), commandCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedmeshes.h
+// ============
+// draw many copies of a basic shape mesh with a single instanced draw call
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameRing.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  InstancedMeshes
+ *
+ *  This class holds its own copy of the basic shape meshes,
+ *  built with the same dimensions and vertex layout as the
+ *  ShapeMeshes class, plus a per-instance attribute buffer.
+ *  All the instances passed to DrawInstanced() are uploaded
+ *  in one buffer update and drawn with one draw call.  When
+ *  the context has a frame ring the instances are copied
+ *  into the region of the frame instead, and the draw starts
+ *  reading at their place with its base instance.
+ *
+ *  The meshes share one vertex and one index buffer, and a
+ *  table keeps where each mesh starts in them.  That lets
+ *  DrawIndirect() draw several meshes with a single multi
+ *  draw, reading the draw commands from a GPU buffer.
+ *
+ *  The curved meshes are built at several levels of detail,
+ *  from finely to coarsely tessellated, and SelectLod() picks
+ *  the level for the size an object covers on the screen.
+ *
+ *  The generated vertex data of a mesh is kept in a cache
+ *  file, keyed by the tessellation it was built with, so
+ *  later launches read it instead of generating it again.
+ *  The buffers hold the vertices in the full float layout or
+ *  in a compact one, packed from the generated floats when
+ *  they are filled.
+ ***********************************************************/
+class InstancedMeshes
+{
+public:
+	// constructor
+	InstancedMeshes();
+	// destructor
+	~InstancedMeshes();
+
+	// the shape meshes that can be drawn instanced
+	enum MESH_KIND
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_PYRAMID4,
+		MESH_SPHERE,
+		MESH_CYLINDER,
+		MESH_TAPERED_CYLINDER,
+		MESH_TORUS,
+		MESH_KIND_COUNT
+	};
+
+	// levels of detail of the curved meshes, level 0 is the finest
+	static const int LOD_COUNT = 3;
+
+	// layouts the shared vertex and index buffers hold the meshes in
+	enum VERTEX_FORMAT
+	{
+		// float positions, normals and texture coordinates with 32 bit
+		// indices, 32 bytes per vertex as in ShapeMeshes
+		VERTEX_FULL = 0,
+		// float positions, octahedral normals in two 16 bit snorms and
+		// half float texture coordinates, 20 bytes per vertex, with 16
+		// bit indices while every mesh has few enough vertices
+		VERTEX_COMPACT,
+		VERTEX_FORMAT_COUNT
+	};
+
+	// per-instance values, laid out to match the instance attributes
+	// of shaders/instancedVertexShader.glsl
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		glm::vec2 UVscale;
+		int materialIndex;
+		// layer of the bound texture array, -1 draws with a color
+		int textureLayer;
+	};
+
+	// one draw of an indirect command buffer, laid out the way
+	// glMultiDrawElementsIndirect() reads it
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// build the vertex data in GPU memory for a shape mesh, at every
+	// level of detail it has
+	void LoadMesh(MESH_KIND meshKind);
+
+	// find the vertex format with the passed in name
+	static bool ParseVertexFormat(const char* name, VERTEX_FORMAT& format);
+	// fill the buffers again with the loaded meshes in another layout,
+	// the instanced program must unpack the normals of the compact one
+	void SetVertexFormat(VERTEX_FORMAT format);
+	VERTEX_FORMAT GetVertexFormat() const { return(m_vertexFormat); }
+	// vertices of the loaded meshes, at every level of detail
+	int GetVertexCount() const;
+	// bytes the vertices and indices of the loaded meshes take in the
+	// buffers when they are held in the passed in layout
+	size_t GetMeshBytes(VERTEX_FORMAT format) const;
+
+	// number of levels of detail a mesh is built with
+	static int GetLodCount(MESH_KIND meshKind);
+	// pick the level of detail for an object whose bounding sphere
+	// covers screenSize of half the screen height, the current level
+	// is only left once the size is clearly past a threshold
+	static int SelectLod(MESH_KIND meshKind, float screenSize, int currentLod);
+	// thresholds and margin SelectLod() uses, for shaders doing the same
+	static float GetLodScreenSize(int lod);
+	static float GetLodHysteresis();
+
+	// start and end the instance uploads of a frame
+	void BeginFrame();
+	void EndFrame();
+
+	// draw every passed in instance of a shape mesh, the caller
+	// must have the instanced shader program in use
+	void DrawInstanced(MESH_KIND meshKind, const INSTANCE_DATA* pInstances, size_t instanceCount, int lod = 0);
+	void DrawInstanced(MESH_KIND meshKind, const std::vector<INSTANCE_DATA>& instances, int lod = 0);
+
+	// make the command drawing instances of a mesh, the instances are
+	// read from the instance buffer starting at baseInstance
+	DRAW_COMMAND MakeDrawCommand(MESH_KIND meshKind, GLuint baseInstance, GLuint instanceCount, int lod = 0) const;
+	// draw a range of the commands in a command buffer with one call,
+	// the instance attributes are read from the passed in buffer
+	void DrawIndirect(GLuint instanceBuffer, GLuint commandBuffer, int firstCommand, int commandCount);
+
+private:
+	// where a mesh is in the shared vertex and index buffers
+	struct MESH_RANGE
+	{
+		GLuint firstIndex;
+		GLuint indexCount;		// 0 until the mesh is loaded
+		GLint baseVertex;
+	};
+
+	MESH_RANGE m_meshRanges[MESH_KIND_COUNT][LOD_COUNT];
+	// the generated vertex data of every loaded mesh, kept so the
+	// shared buffers can be filled again when another mesh is loaded
+	std::vector<GLfloat> m_vertices;
+	std::vector<GLuint> m_indices;
+	// most vertices of one loaded mesh, its indices are relative to
+	// its own first vertex
+	GLuint m_largestMesh;
+	// layout the buffers hold the meshes in, and the type and size of
+	// the indices in it
+	VERTEX_FORMAT m_vertexFormat;
+	GLenum m_indexType;
+	size_t m_indexSize;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	GLuint m_vao;
+	// buffer for the per-instance attributes of DrawInstanced()
+	GLuint m_instanceBuffer;
+	// allocated size of the instance buffer, in instances
+	size_t m_instanceCapacity;
+	// regions the instances of each frame are copied into, NULL when
+	// the context can not map buffers persistently, and the vertex
+	// array reading the instances from it
+	FrameRing* m_pInstanceRing;
+	GLuint m_ringVao;
+	// vertex array reading the instances of DrawIndirect(), and the
+	// instance buffer it is set up with
+	GLuint m_indirectVao;
+	GLuint m_indirectInstanceBuffer;
+
+	// add generated vertex data to the shared buffers
+	void AddMesh(MESH_KIND meshKind, int lod, const std::vector<GLfloat>& vertices, const std::vector<GLuint>& indices);
+	// fill the shared buffers with the vertex data of every mesh
+	void UploadMeshes();
+	// generate the vertex data of a mesh at one level of detail
+	static void BuildMesh(MESH_KIND meshKind, int segments, std::vector<GLfloat>& vertices, std::vector<GLuint>& indices);
+	// check whether the indices fit 16 bits in the passed in layout
+	bool IsShortIndexed(VERTEX_FORMAT format) const;
+
+	// get the path of the cache file of a mesh
+	static std::string GetCachePath(MESH_KIND meshKind);
+	// read the generated vertex data of every level of a mesh from its
+	// cache file, false when there is none or it is out of date
+	static bool LoadCache(MESH_KIND meshKind, std::vector<GLfloat> vertices[LOD_COUNT], std::vector<GLuint> indices[LOD_COUNT]);
+	// write the generated vertex data of every level of a mesh
+	static bool SaveCache(MESH_KIND meshKind, const std::vector<GLfloat> vertices[LOD_COUNT], const std::vector<GLuint> indices[LOD_COUNT]);
+	// describe the per-vertex and per-instance attributes in a VAO
+	void SetupVertexArray(GLuint vao, GLuint instanceBuffer);
+};
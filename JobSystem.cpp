@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// pool of worker threads that split loops over the scene into jobs and steal
+// work from each other so every core stays busy until the loop is done
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <algorithm>
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class - starts the worker threads
+ ***********************************************************/
+JobSystem::JobSystem(unsigned int numWorkers)
+{
+	m_queuedJobs = 0;
+	m_bShutdown = false;
+
+	// the calling thread works on the jobs too, so it gets no worker
+	if (numWorkers == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		numWorkers = (cores > 1) ? cores - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i <= numWorkers; i++)
+	{
+		m_queues.push_back(new JOB_QUEUE());
+	}
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, (int)i + 1));
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class - stops the worker threads
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bShutdown = true;
+	}
+	m_jobReady.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+
+	for (size_t i = 0; i < m_queues.size(); i++)
+	{
+		delete m_queues[i];
+	}
+	m_queues.clear();
+}
+
+/***********************************************************
+ *  GetChunkCount()
+ *
+ *  This method is used for getting how many chunks a range
+ *  of items is split into, so per chunk output can be sized
+ *  before the jobs run.
+ ***********************************************************/
+int JobSystem::GetChunkCount(int count, int chunkSize)
+{
+	if ((count <= 0) || (chunkSize <= 0))
+	{
+		return(0);
+	}
+	return((count + chunkSize - 1) / chunkSize);
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a function over a range
+ *  of items on all the threads.  A range that fits in one
+ *  chunk is run directly on the calling thread.
+ ***********************************************************/
+void JobSystem::ParallelFor(int count, int chunkSize, const RANGE_FUNCTION& function)
+{
+	int chunkCount = GetChunkCount(count, chunkSize);
+	if (chunkCount == 0)
+	{
+		return;
+	}
+	if ((chunkCount == 1) || (m_workers.empty()))
+	{
+		for (int chunk = 0; chunk < chunkCount; chunk++)
+		{
+			function(chunk * chunkSize, std::min(count, (chunk + 1) * chunkSize), chunk);
+		}
+		return;
+	}
+
+	std::atomic<int> remaining(chunkCount);
+
+	// deal the chunks out so every thread starts with its share
+	for (int chunk = 0; chunk < chunkCount; chunk++)
+	{
+		JOB job;
+		job.pFunction = &function;
+		job.begin = chunk * chunkSize;
+		job.end = std::min(count, (chunk + 1) * chunkSize);
+		job.chunk = chunk;
+		job.pRemaining = &remaining;
+
+		JOB_QUEUE* pQueue = m_queues[chunk % m_queues.size()];
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		pQueue->jobs.push_back(job);
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_queuedJobs += chunkCount;
+	}
+	m_jobReady.notify_all();
+
+	// help until the last chunk is done, the chunks still running
+	// on the workers may be what is left
+	while (remaining > 0)
+	{
+		JOB job;
+		if (PopJob(0, job) == true)
+		{
+			RunJob(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  PopJob()
+ *
+ *  This method is used for taking the next job of a thread.
+ *  The newest job of the own queue is taken first, since its
+ *  items are the most likely to still be in the cache, then
+ *  the oldest job of each of the other queues.
+ ***********************************************************/
+bool JobSystem::PopJob(int queueIndex, JOB& job)
+{
+	for (size_t i = 0; i < m_queues.size(); i++)
+	{
+		JOB_QUEUE* pQueue = m_queues[(queueIndex + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+
+		if (pQueue->jobs.empty())
+		{
+			continue;
+		}
+		if (i == 0)
+		{
+			job = pQueue->jobs.back();
+			pQueue->jobs.pop_back();
+		}
+		else
+		{
+			job = pQueue->jobs.front();
+			pQueue->jobs.pop_front();
+		}
+		m_queuedJobs--;
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RunJob()
+ *
+ *  This method is used for running the items of one chunk.
+ *  Counting the chunk as done is the last access to the job,
+ *  since ParallelFor() can return right after.
+ ***********************************************************/
+void JobSystem::RunJob(const JOB& job)
+{
+	(*job.pFunction)(job.begin, job.end, job.chunk);
+	(*job.pRemaining)--;
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is the loop each worker thread runs until the
+ *  job system is destroyed.
+ ***********************************************************/
+void JobSystem::WorkerLoop(int queueIndex)
+{
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_jobReady.wait(lock, [this]() { return((m_queuedJobs > 0) || (m_bShutdown == true)); });
+			if (m_bShutdown == true)
+			{
+				return;
+			}
+		}
+
+		JOB job;
+		if (PopJob(queueIndex, job) == true)
+		{
+			RunJob(job);
+		}
+		else
+		{
+			// another thread took the job between waking and popping
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,87 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// pool of worker threads that split loops over the scene into jobs and steal
+// work from each other so every core stays busy until the loop is done
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  ParallelFor() splits a range of items into chunks and
+ *  deals the chunks out to one queue per thread.  Each thread
+ *  takes the newest chunk of its own queue, and when that is
+ *  empty steals the oldest chunk of another queue, so threads
+ *  that finish early take over the work of slow ones.  The
+ *  calling thread works on the chunks too and only returns
+ *  when all of them are done.
+ *
+ *  Every chunk is passed its own index, so jobs can write
+ *  their output into per chunk lists that are merged in chunk
+ *  order afterwards.  The result is then the same no matter
+ *  which thread ran which chunk.  The jobs never touch OpenGL.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor - zero worker threads means "pick from the CPU count"
+	JobSystem(unsigned int numWorkers = 0);
+	// destructor
+	~JobSystem();
+
+	// called with the items [begin, end) of one chunk and its index
+	typedef std::function<void(int begin, int end, int chunk)> RANGE_FUNCTION;
+
+	// run the function over the items in chunks of up to chunkSize,
+	// returns when every chunk has been run
+	void ParallelFor(int count, int chunkSize, const RANGE_FUNCTION& function);
+
+	// number of chunks ParallelFor() splits the items into
+	static int GetChunkCount(int count, int chunkSize);
+	// worker threads plus the calling thread
+	int GetThreadCount() const { return((int)m_workers.size() + 1); }
+
+private:
+	struct JOB
+	{
+		const RANGE_FUNCTION* pFunction;
+		int begin;
+		int end;
+		int chunk;
+		// chunks of the same ParallelFor() that are not done yet
+		std::atomic<int>* pRemaining;
+	};
+
+	// the queue of one thread, index 0 belongs to the calling thread
+	struct JOB_QUEUE
+	{
+		std::mutex mutex;
+		std::deque<JOB> jobs;
+	};
+
+	std::vector<std::thread> m_workers;
+	std::vector<JOB_QUEUE*> m_queues;
+	// workers sleep on this while no job is queued
+	std::mutex m_wakeMutex;
+	std::condition_variable m_jobReady;
+	std::atomic<int> m_queuedJobs;
+	bool m_bShutdown;
+
+	// take a job from the own queue or steal one from another
+	bool PopJob(int queueIndex, JOB& job);
+	// run a job and count it as done
+	void RunJob(const JOB& job);
+	// thread entry point for the workers
+	void WorkerLoop(int queueIndex);
+};
@@ -0,0 +1,453 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.cpp
+// ============
+// bin the point lights of the scene into a grid of view space clusters, so
+// each fragment only shades with the lights that can reach its cluster
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightClusters.h"
+#include "ComputeProgram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// declaration of global variables
+namespace
+{
+	// clusters binned by one compute work group, must match
+	// local_size_x in the compute shader
+	const GLuint g_WorkGroupSize = 64;
+
+	// buffer bindings declared in the compute shader
+	const GLuint g_LightBinding = 0;
+	const GLuint g_BoundsBinding = 1;
+	const GLuint g_ListBinding = 2;
+	const GLuint g_CounterBinding = 3;
+
+	// room in the lists for this many lights per cluster on average
+	const int g_AverageClusterLights = 32;
+	// the first index and the count of every cluster come first
+	const int g_ListHeaderSize = 2 * LightClusters::CLUSTER_COUNT;
+	const int g_ListCapacity = LightClusters::CLUSTER_COUNT * g_AverageClusterLights;
+
+	// clusters in one depth slice, the CPU binning runs a job per slice
+	const int g_SliceClusters = LightClusters::CLUSTERS_X * LightClusters::CLUSTERS_Y;
+
+	/***********************************************************
+	 *  IsSphereInBox()
+	 *
+	 *  Check whether a sphere reaches into a box, by measuring
+	 *  the distance from its center to the nearest point of
+	 *  the box.  A sphere without a radius reaches every box.
+	 ***********************************************************/
+	bool IsSphereInBox(const glm::vec4& sphere, const glm::vec4& boxMin, const glm::vec4& boxMax)
+	{
+		if (sphere.w <= 0.0f)
+		{
+			return(true);
+		}
+
+		glm::vec3 center = glm::vec3(sphere);
+		glm::vec3 nearest = glm::clamp(center, glm::vec3(boxMin), glm::vec3(boxMax));
+		glm::vec3 offset = center - nearest;
+
+		return(glm::dot(offset, offset) <= sphere.w * sphere.w);
+	}
+
+	/***********************************************************
+	 *  GetSliceDepth()
+	 *
+	 *  Get the view space depth where a depth slice starts, the
+	 *  slices grow by the same factor from the near plane on.
+	 ***********************************************************/
+	float GetSliceDepth(int slice, float nearPlane, float farPlane)
+	{
+		return(nearPlane * std::pow(farPlane / nearPlane, (float)slice / (float)LightClusters::CLUSTERS_Z));
+	}
+}
+
+/***********************************************************
+ *  LightClusters()
+ *
+ *  The constructor for the class.  The list buffer is made
+ *  at its full size, which never changes.
+ ***********************************************************/
+LightClusters::LightClusters()
+{
+	m_program = 0;
+	m_viewLocation = -1;
+	m_lightCountLocation = -1;
+	m_projection = glm::mat4(0.0f);
+	m_nearPlane = 0.0f;
+	m_farPlane = 0.0f;
+	m_clusterBounds.resize(CLUSTER_COUNT);
+	m_sliceLights.resize(CLUSTERS_Z);
+	m_lists.assign(g_ListHeaderSize, 0);
+
+	glGenBuffers(1, &m_lightBuffer);
+	glGenBuffers(1, &m_listBuffer);
+	glGenBuffers(1, &m_boundsBuffer);
+	glGenBuffers(1, &m_counterBuffer);
+	glGenTextures(1, &m_lightTexture);
+	glGenTextures(1, &m_listTexture);
+
+	// a texture buffer needs storage before it can be attached
+	glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, sizeof(POINT_LIGHT), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_listBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, (g_ListHeaderSize + g_ListCapacity) * sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, m_lists.size() * sizeof(GLuint), m_lists.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_counterBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_lightBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, m_listTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_listBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  ~LightClusters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightClusters::~LightClusters()
+{
+	glDeleteTextures(1, &m_lightTexture);
+	glDeleteTextures(1, &m_listTexture);
+	glDeleteBuffers(1, &m_lightBuffer);
+	glDeleteBuffers(1, &m_listBuffer);
+	glDeleteBuffers(1, &m_boundsBuffer);
+	glDeleteBuffers(1, &m_counterBuffer);
+	if (0 != m_program)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+}
+
+/***********************************************************
+ *  IsComputeSupported()
+ *
+ *  This method is used for checking whether the GL context
+ *  can run compute shaders writing storage buffers.
+ ***********************************************************/
+bool LightClusters::IsComputeSupported()
+{
+	return(GLEW_VERSION_4_3 == GL_TRUE);
+}
+
+/***********************************************************
+ *  LoadShader()
+ *
+ *  This method is used for loading the compute shader that
+ *  bins the lights.  False is returned when it does not
+ *  build, and the lights keep being binned on the CPU.
+ ***********************************************************/
+bool LightClusters::LoadShader(const char* filename)
+{
+	GLuint program = ComputeProgram::Load(filename);
+	if (0 == program)
+	{
+		return(false);
+	}
+
+	if (0 != m_program)
+	{
+		glDeleteProgram(m_program);
+	}
+	m_program = program;
+	m_viewLocation = glGetUniformLocation(m_program, "view");
+	m_lightCountLocation = glGetUniformLocation(m_program, "lightCount");
+
+	// the list layout never changes, so it is set once
+	glUseProgram(m_program);
+	glUniform1ui(glGetUniformLocation(m_program, "clusterCount"), (GLuint)CLUSTER_COUNT);
+	glUniform1ui(glGetUniformLocation(m_program, "listStart"), (GLuint)g_ListHeaderSize);
+	glUniform1ui(glGetUniformLocation(m_program, "listCapacity"), (GLuint)g_ListCapacity);
+	glUseProgram(0);
+
+	// the boxes are uploaded again with the next projection
+	m_projection = glm::mat4(0.0f);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for uploading the point lights.  The
+ *  lists are rebuilt by the next Update().
+ ***********************************************************/
+void LightClusters::SetLights(const std::vector<POINT_LIGHT>& lights)
+{
+	m_lights = lights;
+
+	// keep some storage so the texture buffer stays valid
+	size_t size = std::max(m_lights.size(), (size_t)1) * sizeof(POINT_LIGHT);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_lightBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, size, m_lights.empty() ? NULL : m_lights.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BuildClusterBounds()
+ *
+ *  This method is used for computing the view space box of
+ *  every cluster.  The corners of the screen tiles are
+ *  unprojected onto the near and far planes, and each box
+ *  holds the tile's corner rays between the depths of its
+ *  slice.
+ ***********************************************************/
+void LightClusters::BuildClusterBounds(const glm::mat4& projection)
+{
+	glm::mat4 inverseProjection = glm::inverse(projection);
+	glm::vec3 nearCorners[CLUSTERS_X + 1][CLUSTERS_Y + 1];
+	glm::vec3 farCorners[CLUSTERS_X + 1][CLUSTERS_Y + 1];
+
+	m_projection = projection;
+	m_nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+	m_farPlane = projection[3][2] / (projection[2][2] + 1.0f);
+
+	for (int x = 0; x <= CLUSTERS_X; x++)
+	{
+		for (int y = 0; y <= CLUSTERS_Y; y++)
+		{
+			float ndcX = -1.0f + 2.0f * (float)x / (float)CLUSTERS_X;
+			float ndcY = -1.0f + 2.0f * (float)y / (float)CLUSTERS_Y;
+			glm::vec4 nearPoint = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+			glm::vec4 farPoint = inverseProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+
+			nearCorners[x][y] = glm::vec3(nearPoint) / nearPoint.w;
+			farCorners[x][y] = glm::vec3(farPoint) / farPoint.w;
+		}
+	}
+
+	for (int z = 0; z < CLUSTERS_Z; z++)
+	{
+		float depths[2] =
+		{
+			GetSliceDepth(z, m_nearPlane, m_farPlane),
+			GetSliceDepth(z + 1, m_nearPlane, m_farPlane)
+		};
+
+		for (int y = 0; y < CLUSTERS_Y; y++)
+		{
+			for (int x = 0; x < CLUSTERS_X; x++)
+			{
+				glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+				glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+				for (int corner = 0; corner < 4; corner++)
+				{
+					const glm::vec3& nearCorner = nearCorners[x + (corner & 1)][y + (corner >> 1)];
+					const glm::vec3& farCorner = farCorners[x + (corner & 1)][y + (corner >> 1)];
+
+					// the view looks down -z, so the depth is -z
+					for (int d = 0; d < 2; d++)
+					{
+						float t = (depths[d] + nearCorner.z) / (nearCorner.z - farCorner.z);
+						glm::vec3 point = nearCorner + t * (farCorner - nearCorner);
+						boundsMin = glm::min(boundsMin, point);
+						boundsMax = glm::max(boundsMax, point);
+					}
+				}
+
+				CLUSTER_BOUNDS& bounds = m_clusterBounds[x + CLUSTERS_X * (y + CLUSTERS_Y * z)];
+				bounds.boundsMin = glm::vec4(boundsMin, 0.0f);
+				bounds.boundsMax = glm::vec4(boundsMax, 0.0f);
+			}
+		}
+	}
+
+	if (0 != m_program)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_boundsBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_clusterBounds.size() * sizeof(CLUSTER_BOUNDS), m_clusterBounds.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for building the light lists of the
+ *  frame.  The cluster boxes only change with the projection.
+ ***********************************************************/
+void LightClusters::Update(const glm::mat4& view, const glm::mat4& projection, JobSystem* pJobSystem)
+{
+	if (projection != m_projection)
+	{
+		BuildClusterBounds(projection);
+	}
+
+	if (0 != m_program)
+	{
+		DispatchBinning(view);
+	}
+	else
+	{
+		BinLights(view, pJobSystem);
+	}
+}
+
+/***********************************************************
+ *  BinLights()
+ *
+ *  This method is used for building the lists on the CPU.
+ *  Each job bins one depth slice into its own list, after
+ *  skipping the lights whose depth range misses the slice,
+ *  and the slices are joined in order into the buffer.
+ ***********************************************************/
+void LightClusters::BinLights(const glm::mat4& view, JobSystem* pJobSystem)
+{
+	int lightCount = (int)m_lights.size();
+
+	m_viewLights.resize(lightCount);
+	for (int i = 0; i < lightCount; i++)
+	{
+		glm::vec4 position = view * glm::vec4(m_lights[i].position, 1.0f);
+		m_viewLights[i] = glm::vec4(glm::vec3(position), m_lights[i].range);
+	}
+
+	JobSystem::RANGE_FUNCTION binSlices = [&](int begin, int end, int)
+	{
+		for (int z = begin; z < end; z++)
+		{
+			std::vector<GLuint>& sliceList = m_sliceLights[z];
+			float sliceNear = GetSliceDepth(z, m_nearPlane, m_farPlane);
+			float sliceFar = GetSliceDepth(z + 1, m_nearPlane, m_farPlane);
+
+			// each cluster of the slice adds its count, then its lights
+			sliceList.clear();
+			for (int c = 0; c < g_SliceClusters; c++)
+			{
+				const CLUSTER_BOUNDS& bounds = m_clusterBounds[z * g_SliceClusters + c];
+				size_t countIndex = sliceList.size();
+				GLuint count = 0;
+
+				sliceList.push_back(0);
+				for (int i = 0; (i < lightCount) && (count < MAX_CLUSTER_LIGHTS); i++)
+				{
+					const glm::vec4& light = m_viewLights[i];
+					float depth = -light.z;
+
+					if ((light.w > 0.0f) && ((depth + light.w < sliceNear) || (depth - light.w > sliceFar)))
+					{
+						continue;
+					}
+					if (IsSphereInBox(light, bounds.boundsMin, bounds.boundsMax) == true)
+					{
+						sliceList.push_back((GLuint)i);
+						count++;
+					}
+				}
+				sliceList[countIndex] = count;
+			}
+		}
+	};
+
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(CLUSTERS_Z, 1, binSlices);
+	}
+	else
+	{
+		binSlices(0, CLUSTERS_Z, 0);
+	}
+
+	m_lists.resize(g_ListHeaderSize);
+	for (int z = 0; z < CLUSTERS_Z; z++)
+	{
+		const std::vector<GLuint>& sliceList = m_sliceLights[z];
+		size_t read = 0;
+
+		for (int c = 0; c < g_SliceClusters; c++)
+		{
+			int cluster = z * g_SliceClusters + c;
+			GLuint count = sliceList[read++];
+			GLuint room = (GLuint)(g_ListHeaderSize + g_ListCapacity - m_lists.size());
+			GLuint kept = std::min(count, room);
+
+			m_lists[2 * cluster] = (GLuint)m_lists.size();
+			m_lists[2 * cluster + 1] = kept;
+			m_lists.insert(m_lists.end(), sliceList.begin() + read, sliceList.begin() + read + kept);
+			read += count;
+		}
+	}
+
+	glBindBuffer(GL_TEXTURE_BUFFER, m_listBuffer);
+	glBufferSubData(GL_TEXTURE_BUFFER, 0, m_lists.size() * sizeof(GLuint), m_lists.data());
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  DispatchBinning()
+ *
+ *  This method is used for building the lists on the GPU.
+ *  The compute program is left in use, so the caller has to
+ *  switch back to its own program before drawing.
+ ***********************************************************/
+void LightClusters::DispatchBinning(const glm::mat4& view)
+{
+	const GLuint zero = 0;
+
+	// the clusters allocate their part of the lists from the counter
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_counterBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zero), &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glUseProgram(m_program);
+	glUniformMatrix4fv(m_viewLocation, 1, GL_FALSE, &view[0][0]);
+	glUniform1ui(m_lightCountLocation, (GLuint)m_lights.size());
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_LightBinding, m_lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_BoundsBinding, m_boundsBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ListBinding, m_listBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CounterBinding, m_counterBuffer);
+
+	glDispatchCompute((CLUSTER_COUNT + g_WorkGroupSize - 1) / g_WorkGroupSize, 1, 1);
+
+	// the fragment shaders read the lists through the texture buffer
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the texture buffers the
+ *  shaders read the lights and the lists from.
+ ***********************************************************/
+void LightClusters::Bind(int firstTextureUnit) const
+{
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+	glActiveTexture(GL_TEXTURE0 + firstTextureUnit + 1);
+	glBindTexture(GL_TEXTURE_BUFFER, m_listTexture);
+}
+
+/***********************************************************
+ *  GetClusterBlock()
+ *
+ *  This method is used for getting the values the shaders
+ *  need to find the cluster of a fragment.
+ ***********************************************************/
+UniformBuffers::CLUSTER_BLOCK LightClusters::GetClusterBlock(const GLint viewport[4]) const
+{
+	UniformBuffers::CLUSTER_BLOCK block;
+
+	block.depthSlicing = glm::vec4(
+		m_nearPlane,
+		m_farPlane,
+		(float)CLUSTERS_Z / std::log(m_farPlane / m_nearPlane),
+		0.0f);
+	block.viewport = glm::vec4((float)viewport[0], (float)viewport[1], (float)viewport[2], (float)viewport[3]);
+	block.grid = glm::ivec4(CLUSTERS_X, CLUSTERS_Y, CLUSTERS_Z, 0);
+
+	return(block);
+}
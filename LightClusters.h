@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclusters.h
+// ============
+// bin the point lights of the scene into a grid of view space clusters, so
+// each fragment only shades with the lights that can reach its cluster
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "UniformBuffers.h"
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LightClusters
+ *
+ *  The view is split into tiles across the screen and into
+ *  depth slices that grow exponentially from the near plane
+ *  to the far plane.  Each frame Update() tests the sphere of
+ *  every point light against the view space box of every
+ *  cluster and writes the list of lights per cluster.  The
+ *  lists are built by a compute shader when the context has
+ *  them, and on the job system threads otherwise.
+ *
+ *  The shaders read two texture buffers, bound by Bind():
+ *
+ *    lights  four RGBA32F texels per light: position and
+ *            range, then the ambient, diffuse and specular
+ *            colors
+ *    lists   R32UI, the first index and the count of every
+ *            cluster, followed by the light indices the first
+ *            indices point to
+ *
+ *  Lights without a range reach every cluster.  A cluster
+ *  keeps at most MAX_CLUSTER_LIGHTS lights, and the lights
+ *  that do not fit into the index part of the lists are
+ *  dropped.
+ ***********************************************************/
+class LightClusters
+{
+public:
+	// constructor
+	LightClusters();
+	// destructor
+	~LightClusters();
+
+	// size of the cluster grid
+	static const int CLUSTERS_X = 16;
+	static const int CLUSTERS_Y = 9;
+	static const int CLUSTERS_Z = 24;
+	static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+	// most lights one cluster lists, must match the compute shader
+	static const int MAX_CLUSTER_LIGHTS = 64;
+
+	// a point light as the shaders read it, laid out to match both
+	// the light texels and the std430 struct of the compute shader
+	struct POINT_LIGHT
+	{
+		glm::vec3 position;
+		// distance at which the light has faded out, 0 for none
+		float range;
+		glm::vec3 ambient;
+		float reserved0;
+		glm::vec3 diffuse;
+		float reserved1;
+		glm::vec3 specular;
+		float reserved2;
+	};
+
+	// check whether the GL context can bin the lights in a compute
+	// shader
+	static bool IsComputeSupported();
+
+	// compile and link the binning compute shader, otherwise the
+	// lights are binned on the CPU
+	bool LoadShader(const char* filename);
+
+	// upload the point lights of the scene
+	void SetLights(const std::vector<POINT_LIGHT>& lights);
+	int GetLightCount() const { return((int)m_lights.size()); }
+
+	// build the light lists of the clusters of the passed in camera,
+	// which leaves the compute program in use when there is one
+	void Update(const glm::mat4& view, const glm::mat4& projection, JobSystem* pJobSystem = NULL);
+
+	// bind the light and list buffers to the passed in texture unit
+	// and the one after it
+	void Bind(int firstTextureUnit) const;
+
+	// the cluster block values for a viewport, valid after Update()
+	UniformBuffers::CLUSTER_BLOCK GetClusterBlock(const GLint viewport[4]) const;
+
+private:
+	// view space box of one cluster, laid out for std430
+	struct CLUSTER_BOUNDS
+	{
+		glm::vec4 boundsMin;
+		glm::vec4 boundsMax;
+	};
+
+	GLuint m_program;
+	GLint m_viewLocation;
+	GLint m_lightCountLocation;
+
+	// the lights of SetLights(), and the buffer holding them
+	std::vector<POINT_LIGHT> m_lights;
+	GLuint m_lightBuffer;
+	GLuint m_lightTexture;
+	// the cluster lists, as built on the CPU or the GPU
+	GLuint m_listBuffer;
+	GLuint m_listTexture;
+	// boxes of the clusters, and the counter the compute shader
+	// allocates the list indices from
+	GLuint m_boundsBuffer;
+	GLuint m_counterBuffer;
+
+	// projection the boxes and depth slicing were made for
+	glm::mat4 m_projection;
+	float m_nearPlane;
+	float m_farPlane;
+	std::vector<CLUSTER_BOUNDS> m_clusterBounds;
+
+	// the view space light spheres and the lists of the CPU binning,
+	// kept between frames so they keep their memory
+	std::vector<glm::vec4> m_viewLights;
+	std::vector<GLuint> m_lists;
+	std::vector<std::vector<GLuint>> m_sliceLights;
+
+	// compute the cluster boxes of a projection
+	void BuildClusterBounds(const glm::mat4& projection);
+	// build the lists with the job system and upload them
+	void BinLights(const glm::mat4& view, JobSystem* pJobSystem);
+	// build the lists in the compute shader
+	void DispatchBinning(const glm::mat4& view);
+};
@@ -22,6 +22,10 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "ProgramCache.h"
+#include "FrameProfiler.h"
+#include "Benchmark.h"
+#include "FramePacer.h"
 
 // Namespace for declaring global variables
 namespace
@@ -29,6 +33,10 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// shader files of the main program
+	const char* const VERTEX_SHADER_FILE = "shaders/vertexShader.glsl";
+	const char* const FRAGMENT_SHADER_FILE = "shaders/fragmentShader.glsl";
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -38,6 +46,8 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// profiler timing the sections of every frame
+	FrameProfiler* g_FrameProfiler = nullptr;
 }
 
 // Function declarations - all functions that are called manually
@@ -54,6 +64,14 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// the transform benchmark only times work on the CPU, so it
+	// runs before any window is made
+	if (Benchmark::IsTransformBenchmark(argc, argv) == true)
+	{
+		Benchmark::RunTransformBenchmark();
+		return(EXIT_SUCCESS);
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
@@ -66,8 +84,30 @@ int main(int argc, char* argv[])
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
+	// the benchmark draws into an offscreen framebuffer of a hidden
+	// window, so it can run without a display
+	Benchmark::BENCHMARK_SETTINGS benchmarkSettings;
+	bool bBenchmark = Benchmark::ParseArguments(argc, argv, benchmarkSettings);
+	// how the displayed frames are synchronized and capped
+	FramePacer::PACING_SETTINGS pacingSettings;
+	if (FramePacer::ParseArguments(argc, argv, pacingSettings) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
 	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	if (bBenchmark == true)
+	{
+		g_Window = g_ViewManager->CreateOffscreenWindow(WINDOW_TITLE);
+	}
+	else
+	{
+		g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+	}
+	if (NULL == g_Window)
+	{
+		return(EXIT_FAILURE);
+	}
 
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
@@ -75,42 +115,131 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"shaders/vertexShader.glsl",
-		"shaders/fragmentShader.glsl");
+	// load the shader code from the external GLSL files, or the
+	// program binary cached by an earlier launch
+	ProgramCache::Load(g_ShaderManager, VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE);
 	g_ShaderManager->use();
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
 	g_SceneManager->PrepareScene();
+	// the view manager feeds the camera values into the shared blocks
+	g_ViewManager->SetUniformBuffers(g_SceneManager->GetUniformBuffers());
 
-	// loop will keep running until the application is closed 
-	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	int exitCode = EXIT_SUCCESS;
+	if (bBenchmark == true)
+	{
+		// draw the timed benchmark frames and exit
+		Benchmark benchmark(benchmarkSettings);
+		if (benchmark.Run(g_Window, g_ViewManager, g_SceneManager) == false)
+		{
+			exitCode = EXIT_FAILURE;
+		}
+	}
+	else
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		// time the frame sections - F3 shows the overlay, F4 writes the CSV
+		g_FrameProfiler = new FrameProfiler();
+		int viewSection = g_FrameProfiler->AddSection("view");
+		g_SceneManager->SetFrameProfiler(g_FrameProfiler);
+		int swapSection = g_FrameProfiler->AddSection("swap");
+		int paceSection = g_FrameProfiler->AddSection("pace");
+		FramePacer framePacer(pacingSettings);
+		framePacer.Apply();
+		// edited shader files are built again while the scene runs
+		g_SceneManager->WatchMainShaders(VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE);
+
+		// loop will keep running until the application is closed 
+		// or until an error has occurred
+		while (!glfwWindowShouldClose(g_Window))
+		{
+			// swap in the programs of any edited shader files
+			g_SceneManager->ReloadChangedShaders();
+			// move the camera by the time since the last frame
+			bool bViewChanged = g_ViewManager->UpdateCamera();
+
+			// report the object under the view center when clicked
+			glm::vec3 pickOrigin;
+			glm::vec3 pickDirection;
+			if (g_ViewManager->GetPickRay(pickOrigin, pickDirection) == true)
+			{
+				g_SceneManager->PickNode(pickOrigin, pickDirection);
+			}
+
+			// switch the depth pre-pass, the overdraw it saves shows in
+			// the sample counts of the profile
+			if (g_ViewManager->GetDepthPrepassToggle() == true)
+			{
+				bool bDepthPrepass = !g_SceneManager->IsDepthPrepassEnabled();
+				g_SceneManager->SetDepthPrepass(bDepthPrepass);
+				std::cout << "Depth pre-pass " << ((bDepthPrepass == true) ? "on" : "off") << std::endl;
+			}
+			if (g_ViewManager->GetTextureReportRequest() == true)
+			{
+				g_SceneManager->PrintTextureResidency();
+			}
+			bool bOverlayToggled = g_FrameProfiler->HandleKeys(g_Window);
+
+			// with on-demand rendering a frame that would look like the
+			// last one is not drawn, the last frame stays on the screen
+			// until an event or a scene change asks for a new one
+			if ((framePacer.IsOnDemand() == true) && (bViewChanged == false) &&
+				(bOverlayToggled == false) && (g_FrameProfiler->IsOverlayVisible() == false) &&
+				(g_SceneManager->IsRedrawNeeded() == false))
+			{
+				g_FrameProfiler->CountIdleFrame();
+				framePacer.WaitForEvents();
+				continue;
+			}
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			g_FrameProfiler->BeginFrame();
+			// move on to the buffer regions of this frame
+			g_SceneManager->BeginFrame();
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+			// Enable z-depth
+			glEnable(GL_DEPTH_TEST);
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+			// Clear the frame and z buffers
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+			// convert from 3D object space to 2D view
+			g_FrameProfiler->BeginSection(viewSection);
+			g_ViewManager->PrepareSceneView();
+			g_FrameProfiler->EndSection(viewSection);
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+			// refresh the 3D scene
+			g_SceneManager->RenderScene();
 
-		// query the latest GLFW events
-		glfwPollEvents();
+			// draw the frame timings over the scene when toggled on
+			g_FrameProfiler->DrawOverlay();
+			// the GPU reads this frame's regions until it passes here
+			g_SceneManager->EndFrame();
+
+			// Flips the the back buffer with the front buffer every frame.
+			g_FrameProfiler->BeginSection(swapSection);
+			glfwSwapBuffers(g_Window);
+			g_FrameProfiler->EndSection(swapSection);
+
+			// wait out the frame cap before the events are read, so the
+			// next frame is drawn from the newest input
+			g_FrameProfiler->BeginSection(paceSection);
+			framePacer.WaitForNextFrame();
+			g_FrameProfiler->EndSection(paceSection);
+
+			g_FrameProfiler->EndFrame(g_SceneManager->GetRenderCounters());
+
+			// query the latest GLFW events
+			glfwPollEvents();
+		}
 	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_FrameProfiler)
+	{
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -127,8 +256,8 @@ int main(int argc, char* argv[])
 		g_ShaderManager = NULL;
 	}
 
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	// Terminates the program
+	exit(exitCode);
 }
 
 /***********************************************************
@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// overdrawcounters.cpp
+// ============
+// count the samples that pass the depth test in the depth pre-pass and in the
+// opaque shading pass, to show how often each pixel is shaded
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "OverdrawCounters.h"
+
+/***********************************************************
+ *  OverdrawCounters()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+OverdrawCounters::OverdrawCounters()
+{
+	for (int q = 0; q < QUERY_LATENCY; q++)
+	{
+		glGenQueries(PASS_COUNT, m_queries[q]);
+		for (int p = 0; p < PASS_COUNT; p++)
+		{
+			m_bQueryPending[q][p] = false;
+		}
+	}
+	for (int p = 0; p < PASS_COUNT; p++)
+	{
+		m_samples[p] = 0;
+	}
+	m_frameCount = 0;
+	m_querySet = 0;
+}
+
+/***********************************************************
+ *  ~OverdrawCounters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+OverdrawCounters::~OverdrawCounters()
+{
+	for (int q = 0; q < QUERY_LATENCY; q++)
+	{
+		glDeleteQueries(PASS_COUNT, m_queries[q]);
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting to count the samples of
+ *  a frame.  The counts of the frame that last used this set
+ *  of queries are read first, so the set can be reused.  A
+ *  pass that frame did not draw counts as 0 samples.
+ ***********************************************************/
+void OverdrawCounters::BeginFrame()
+{
+	m_querySet = m_frameCount % QUERY_LATENCY;
+	m_frameCount++;
+
+	for (int p = 0; p < PASS_COUNT; p++)
+	{
+		if (m_bQueryPending[m_querySet][p] == false)
+		{
+			m_samples[p] = 0;
+			continue;
+		}
+		m_bQueryPending[m_querySet][p] = false;
+
+		GLint bAvailable = GL_FALSE;
+		glGetQueryObjectiv(m_queries[m_querySet][p], GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+		if (bAvailable == GL_TRUE)
+		{
+			GLuint samples = 0;
+			glGetQueryObjectuiv(m_queries[m_querySet][p], GL_QUERY_RESULT, &samples);
+			m_samples[p] = (int)samples;
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  This method is used for starting to count the samples of
+ *  a pass of the current frame.
+ ***********************************************************/
+void OverdrawCounters::BeginPass(PASS pass)
+{
+	glBeginQuery(GL_SAMPLES_PASSED, m_queries[m_querySet][pass]);
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method is used for finishing the count of a pass of
+ *  the current frame.
+ ***********************************************************/
+void OverdrawCounters::EndPass(PASS pass)
+{
+	glEndQuery(GL_SAMPLES_PASSED);
+	m_bQueryPending[m_querySet][pass] = true;
+}
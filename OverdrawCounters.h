@@ -0,0 +1,69 @@
+///////////////////////////////////////////////////////////////////////////////
+// overdrawcounters.h
+// ============
+// count the samples that pass the depth test in the depth pre-pass and in the
+// opaque shading pass, to show how often each pixel is shaded
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  OverdrawCounters
+ *
+ *  Each pass of a frame is wrapped in a GL_SAMPLES_PASSED
+ *  query.  Like the timer queries of the frame profiler, the
+ *  results are read a few frames later so reading them never
+ *  stalls the pipeline, and a result that is still not
+ *  available by then is dropped.
+ *
+ *  Without the pre-pass, every sample that passes the depth
+ *  test at the time it is drawn is shaded, so the shading
+ *  samples divided by the pixels of the view is the overdraw.
+ *  With the pre-pass, only the nearest sample of each pixel
+ *  passes the equal depth test, and the overdraw moves into
+ *  the cheap depth samples instead.
+ ***********************************************************/
+class OverdrawCounters
+{
+public:
+	// constructor
+	OverdrawCounters();
+	// destructor
+	~OverdrawCounters();
+
+	// frames the queries are read after
+	static const int QUERY_LATENCY = 4;
+
+	// passes of a frame whose samples are counted
+	enum PASS
+	{
+		PASS_DEPTH = 0,		// the depth pre-pass
+		PASS_SHADING,		// the opaque draws with shading
+		PASS_COUNT
+	};
+
+	// start counting a frame, which first reads the counts of the
+	// frame that last used the same queries
+	void BeginFrame();
+	// mark the start and end of a pass of the frame, passes must not
+	// nest
+	void BeginPass(PASS pass);
+	void EndPass(PASS pass);
+
+	// samples of a pass in the newest frame whose counts were read,
+	// 0 for a pass that frame did not draw
+	int GetSamples(PASS pass) const { return(m_samples[pass]); }
+
+private:
+	GLuint m_queries[QUERY_LATENCY][PASS_COUNT];
+	bool m_bQueryPending[QUERY_LATENCY][PASS_COUNT];
+	// read counts
+	int m_samples[PASS_COUNT];
+	// frames started, selects the queries of the current frame
+	unsigned int m_frameCount;
+	// queries of the frame being counted
+	int m_querySet;
+};
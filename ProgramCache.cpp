@@ -0,0 +1,402 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.cpp
+// ============
+// store the linked binaries of the shader programs on disk so later launches
+// can skip compiling and linking the GLSL sources
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ProgramCache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// cache files sit next to the vertex shader with this extension
+	const char* g_CacheExtension = ".progcache";
+
+	// identifies the cache file layout, bump the version on change
+	const uint32_t g_CacheMagic = 0x31475250;	// "PRG1"
+	const uint32_t g_CacheVersion = 1;
+
+	// FNV-1a 64 bit offset basis and prime
+	const uint64_t g_HashBasis = 0xCBF29CE484222325ULL;
+	const uint64_t g_HashPrime = 0x00000100000001B3ULL;
+
+	// fixed size header written at the start of every cache file,
+	// the program binary follows it
+	struct CACHE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceHash;
+		uint64_t driverHash;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+	};
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the current GL
+ *  context can hand out program binaries in at least one
+ *  format.
+ ***********************************************************/
+bool ProgramCache::IsSupported()
+{
+	if (!GLEW_ARB_get_program_binary)
+	{
+		return(false);
+	}
+
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+
+	return(formatCount > 0);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for building the program of a pair
+ *  of shader files into a shader manager.  The cache file is
+ *  tried first, and written after linking when it was out of
+ *  date.  The shader manager keeps its old program when the
+ *  files do not build, so a broken edit leaves the running
+ *  program in place.  The defines are part of the hashed
+ *  sources, so every variant is keyed on its own.
+ ***********************************************************/
+bool ProgramCache::Load(ShaderManager* pShader, const char* vertexShaderFile, const char* fragmentShaderFile, const std::string& defines)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+
+	if ((ReadSource(vertexShaderFile, defines, vertexSource) == false) ||
+		(ReadSource(fragmentShaderFile, defines, fragmentSource) == false))
+	{
+		return(false);
+	}
+
+	bool bCache = IsSupported();
+	uint64_t sourceHash = HashText(fragmentSource, HashText(vertexSource, g_HashBasis));
+	uint64_t driverHash = 0;
+	std::string cachePath = GetCachePath(vertexShaderFile, fragmentShaderFile, defines);
+	GLuint program = 0;
+
+	if (bCache == true)
+	{
+		driverHash = GetDriverHash();
+		program = LoadBinary(cachePath, sourceHash, driverHash);
+	}
+	if (0 == program)
+	{
+		program = BuildProgram(vertexShaderFile, vertexSource, fragmentShaderFile, fragmentSource);
+		if (0 == program)
+		{
+			return(false);
+		}
+		if (bCache == true)
+		{
+			SaveBinary(cachePath, program, sourceHash, driverHash);
+		}
+	}
+
+	if (0 != pShader->m_programID)
+	{
+		glDeleteProgram(pShader->m_programID);
+	}
+	pShader->m_programID = program;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadSource()
+ *
+ *  This method is used for reading the text of a shader
+ *  file.  The #version line has to stay the first line, so
+ *  the defines go right after it.
+ ***********************************************************/
+bool ProgramCache::ReadSource(const char* filename, const std::string& defines, std::string& source)
+{
+	std::ifstream shaderFile(filename);
+	if (!shaderFile)
+	{
+		std::cout << "Could not open shader " << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream text;
+	text << shaderFile.rdbuf();
+	source = text.str();
+
+	if (defines.empty() == false)
+	{
+		size_t insertAt = 0;
+		size_t version = source.find("#version");
+		if (version != std::string::npos)
+		{
+			size_t lineEnd = source.find('\n', version);
+			insertAt = (lineEnd != std::string::npos) ? lineEnd + 1 : source.size();
+		}
+		source.insert(insertAt, defines);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for compiling the two stages of a
+ *  program and linking them, asking the driver to keep the
+ *  binary retrievable.  0 is returned, with the compiler or
+ *  linker log written out, when that fails.
+ ***********************************************************/
+GLuint ProgramCache::BuildProgram(const char* vertexShaderFile, const std::string& vertexSource, const char* fragmentShaderFile, const std::string& fragmentSource)
+{
+	GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderFile, vertexSource);
+	GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderFile, fragmentSource);
+
+	if ((0 == vertexShader) || (0 == fragmentShader))
+	{
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return(0);
+	}
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
+	glDetachShader(program, vertexShader);
+	glDetachShader(program, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char log[1024];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		std::cout << "Could not link shaders " << vertexShaderFile << ", " << fragmentShaderFile << std::endl << log << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method is used for compiling one stage of a program.
+ ***********************************************************/
+GLuint ProgramCache::CompileShader(GLenum type, const char* filename, const std::string& source)
+{
+	const char* pSource = source.c_str();
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &pSource, NULL);
+	glCompileShader(shader);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cout << "Could not compile shader " << filename << std::endl << log << std::endl;
+		glDeleteShader(shader);
+		return(0);
+	}
+
+	return(shader);
+}
+
+/***********************************************************
+ *  HashText()
+ *
+ *  This method is used for folding the length and the bytes
+ *  of a text into an FNV-1a hash.  The length goes first, so
+ *  moving text from one source to the other changes the key.
+ ***********************************************************/
+uint64_t ProgramCache::HashText(const std::string& text, uint64_t hash)
+{
+	uint64_t length = (uint64_t)text.size();
+
+	for (int i = 0; i < 8; i++)
+	{
+		hash = (hash ^ ((length >> (i * 8)) & 0xFF)) * g_HashPrime;
+	}
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		hash = (hash ^ (unsigned char)text[i]) * g_HashPrime;
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  GetDriverHash()
+ *
+ *  This method is used for hashing the vendor, renderer and
+ *  version strings of the context, since a binary is only
+ *  valid for the driver that made it.
+ ***********************************************************/
+uint64_t ProgramCache::GetDriverHash()
+{
+	const GLenum names[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	uint64_t hash = g_HashBasis;
+
+	for (int i = 0; i < 3; i++)
+	{
+		const GLubyte* pName = glGetString(names[i]);
+		hash = HashText((NULL != pName) ? (const char*)pName : "", hash);
+	}
+
+	return(hash);
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for getting the cache file path for
+ *  a program, the vertex shader path with the extension
+ *  replaced by the name of the fragment shader, since one
+ *  vertex shader can go with several fragment shaders.  The
+ *  variants made with defines add the hash of the defines.
+ ***********************************************************/
+std::string ProgramCache::GetCachePath(const char* vertexShaderFile, const char* fragmentShaderFile, const std::string& defines)
+{
+	std::string vertexPath = vertexShaderFile;
+	std::string fragmentName = fragmentShaderFile;
+
+	size_t separator = fragmentName.find_last_of("/\\");
+	if (separator != std::string::npos)
+	{
+		fragmentName = fragmentName.substr(separator + 1);
+	}
+	size_t extension = fragmentName.rfind('.');
+	if (extension != std::string::npos)
+	{
+		fragmentName = fragmentName.substr(0, extension);
+	}
+	extension = vertexPath.rfind('.');
+	if ((extension != std::string::npos) && (vertexPath.find_first_of("/\\", extension) == std::string::npos))
+	{
+		vertexPath = vertexPath.substr(0, extension);
+	}
+
+	if (defines.empty() == false)
+	{
+		char variant[24];
+		snprintf(variant, sizeof(variant), ".%016llx", (unsigned long long)HashText(defines, g_HashBasis));
+		fragmentName += variant;
+	}
+
+	return(vertexPath + "." + fragmentName + g_CacheExtension);
+}
+
+/***********************************************************
+ *  LoadBinary()
+ *
+ *  This method is used for creating a program from its cache
+ *  file.  The driver can still refuse a binary whose key
+ *  matches, for example after an update that kept the
+ *  version string, which shows up as a failed link.
+ ***********************************************************/
+GLuint ProgramCache::LoadBinary(const std::string& cachePath, uint64_t sourceHash, uint64_t driverHash)
+{
+	std::ifstream cacheFile(cachePath.c_str(), std::ios::binary);
+	if (!cacheFile)
+	{
+		return(0);
+	}
+
+	CACHE_HEADER header;
+	cacheFile.read((char*)&header, sizeof(header));
+	if (!cacheFile ||
+		(header.magic != g_CacheMagic) ||
+		(header.version != g_CacheVersion) ||
+		(header.sourceHash != sourceHash) ||
+		(header.driverHash != driverHash) ||
+		(header.binarySize == 0))
+	{
+		return(0);
+	}
+
+	std::vector<char> binary(header.binarySize);
+	cacheFile.read(binary.data(), binary.size());
+	if (!cacheFile)
+	{
+		return(0);
+	}
+
+	GLuint program = glCreateProgram();
+	glProgramBinary(program, (GLenum)header.binaryFormat, binary.data(), (GLsizei)binary.size());
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		std::cout << "Program cache refused by the driver:" << cachePath << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  SaveBinary()
+ *
+ *  This method is used for writing the binary of a linked
+ *  program to its cache file.
+ ***********************************************************/
+bool ProgramCache::SaveBinary(const std::string& cachePath, GLuint program, uint64_t sourceHash, uint64_t driverHash)
+{
+	GLint binarySize = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+	if (binarySize <= 0)
+	{
+		return(false);
+	}
+
+	std::vector<char> binary(binarySize);
+	GLenum binaryFormat = 0;
+	GLsizei length = 0;
+	glGetProgramBinary(program, binarySize, &length, &binaryFormat, binary.data());
+	if (length <= 0)
+	{
+		return(false);
+	}
+
+	std::ofstream cacheFile(cachePath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!cacheFile)
+	{
+		std::cout << "Could not write program cache:" << cachePath << std::endl;
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	header.magic = g_CacheMagic;
+	header.version = g_CacheVersion;
+	header.sourceHash = sourceHash;
+	header.driverHash = driverHash;
+	header.binaryFormat = (uint32_t)binaryFormat;
+	header.binarySize = (uint32_t)length;
+	cacheFile.write((const char*)&header, sizeof(header));
+	cacheFile.write(binary.data(), length);
+
+	std::cout << "Wrote program cache:" << cachePath << ", bytes:" << length << std::endl;
+
+	return(true);
+}
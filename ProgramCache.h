@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+// programcache.h
+// ============
+// store the linked binaries of the shader programs on disk so later launches
+// can skip compiling and linking the GLSL sources
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+/***********************************************************
+ *  ProgramCache
+ *
+ *  Each pair of vertex and fragment shader files gets a
+ *  cache file next to the vertex shader holding the program
+ *  binary the driver handed back after linking.  The cache
+ *  is keyed by a hash of both sources and one of the driver
+ *  vendor, renderer and version, so editing a shader or
+ *  updating the driver invalidates it automatically.  A
+ *  binary the driver refuses is rebuilt from the sources.
+ ***********************************************************/
+class ProgramCache
+{
+public:
+	// check whether the GL context can hand out program binaries
+	static bool IsSupported();
+
+	// build the program of a vertex and a fragment shader file into
+	// the passed in shader manager, from the cache file when it is up
+	// to date.  The passed in #define lines are put after the #version
+	// line of both sources, each set of them making a program of its
+	// own.  The old program of the shader manager is deleted once the
+	// new one is linked, and kept when the files do not build, in
+	// which case false is returned with the log written out
+	static bool Load(ShaderManager* pShader, const char* vertexShaderFile, const char* fragmentShaderFile, const std::string& defines = std::string());
+
+private:
+	// read the whole text of a shader file, with the #define lines put
+	// after its #version line
+	static bool ReadSource(const char* filename, const std::string& defines, std::string& source);
+	// compile and link the sources into a program, 0 on failure
+	static GLuint BuildProgram(const char* vertexShaderFile, const std::string& vertexSource, const char* fragmentShaderFile, const std::string& fragmentSource);
+	// compile one stage of a program, 0 on failure
+	static GLuint CompileShader(GLenum type, const char* filename, const std::string& source);
+
+	// fold a text into a running hash
+	static uint64_t HashText(const std::string& text, uint64_t hash);
+	// get the hash of the driver the binaries were made by
+	static uint64_t GetDriverHash();
+	// get the path of the cache file for a program and its defines
+	static std::string GetCachePath(const char* vertexShaderFile, const char* fragmentShaderFile, const std::string& defines);
+
+	// create a program from its cache file, 0 when there is no cache
+	// file, it is out of date or the driver refuses the binary
+	static GLuint LoadBinary(const std::string& cachePath, uint64_t sourceHash, uint64_t driverHash);
+	// write the cache file of a linked program
+	static bool SaveBinary(const std::string& cachePath, GLuint program, uint64_t sourceHash, uint64_t driverHash);
+};
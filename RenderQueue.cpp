@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// collect the draws of a frame, sort them to share render state, and count
+// the state changes that were made or skipped
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// set in the keys of transparent draws so they sort last
+	const uint64_t g_TransparentBit = (uint64_t)1 << 63;
+
+	/***********************************************************
+	 *  CompareItems()
+	 *
+	 *  Order two draw items by their sort keys.
+	 ***********************************************************/
+	bool CompareItems(const RenderQueue::DRAW_ITEM& a, const RenderQueue::DRAW_ITEM& b)
+	{
+		return(a.sortKey < b.sortKey);
+	}
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+	memset(&m_counters, 0, sizeof(m_counters));
+	memset(&m_lastCounters, 0, sizeof(m_lastCounters));
+}
+
+/***********************************************************
+ *  MakeOpaqueKey()
+ *
+ *  This method is used for packing the state of an opaque
+ *  draw into a sort key, from the most to the least costly
+ *  state to change: program, texture, material, then mesh.
+ ***********************************************************/
+uint64_t RenderQueue::MakeOpaqueKey(int program, int texture, int material, int mesh)
+{
+	// shift -1 (none) to 0 so it sorts before the real handles
+	uint64_t key = 0;
+	key |= ((uint64_t)(program & 0xFF)) << 48;
+	key |= ((uint64_t)((texture + 1) & 0xFFFF)) << 32;
+	key |= ((uint64_t)((material + 1) & 0xFFFF)) << 16;
+	key |= ((uint64_t)(mesh & 0xFFFF));
+
+	return(key);
+}
+
+/***********************************************************
+ *  MakeTransparentKey()
+ *
+ *  This method is used for making the sort key of a draw
+ *  that blends with what is behind it.  The bits of a
+ *  positive float order like the float, so inverting them
+ *  puts the farthest draws first.
+ ***********************************************************/
+uint64_t RenderQueue::MakeTransparentKey(float viewDistance)
+{
+	uint32_t distanceBits = 0;
+
+	viewDistance = std::max(viewDistance, 0.0f);
+	memcpy(&distanceBits, &viewDistance, sizeof(distanceBits));
+
+	return(g_TransparentBit | (uint64_t)(0xFFFFFFFFu - distanceBits));
+}
+
+/***********************************************************
+ *  MakeBlendedKey()
+ *
+ *  This method is used for making the sort key of a
+ *  transparent draw that is composited order independently,
+ *  so it only needs to share state with its neighbours.
+ ***********************************************************/
+uint64_t RenderQueue::MakeBlendedKey(int texture, int material, int mesh)
+{
+	return(g_TransparentBit | MakeOpaqueKey(0, texture, material, mesh));
+}
+
+/***********************************************************
+ *  IsTransparentKey()
+ *
+ *  This method is used for checking whether a sort key was
+ *  made for a transparent draw.
+ ***********************************************************/
+bool RenderQueue::IsTransparentKey(uint64_t sortKey)
+{
+	return((sortKey & g_TransparentBit) != 0);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for starting a new frame.  The
+ *  counters of the last frame kept by EndFrame() stay
+ *  readable until the next call to EndFrame().
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	m_items.clear();
+	memset(&m_counters, 0, sizeof(m_counters));
+}
+
+/***********************************************************
+ *  MakeItem()
+ *
+ *  This method is used for filling in a draw item.
+ ***********************************************************/
+RenderQueue::DRAW_ITEM RenderQueue::MakeItem(uint64_t sortKey, ITEM_TYPE type, int index)
+{
+	DRAW_ITEM item;
+
+	item.sortKey = sortKey;
+	item.type = type;
+	item.index = index;
+
+	return(item);
+}
+
+/***********************************************************
+ *  Add()
+ *
+ *  This method is used for adding a draw to the frame.
+ ***********************************************************/
+void RenderQueue::Add(uint64_t sortKey, ITEM_TYPE type, int index)
+{
+	m_items.push_back(MakeItem(sortKey, type, index));
+}
+
+/***********************************************************
+ *  AddItems()
+ *
+ *  This method is used for adding a list of draws to the
+ *  frame, after the draws that were already added.
+ ***********************************************************/
+void RenderQueue::AddItems(const std::vector<DRAW_ITEM>& items)
+{
+	m_items.insert(m_items.end(), items.begin(), items.end());
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for sorting the draws of the frame
+ *  into drawing order.  The sort is stable so draws with the
+ *  same key keep the order they were added in.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	std::stable_sort(m_items.begin(), m_items.end(), CompareItems);
+}
+
+/***********************************************************
+ *  CountState()
+ *
+ *  This method is used for counting a state change that was
+ *  either made or skipped because the value was already set.
+ ***********************************************************/
+void RenderQueue::CountState(STATE_COUNTER& counter, bool bChanged)
+{
+	if (bChanged == true)
+	{
+		counter.changed++;
+	}
+	else
+	{
+		counter.elided++;
+	}
+}
@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// collect the draws of a frame, sort them to share render state, and count
+// the state changes that were made or skipped
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  Each frame the draws are added with a 64 bit sort key.
+ *  Opaque keys order the draws by shader program, texture,
+ *  material and mesh, so draws that share state end up next
+ *  to each other.  Transparent keys sort after every opaque
+ *  key, farthest from the camera first, so they blend over
+ *  what is behind them.  When the transparent draws are
+ *  composited order independently their keys sort by state
+ *  instead, still after every opaque key.
+ *
+ *  The queue also keeps the per frame counters of the state
+ *  changes that the drawing code made and skipped.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+
+	// what the index of a draw item refers to
+	enum ITEM_TYPE
+	{
+		ITEM_NODE = 0,			// a scene graph node
+		ITEM_INSTANCE_BATCH,	// a batch of instanced nodes
+		ITEM_INDIRECT_GROUP		// batches drawn with one indirect draw
+	};
+
+	struct DRAW_ITEM
+	{
+		uint64_t sortKey;
+		ITEM_TYPE type;
+		int index;
+	};
+
+	// how often one kind of state was changed or left as it was
+	struct STATE_COUNTER
+	{
+		int changed;
+		int elided;
+	};
+
+	struct FRAME_COUNTERS
+	{
+		int drawCalls;
+		// objects skipped because they were outside the view
+		int culled;
+		// instances skipped because nearer objects hid them in the
+		// depth of the frame before
+		int occluded;
+		STATE_COUNTER program;
+		STATE_COUNTER texture;
+		STATE_COUNTER sampler;
+		STATE_COUNTER material;
+		STATE_COUNTER UVscale;
+		STATE_COUNTER color;
+		// samples that passed the depth test in the depth pre-pass
+		// and in the opaque shading pass, counted a few frames before,
+		// and the pixels of the view they were drawn into
+		int depthSamples;
+		int shadedSamples;
+		int viewPixels;
+	};
+
+	// build the sort key of an opaque draw, -1 texture or material
+	// means the draw does not use one
+	static uint64_t MakeOpaqueKey(int program, int texture, int material, int mesh);
+	// build the sort key of a transparent draw that blends over what
+	// was drawn before it, farthest from the camera first
+	static uint64_t MakeTransparentKey(float viewDistance);
+	// build the sort key of a transparent draw whose blending does not
+	// depend on the order, which sorts by state like an opaque draw
+	static uint64_t MakeBlendedKey(int texture, int material, int mesh);
+	// check whether a sort key is one of the transparent keys
+	static bool IsTransparentKey(uint64_t sortKey);
+	// build a draw item, for lists that are added all at once
+	static DRAW_ITEM MakeItem(uint64_t sortKey, ITEM_TYPE type, int index);
+
+	// remove the items and reset the counters for a new frame
+	void Clear();
+	// keep the counters of the frame that was just drawn
+	void EndFrame() { m_lastCounters = m_counters; }
+	// add a draw item to the frame
+	void Add(uint64_t sortKey, ITEM_TYPE type, int index);
+	// add a list of draw items built away from the queue, such as
+	// on another thread
+	void AddItems(const std::vector<DRAW_ITEM>& items);
+	// put the items into drawing order
+	void Sort();
+
+	int GetItemCount() const { return((int)m_items.size()); }
+	const DRAW_ITEM& GetItem(int index) const { return(m_items[index]); }
+
+	// record whether a piece of state had to be changed
+	void CountState(STATE_COUNTER& counter, bool bChanged);
+	void CountDrawCall() { m_counters.drawCalls++; }
+	void CountCulled(int objects) { m_counters.culled += objects; }
+	void CountOccluded(int instances) { m_counters.occluded += instances; }
+	void CountSamples(int depthSamples, int shadedSamples, int viewPixels)
+	{
+		m_counters.depthSamples = depthSamples;
+		m_counters.shadedSamples = shadedSamples;
+		m_counters.viewPixels = viewPixels;
+	}
+	FRAME_COUNTERS& GetCounters() { return(m_counters); }
+	// counters of the last finished frame
+	const FRAME_COUNTERS& GetLastFrameCounters() const { return(m_lastCounters); }
+
+private:
+	std::vector<DRAW_ITEM> m_items;
+	FRAME_COUNTERS m_counters;
+	FRAME_COUNTERS m_lastCounters;
+};
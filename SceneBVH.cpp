@@ -0,0 +1,534 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy over the scene graph nodes, for culling the scene
+// against the view and for picking objects with a ray
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <algorithm>
+#include <limits>
+
+// declaration of global variables
+namespace
+{
+	// leaves hold at most this many scene nodes unless the nodes
+	// can not be split apart
+	const int g_MaxLeafPrimitives = 4;
+	// candidate split positions tried along the split axis
+	const int g_SplitBins = 12;
+	// cost of visiting an inner node, relative to testing a box
+	const float g_TraversalCost = 1.0f;
+	// moved nodes, as a share of all nodes, after which the refitted
+	// tree is likely worse than a new one
+	const float g_RebuildShare = 0.25f;
+	// trees over fewer scene nodes are culled on the calling thread
+	const int g_ParallelCullPrimitives = 2048;
+	// subtrees culled as separate jobs for each thread, more than
+	// one so the threads can even out unbalanced subtrees
+	const int g_CullSubtreesPerThread = 4;
+
+	struct BOUNDS
+	{
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	/***********************************************************
+	 *  EmptyBounds()
+	 *
+	 *  Get a box that any box grows to fit.
+	 ***********************************************************/
+	BOUNDS EmptyBounds()
+	{
+		BOUNDS bounds;
+		float large = std::numeric_limits<float>::max();
+
+		bounds.boundsMin = glm::vec3(large, large, large);
+		bounds.boundsMax = glm::vec3(-large, -large, -large);
+		return(bounds);
+	}
+
+	/***********************************************************
+	 *  GrowBounds()
+	 *
+	 *  Grow a box to hold another box.
+	 ***********************************************************/
+	void GrowBounds(BOUNDS& bounds, const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		bounds.boundsMin = glm::min(bounds.boundsMin, boundsMin);
+		bounds.boundsMax = glm::max(bounds.boundsMax, boundsMax);
+	}
+
+	/***********************************************************
+	 *  SurfaceArea()
+	 *
+	 *  Get the surface area of a box, 0 for an empty box.
+	 ***********************************************************/
+	float SurfaceArea(const BOUNDS& bounds)
+	{
+		glm::vec3 size = bounds.boundsMax - bounds.boundsMin;
+		if ((size.x < 0.0f) || (size.y < 0.0f) || (size.z < 0.0f))
+		{
+			return(0.0f);
+		}
+		return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+	}
+
+	/***********************************************************
+	 *  IntersectBox()
+	 *
+	 *  Test a ray against a box with the slab method.  The hit
+	 *  distance is along the ray direction, in its units.
+	 ***********************************************************/
+	bool IntersectBox(
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		float maxDistance,
+		float& hitDistance)
+	{
+		float nearest = 0.0f;
+		float farthest = maxDistance;
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float t0 = (boundsMin[axis] - origin[axis]) * inverseDirection[axis];
+			float t1 = (boundsMax[axis] - origin[axis]) * inverseDirection[axis];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			nearest = std::max(nearest, t0);
+			farthest = std::min(farthest, t1);
+			if (nearest > farthest)
+			{
+				return(false);
+			}
+		}
+
+		hitDistance = nearest;
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+	m_refitCount = 0;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over all the
+ *  nodes of the scene graph, which must have their bounds
+ *  up to date.
+ ***********************************************************/
+void SceneBVH::Build(const SceneGraph& sceneGraph)
+{
+	int count = sceneGraph.GetNodeCount();
+	std::vector<glm::vec3> centroids(count);
+
+	m_nodes.clear();
+	m_parents.clear();
+	m_primitives.resize(count);
+	m_primitiveLeaves.assign(count, -1);
+	m_refitCount = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		const SceneGraph::SCENE_NODE& node = sceneGraph.GetNode(i);
+		m_primitives[i] = i;
+		centroids[i] = 0.5f * (node.boundsMin + node.boundsMax);
+	}
+
+	if (count > 0)
+	{
+		m_nodes.reserve(2 * count);
+		m_parents.reserve(2 * count);
+		BuildRange(sceneGraph, centroids, 0, count, -1);
+	}
+}
+
+/***********************************************************
+ *  BuildRange()
+ *
+ *  This method is used for building the subtree over a
+ *  range of the primitive array.  The range is split into
+ *  two where the surface area heuristic estimates the lowest
+ *  cost, trying a few evenly spaced positions along the axis
+ *  the centroids spread the most.
+ ***********************************************************/
+int SceneBVH::BuildRange(const SceneGraph& sceneGraph, std::vector<glm::vec3>& centroids, int first, int count, int parent)
+{
+	int index = (int)m_nodes.size();
+	BOUNDS bounds = EmptyBounds();
+	BOUNDS centroidBounds = EmptyBounds();
+
+	for (int i = first; i < first + count; i++)
+	{
+		const SceneGraph::SCENE_NODE& node = sceneGraph.GetNode(m_primitives[i]);
+		const glm::vec3& centroid = centroids[m_primitives[i]];
+		GrowBounds(bounds, node.boundsMin, node.boundsMax);
+		GrowBounds(centroidBounds, centroid, centroid);
+	}
+
+	BVH_NODE treeNode;
+	treeNode.boundsMin = bounds.boundsMin;
+	treeNode.boundsMax = bounds.boundsMax;
+	treeNode.rightChild = -1;
+	treeNode.firstPrimitive = first;
+	treeNode.primitiveCount = count;
+	m_nodes.push_back(treeNode);
+	m_parents.push_back(parent);
+
+	// split along the axis the centroids spread the most
+	glm::vec3 spread = centroidBounds.boundsMax - centroidBounds.boundsMin;
+	int axis = 0;
+	if (spread.y > spread[axis])
+	{
+		axis = 1;
+	}
+	if (spread.z > spread[axis])
+	{
+		axis = 2;
+	}
+
+	int split = first;
+	if ((count > g_MaxLeafPrimitives) && (spread[axis] > 0.0f))
+	{
+		// sort the centroids into bins and evaluate splitting
+		// between each pair of neighbouring bins
+		BOUNDS binBounds[g_SplitBins];
+		int binCounts[g_SplitBins];
+		float binScale = g_SplitBins / spread[axis];
+
+		for (int b = 0; b < g_SplitBins; b++)
+		{
+			binBounds[b] = EmptyBounds();
+			binCounts[b] = 0;
+		}
+		for (int i = first; i < first + count; i++)
+		{
+			const SceneGraph::SCENE_NODE& node = sceneGraph.GetNode(m_primitives[i]);
+			int b = std::min((int)((centroids[m_primitives[i]][axis] - centroidBounds.boundsMin[axis]) * binScale), g_SplitBins - 1);
+			GrowBounds(binBounds[b], node.boundsMin, node.boundsMax);
+			binCounts[b]++;
+		}
+
+		// sweep from the right to get the area and count of every
+		// right hand side, then from the left to price each split
+		float rightAreas[g_SplitBins];
+		int rightCounts[g_SplitBins];
+		BOUNDS right = EmptyBounds();
+		int rightCount = 0;
+		for (int b = g_SplitBins - 1; b > 0; b--)
+		{
+			GrowBounds(right, binBounds[b].boundsMin, binBounds[b].boundsMax);
+			rightCount += binCounts[b];
+			rightAreas[b] = SurfaceArea(right);
+			rightCounts[b] = rightCount;
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		int bestBin = -1;
+		BOUNDS left = EmptyBounds();
+		int leftCount = 0;
+		for (int b = 1; b < g_SplitBins; b++)
+		{
+			GrowBounds(left, binBounds[b - 1].boundsMin, binBounds[b - 1].boundsMax);
+			leftCount += binCounts[b - 1];
+			if ((leftCount == 0) || (rightCounts[b] == 0))
+			{
+				continue;
+			}
+			float cost = leftCount * SurfaceArea(left) + rightCounts[b] * rightAreas[b];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = b;
+			}
+		}
+
+		// only split when it is estimated to be cheaper than testing
+		// every box of the range, unless the leaf would be too large
+		float parentArea = SurfaceArea(bounds);
+		float leafCost = (float)count;
+		float splitCost = g_TraversalCost + ((parentArea > 0.0f) ? bestCost / parentArea : 0.0f);
+		if ((bestBin > 0) && ((splitCost < leafCost) || (count > 4 * g_MaxLeafPrimitives)))
+		{
+			float splitPosition = centroidBounds.boundsMin[axis] + bestBin / binScale;
+			int* pMiddle = std::partition(
+				&m_primitives[first],
+				&m_primitives[first] + count,
+				[&](int primitive) { return(centroids[primitive][axis] < splitPosition); });
+			split = (int)(pMiddle - &m_primitives[0]);
+		}
+	}
+
+	// boxes on top of each other can not be told apart by their
+	// centroids, so a large range of them is halved instead
+	if (((split == first) || (split == first + count)) && (count > 4 * g_MaxLeafPrimitives))
+	{
+		split = first + count / 2;
+	}
+
+	if ((split == first) || (split == first + count))
+	{
+		for (int i = first; i < first + count; i++)
+		{
+			m_primitiveLeaves[m_primitives[i]] = index;
+		}
+		return(index);
+	}
+
+	BuildRange(sceneGraph, centroids, first, split - first, index);
+	int rightChild = BuildRange(sceneGraph, centroids, split, first + count - split, index);
+	m_nodes[index].rightChild = rightChild;
+
+	return(index);
+}
+
+/***********************************************************
+ *  RefitNode()
+ *
+ *  This method is used for recomputing the box of a tree
+ *  node, from its scene nodes for a leaf or from its two
+ *  children otherwise.
+ ***********************************************************/
+void SceneBVH::RefitNode(const SceneGraph& sceneGraph, int index)
+{
+	BVH_NODE& treeNode = m_nodes[index];
+	BOUNDS bounds = EmptyBounds();
+
+	if (treeNode.rightChild < 0)
+	{
+		for (int i = treeNode.firstPrimitive; i < treeNode.firstPrimitive + treeNode.primitiveCount; i++)
+		{
+			const SceneGraph::SCENE_NODE& node = sceneGraph.GetNode(m_primitives[i]);
+			GrowBounds(bounds, node.boundsMin, node.boundsMax);
+		}
+	}
+	else
+	{
+		const BVH_NODE& leftNode = m_nodes[index + 1];
+		const BVH_NODE& rightNode = m_nodes[treeNode.rightChild];
+		GrowBounds(bounds, leftNode.boundsMin, leftNode.boundsMax);
+		GrowBounds(bounds, rightNode.boundsMin, rightNode.boundsMax);
+	}
+
+	treeNode.boundsMin = bounds.boundsMin;
+	treeNode.boundsMax = bounds.boundsMax;
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for updating the tree after some of
+ *  the scene nodes moved.  Only the boxes on the paths from
+ *  their leaves to the root are recomputed.  Once many nodes
+ *  have moved the tree is built again, since the refitted
+ *  boxes overlap more and more.
+ ***********************************************************/
+void SceneBVH::Refit(const SceneGraph& sceneGraph, const std::vector<int>& movedNodes)
+{
+	if (sceneGraph.GetNodeCount() != GetPrimitiveCount())
+	{
+		Build(sceneGraph);
+		return;
+	}
+
+	m_refitCount += (int)movedNodes.size();
+	if (m_refitCount > g_RebuildShare * GetPrimitiveCount())
+	{
+		Build(sceneGraph);
+		return;
+	}
+
+	for (size_t i = 0; i < movedNodes.size(); i++)
+	{
+		for (int index = m_primitiveLeaves[movedNodes[i]]; index >= 0; index = m_parents[index])
+		{
+			RefitNode(sceneGraph, index);
+		}
+	}
+}
+
+/***********************************************************
+ *  Cull()
+ *
+ *  This method is used for flagging the scene nodes that may
+ *  be visible.  The flags must be cleared beforehand.
+ *  For large trees the top levels are split into subtrees
+ *  that are culled as separate jobs.  The subtrees own
+ *  separate scene nodes, so the jobs never write the same
+ *  flag.
+ ***********************************************************/
+void SceneBVH::Cull(const SceneGraph& sceneGraph, const Frustum& frustum, std::vector<char>& visibleNodes, JobSystem* pJobSystem) const
+{
+	if (m_nodes.empty())
+	{
+		return;
+	}
+	if ((NULL == pJobSystem) || (GetPrimitiveCount() < g_ParallelCullPrimitives))
+	{
+		CullSubtree(sceneGraph, frustum, 0, visibleNodes);
+		return;
+	}
+
+	// replace inner nodes by their children a level at a time until
+	// there are enough subtrees to go around
+	size_t subtreeCount = (size_t)(pJobSystem->GetThreadCount() * g_CullSubtreesPerThread);
+	std::vector<int> roots(1, 0);
+	bool bSplit = true;
+	while ((roots.size() < subtreeCount) && (bSplit == true))
+	{
+		std::vector<int> children;
+		bSplit = false;
+		for (size_t i = 0; i < roots.size(); i++)
+		{
+			const BVH_NODE& treeNode = m_nodes[roots[i]];
+			if (treeNode.rightChild < 0)
+			{
+				children.push_back(roots[i]);
+			}
+			else
+			{
+				children.push_back(roots[i] + 1);
+				children.push_back(treeNode.rightChild);
+				bSplit = true;
+			}
+		}
+		roots.swap(children);
+	}
+
+	pJobSystem->ParallelFor((int)roots.size(), 1,
+		[&](int begin, int end, int)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				CullSubtree(sceneGraph, frustum, roots[i], visibleNodes);
+			}
+		});
+}
+
+/***********************************************************
+ *  CullSubtree()
+ *
+ *  This method is used for flagging the visible scene nodes
+ *  below one tree node.  A subtree fully inside the frustum
+ *  has all its nodes flagged without testing them, and one
+ *  fully outside is skipped.
+ ***********************************************************/
+void SceneBVH::CullSubtree(const SceneGraph& sceneGraph, const Frustum& frustum, int root, std::vector<char>& visibleNodes) const
+{
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = root;
+
+	while (stackSize > 0)
+	{
+		const BVH_NODE& treeNode = m_nodes[stack[--stackSize]];
+		int firstPrimitive = treeNode.firstPrimitive;
+		int lastPrimitive = treeNode.firstPrimitive + treeNode.primitiveCount;
+
+		Frustum::CULL_RESULT result = frustum.TestBox(treeNode.boundsMin, treeNode.boundsMax);
+		if (result == Frustum::CULL_OUTSIDE)
+		{
+			continue;
+		}
+
+		if (result == Frustum::CULL_INSIDE)
+		{
+			for (int i = firstPrimitive; i < lastPrimitive; i++)
+			{
+				visibleNodes[m_primitives[i]] = 1;
+			}
+		}
+		else if ((treeNode.rightChild < 0) || (stackSize + 2 > 64))
+		{
+			for (int i = firstPrimitive; i < lastPrimitive; i++)
+			{
+				const SceneGraph::SCENE_NODE& node = sceneGraph.GetNode(m_primitives[i]);
+				if (frustum.IsBoxVisible(node.boundsMin, node.boundsMax) == true)
+				{
+					visibleNodes[m_primitives[i]] = 1;
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize++] = treeNode.rightChild;
+			stack[stackSize++] = (int)(&treeNode - &m_nodes[0]) + 1;
+		}
+	}
+}
+
+/***********************************************************
+ *  Raycast()
+ *
+ *  This method is used for finding the nearest scene node
+ *  whose box is hit by a ray.  Subtrees whose box is farther
+ *  than the nearest hit so far are not visited.
+ ***********************************************************/
+int SceneBVH::Raycast(const SceneGraph& sceneGraph, const glm::vec3& origin, const glm::vec3& direction, float& hitDistance) const
+{
+	int hitNode = -1;
+	float nearest = std::numeric_limits<float>::max();
+
+	if (m_nodes.empty())
+	{
+		return(-1);
+	}
+
+	// a zero direction component divides to infinity, which the
+	// slab test handles
+	glm::vec3 inverseDirection = glm::vec3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	std::vector<int> stack;
+	stack.push_back(0);
+	while (stack.empty() == false)
+	{
+		int index = stack.back();
+		const BVH_NODE& treeNode = m_nodes[index];
+		float distance = 0.0f;
+		stack.pop_back();
+
+		if (IntersectBox(origin, inverseDirection, treeNode.boundsMin, treeNode.boundsMax, nearest, distance) == false)
+		{
+			continue;
+		}
+
+		if (treeNode.rightChild >= 0)
+		{
+			stack.push_back(treeNode.rightChild);
+			stack.push_back(index + 1);
+			continue;
+		}
+
+		for (int i = treeNode.firstPrimitive; i < treeNode.firstPrimitive + treeNode.primitiveCount; i++)
+		{
+			const SceneGraph::SCENE_NODE& node = sceneGraph.GetNode(m_primitives[i]);
+			if ((IntersectBox(origin, inverseDirection, node.boundsMin, node.boundsMax, nearest, distance) == true) &&
+				(distance < nearest))
+			{
+				nearest = distance;
+				hitNode = m_primitives[i];
+			}
+		}
+	}
+
+	if (hitNode >= 0)
+	{
+		hitDistance = nearest;
+	}
+	return(hitNode);
+}
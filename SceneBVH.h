@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the scene graph nodes, for culling the scene
+// against the view and for picking objects with a ray
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGraph.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  The tree is built top down over the world space boxes of
+ *  the scene nodes, splitting each range of nodes where the
+ *  surface area heuristic estimates the cheapest traversal.
+ *  It is stored as a flat array in depth first order: the
+ *  left child of an inner node directly follows it, and the
+ *  nodes below any tree node belong to one contiguous range
+ *  of the primitive array.
+ *
+ *  When only a few scene nodes move, Refit() grows or shrinks
+ *  the boxes on the paths up from their leaves instead of
+ *  building the tree again.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// constructor
+	SceneBVH();
+
+	// build the tree over every node of the scene graph
+	void Build(const SceneGraph& sceneGraph);
+	// update the boxes above the passed in moved scene nodes
+	void Refit(const SceneGraph& sceneGraph, const std::vector<int>& movedNodes);
+
+	// number of scene nodes the tree was built over
+	int GetPrimitiveCount() const { return((int)m_primitives.size()); }
+
+	// flag the scene nodes whose boxes may be in the frustum, the
+	// subtrees are culled on the threads of the job system when
+	// one is passed in
+	void Cull(const SceneGraph& sceneGraph, const Frustum& frustum, std::vector<char>& visibleNodes, JobSystem* pJobSystem = NULL) const;
+	// find the nearest scene node whose box the ray hits, -1 when
+	// none is hit, the direction does not need to be normalized
+	int Raycast(const SceneGraph& sceneGraph, const glm::vec3& origin, const glm::vec3& direction, float& hitDistance) const;
+
+private:
+	struct BVH_NODE
+	{
+		glm::vec3 boundsMin;
+		int rightChild;			// -1 for a leaf
+		glm::vec3 boundsMax;
+		int firstPrimitive;
+		int primitiveCount;
+	};
+
+	std::vector<BVH_NODE> m_nodes;
+	// scene node indices, ordered so each tree node owns a range
+	std::vector<int> m_primitives;
+	// parent of each tree node and leaf of each scene node, for refits
+	std::vector<int> m_parents;
+	std::vector<int> m_primitiveLeaves;
+	// scene nodes refitted since the last build
+	int m_refitCount;
+
+	// build the subtree over a range of the primitives, returns its index
+	int BuildRange(const SceneGraph& sceneGraph, std::vector<glm::vec3>& centroids, int first, int count, int parent);
+	// recompute the box of one tree node from what is below it
+	void RefitNode(const SceneGraph& sceneGraph, int index);
+	// flag the visible scene nodes below one tree node
+	void CullSubtree(const SceneGraph& sceneGraph, const Frustum& frustum, int root, std::vector<char>& visibleNodes) const;
+};
@@ -0,0 +1,616 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// load the textures, materials, lights and objects of a 3D scene from a text
+// scene file, compiled once into a binary file that loads with a single read
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+#include "SceneGraph.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+
+// declaration of global variables
+namespace
+{
+	// compiled files sit next to the scene file with this extension
+	const char* g_CompiledExtension = ".bin";
+
+	// identifies the compiled file layout, bump the version on change
+	const uint32_t g_CompiledMagic = 0x314E4353;	// "SCN1"
+	const uint32_t g_CompiledVersion = 4;
+
+	// fixed size header written at the start of every compiled file,
+	// the record arrays follow it in the order of the counts
+	struct COMPILED_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		int64_t sourceModifiedTime;
+		int64_t sourceFileSize;
+		uint32_t textureCount;
+		uint32_t materialCount;
+		uint32_t lightCount;
+		uint32_t objectCount;
+	};
+
+	// mesh names used by the object lines of the text form
+	struct MESH_NAME
+	{
+		const char* name;
+		SceneGraph::MESH_TYPE mesh;
+	};
+	const MESH_NAME g_MeshNames[] =
+	{
+		{ "plane", SceneGraph::MESH_PLANE },
+		{ "box", SceneGraph::MESH_BOX },
+		{ "pyramid4", SceneGraph::MESH_PYRAMID4 },
+		{ "cylinder", SceneGraph::MESH_CYLINDER },
+		{ "taperedCylinder", SceneGraph::MESH_TAPERED_CYLINDER },
+		{ "torus", SceneGraph::MESH_TORUS },
+		{ "sphere", SceneGraph::MESH_SPHERE }
+	};
+
+	/***********************************************************
+	 *  CopyTag()
+	 *
+	 *  Copy a string into a fixed size record field, false is
+	 *  returned if it does not fit.
+	 ***********************************************************/
+	bool CopyTag(char* dest, size_t destSize, const std::string& value)
+	{
+		if (value.size() >= destSize)
+		{
+			return(false);
+		}
+		memset(dest, 0, destSize);
+		memcpy(dest, value.c_str(), value.size());
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ReadVec3()
+	 *
+	 *  Read three floats from a line of the text form.
+	 ***********************************************************/
+	bool ReadVec3(std::istringstream& line, glm::vec3& value)
+	{
+		line >> value.x >> value.y >> value.z;
+		return(!line.fail());
+	}
+
+	/***********************************************************
+	 *  AppendArray()
+	 *
+	 *  Append the raw bytes of a record array to a buffer.
+	 ***********************************************************/
+	template <typename T>
+	void AppendArray(std::vector<char>& buffer, const std::vector<T>& values)
+	{
+		const char* pBytes = (const char*)values.data();
+		buffer.insert(buffer.end(), pBytes, pBytes + (values.size() * sizeof(T)));
+	}
+
+	/***********************************************************
+	 *  ReadArray()
+	 *
+	 *  Copy a record array out of a buffer, advancing the read
+	 *  offset past it.
+	 ***********************************************************/
+	template <typename T>
+	void ReadArray(const std::vector<char>& buffer, size_t& offset, uint32_t count, std::vector<T>& values)
+	{
+		values.resize(count);
+		if (count > 0)
+		{
+			memcpy(values.data(), &buffer[offset], count * sizeof(T));
+		}
+		offset += count * sizeof(T);
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+}
+
+/***********************************************************
+ *  GetCompiledPath()
+ *
+ *  This method is used for getting the compiled file path for
+ *  the passed in scene file.
+ ***********************************************************/
+std::string SceneFile::GetCompiledPath(const std::string& filename)
+{
+	return(filename + g_CompiledExtension);
+}
+
+/***********************************************************
+ *  GetSourceStamp()
+ *
+ *  This method is used for reading the size and modification
+ *  time of a scene file, which together key its compiled file.
+ ***********************************************************/
+bool SceneFile::GetSourceStamp(const std::string& filename, int64_t& modifiedTime, int64_t& fileSize)
+{
+	struct stat fileInfo;
+
+	if (stat(filename.c_str(), &fileInfo) != 0)
+	{
+		return(false);
+	}
+
+	modifiedTime = (int64_t)fileInfo.st_mtime;
+	fileSize = (int64_t)fileInfo.st_size;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing everything that was
+ *  loaded from a scene file.
+ ***********************************************************/
+void SceneFile::Clear()
+{
+	m_textures.clear();
+	m_materials.clear();
+	m_lights.clear();
+	m_transforms.clear();
+	m_textureIDs.clear();
+	m_materialIDs.clear();
+	m_draws.clear();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for loading a scene file.  The
+ *  compiled copy is used when it is up to date, otherwise the
+ *  text is parsed and the compiled copy is written for the
+ *  next launch.
+ ***********************************************************/
+bool SceneFile::Load(const std::string& filename)
+{
+	Clear();
+
+	if (LoadCompiled(filename) == true)
+	{
+		std::cout << "Loaded compiled scene " << GetCompiledPath(filename) << std::endl;
+		return(true);
+	}
+
+	if (LoadText(filename) == false)
+	{
+		Clear();
+		return(false);
+	}
+
+	if (SaveCompiled(filename) == false)
+	{
+		std::cout << "Could not write compiled scene " << GetCompiledPath(filename) << std::endl;
+	}
+
+	std::cout << "Loaded scene " << filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  LoadText()
+ *
+ *  This method is used for parsing the text form of a scene
+ *  file.  Objects refer to textures and materials by tag, so
+ *  those must be defined on earlier lines.
+ ***********************************************************/
+bool SceneFile::LoadText(const std::string& filename)
+{
+	std::ifstream sceneFile(filename.c_str());
+	if (!sceneFile)
+	{
+		std::cout << "Could not open scene file " << filename << std::endl;
+		return(false);
+	}
+
+	std::string text;
+	int lineNumber = 0;
+	bool bValid = true;
+
+	while (std::getline(sceneFile, text) && (bValid == true))
+	{
+		lineNumber++;
+
+		std::istringstream line(text);
+		std::string keyword;
+		std::string tag;
+
+		// skip blank lines and comments
+		if (!(line >> keyword) || (keyword[0] == '#'))
+		{
+			continue;
+		}
+
+		if (keyword == "texture")
+		{
+			SCENE_TEXTURE texture;
+			std::string path;
+			line >> tag >> path;
+			bValid = !line.fail() &&
+				CopyTag(texture.tag, sizeof(texture.tag), tag) &&
+				CopyTag(texture.filename, sizeof(texture.filename), path);
+			m_textures.push_back(texture);
+		}
+		else if (keyword == "material")
+		{
+			SCENE_MATERIAL material;
+			std::string field;
+			line >> tag;
+			bValid = CopyTag(material.tag, sizeof(material.tag), tag) &&
+				ReadVec3(line, material.diffuseColor) &&
+				ReadVec3(line, material.specularColor);
+			line >> material.shininess;
+			bValid = bValid && !line.fail();
+			// the anisotropy of the textures is optional
+			material.anisotropy = 0;
+			if ((bValid == true) && (line >> field))
+			{
+				bValid = (field == "anisotropy") && (line >> material.anisotropy) && (material.anisotropy > 0);
+			}
+			m_materials.push_back(material);
+		}
+		else if ((keyword == "directional") || (keyword == "point") || (keyword == "spot"))
+		{
+			SCENE_LIGHT light = SCENE_LIGHT();
+
+			if (keyword == "spot")
+			{
+				light.type = LIGHT_SPOT;
+			}
+			else
+			{
+				light.type = (keyword == "point") ? LIGHT_POINT : LIGHT_DIRECTIONAL;
+				bValid = ReadVec3(line, light.vector);
+			}
+			bValid = bValid &&
+				ReadVec3(line, light.ambient) &&
+				ReadVec3(line, light.diffuse) &&
+				ReadVec3(line, light.specular);
+			// the range of point lights is optional
+			if ((light.type == LIGHT_POINT) && !(line >> light.range))
+			{
+				light.range = 0.0f;
+			}
+			if (light.type == LIGHT_SPOT)
+			{
+				line >> light.constant >> light.linear >> light.quadratic
+					>> light.cutOffDegrees >> light.outerCutOffDegrees;
+				bValid = bValid && !line.fail();
+				// the position and direction of spot lights are optional
+				if (bValid == true)
+				{
+					if (ReadVec3(line, light.vector) == false)
+					{
+						light.vector = glm::vec3(0.0f, 0.0f, 0.0f);
+					}
+					else
+					{
+						bValid = ReadVec3(line, light.direction);
+					}
+				}
+			}
+			m_lights.push_back(light);
+		}
+		else if (keyword == "object")
+		{
+			SCENE_TRANSFORM transform;
+			SCENE_DRAW draw;
+			int32_t textureID = -1;
+			int32_t materialID = -1;
+			std::string meshName;
+			std::string field;
+
+			transform.scaleXYZ = glm::vec3(1.0f, 1.0f, 1.0f);
+			transform.rotationDegrees = glm::vec3(0.0f, 0.0f, 0.0f);
+			transform.positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
+			draw.drawFlags = 0;
+			draw.bInstanced = 0;
+			draw.bDynamic = 0;
+			draw.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+			draw.UVscale = glm::vec2(1.0f, 1.0f);
+
+			line >> meshName;
+			bValid = false;
+			for (size_t i = 0; i < sizeof(g_MeshNames) / sizeof(g_MeshNames[0]); i++)
+			{
+				if (meshName == g_MeshNames[i].name)
+				{
+					draw.mesh = g_MeshNames[i].mesh;
+					bValid = true;
+				}
+			}
+
+			while ((bValid == true) && (line >> field))
+			{
+				if (field == "scale")
+				{
+					bValid = ReadVec3(line, transform.scaleXYZ);
+				}
+				else if (field == "rotate")
+				{
+					bValid = ReadVec3(line, transform.rotationDegrees);
+				}
+				else if (field == "position")
+				{
+					bValid = ReadVec3(line, transform.positionXYZ);
+				}
+				else if (field == "uv")
+				{
+					line >> draw.UVscale.x >> draw.UVscale.y;
+					bValid = !line.fail();
+				}
+				else if (field == "color")
+				{
+					line >> draw.color.r >> draw.color.g >> draw.color.b >> draw.color.a;
+					bValid = !line.fail();
+				}
+				else if (field == "texture")
+				{
+					line >> tag;
+					textureID = -1;
+					for (size_t i = 0; i < m_textures.size(); i++)
+					{
+						if (tag == m_textures[i].tag)
+						{
+							textureID = (int32_t)i;
+						}
+					}
+					bValid = (textureID >= 0);
+				}
+				else if (field == "material")
+				{
+					line >> tag;
+					materialID = -1;
+					for (size_t i = 0; i < m_materials.size(); i++)
+					{
+						if (tag == m_materials[i].tag)
+						{
+							materialID = (int32_t)i;
+						}
+					}
+					bValid = (materialID >= 0);
+				}
+				else if (field == "draw")
+				{
+					// the draw parts run to the next field
+					std::streampos position = line.tellg();
+					while (line >> field)
+					{
+						if (field == "top")
+						{
+							draw.drawFlags |= SceneGraph::DRAW_TOP;
+						}
+						else if (field == "bottom")
+						{
+							draw.drawFlags |= SceneGraph::DRAW_BOTTOM;
+						}
+						else if (field == "sides")
+						{
+							draw.drawFlags |= SceneGraph::DRAW_SIDES;
+						}
+						else
+						{
+							line.seekg(position);
+							break;
+						}
+						position = line.tellg();
+					}
+					line.clear();
+					bValid = (draw.drawFlags != 0);
+				}
+				else if (field == "instanced")
+				{
+					draw.bInstanced = 1;
+				}
+				else if (field == "dynamic")
+				{
+					draw.bDynamic = 1;
+				}
+				else
+				{
+					bValid = false;
+				}
+			}
+
+			if (draw.drawFlags == 0)
+			{
+				draw.drawFlags = SceneGraph::DRAW_ALL;
+			}
+
+			m_transforms.push_back(transform);
+			m_textureIDs.push_back(textureID);
+			m_materialIDs.push_back(materialID);
+			m_draws.push_back(draw);
+		}
+		else
+		{
+			bValid = false;
+		}
+	}
+
+	if (bValid == false)
+	{
+		std::cout << "Error in scene file " << filename << " at line " << lineNumber << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadCompiled()
+ *
+ *  This method is used for reading the compiled copy of a
+ *  scene file.  The whole file is read in one call and the
+ *  arrays are copied straight out of it.  False is returned
+ *  if there is no compiled file, if it is out of date or if
+ *  its records do not hold a valid scene.
+ ***********************************************************/
+bool SceneFile::LoadCompiled(const std::string& filename)
+{
+	int64_t modifiedTime = 0;
+	int64_t fileSize = 0;
+
+	if (GetSourceStamp(filename, modifiedTime, fileSize) == false)
+	{
+		return(false);
+	}
+
+	std::ifstream compiledFile(GetCompiledPath(filename).c_str(), std::ios::binary | std::ios::ate);
+	if (!compiledFile)
+	{
+		return(false);
+	}
+
+	std::vector<char> buffer((size_t)compiledFile.tellg());
+	if (buffer.size() < sizeof(COMPILED_HEADER))
+	{
+		return(false);
+	}
+	compiledFile.seekg(0);
+	compiledFile.read(buffer.data(), buffer.size());
+	if (!compiledFile)
+	{
+		return(false);
+	}
+
+	COMPILED_HEADER header;
+	memcpy(&header, buffer.data(), sizeof(header));
+
+	// the counts are 32 bit, so the size is added up in 64 bits to
+	// not wrap around where size_t is 32 bits
+	uint64_t expectedSize = (uint64_t)sizeof(COMPILED_HEADER) +
+		((uint64_t)header.textureCount * sizeof(SCENE_TEXTURE)) +
+		((uint64_t)header.materialCount * sizeof(SCENE_MATERIAL)) +
+		((uint64_t)header.lightCount * sizeof(SCENE_LIGHT)) +
+		((uint64_t)header.objectCount * (sizeof(SCENE_TRANSFORM) + (2 * sizeof(int32_t)) + sizeof(SCENE_DRAW)));
+
+	if ((header.magic != g_CompiledMagic) ||
+		(header.version != g_CompiledVersion) ||
+		(header.sourceModifiedTime != modifiedTime) ||
+		(header.sourceFileSize != fileSize) ||
+		((uint64_t)buffer.size() != expectedSize))
+	{
+		return(false);
+	}
+
+	size_t offset = sizeof(COMPILED_HEADER);
+	ReadArray(buffer, offset, header.textureCount, m_textures);
+	ReadArray(buffer, offset, header.materialCount, m_materials);
+	ReadArray(buffer, offset, header.lightCount, m_lights);
+	ReadArray(buffer, offset, header.objectCount, m_transforms);
+	ReadArray(buffer, offset, header.objectCount, m_textureIDs);
+	ReadArray(buffer, offset, header.objectCount, m_materialIDs);
+	ReadArray(buffer, offset, header.objectCount, m_draws);
+
+	if (IsCompiledValid() == false)
+	{
+		std::cout << "Ignoring invalid compiled scene " << GetCompiledPath(filename) << std::endl;
+		Clear();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsCompiledValid()
+ *
+ *  This method is used for checking the records read from a
+ *  compiled file before they are used.  Every tag and file
+ *  name must end within its record, every object must refer
+ *  to a texture and a material that exist, or to none, and
+ *  must be drawn with one of the meshes.
+ ***********************************************************/
+bool SceneFile::IsCompiledValid() const
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if ((memchr(m_textures[i].tag, '\0', MAX_TAG_LENGTH) == NULL) ||
+			(memchr(m_textures[i].filename, '\0', MAX_PATH_LENGTH) == NULL))
+		{
+			return(false);
+		}
+	}
+	for (size_t i = 0; i < m_materials.size(); i++)
+	{
+		if (memchr(m_materials[i].tag, '\0', MAX_TAG_LENGTH) == NULL)
+		{
+			return(false);
+		}
+	}
+
+	// the sphere is the last of the meshes
+	for (size_t i = 0; i < m_draws.size(); i++)
+	{
+		if ((m_textureIDs[i] < -1) || (m_textureIDs[i] >= (int32_t)m_textures.size()) ||
+			(m_materialIDs[i] < -1) || (m_materialIDs[i] >= (int32_t)m_materials.size()) ||
+			(m_draws[i].mesh < SceneGraph::MESH_PLANE) || (m_draws[i].mesh > SceneGraph::MESH_SPHERE))
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SaveCompiled()
+ *
+ *  This method is used for writing the loaded scene into the
+ *  compiled copy of the scene file.
+ ***********************************************************/
+bool SceneFile::SaveCompiled(const std::string& filename)
+{
+	COMPILED_HEADER header;
+	memset(&header, 0, sizeof(header));
+
+	if (GetSourceStamp(filename, header.sourceModifiedTime, header.sourceFileSize) == false)
+	{
+		return(false);
+	}
+
+	header.magic = g_CompiledMagic;
+	header.version = g_CompiledVersion;
+	header.textureCount = (uint32_t)m_textures.size();
+	header.materialCount = (uint32_t)m_materials.size();
+	header.lightCount = (uint32_t)m_lights.size();
+	header.objectCount = (uint32_t)m_transforms.size();
+
+	// build the whole file in memory so it is written in one call
+	std::vector<char> buffer((const char*)&header, (const char*)&header + sizeof(header));
+	AppendArray(buffer, m_textures);
+	AppendArray(buffer, m_materials);
+	AppendArray(buffer, m_lights);
+	AppendArray(buffer, m_transforms);
+	AppendArray(buffer, m_textureIDs);
+	AppendArray(buffer, m_materialIDs);
+	AppendArray(buffer, m_draws);
+
+	std::ofstream compiledFile(GetCompiledPath(filename).c_str(), std::ios::binary | std::ios::trunc);
+	if (!compiledFile)
+	{
+		return(false);
+	}
+	compiledFile.write(buffer.data(), buffer.size());
+
+	return(!compiledFile.fail());
+}
@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// load the textures, materials, lights and objects of a 3D scene from a text
+// scene file, compiled once into a binary file that loads with a single read
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  The text form of a scene file is written by hand, see
+ *  scenes/kitchen.scene for the syntax.  Loading it also
+ *  writes a compiled copy next to it, holding the same data
+ *  as fixed size records in one contiguous block, so later
+ *  launches copy the arrays straight out of the file with no
+ *  parsing.  The compiled file is keyed by the text file's
+ *  size and modification time, so editing the text file
+ *  recompiles it on the next load.
+ *
+ *  The objects are kept as parallel arrays, index i of each
+ *  object array describes the same object.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+
+	// longest tag and file name the compiled records can hold
+	static const int MAX_TAG_LENGTH = 32;
+	static const int MAX_PATH_LENGTH = 128;
+
+	enum LIGHT_TYPE
+	{
+		LIGHT_DIRECTIONAL = 0,
+		LIGHT_POINT,
+		LIGHT_SPOT
+	};
+
+	struct SCENE_TEXTURE
+	{
+		char tag[MAX_TAG_LENGTH];
+		char filename[MAX_PATH_LENGTH];
+	};
+
+	struct SCENE_MATERIAL
+	{
+		char tag[MAX_TAG_LENGTH];
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+		// anisotropic filtering of its textures, 0 for the default
+		int32_t anisotropy;
+	};
+
+	struct SCENE_LIGHT
+	{
+		int32_t type;
+		// direction of directional lights, position of point and spot
+		// lights
+		glm::vec3 vector;
+		glm::vec3 ambient;
+		glm::vec3 diffuse;
+		glm::vec3 specular;
+		// distance at which point lights fade out, 0 for lights that
+		// reach everything
+		float range;
+		// attenuation and cone of spot lights
+		float constant;
+		float linear;
+		float quadratic;
+		float cutOffDegrees;
+		float outerCutOffDegrees;
+		// where spot lights point, zero for spot lights without a place
+		// in the scene, which cast no shadows
+		glm::vec3 direction;
+	};
+
+	struct SCENE_TRANSFORM
+	{
+		glm::vec3 scaleXYZ;
+		glm::vec3 rotationDegrees;
+		glm::vec3 positionXYZ;
+	};
+
+	struct SCENE_DRAW
+	{
+		int32_t mesh;			// a SceneGraph::MESH_TYPE
+		int32_t drawFlags;		// SceneGraph::DRAW_FLAGS
+		int32_t bInstanced;
+		int32_t bDynamic;
+		glm::vec4 color;
+		glm::vec2 UVscale;
+	};
+
+	// load a scene file, from its compiled copy when up to date
+	bool Load(const std::string& filename);
+	// remove everything that was loaded
+	void Clear();
+
+	const std::vector<SCENE_TEXTURE>& GetTextures() const { return(m_textures); }
+	const std::vector<SCENE_MATERIAL>& GetMaterials() const { return(m_materials); }
+	const std::vector<SCENE_LIGHT>& GetLights() const { return(m_lights); }
+
+	int GetObjectCount() const { return((int)m_transforms.size()); }
+	const std::vector<SCENE_TRANSFORM>& GetTransforms() const { return(m_transforms); }
+	// indices into the texture and material arrays, -1 for none
+	const std::vector<int32_t>& GetTextureIDs() const { return(m_textureIDs); }
+	const std::vector<int32_t>& GetMaterialIDs() const { return(m_materialIDs); }
+	const std::vector<SCENE_DRAW>& GetDraws() const { return(m_draws); }
+
+private:
+	std::vector<SCENE_TEXTURE> m_textures;
+	std::vector<SCENE_MATERIAL> m_materials;
+	std::vector<SCENE_LIGHT> m_lights;
+	std::vector<SCENE_TRANSFORM> m_transforms;
+	std::vector<int32_t> m_textureIDs;
+	std::vector<int32_t> m_materialIDs;
+	std::vector<SCENE_DRAW> m_draws;
+
+	// parse the text form of a scene file
+	bool LoadText(const std::string& filename);
+	// read and write the compiled form of a scene file
+	bool LoadCompiled(const std::string& filename);
+	bool SaveCompiled(const std::string& filename);
+	// check the records read from a compiled file
+	bool IsCompiledValid() const;
+
+	// get the path of the compiled file for a scene file
+	static std::string GetCompiledPath(const std::string& filename);
+	// get the size and modification time that key the compiled file
+	static bool GetSourceStamp(const std::string& filename, int64_t& modifiedTime, int64_t& fileSize);
+};
@@ -0,0 +1,332 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.cpp
+// ============
+// retained list of the objects in a 3D scene with cached model matrices
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGraph.h"
+#include "BatchTransforms.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+
+namespace
+{
+	// dirty nodes updated by one job
+	const int g_TransformChunkSize = 256;
+	// dirty nodes whose values are gathered for one batch compose
+	const int g_ComposeBlockSize = 64;
+}
+
+/***********************************************************
+ *  SceneGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGraph::SceneGraph()
+{
+	m_transformVersion = 0;
+	m_staticVersion = 0;
+}
+
+/***********************************************************
+ *  ComposeModelMatrix()
+ *
+ *  This method is used for composing the model matrix from
+ *  the passed in transformation values.
+ ***********************************************************/
+glm::mat4 SceneGraph::ComposeModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 scale;
+	glm::mat4 rotationX;
+	glm::mat4 rotationY;
+	glm::mat4 rotationZ;
+	glm::mat4 translation;
+
+	// set the scale value in the transform buffer
+	scale = glm::scale(scaleXYZ);
+	// set the rotation values in the transform buffer
+	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
+	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
+	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+	// set the translation value in the transform buffer
+	translation = glm::translate(positionXYZ);
+
+	return(translation * rotationZ * rotationY * rotationX * scale);
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the object space box
+ *  around a basic shape mesh, using the ShapeMeshes sizes.
+ *  The torus box is kept loose since its thickness can vary.
+ ***********************************************************/
+void SceneGraph::GetMeshBounds(MESH_TYPE mesh, glm::vec3& boundsMin, glm::vec3& boundsMax)
+{
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		// 2x2 plane lying flat on the XZ axes
+		boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 0.0f, 1.0f);
+		break;
+	case MESH_BOX:
+	case MESH_PYRAMID4:
+		// unit sized and centered at the origin
+		boundsMin = glm::vec3(-0.5f, -0.5f, -0.5f);
+		boundsMax = glm::vec3(0.5f, 0.5f, 0.5f);
+		break;
+	case MESH_CYLINDER:
+	case MESH_TAPERED_CYLINDER:
+		// unit radius, standing 1 unit tall on the XZ axes
+		boundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+		break;
+	case MESH_TORUS:
+		boundsMin = glm::vec3(-1.5f, -1.5f, -1.5f);
+		boundsMax = glm::vec3(1.5f, 1.5f, 1.5f);
+		break;
+	case MESH_SPHERE:
+	default:
+		boundsMin = glm::vec3(-1.0f, -1.0f, -1.0f);
+		boundsMax = glm::vec3(1.0f, 1.0f, 1.0f);
+		break;
+	}
+}
+
+/***********************************************************
+ *  TransformBounds()
+ *
+ *  This method is used for getting the world space box that
+ *  holds an object space box after it is transformed.  The
+ *  absolute values of the matrix give how far the moved box
+ *  reaches along each world axis.
+ ***********************************************************/
+void SceneGraph::TransformBounds(
+	const glm::mat4& modelMatrix,
+	const glm::vec3& localMin,
+	const glm::vec3& localMax,
+	glm::vec3& boundsMin,
+	glm::vec3& boundsMax)
+{
+	glm::vec3 localCenter = 0.5f * (localMin + localMax);
+	glm::vec3 localExtent = 0.5f * (localMax - localMin);
+	glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(localCenter, 1.0f));
+	glm::vec3 extent;
+
+	for (int row = 0; row < 3; row++)
+	{
+		extent[row] =
+			glm::abs(modelMatrix[0][row]) * localExtent.x +
+			glm::abs(modelMatrix[1][row]) * localExtent.y +
+			glm::abs(modelMatrix[2][row]) * localExtent.z;
+	}
+
+	boundsMin = center - extent;
+	boundsMax = center + extent;
+}
+
+/***********************************************************
+ *  MakeNode()
+ *
+ *  This method is used for making a node with the passed in
+ *  transformation values, an untextured white color, no
+ *  material and a dirty model matrix.
+ ***********************************************************/
+SceneGraph::SCENE_NODE SceneGraph::MakeNode(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	SCENE_NODE node;
+
+	node.scaleXYZ = scaleXYZ;
+	node.XrotationDegrees = XrotationDegrees;
+	node.YrotationDegrees = YrotationDegrees;
+	node.ZrotationDegrees = ZrotationDegrees;
+	node.positionXYZ = positionXYZ;
+
+	node.mesh = MESH_BOX;
+	node.drawFlags = DRAW_ALL;
+	node.textureSlot = -1;
+	node.color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+	node.UVscale = glm::vec2(1.0f, 1.0f);
+	node.materialIndex = -1;
+	node.bInstanced = false;
+	node.bDynamic = false;
+
+	node.modelMatrix = glm::mat4(1.0f);
+	node.bDirty = true;
+	node.boundsMin = positionXYZ;
+	node.boundsMax = positionXYZ;
+
+	return(node);
+}
+
+/***********************************************************
+ *  AddNode()
+ *
+ *  This method is used for adding a node to the scene.  Its
+ *  model matrix is computed on the next UpdateTransforms().
+ ***********************************************************/
+int SceneGraph::AddNode(const SCENE_NODE& node)
+{
+	int index = (int)m_nodes.size();
+
+	m_nodes.push_back(node);
+	m_nodes[index].bDirty = true;
+	m_dirtyNodes.push_back(index);
+	if (node.bDynamic == false)
+	{
+		m_staticVersion++;
+	}
+
+	return(index);
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  This method is used for moving a node, which flags its
+ *  model matrix for recomputing.  A static node that moves
+ *  is no longer static, so the static version changes.
+ ***********************************************************/
+void SceneGraph::SetTransform(
+	int index,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	SCENE_NODE& node = m_nodes[index];
+
+	node.scaleXYZ = scaleXYZ;
+	node.XrotationDegrees = XrotationDegrees;
+	node.YrotationDegrees = YrotationDegrees;
+	node.ZrotationDegrees = ZrotationDegrees;
+	node.positionXYZ = positionXYZ;
+
+	if (node.bDynamic == false)
+	{
+		node.bDynamic = true;
+		m_staticVersion++;
+	}
+	if (node.bDirty == false)
+	{
+		node.bDirty = true;
+		m_dirtyNodes.push_back(index);
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the nodes.
+ ***********************************************************/
+void SceneGraph::Clear()
+{
+	m_nodes.clear();
+	m_dirtyNodes.clear();
+	m_updatedNodes.clear();
+	m_transformVersion++;
+	m_staticVersion++;
+}
+
+/***********************************************************
+ *  UpdateTransforms()
+ *
+ *  This method is used for recomputing the model matrices and
+ *  bounds of the nodes that were added or moved since the
+ *  last call.  The matrix of a node only depends on its own
+ *  values, so the dirty nodes can be split over threads.
+ *  Each job gathers the values of its nodes in blocks into
+ *  arrays per value and composes the matrices of a block in
+ *  one call to the batch transform kernels.  When nothing
+ *  has changed this does no work at all.
+ ***********************************************************/
+void SceneGraph::UpdateTransforms(JobSystem* pJobSystem)
+{
+	m_updatedNodes.clear();
+	if (m_dirtyNodes.empty())
+	{
+		return;
+	}
+
+	JobSystem::RANGE_FUNCTION updateRange = [this](int begin, int end, int)
+	{
+		float values[9][g_ComposeBlockSize];
+		glm::mat4 models[g_ComposeBlockSize];
+
+		BatchTransforms::TRANSFORM_ARRAYS transforms;
+		transforms.scaleX = values[0];
+		transforms.scaleY = values[1];
+		transforms.scaleZ = values[2];
+		transforms.rotationX = values[3];
+		transforms.rotationY = values[4];
+		transforms.rotationZ = values[5];
+		transforms.positionX = values[6];
+		transforms.positionY = values[7];
+		transforms.positionZ = values[8];
+
+		for (int blockBegin = begin; blockBegin < end; blockBegin += g_ComposeBlockSize)
+		{
+			int blockCount = std::min(g_ComposeBlockSize, end - blockBegin);
+
+			for (int i = 0; i < blockCount; i++)
+			{
+				const SCENE_NODE& node = m_nodes[m_dirtyNodes[blockBegin + i]];
+
+				values[0][i] = node.scaleXYZ.x;
+				values[1][i] = node.scaleXYZ.y;
+				values[2][i] = node.scaleXYZ.z;
+				values[3][i] = node.XrotationDegrees;
+				values[4][i] = node.YrotationDegrees;
+				values[5][i] = node.ZrotationDegrees;
+				values[6][i] = node.positionXYZ.x;
+				values[7][i] = node.positionXYZ.y;
+				values[8][i] = node.positionXYZ.z;
+			}
+
+			BatchTransforms::Compose(transforms, blockCount, models);
+
+			for (int i = 0; i < blockCount; i++)
+			{
+				SCENE_NODE& node = m_nodes[m_dirtyNodes[blockBegin + i]];
+
+				node.modelMatrix = models[i];
+				node.bDirty = false;
+
+				glm::vec3 localMin;
+				glm::vec3 localMax;
+				GetMeshBounds(node.mesh, localMin, localMax);
+				TransformBounds(node.modelMatrix, localMin, localMax, node.boundsMin, node.boundsMax);
+			}
+		}
+	};
+
+	int count = (int)m_dirtyNodes.size();
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(count, g_TransformChunkSize, updateRange);
+	}
+	else
+	{
+		updateRange(0, count, 0);
+	}
+
+	m_updatedNodes.swap(m_dirtyNodes);
+	m_dirtyNodes.clear();
+	m_transformVersion++;
+}
@@ -0,0 +1,149 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegraph.h
+// ============
+// retained list of the objects in a 3D scene with cached model matrices
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneGraph
+ *
+ *  This class holds every object of the 3D scene in a flat
+ *  array of nodes.  Each node keeps its transformation
+ *  values, what to draw it with, and its model matrix.  The
+ *  model matrix, and the world space box bounding the node,
+ *  are only recomputed after the transformation values
+ *  change, so static objects cost no matrix math.
+ ***********************************************************/
+class SceneGraph
+{
+public:
+	// constructor
+	SceneGraph();
+
+	// the basic shape meshes a node can be drawn with
+	enum MESH_TYPE
+	{
+		MESH_PLANE = 0,
+		MESH_BOX,
+		MESH_PYRAMID4,
+		MESH_CYLINDER,
+		MESH_TAPERED_CYLINDER,
+		MESH_TORUS,
+		MESH_SPHERE
+	};
+
+	// parts of the cylinder meshes to draw
+	enum DRAW_FLAGS
+	{
+		DRAW_TOP = 1,
+		DRAW_BOTTOM = 2,
+		DRAW_SIDES = 4,
+		DRAW_ALL = DRAW_TOP | DRAW_BOTTOM | DRAW_SIDES
+	};
+
+	struct SCENE_NODE
+	{
+		// transformation values
+		glm::vec3 scaleXYZ;
+		float XrotationDegrees;
+		float YrotationDegrees;
+		float ZrotationDegrees;
+		glm::vec3 positionXYZ;
+
+		// mesh and shader values used for drawing
+		MESH_TYPE mesh;
+		int drawFlags;
+		int textureSlot;		// -1 draws with the color instead
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		int materialIndex;		// -1 leaves the material unchanged
+		bool bInstanced;		// drawn in one batch with similar nodes
+		// expected to move, so it is drawn into the shadow maps every
+		// frame instead of into the cached static shadows
+		bool bDynamic;
+
+		// cached model matrix and whether it needs recomputing
+		glm::mat4 modelMatrix;
+		bool bDirty;
+		// world space box around the transformed mesh
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	// compose a model matrix from transformation values
+	static glm::mat4 ComposeModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// get the object space box around a mesh
+	static void GetMeshBounds(MESH_TYPE mesh, glm::vec3& boundsMin, glm::vec3& boundsMax);
+	// get the world space box around an object space box moved by
+	// the passed in model matrix
+	static void TransformBounds(
+		const glm::mat4& modelMatrix,
+		const glm::vec3& localMin,
+		const glm::vec3& localMax,
+		glm::vec3& boundsMin,
+		glm::vec3& boundsMax);
+
+	// make a node with the passed in transformation values and
+	// defaults for everything else
+	static SCENE_NODE MakeNode(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// add a node, returns its index
+	int AddNode(const SCENE_NODE& node);
+	// change the transformation values of a node, which makes it a
+	// dynamic node from then on
+	void SetTransform(
+		int index,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+	// remove all the nodes
+	void Clear();
+
+	// recompute the model matrices of the nodes that changed, split
+	// over the threads of the job system when one is passed in
+	void UpdateTransforms(JobSystem* pJobSystem = NULL);
+
+	int GetNodeCount() const { return((int)m_nodes.size()); }
+	const SCENE_NODE& GetNode(int index) const { return(m_nodes[index]); }
+	// changes every time a cached model matrix is recomputed, so
+	// data derived from the matrices knows when to be rebuilt
+	unsigned int GetTransformVersion() const { return(m_transformVersion); }
+	// nodes whose matrices the last UpdateTransforms() recomputed
+	const std::vector<int>& GetUpdatedNodes() const { return(m_updatedNodes); }
+	// whether any node moved since the last UpdateTransforms()
+	bool HasDirtyNodes() const { return(m_dirtyNodes.empty() == false); }
+	// changes every time a static node is added, removed or becomes
+	// dynamic, so depth cached from the static nodes knows when to be
+	// rendered again
+	unsigned int GetStaticVersion() const { return(m_staticVersion); }
+
+private:
+	std::vector<SCENE_NODE> m_nodes;
+	// indices of the nodes with a dirty model matrix
+	std::vector<int> m_dirtyNodes;
+	std::vector<int> m_updatedNodes;
+	unsigned int m_transformVersion;
+	unsigned int m_staticVersion;
+};
@@ -16,6 +16,11 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
 // declaration of global variables
 namespace
 {
@@ -23,7 +28,114 @@ namespace
 	const char* g_ColorValueName = "objectColor";
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
+	const char* g_TextureArrayValueName = "objectTextures";
 	const char* g_UseLightingName = "bUseLighting";
+	const char* g_UVscaleName = "UVscale";
+	const char* g_DiffuseColorName = "material.diffuseColor";
+	const char* g_SpecularColorName = "material.specularColor";
+	const char* g_ShininessName = "material.shininess";
+
+	// names of the light cluster samplers in the shader code
+	const char* g_ClusterLightsName = "clusterLights";
+	const char* g_ClusterListsName = "clusterLightLists";
+	// name of the shadow map sampler in the shader code
+	const char* g_ShadowMapsName = "shadowMaps";
+
+	// shader files of the instanced and transparent programs
+	const char* g_InstancedVertexShaderFile = "shaders/instancedVertexShader.glsl";
+	const char* g_InstancedFragmentShaderFile = "shaders/instancedFragmentShader.glsl";
+	const char* g_TransparentVertexShaderFile = "shaders/transparentVertexShader.glsl";
+	const char* g_TransparentFragmentShaderFile = "shaders/transparentFragmentShader.glsl";
+
+	// scene file describing the textures, materials, lights and objects
+	const char* g_SceneFileName = "scenes/kitchen.scene";
+
+	// distance between the objects of the generated benchmark scenes
+	const float g_BenchmarkSpacing = 1.5f;
+	// height and reach of the generated benchmark point lights
+	const float g_BenchmarkLightHeight = 1.5f;
+	const float g_BenchmarkLightRange = 4.0f;
+
+	// meshes the benchmark objects cycle through, all but the last
+	// are drawn instanced so the per node draws are timed too
+	const SceneGraph::MESH_TYPE g_BenchmarkMeshes[] =
+	{
+		SceneGraph::MESH_BOX,
+		SceneGraph::MESH_PYRAMID4,
+		SceneGraph::MESH_PLANE,
+		SceneGraph::MESH_SPHERE,
+		SceneGraph::MESH_CYLINDER,
+		SceneGraph::MESH_TAPERED_CYLINDER,
+		SceneGraph::MESH_TORUS
+	};
+	const int g_BenchmarkMeshCount = sizeof(g_BenchmarkMeshes) / sizeof(g_BenchmarkMeshes[0]);
+
+	/***********************************************************
+	 *  GetInstancedMeshKind()
+	 *
+	 *  Get the instanced mesh matching the mesh of a scene node,
+	 *  false is returned if it can not be drawn instanced.  The
+	 *  instanced cylinders always have all their parts.
+	 ***********************************************************/
+	bool GetInstancedMeshKind(const SceneGraph::SCENE_NODE& node, InstancedMeshes::MESH_KIND& meshKind)
+	{
+		switch (node.mesh)
+		{
+		case SceneGraph::MESH_PLANE:
+			meshKind = InstancedMeshes::MESH_PLANE;
+			return(true);
+		case SceneGraph::MESH_BOX:
+			meshKind = InstancedMeshes::MESH_BOX;
+			return(true);
+		case SceneGraph::MESH_PYRAMID4:
+			meshKind = InstancedMeshes::MESH_PYRAMID4;
+			return(true);
+		case SceneGraph::MESH_SPHERE:
+			meshKind = InstancedMeshes::MESH_SPHERE;
+			return(true);
+		case SceneGraph::MESH_CYLINDER:
+			meshKind = InstancedMeshes::MESH_CYLINDER;
+			return(node.drawFlags == SceneGraph::DRAW_ALL);
+		case SceneGraph::MESH_TAPERED_CYLINDER:
+			meshKind = InstancedMeshes::MESH_TAPERED_CYLINDER;
+			return(true);
+		case SceneGraph::MESH_TORUS:
+			meshKind = InstancedMeshes::MESH_TORUS;
+			return(true);
+		default:
+			return(false);
+		}
+	}
+
+	/***********************************************************
+	 *  GetScreenSize()
+	 *
+	 *  Get the share of half the screen height covered by the
+	 *  sphere around the bounds of a scene node, where the
+	 *  projection scale is 1 / tan(half the field of view).
+	 *  The size is unbounded when the camera is inside it.
+	 ***********************************************************/
+	float GetScreenSize(const SceneGraph::SCENE_NODE& node, const glm::vec3& viewPosition, float projectionScale)
+	{
+		glm::vec3 center = 0.5f * (node.boundsMin + node.boundsMax);
+		float radius = 0.5f * glm::length(node.boundsMax - node.boundsMin);
+		float distance = glm::length(center - viewPosition);
+
+		if (distance <= radius)
+		{
+			return(std::numeric_limits<float>::max());
+		}
+		return(radius * projectionScale / distance);
+	}
+
+	// scene nodes turned into draw items by one job
+	const int g_QueueChunkSize = 1024;
+
+	// texture units assumed when the GL limit can not be read
+	const int g_DefaultTextureUnits = 16;
+
+	// color drawn in place of a texture that is still streaming in
+	const glm::vec4 g_PlaceholderColor = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
 }
 
 /***********************************************************
@@ -35,6 +147,74 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 {
 	m_pShaderManager = pShaderManager;
 	m_basicMeshes = new ShapeMeshes();
+	// the next to last texture unit is kept free for binding the
+	// textures that do not have a unit of their own
+	GLint textureUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+	if (textureUnits <= 0)
+	{
+		textureUnits = g_DefaultTextureUnits;
+	}
+	// the very last unit is kept for the texture arrays, so a sampler2D
+	// and a sampler2DArray never read from the same unit, the two
+	// before it for the targets of the transparency pass, two more
+	// for the light cluster buffers, one for the shadow maps and one
+	// for the depth pyramid
+	m_boundTextureUnits = textureUnits - 8;
+	m_sharedUnitTexture = -1;
+	m_depthPyramidUnit = textureUnits - 7;
+	m_shadowUnit = textureUnits - 6;
+	m_lightClusterUnit = textureUnits - 5;
+	m_transparencyUnit = textureUnits - 3;
+	m_textureArrayUnit = textureUnits - 1;
+	m_boundTextureArray = -1;
+	m_textureVersion = 0;
+	m_pTextureArrays = NULL;
+	if (TextureArrays::IsSupported() == true)
+	{
+		m_pTextureArrays = new TextureArrays();
+	}
+	m_pTextureLoader = NULL;
+	m_uploadPBO = 0;
+	m_bUseTextureCache = TextureCache::IsSupported();
+	m_loadedShapeMeshes = 0;
+	m_pInstancedMeshes = NULL;
+	m_pInstancedPrograms = NULL;
+	for (int i = 0; i < ShaderPermutations::VARIANT_COUNT; i++)
+	{
+		m_pInstancedUniforms[i] = NULL;
+	}
+	m_instancedLightFeatures = ShaderPermutations::FEATURE_LIGHTING;
+	m_pInstanceCulling = NULL;
+	m_pDepthPyramid = NULL;
+	m_bOcclusionCulling = true;
+	m_pTransparentShader = NULL;
+	m_pTransparentUniforms = NULL;
+	m_pTransparencyPass = NULL;
+	m_pShaderWatcher = NULL;
+	m_pSceneGraph = new SceneGraph();
+	m_instanceBatchVersion = 0;
+	m_instanceBatchTextureVersion = 0;
+	m_bFrustumCulling = true;
+	m_pSceneBVH = new SceneBVH();
+	m_sceneBVHVersion = 0;
+	m_pJobSystem = new JobSystem();
+	m_pSceneFile = new SceneFile();
+	m_pUniforms = NULL;
+	m_pUniformBuffers = NULL;
+	m_bMainLightBlock = false;
+	m_pLightClusters = NULL;
+	m_lightBlock = UniformBuffers::LIGHT_BLOCK();
+	m_pShadowMaps = NULL;
+	m_pTextureResidency = new TextureResidency();
+	m_pTextureSamplers = new TextureSamplers();
+	m_unitSamplers.assign(textureUnits, 0);
+	m_bDepthPrepass = false;
+	m_pOverdrawCounters = NULL;
+	m_bRedrawNeeded = true;
+	m_pRenderQueue = new RenderQueue();
+	ResetRenderState();
+	m_pFrameProfiler = NULL;
 }
 
 /***********************************************************
@@ -47,6 +227,96 @@ SceneManager::~SceneManager()
 	m_pShaderManager = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_pSceneGraph;
+	m_pSceneGraph = NULL;
+	delete m_pSceneFile;
+	m_pSceneFile = NULL;
+	delete m_pUniforms;
+	m_pUniforms = NULL;
+	for (int i = 0; i < ShaderPermutations::VARIANT_COUNT; i++)
+	{
+		delete m_pInstancedUniforms[i];
+		m_pInstancedUniforms[i] = NULL;
+	}
+	delete m_pShaderWatcher;
+	m_pShaderWatcher = NULL;
+	delete m_pUniformBuffers;
+	m_pUniformBuffers = NULL;
+	if (NULL != m_pLightClusters)
+	{
+		delete m_pLightClusters;
+		m_pLightClusters = NULL;
+	}
+	if (NULL != m_pShadowMaps)
+	{
+		delete m_pShadowMaps;
+		m_pShadowMaps = NULL;
+	}
+	if (NULL != m_pOverdrawCounters)
+	{
+		delete m_pOverdrawCounters;
+		m_pOverdrawCounters = NULL;
+	}
+	delete m_pRenderQueue;
+	m_pRenderQueue = NULL;
+	delete m_pTextureArrays;
+	m_pTextureArrays = NULL;
+	delete m_pSceneBVH;
+	m_pSceneBVH = NULL;
+	delete m_pJobSystem;
+	m_pJobSystem = NULL;
+	if (NULL != m_pInstanceCulling)
+	{
+		delete m_pInstanceCulling;
+		m_pInstanceCulling = NULL;
+	}
+	if (NULL != m_pDepthPyramid)
+	{
+		delete m_pDepthPyramid;
+		m_pDepthPyramid = NULL;
+	}
+	if (NULL != m_pInstancedMeshes)
+	{
+		delete m_pInstancedMeshes;
+		m_pInstancedMeshes = NULL;
+	}
+	if (NULL != m_pInstancedPrograms)
+	{
+		delete m_pInstancedPrograms;
+		m_pInstancedPrograms = NULL;
+	}
+	if (NULL != m_pTransparencyPass)
+	{
+		delete m_pTransparencyPass;
+		m_pTransparencyPass = NULL;
+	}
+	if (NULL != m_pTransparentUniforms)
+	{
+		delete m_pTransparentUniforms;
+		m_pTransparentUniforms = NULL;
+	}
+	if (NULL != m_pTransparentShader)
+	{
+		delete m_pTransparentShader;
+		m_pTransparentShader = NULL;
+	}
+
+	// stop the decode workers before releasing the upload buffer
+	if (NULL != m_pTextureLoader)
+	{
+		delete m_pTextureLoader;
+		m_pTextureLoader = NULL;
+	}
+	DestroyGLTextures();
+	delete m_pTextureResidency;
+	m_pTextureResidency = NULL;
+	delete m_pTextureSamplers;
+	m_pTextureSamplers = NULL;
+	if (0 != m_uploadPBO)
+	{
+		glDeleteBuffers(1, &m_uploadPBO);
+		m_uploadPBO = 0;
+	}
 }
 
 /***********************************************************
@@ -57,1022 +327,2788 @@ SceneManager::~SceneManager()
  *  generating the mipmaps, and loading the read texture into
  *  the next available texture slot in memory.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
+	TextureLoader::DECODED_IMAGE image;
 
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
+	image.filename = filename;
+	image.tag = tag;
+	image.slot = ReserveTextureSlot(tag);
+	image.pixels = NULL;
+	if (image.slot < 0)
 	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		return false;
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	// a current compressed copy makes decoding the image unnecessary
+	if ((m_bUseTextureCache == false) ||
+		(TextureCache::Load(filename, image.compressed) == false))
+	{
+		// try to parse the image data from the specified image file
+		image.pixels = stbi_load(
+			filename,
+			&image.width,
+			&image.height,
+			&image.colorChannels,
+			0);
+	}
 
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
+	size_t uploadBytes = 0;
+	return(UploadGLTexture(image, uploadBytes));
+}
 
-		return true;
+/***********************************************************
+ *  QueueGLTexture()
+ *
+ *  This method is used for reserving a texture slot for the
+ *  passed in tag and handing the image file to the worker
+ *  threads for decoding.  The texture is uploaded later by
+ *  ProcessLoadedTextures() once the decode has finished.
+ ***********************************************************/
+bool SceneManager::QueueGLTexture(const char* filename, const std::string& tag)
+{
+	int slot = ReserveTextureSlot(tag);
+	if (slot < 0)
+	{
+		return false;
 	}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+	if (NULL == m_pTextureLoader)
+	{
+		m_pTextureLoader = new TextureLoader(0, m_bUseTextureCache);
+	}
+	m_pTextureLoader->QueueImage(filename, tag, slot);
 
-	// Error loading the image
-	return false;
+	return true;
 }
 
 /***********************************************************
- *  BindGLTextures()
+ *  ReserveTextureSlot()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for registering a tag as the next
+ *  texture handle before its image data is ready.  The tag
+ *  is interned here so later lookups are a single hash.
  ***********************************************************/
-void SceneManager::BindGLTextures()
+int SceneManager::ReserveTextureSlot(const std::string& tag)
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	if (m_textureHandles.find(tag) != m_textureHandles.end())
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		std::cout << "Texture tag is already loaded:" << tag << std::endl;
+		return(-1);
 	}
+
+	TEXTURE_INFO texture;
+	texture.ID = 0;
+	texture.tag = tag;
+	texture.bResident = false;
+	m_textureIDs.push_back(texture);
+
+	int textureSlot = (int)m_textureIDs.size() - 1;
+	m_textureHandles[tag] = textureSlot;
+
+	return(textureSlot);
 }
 
 /***********************************************************
- *  DestroyGLTextures()
+ *  GetTextureUnit()
  *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  This method is used for getting the texture unit that a
+ *  texture handle is sampled from.
  ***********************************************************/
-void SceneManager::DestroyGLTextures()
+int SceneManager::GetTextureUnit(int textureSlot) const
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	if (textureSlot < m_boundTextureUnits)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		return(textureSlot);
 	}
+	return(m_boundTextureUnits);
 }
 
 /***********************************************************
- *  FindTextureID()
+ *  BindTextureUnit()
  *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for making sure the texture of a
+ *  handle is bound to its unit before it is sampled.  Only
+ *  the textures sharing the last unit need binding here.
  ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
+int SceneManager::BindTextureUnit(int textureSlot)
 {
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
+	int textureUnit = GetTextureUnit(textureSlot);
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	if ((textureUnit != textureSlot) && (m_sharedUnitTexture != textureSlot))
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
+		glActiveTexture(GL_TEXTURE0 + textureUnit);
+		glBindTexture(GL_TEXTURE_2D, m_textureIDs[textureSlot].ID);
+		m_sharedUnitTexture = textureSlot;
 	}
 
-	return(textureID);
+	return(textureUnit);
 }
 
 /***********************************************************
- *  FindTextureSlot()
+ *  UploadGLTexture()
  *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
+ *  This method is used for configuring the texture mapping
+ *  parameters in OpenGL, streaming the decoded image through
+ *  a pixel buffer object, generating the mipmaps, and binding
+ *  the texture to its reserved slot.  The pixel data is freed.
+ *  Images read from the texture cache already hold all their
+ *  compressed mip levels and are uploaded directly.  The
+ *  bytes uploaded, compressed by the driver and read back
+ *  for the cache are added to uploadBytes.
  ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
+bool SceneManager::UploadGLTexture(TextureLoader::DECODED_IMAGE& image, size_t& uploadBytes)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
+	GLuint textureID = 0;
+	GLenum internalFormat = GL_RGB8;
+	GLenum pixelFormat = GL_RGB;
 
-	while ((index < m_loadedTextures) && (bFound == false))
+	// if the image was read from the compressed texture cache
+	if (image.compressed.levels.size() > 0)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		std::cout << "Successfully loaded cached texture:" << image.filename << ", width:" << image.compressed.levels[0].width << ", height:" << image.compressed.levels[0].height << ", levels:" << image.compressed.levels.size() << std::endl;
+
+		glGenTextures(1, &textureID);
+		glActiveTexture(GL_TEXTURE0 + GetTextureUnit(image.slot));
+		glBindTexture(GL_TEXTURE_2D, textureID);
+		if (image.slot >= m_boundTextureUnits)
 		{
-			textureSlot = index;
-			bFound = true;
+			m_sharedUnitTexture = image.slot;
 		}
-		else
-			index++;
+
+		// set the texture wrapping parameters
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		// set texture filtering parameters, the bound sampler overrides
+		// them while drawing
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		// the cached mip chain replaces glGenerateMipmap(), the whole
+		// chain goes into the texture array layer and only its tail
+		// into the texture, the rest is streamed in when it is seen
+		uploadBytes += TextureCache::GetChainBytes(image.compressed);
+		AddToTextureArray(image.slot, image.compressed);
+
+		// the residency manager keeps the chain to stream the levels
+		// from, and uploads the levels the texture starts with
+		m_pTextureResidency->AddTexture(image.slot, image.tag, textureID, image.compressed, false);
+		TextureLoader::FreeImage(image);
+
+		m_textureIDs[image.slot].ID = m_pTextureResidency->GetTexture(image.slot);
+		m_textureIDs[image.slot].bResident = true;
+
+		return true;
 	}
 
-	return(textureSlot);
-}
+	// if the image could not be read from the image file
+	if (NULL == image.pixels)
+	{
+		std::cout << "Could not load image:" << image.filename << std::endl;
+		return false;
+	}
 
-/***********************************************************
- *  FindMaterial()
- *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
- ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
-{
-	if (m_objectMaterials.size() == 0)
+	std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
+
+	// if the loaded image is in RGB format
+	if (image.colorChannels == 3)
 	{
-		return(false);
+		internalFormat = GL_RGB8;
+		pixelFormat = GL_RGB;
+	}
+	// if the loaded image is in RGBA format - it supports transparency
+	else if (image.colorChannels == 4)
+	{
+		internalFormat = GL_RGBA8;
+		pixelFormat = GL_RGBA;
+	}
+	else
+	{
+		std::cout << "Not implemented to handle image with " << image.colorChannels << " channels" << std::endl;
+		TextureLoader::FreeImage(image);
+		return false;
+	}
+
+	// let the driver block compress the image so it can be cached
+	if (m_bUseTextureCache == true)
+	{
+		internalFormat = TextureCache::GetCompressedFormat(image.colorChannels);
+	}
+
+	// copy the pixels into the upload buffer - orphaning the previous
+	// storage lets the driver keep transferring the last texture while
+	// this one is being written
+	GLsizeiptr imageSize = (GLsizeiptr)image.width * image.height * image.colorChannels;
+	if (0 == m_uploadPBO)
+	{
+		glGenBuffers(1, &m_uploadPBO);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_uploadPBO);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, imageSize, NULL, GL_STREAM_DRAW);
+	void* pBuffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, imageSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (NULL != pBuffer)
+	{
+		memcpy(pBuffer, image.pixels, imageSize);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+
+	// bind the new texture straight to its reserved unit so it does
+	// not need to be bound again before it is drawn with
+	glGenTextures(1, &textureID);
+	glActiveTexture(GL_TEXTURE0 + GetTextureUnit(image.slot));
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	if (image.slot >= m_boundTextureUnits)
+	{
+		m_sharedUnitTexture = image.slot;
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters, the bound sampler overrides
+	// them while drawing
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// rows of RGB images are not always 4 byte aligned
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (NULL != pBuffer)
+	{
+		// source the pixels from the bound upload buffer
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, pixelFormat, GL_UNSIGNED_BYTE, (void*)0);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+	else
+	{
+		// the buffer could not be mapped, so upload from client memory
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, pixelFormat, GL_UNSIGNED_BYTE, image.pixels);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	// the pixels, and the mipmaps the driver makes from them, all go
+	// through the compression
+	size_t imageBytes = (size_t)imageSize;
+	uploadBytes += imageBytes + imageBytes / 3;
+
+	// store the compressed mip chain so the next launch can skip all
+	// this, the residency manager streams the levels from it too.  A
+	// worker writes the file, the read back is done here
+	TextureCache::COMPRESSED_IMAGE chain;
+	bool bChain = (m_bUseTextureCache == true) && (TextureCache::ReadBack(chain) == true);
+	if (bChain == true)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		uploadBytes += TextureCache::GetChainBytes(chain);
+		if (NULL != m_pTextureLoader)
 		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			m_pTextureLoader->QueueCacheWrite(image.filename, chain);
 		}
 		else
 		{
-			index++;
+			TextureCache::Save(image.filename, chain);
 		}
 	}
 
-	return(true);
+	// free the image data from local memory
+	TextureLoader::FreeImage(image);
+	AddToTextureArray(image.slot, textureID);
+
+	// without a compressed chain the texture is kept whole, with its
+	// mipmaps adding a third
+	if (bChain == true)
+	{
+		m_pTextureResidency->AddTexture(image.slot, image.tag, textureID, chain, true);
+	}
+	else
+	{
+		m_pTextureResidency->AddFixedTexture(image.slot, image.tag, textureID, imageBytes + imageBytes / 3);
+	}
+
+	// register the loaded texture against its reserved slot
+	m_textureIDs[image.slot].ID = m_pTextureResidency->GetTexture(image.slot);
+	m_textureIDs[image.slot].bResident = true;
+
+	return true;
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  AddToTextureArray()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for packing a copy of a just uploaded
+ *  texture, still bound to GL_TEXTURE_2D, into the texture
+ *  array of its size and format.  The instance batches are
+ *  rebuilt so they pick up the new layer.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
+void SceneManager::AddToTextureArray(int textureSlot, GLuint textureID)
 {
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+	if (NULL != m_pTextureArrays)
+	{
+		m_pTextureArrays->AddTexture(textureSlot, textureID);
+		// a full array is reallocated when it grows
+		m_boundTextureArray = -1;
+		m_pTextureResidency->SetArrayBytes(m_pTextureArrays->GetAllocatedBytes());
+	}
+	m_textureVersion++;
+}
 
-	if (NULL != m_pShaderManager)
+/***********************************************************
+ *  AddToTextureArray()
+ *
+ *  This method is used for uploading a cached compressed mip
+ *  chain into the texture array of its size and format, so
+ *  the texture of the slot only needs its tail levels.  The
+ *  instance batches are rebuilt so they pick up the new layer.
+ ***********************************************************/
+void SceneManager::AddToTextureArray(int textureSlot, const TextureCache::COMPRESSED_IMAGE& chain)
+{
+	if (NULL != m_pTextureArrays)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_pTextureArrays->AddChain(textureSlot, chain);
+		// a full array is reallocated when it grows
+		m_boundTextureArray = -1;
+		m_pTextureResidency->SetArrayBytes(m_pTextureArrays->GetAllocatedBytes());
 	}
+	m_textureVersion++;
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  ProcessLoadedTextures()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for uploading the images that the
+ *  worker threads have finished decoding.  A few megabytes
+ *  are uploaded per call so that streaming the textures in
+ *  does not cause a visible hitch in the frame rate.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
+void SceneManager::ProcessLoadedTextures()
 {
-	// variables for this method
-	glm::vec4 currentColor;
+	const size_t maxUploadBytes = 16 * 1024 * 1024;
+	size_t uploadedBytes = 0;
 
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
+	if (NULL == m_pTextureLoader)
+	{
+		return;
+	}
+
+	TextureLoader::DECODED_IMAGE image;
+	while ((uploadedBytes < maxUploadBytes) &&
+		   (m_pTextureLoader->PopDecodedImage(image) == true))
+	{
+		// the upload counts the chains of images read from the cache,
+		// and the compression and read back of the ones that were not
+		UploadGLTexture(image, uploadedBytes);
+		m_bRedrawNeeded = true;
+	}
 
-	if (NULL != m_pShaderManager)
+	// every queued texture is resident and its cache file written, so
+	// the workers can be released
+	if (m_pTextureLoader->GetPendingCount() == 0)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_bRedrawNeeded = true;
+		delete m_pTextureLoader;
+		m_pTextureLoader = NULL;
 	}
 }
 
 /***********************************************************
- *  SetShaderTexture()
+ *  IsTextureResident()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for checking whether the texture with
+ *  the passed in tag has been uploaded and can be sampled.
  ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
+bool SceneManager::IsTextureResident(const std::string& tag)
 {
-	if (NULL != m_pShaderManager)
+	int textureSlot = FindTextureSlot(tag);
+
+	if (textureSlot < 0)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
+		return(false);
+	}
+
+	return(m_textureIDs[textureSlot].bResident);
+}
+
+/***********************************************************
+ *  AreTexturesLoaded()
+ *
+ *  This method is used for checking whether all the queued
+ *  textures have finished streaming in.
+ ***********************************************************/
+bool SceneManager::AreTexturesLoaded()
+{
+	return(NULL == m_pTextureLoader);
+}
 
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+/***********************************************************
+ *  BindGLTextures()
+ *
+ *  This method is used for binding the loaded textures to
+ *  OpenGL texture memory slots.  Textures past the number of
+ *  texture units are bound when they are used instead.
+ ***********************************************************/
+void SceneManager::BindGLTextures()
+{
+	for (int i = 0; (i < (int)m_textureIDs.size()) && (i < m_boundTextureUnits); i++)
+	{
+		// bind textures on corresponding texture units
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
 	}
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  DestroyGLTextures()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for freeing the memory in all the
+ *  used texture memory slots.  The residency manager owns
+ *  the textures, so it deletes them; the slots stay reserved
+ *  and draw with the placeholder color.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::DestroyGLTextures()
 {
-	if (NULL != m_pShaderManager)
+	m_pTextureResidency->Clear();
+	for (int i = 0; i < (int)m_textureIDs.size(); i++)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_textureIDs[i].ID = 0;
+		m_textureIDs[i].bResident = false;
 	}
+	m_sharedUnitTexture = -1;
 }
 
 /***********************************************************
- *  SetShaderMaterial()
+ *  UpdateTextureResidency()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for moving the textures to the levels
+ *  the last frame asked for.  The replaced textures are
+ *  uploaded through the shared unit, and bound to their own
+ *  units afterwards.
  ***********************************************************/
-void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+void SceneManager::UpdateTextureResidency()
 {
-	if (m_objectMaterials.size() > 0)
+	glActiveTexture(GL_TEXTURE0 + m_boundTextureUnits);
+	m_pTextureResidency->Update();
+
+	const std::vector<int>& changedSlots = m_pTextureResidency->GetChangedSlots();
+	if (changedSlots.empty() == true)
 	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
+		return;
+	}
+
+	// the new levels are sampled by the next frame, which may ask for
+	// other levels again
+	m_bRedrawNeeded = true;
+	m_sharedUnitTexture = -1;
+	for (size_t i = 0; i < changedSlots.size(); i++)
+	{
+		int textureSlot = changedSlots[i];
 
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
+		m_textureIDs[textureSlot].ID = m_pTextureResidency->GetTexture(textureSlot);
+		if (textureSlot < m_boundTextureUnits)
 		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
+			glActiveTexture(GL_TEXTURE0 + textureSlot);
+			glBindTexture(GL_TEXTURE_2D, m_textureIDs[textureSlot].ID);
 		}
 	}
 }
 
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
-void SceneManager::LoadSceneTextures()
+/***********************************************************
+ *  RequestTextureLevels()
+ *
+ *  This method is used for asking the residency manager for
+ *  the level each visible texture is seen at, from the size
+ *  of a node on the screen and how often the texture repeats
+ *  across it.  Instanced nodes whose texture was packed into
+ *  an array sample the array instead, so they ask for none.
+ ***********************************************************/
+void SceneManager::RequestTextureLevels(const glm::vec3& viewPosition, float projectionScale)
 {
-	/*** STUDENTS - add the code BELOW for loading the textures that ***/
-	/*** will be used for mapping to objects in the 3D scene. Up to  ***/
-	/*** 16 textures can be loaded per scene. Refer to the code in   ***/
-	/*** the OpenGL Sample for help.                                 ***/
-
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
 
-	// Loads six square BaseColor maps from ambientCG.
-	// Files are referenced relative to the exe's working directory (e.g., ...\Debug\textures\).
+	for (int i = 0; i < m_pSceneGraph->GetNodeCount(); i++)
+	{
+		const SceneGraph::SCENE_NODE& node = m_pSceneGraph->GetNode(i);
+		InstancedMeshes::MESH_KIND meshKind;
 
-	bool bReturn = false;
+		if ((node.textureSlot < 0) || (m_visibleNodes[i] == 0))
+		{
+			continue;
+		}
+		if ((node.bInstanced == true) && (GetInstancedMeshKind(node, meshKind) == true) &&
+			(NULL != m_pTextureArrays) && (m_pTextureArrays->GetArray(node.textureSlot) >= 0))
+		{
+			continue;
+		}
 
-	bReturn = CreateGLTexture(
-		"textures/Onyx011_2K-JPG_Color.jpg", "onyx"
-	);
+		// the screen size covers half the view height per unit
+		float screenSize = std::min(GetScreenSize(node, viewPosition, projectionScale), 2.0f);
+		float repeat = std::max(std::max(node.UVscale.x, node.UVscale.y), 1.0f);
+		m_pTextureResidency->Request(node.textureSlot, screenSize * (float)viewport[3] / repeat);
+	}
+}
 
-	bReturn = CreateGLTexture(
-		"textures/Ice002_2K-JPG_Color.jpg", "ice"
-	);
-
-	bReturn = CreateGLTexture(
-		"textures/Wood066_2K-JPG_Color.jpg", "wood"
-	);
-
-	bReturn = CreateGLTexture(
-		"textures/Ground035_4K-JPG_Color.jpg", "ground"
-	);
-
-	bReturn = CreateGLTexture(
-		"textures/Concrete044D_2K-JPG_Color.jpg", "concrete"
-	);
-
-	bReturn = CreateGLTexture(
-		"textures/Metal049A_2K-JPG_Color.jpg", "metal"
-	);
-
-	bReturn = CreateGLTexture(
-		"textures/Wood032_2K-JPG_Color.jpg", "wood2"
-	);
-
-	bReturn = CreateGLTexture(
-		"textures/meat_color_2k.jpg", "meat"
-	);
-
-
-
-	// after the texture image data is loaded into memory, the
-	// loaded textures need to be bound to texture slots - there
-	// are a total of 16 available slots for scene textures
-	BindGLTextures();
-}
+/***********************************************************
+ *  SetAnisotropy()
+ *
+ *  This method is used for setting the anisotropic filtering
+ *  of the textures whose material does not pick its own.
+ ***********************************************************/
+void SceneManager::SetAnisotropy(int anisotropy)
+{
+	m_pTextureSamplers->SetDefaultAnisotropy(anisotropy);
+	m_bRedrawNeeded = true;
+}
 
 /***********************************************************
- *  DefineObjectMaterials()
+ *  SetTextureBudget()
  *
- *  This method is used for configuring the various material
- *  settings for all of the objects within the 3D scene.
+ *  This method is used for setting the video memory the
+ *  single textures may use, in megabytes.
  ***********************************************************/
-void SceneManager::DefineObjectMaterials()
+void SceneManager::SetTextureBudget(int megabytes)
 {
-	/*** STUDENTS - add the code BELOW for defining object materials. ***/
-	/*** There is no limit to the number of object materials that can ***/
-	/*** be defined. Refer to the code in the OpenGL Sample for help  ***/
-
-	OBJECT_MATERIAL goldMaterial;
-	goldMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.2f);
-	goldMaterial.specularColor = glm::vec3(0.6f, 0.5f, 0.4f);
-	goldMaterial.shininess = 22.0;
-	goldMaterial.tag = "gold";
-	m_objectMaterials.push_back(goldMaterial);
-
-	OBJECT_MATERIAL cementMaterial;
-	cementMaterial.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-	cementMaterial.specularColor = glm::vec3(0.4f, 0.4f, 0.4f);
-	cementMaterial.shininess = 0.5;
-	cementMaterial.tag = "cement";
-	m_objectMaterials.push_back(cementMaterial);
-
-	OBJECT_MATERIAL woodMaterial;
-	woodMaterial.diffuseColor = glm::vec3(0.3f, 0.2f, 0.1f);
-	woodMaterial.specularColor = glm::vec3(0.1f, 0.1f, 0.1f);
-	woodMaterial.shininess = 0.3;
-	woodMaterial.tag = "wood";
-	m_objectMaterials.push_back(woodMaterial);
-
-	OBJECT_MATERIAL tileMaterial;
-	tileMaterial.diffuseColor = glm::vec3(0.3f, 0.2f, 0.1f);
-	tileMaterial.specularColor = glm::vec3(0.4f, 0.5f, 0.6f);
-	tileMaterial.shininess = 25.0;
-	tileMaterial.tag = "tile";
-	m_objectMaterials.push_back(tileMaterial);
-
-	OBJECT_MATERIAL glassMaterial;
-	glassMaterial.diffuseColor = glm::vec3(0.3f, 0.3f, 0.3f);
-	glassMaterial.specularColor = glm::vec3(0.6f, 0.6f, 0.6f);
-	glassMaterial.shininess = 85.0;
-	glassMaterial.tag = "glass";
-	m_objectMaterials.push_back(glassMaterial);
-
-	OBJECT_MATERIAL clayMaterial;
-	clayMaterial.diffuseColor = glm::vec3(0.4f, 0.4f, 0.5f);
-	clayMaterial.specularColor = glm::vec3(0.2f, 0.2f, 0.4f);
-	clayMaterial.shininess = 0.5;
-	clayMaterial.tag = "clay";
-	m_objectMaterials.push_back(clayMaterial);
-
-	OBJECT_MATERIAL plasticClear;
-	plasticClear.diffuseColor = glm::vec3(0.95f, 0.95f, 0.95f);  // tint
-	plasticClear.specularColor = glm::vec3(0.75f, 0.75f, 0.75f);  // glossy
-	plasticClear.shininess = 96.0f;
-	plasticClear.tag = "plasticClear";
-	m_objectMaterials.push_back(plasticClear);
+	m_pTextureResidency->SetBudget((size_t)megabytes * 1024 * 1024);
+	m_bRedrawNeeded = true;
 }
 
 /***********************************************************
- *  SetupSceneLights()
+ *  PrintTextureResidency()
  *
- *  This method is called to add and configure the light
- *  sources for the 3D scene.  There are up to 4 light sources.
+ *  This method is used for printing how much video memory
+ *  each texture uses.
  ***********************************************************/
-void SceneManager::SetupSceneLights()
+void SceneManager::PrintTextureResidency() const
 {
-	// this line of code is NEEDED for telling the shaders to render 
-	// the 3D scene with custom lighting, if no light sources have
-	// been added then the display window will be black - to use the 
-	// default OpenGL lighting then comment out the following line
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
-
-	/*** STUDENTS - add the code BELOW for setting up light sources ***/
-	/*** Up to four light sources can be defined. Refer to the code ***/
-	/*** in the OpenGL Sample for help                              ***/
-
-	// directional light to emulate sunlight coming into scene
-	m_pShaderManager->setVec3Value("directionalLight.direction", -0.05f, -0.3f, -0.1f);
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.6f, 0.6f, 0.6f);
-	m_pShaderManager->setVec3Value("directionalLight.specular", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
-
-	// point light 1
-	m_pShaderManager->setVec3Value("pointLights[0].position", -4.0f, 8.0f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
-	// point light 2
-	m_pShaderManager->setVec3Value("pointLights[1].position", 4.0f, 8.0f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("pointLights[1].specular", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
-	// point light 3 - warm orange
-	m_pShaderManager->setVec3Value("pointLights[2].position", 3.8f, 5.5f, 4.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].ambient", 0.06f, 0.03f, 0.00f);
-	m_pShaderManager->setVec3Value("pointLights[2].diffuse", 0.95f, 0.50f, 0.15f);
-	m_pShaderManager->setVec3Value("pointLights[2].specular", 1.0f, 0.9f, 0.8f);
-	m_pShaderManager->setBoolValue("pointLights[2].bActive", true);
-	// point light 4
-	m_pShaderManager->setVec3Value("pointLights[3].position", 3.8f, 3.5f, 4.0f);
-	m_pShaderManager->setVec3Value("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[3].diffuse", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setVec3Value("pointLights[3].specular", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setBoolValue("pointLights[3].bActive", true);
-	// point light 4
-	m_pShaderManager->setVec3Value("pointLights[4].position", -3.2f, 6.0f, -4.0f);
-	m_pShaderManager->setVec3Value("pointLights[4].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[4].diffuse", 0.9f, 0.9f, 0.9f);
-	m_pShaderManager->setVec3Value("pointLights[4].specular", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setBoolValue("pointLights[4].bActive", true);
-
-	m_pShaderManager->setVec3Value("spotLight.ambient", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setVec3Value("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-	m_pShaderManager->setVec3Value("spotLight.specular", 0.7f, 0.7f, 0.7f);
-	m_pShaderManager->setFloatValue("spotLight.constant", 1.0f);
-	m_pShaderManager->setFloatValue("spotLight.linear", 0.09f);
-	m_pShaderManager->setFloatValue("spotLight.quadratic", 0.032f);
-	m_pShaderManager->setFloatValue("spotLight.cutOff", glm::cos(glm::radians(42.5f)));
-	m_pShaderManager->setFloatValue("spotLight.outerCutOff", glm::cos(glm::radians(48.0f)));
-	m_pShaderManager->setBoolValue("spotLight.bActive", true);
+	m_pTextureResidency->PrintReport();
 }
 
-
 /***********************************************************
- *  PrepareScene()
+ *  FindTextureID()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for getting an ID for the previously
+ *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-void SceneManager::PrepareScene()
+int SceneManager::FindTextureID(const std::string& tag)
 {
+	int textureSlot = FindTextureSlot(tag);
 
-	// define the materials for objects in the scene
-	DefineObjectMaterials();
-	// add and define the light sources for the scene
-	SetupSceneLights();
-
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
-	LoadSceneTextures();
-
-	m_basicMeshes->LoadPlaneMesh();        // countertop
-	m_basicMeshes->LoadBoxMesh();          // cutting board
-	m_basicMeshes->LoadPyramid4Mesh();
-	m_basicMeshes->LoadCylinderMesh();     // cup body, marinade fill
-	m_basicMeshes->LoadTaperedCylinderMesh(); // knife handle, meat chunk
-	m_basicMeshes->LoadTorusMesh();        // lid
-	m_basicMeshes->LoadSphereMesh();       // pork pieces
+	if (textureSlot < 0)
+	{
+		return(-1);
+	}
 
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	return(m_textureIDs[textureSlot].ID);
 }
 
 /***********************************************************
- *  RenderScene()
+ *  FindTextureSlot()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
  ***********************************************************/
-void SceneManager::RenderScene()
+int SceneManager::FindTextureSlot(const std::string& tag)
 {
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh (counter top)
-	scaleXYZ = glm::vec3(24.0f, 1.0f, 14.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	std::unordered_map<std::string, int>::const_iterator found = m_textureHandles.find(tag);
 
-	//SetShaderColor(1, 1, 1, 1);
-
-	SetShaderTexture("onyx");
-	SetTextureUVScale(3.0, 2.0);
-	SetShaderMaterial("tile");
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-	/****************************************************************/
+	if (found == m_textureHandles.end())
+	{
+		return(-1);
+	}
 
-	// set the XYZ scale for the mesh (cutting board)
-	scaleXYZ = glm::vec3(8.6f, 0.25f, 5.0f);
+	return(found->second);
+}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
+{
+	int index = FindMaterialIndex(tag);
 
-	// set the XYZ position for the mesh (sit on plane: posY = height/2)
-	positionXYZ = glm::vec3(-0.5f, 0.125f, 0.8f);
+	if (index < 0)
+	{
+		return(false);
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	material = m_objectMaterials[index];
+	return(true);
+}
 
-	// set the color values into the shader
-	//SetShaderColor(0.22f, 0.22f, 0.22f, 1.0f);
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a defined
+ *  material, which is its position in the material array of
+ *  the instanced shader.  -1 is returned if it is not found.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const std::string& tag)
+{
+	std::unordered_map<std::string, int>::const_iterator found = m_materialHandles.find(tag);
 
-	SetShaderTexture("wood");
-	SetTextureUVScale(1.6, 1.0);
-	SetShaderMaterial("wood");
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawBoxMesh();
-	/****************************************************************/
+	if (found == m_materialHandles.end())
+	{
+		return(-1);
+	}
 
-	// set the XYZ scale for the mesh (knife blade)
-	scaleXYZ = glm::vec3(0.05f, 5.00f, 0.35f);
+	return(found->second);
+}
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = -10.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+/***********************************************************
+ *  AddObjectMaterial()
+ *
+ *  This method is used for adding a material to the defined
+ *  materials and interning its tag as a material handle.
+ ***********************************************************/
+void SceneManager::AddObjectMaterial(const OBJECT_MATERIAL& material)
+{
+	if (m_materialHandles.find(material.tag) != m_materialHandles.end())
+	{
+		std::cout << "Material tag is already defined:" << material.tag << std::endl;
+		return;
+	}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(1.6f, 0.33f, 1.1f);
+	m_materialHandles[material.tag] = (int)m_objectMaterials.size();
+	m_objectMaterials.push_back(material);
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	glm::mat4 modelView = SceneGraph::ComposeModelMatrix(
 		scaleXYZ,
 		XrotationDegrees,
 		YrotationDegrees,
 		ZrotationDegrees,
 		positionXYZ);
 
-	// set the color values into the shader
-	//SetShaderColor(0.20f, 0.55f, 0.90f, 1.0f);
-	SetShaderTexture("metal");
-	SetTextureUVScale(2.0, 1.0);
-	SetShaderMaterial("tile");
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+	glUniformMatrix4fv(m_renderState.pLocations->model, 1, GL_FALSE, &modelView[0][0]);
+}
 
+/***********************************************************
+ *  SetShaderColor()
+ *
+ *  This method is used for setting the passed in color
+ *  into the shader for the next draw command
+ ***********************************************************/
+void SceneManager::SetShaderColor(
+	float redColorValue,
+	float greenColorValue,
+	float blueColorValue,
+	float alphaValue)
+{
+	// variables for this method
+	glm::vec4 currentColor;
 
-	// set the XYZ scale for the mesh (knife handle)
-	scaleXYZ = glm::vec3(0.20f, 1.10f, 0.20f);
+	currentColor.r = redColorValue;
+	currentColor.g = greenColorValue;
+	currentColor.b = blueColorValue;
+	currentColor.a = alphaValue;
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = -10.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 90.0f;
+	glUniform1i(m_renderState.pLocations->bUseTexture, false);
+	glUniform4fv(m_renderState.pLocations->objectColor, 1, &currentColor[0]);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.15f, 0.30f, 1.65f);
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data
+ *  associated with the passed in ID into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	const std::string& textureTag)
+{
+	SetShaderTexture(FindTextureSlot(textureTag));
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data of the
+ *  passed in texture handle into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureSlot)
+{
+	int textureID = textureSlot;
 
-	// set the color values into the shader
-	//SetShaderColor(0.22f, 0.22f, 0.22f, 1.0f);
+	// until the texture has streamed in, draw with a flat color
+	if ((textureID < 0) || (m_textureIDs[textureID].bResident == false))
+	{
+		glUniform1i(m_renderState.pLocations->bUseTexture, false);
+		glUniform4fv(m_renderState.pLocations->objectColor, 1, &g_PlaceholderColor[0]);
+		return;
+	}
 
-	SetShaderTexture("wood2");
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderMaterial("wood");
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawTaperedCylinderMesh();
-	/****************************************************************/
+	glUniform1i(m_renderState.pLocations->bUseTexture, true);
+	glUniform1i(m_renderState.pLocations->objectTexture, BindTextureUnit(textureID));
+}
 
-	// Meat pyramid A
-	scaleXYZ = glm::vec3(1.60f, 1.10f, 1.20f);
-	XrotationDegrees = -6.0f;
-	YrotationDegrees = 18.0f;
-	ZrotationDegrees = 4.0f;
+/***********************************************************
+ *  SetTextureUVScale()
+ *
+ *  This method is used for setting the texture UV scale
+ *  values into the shader.
+ ***********************************************************/
+void SceneManager::SetTextureUVScale(float u, float v)
+{
+	glUniform2f(m_renderState.pLocations->UVscale, u, v);
+}
 
-	positionXYZ = glm::vec3(-2.25f, 2.00f, 0.60f);
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the material values
+ *  into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	const std::string& materialTag)
+{
+	SetShaderMaterial(FindMaterialIndex(materialTag));
+}
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the values of the defined
+ *  material with the passed in handle into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	int materialIndex)
+{
+	if ((materialIndex >= 0) &&
+		(materialIndex < (int)m_objectMaterials.size()))
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[materialIndex];
+		glUniform3fv(m_renderState.pLocations->diffuseColor, 1, &material.diffuseColor[0]);
+		glUniform3fv(m_renderState.pLocations->specularColor, 1, &material.specularColor[0]);
+		glUniform1f(m_renderState.pLocations->shininess, material.shininess);
+	}
+}
 
-	
-	SetShaderTexture("meat");          
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
+/***********************************************************
+ *  DrawInstancedMeshes()
+ *
+ *  This method is used for drawing every passed in instance
+ *  of a mesh with the instanced shader program, in a single
+ *  draw call.  All the instances share one texture.
+ ***********************************************************/
+void SceneManager::DrawInstancedMeshes(
+	InstancedMeshes::MESH_KIND meshKind,
+	int textureSlot,
+	const std::vector<InstancedMeshes::INSTANCE_DATA>& instances,
+	int lod)
+{
+	if ((NULL == m_pInstancedPrograms) || (NULL == m_pInstancedMeshes) || (instances.size() == 0))
+	{
+		return;
+	}
 
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+	// the camera, lights and materials come from the uniform blocks
+	if (UseInstancedProgram(textureSlot, -1) == false)
+	{
+		return;
+	}
 
-	// Meat pyramid B (slightly different, overlaps A)
-	scaleXYZ = glm::vec3(1.20f, 0.90f, 1.00f);
-	XrotationDegrees = 8.0f;
-	YrotationDegrees = -22.0f;
-	ZrotationDegrees = -10.0f;
+	m_pInstancedMeshes->DrawInstanced(meshKind, instances, lod);
+	m_pRenderQueue->CountDrawCall();
+}
 
-	positionXYZ = glm::vec3(-1.95f, 1.45f, 1.25f);
+/***********************************************************
+ *  DrawInstancedMeshes()
+ *
+ *  This method is used for drawing the visible instances of
+ *  a batch, with a draw call for each level of detail they
+ *  use.  A batch packed into a texture array binds the array
+ *  once, and every instance samples the layer of its own
+ *  texture.
+ ***********************************************************/
+void SceneManager::DrawInstancedMeshes(const INSTANCE_BATCH& batch)
+{
+	if (batch.textureArray < 0)
+	{
+		for (int lod = 0; lod < InstancedMeshes::LOD_COUNT; lod++)
+		{
+			DrawInstancedMeshes(batch.meshKind, batch.textureSlot, batch.visibleInstances[lod], lod);
+		}
+		return;
+	}
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	if ((NULL == m_pInstancedPrograms) || (NULL == m_pInstancedMeshes) || (batch.visibleCount == 0))
+	{
+		return;
+	}
 
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
+	if (UseInstancedProgram(-1, batch.textureArray) == false)
+	{
+		return;
+	}
 
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+	for (int lod = 0; lod < InstancedMeshes::LOD_COUNT; lod++)
+	{
+		if (batch.visibleInstances[lod].empty() == false)
+		{
+			m_pInstancedMeshes->DrawInstanced(batch.meshKind, batch.visibleInstances[lod], lod);
+			m_pRenderQueue->CountDrawCall();
+		}
+	}
+}
 
-	// Meat pyramid C  BIG middle piece
-	scaleXYZ = glm::vec3(2.75f, 2.75f,2.75f);
-	XrotationDegrees = -4.0f;
-	YrotationDegrees = 10.0f;
-	ZrotationDegrees = 2.0f;
+/***********************************************************
+ *  DrawIndirectGroup()
+ *
+ *  This method is used for drawing the batches of a group
+ *  with one multi draw.  The instance counts of the draw
+ *  commands were written by the culling compute shader, so
+ *  nothing about the instances is known on the CPU.
+ ***********************************************************/
+void SceneManager::DrawIndirectGroup(const INDIRECT_GROUP& group)
+{
+	if ((NULL == m_pInstancedPrograms) || (NULL == m_pInstancedMeshes) || (NULL == m_pInstanceCulling))
+	{
+		return;
+	}
 
-	positionXYZ = glm::vec3(-2.30f, 1.45f, 0.70f);
+	if (UseInstancedProgram(group.textureSlot, group.textureArray) == false)
+	{
+		return;
+	}
 
-	SetTransformations(
-		scaleXYZ, 
-		XrotationDegrees,
-		YrotationDegrees, 
-		ZrotationDegrees, 
-		positionXYZ
-	);
-
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
-
-	// Meat pyramid D
-	scaleXYZ = glm::vec3(2.10f, 0.85f, 1.95f);
-	XrotationDegrees = 6.0f;
-	YrotationDegrees = 28.0f;
-	ZrotationDegrees = -8.0f;
-
-	positionXYZ = glm::vec3(-2.95f, 0.60f, 0.35f);
-
-	SetTransformations(
-		scaleXYZ, 
-		XrotationDegrees,
-		YrotationDegrees, 
-		ZrotationDegrees,
-		positionXYZ
-	);
-
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
-
-	// Meat pyramid E
-	scaleXYZ = glm::vec3(1.95f, 0.75f, 1.90f);
-	XrotationDegrees = -38.0f;
-	YrotationDegrees = -48.0f;
-	ZrotationDegrees = 12.0f;
-
-	positionXYZ = glm::vec3(-1.70f, 1.10f, 0.35f);
-
-	SetTransformations(
-		scaleXYZ, 
-		XrotationDegrees, 
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	m_pInstancedMeshes->DrawIndirect(
+		m_pInstanceCulling->GetVisibleInstanceBuffer(),
+		m_pInstanceCulling->GetCommandBuffer(),
+		group.firstCommand,
+		group.commandCount);
+	m_pRenderQueue->CountDrawCall();
+}
 
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+/***********************************************************
+ *  UseInstancedProgram()
+ *
+ *  This method is used for switching to the instanced program
+ *  variant for what a draw samples, and for binding what it
+ *  samples.  A texture array is bound once, and every
+ *  instance samples the layer of its own texture.  Until a
+ *  single texture has streamed in, the instances are drawn
+ *  with a flat color by the untextured variant.
+ ***********************************************************/
+bool SceneManager::UseInstancedProgram(int textureSlot, int textureArray)
+{
+	int features = GetInstancedFeatures(textureSlot, textureArray);
+	bool bBuilt = false;
+	ShaderManager* pProgram = m_pInstancedPrograms->GetProgram(features, bBuilt);
 
-	// set the XYZ scale for the mesh (marinade)
-	scaleXYZ = glm::vec3(1.0f, 2.65f, 1.00f);
+	if (NULL == pProgram)
+	{
+		return(false);
+	}
+	if (bBuilt == true)
+	{
+		ConnectInstancedVariant(features);
+		m_renderState.pProgram = pProgram;
+	}
+	UseProgram(pProgram);
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 180.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	const UNIFORM_LOCATIONS& locations = m_instancedLocations[features];
+	if ((features & ShaderPermutations::FEATURE_TEXTURE_ARRAY) != 0)
+	{
+		bool bChanged = (m_boundTextureArray != textureArray);
+		m_pRenderQueue->CountState(m_pRenderQueue->GetCounters().texture, bChanged);
+		if (bChanged == true)
+		{
+			glActiveTexture(GL_TEXTURE0 + m_textureArrayUnit);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, m_pTextureArrays->GetArrayTexture(textureArray));
+			m_boundTextureArray = textureArray;
+		}
+		// the instances of a draw can not pick different samplers
+		BindSampler(m_textureArrayUnit, m_pTextureSamplers->GetDefaultSampler());
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.2f, 2.75f, -1.0f);
+		// instances without a layer are drawn with the placeholder color
+		glUniform4fv(locations.objectColor, 1, &g_PlaceholderColor[0]);
+	}
+	else if ((features & ShaderPermutations::FEATURE_TEXTURE) != 0)
+	{
+		int textureUnit = BindTextureUnit(textureSlot);
+		glUniform1i(locations.objectTexture, textureUnit);
+		BindSampler(textureUnit, m_pTextureSamplers->GetDefaultSampler());
+	}
+	else
+	{
+		glUniform4fv(locations.objectColor, 1, &g_PlaceholderColor[0]);
+	}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+	return(true);
+}
 
-	// set the color values into the shader
-	SetShaderColor(0.30f, 0.12f, 0.08f, 1.0f);
+/***********************************************************
+ *  GetInstancedFeatures()
+ *
+ *  This method is used for getting the features of the
+ *  instanced program variant a draw is drawn with, from what
+ *  it samples and the lights of the frame.
+ ***********************************************************/
+int SceneManager::GetInstancedFeatures(int textureSlot, int textureArray) const
+{
+	int features = m_instancedLightFeatures;
 
-	SetShaderMaterial("tile");
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
+	if (textureArray >= 0)
+	{
+		features |= ShaderPermutations::FEATURE_TEXTURE_ARRAY;
+	}
+	else if ((textureSlot >= 0) && (m_textureIDs[textureSlot].bResident == true))
+	{
+		features |= ShaderPermutations::FEATURE_TEXTURE;
+	}
+	// the compact vertices pack the normals the shader unfolds
+	if ((NULL != m_pInstancedMeshes) && (m_pInstancedMeshes->GetVertexFormat() == InstancedMeshes::VERTEX_COMPACT))
+	{
+		features |= ShaderPermutations::FEATURE_PACKED_NORMALS;
+	}
 
-	// Pork piece A (pyramid)  peeking out near rim
-	scaleXYZ = glm::vec3(0.34f, 0.26f, 0.28f);
-	XrotationDegrees = 12.0f;
-	YrotationDegrees = 18.0f;
-	ZrotationDegrees = -8.0f;
+	return(features);
+}
 
-	positionXYZ = glm::vec3(5.18f, 2.75f, -1.06f);
+/***********************************************************
+ *  GetLightFeatures()
+ *
+ *  This method is used for getting the lighting features of
+ *  the lights that are on, so the lit variants leave out the
+ *  code of the lights that are off.
+ ***********************************************************/
+int SceneManager::GetLightFeatures() const
+{
+	int features = ShaderPermutations::FEATURE_LIGHTING;
+
+	if (m_lightBlock.directionalLight.bActive != 0)
+	{
+		features |= ShaderPermutations::FEATURE_DIRECTIONAL_LIGHT;
+	}
+	if ((NULL != m_pLightClusters) && (m_pLightClusters->GetLightCount() > 0))
+	{
+		features |= ShaderPermutations::FEATURE_POINT_LIGHTS;
+	}
+	if (m_lightBlock.spotLight.bActive != 0)
+	{
+		features |= ShaderPermutations::FEATURE_SPOT_LIGHT;
+	}
+
+	return(features);
+}
+
+/***********************************************************
+ *  ConnectInstancedVariant()
+ *
+ *  This method is used for looking up the uniform locations
+ *  of an instanced program variant and connecting its blocks
+ *  and samplers, once it is built.  The blocks and samplers
+ *  a variant leaves out are skipped.
+ ***********************************************************/
+void SceneManager::ConnectInstancedVariant(int features)
+{
+	ShaderManager* pProgram = m_pInstancedPrograms->FindProgram(features);
+
+	delete m_pInstancedUniforms[features];
+	m_pInstancedUniforms[features] = new ShaderUniforms(pProgram->m_programID);
+
+	ShaderUniforms* pUniforms = m_pInstancedUniforms[features];
+	ResolveUniformLocations(*pUniforms, m_instancedLocations[features]);
+	pUniforms->BindBlock(UniformBuffers::FRAME_BLOCK_NAME, UniformBuffers::FRAME_BINDING);
+	pUniforms->BindBlock(UniformBuffers::LIGHT_BLOCK_NAME, UniformBuffers::LIGHT_BINDING);
+	pUniforms->BindBlock(UniformBuffers::MATERIAL_BLOCK_NAME, UniformBuffers::MATERIAL_BINDING);
+	// the array sampler always reads the array unit
+	pProgram->use();
+	glUniform1i(m_instancedLocations[features].objectTextures, m_textureArrayUnit);
+	ConnectLightClusters(pProgram, pUniforms);
+	ConnectShadowMaps(pProgram, pUniforms);
+}
+
+/***********************************************************
+ *  BindSampler()
+ *
+ *  This method is used for binding a sampler object to a
+ *  texture unit, unless it is bound there already.
+ ***********************************************************/
+void SceneManager::BindSampler(int textureUnit, GLuint sampler)
+{
+	bool bChanged = (m_unitSamplers[textureUnit] != sampler);
+
+	m_pRenderQueue->CountState(m_pRenderQueue->GetCounters().sampler, bChanged);
+	if (bChanged == true)
+	{
+		glBindSampler(textureUnit, sampler);
+		m_unitSamplers[textureUnit] = sampler;
+	}
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+void SceneManager::LoadSceneTextures()
+{
+	// The texture images are listed in the scene file, with paths
+	// relative to the exe's working directory (e.g., ...\Debug\textures\).
+	// The images are decoded on worker threads and uploaded as they finish,
+	// so the first frames are drawn with placeholder colors.
+	const std::vector<SceneFile::SCENE_TEXTURE>& textures = m_pSceneFile->GetTextures();
+
+	for (size_t i = 0; i < textures.size(); i++)
+	{
+		QueueGLTexture(textures[i].filename, textures[i].tag);
+	}
+
+	// nothing is bound here, each texture binds itself to the unit
+	// of its slot when it is uploaded, and textures past the units
+	// are bound by BindTextureUnit() when they are drawn with
+}
+
+/***********************************************************
+ *  DefineObjectMaterials()
+ *
+ *  This method is used for configuring the various material
+ *  settings for all of the objects within the 3D scene.
+ ***********************************************************/
+void SceneManager::DefineObjectMaterials()
+{
+	// the materials are defined by the material lines of the scene file
+	const std::vector<SceneFile::SCENE_MATERIAL>& materials = m_pSceneFile->GetMaterials();
+
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		OBJECT_MATERIAL material;
+		material.diffuseColor = materials[i].diffuseColor;
+		material.specularColor = materials[i].specularColor;
+		material.shininess = materials[i].shininess;
+		material.tag = materials[i].tag;
+		material.anisotropy = materials[i].anisotropy;
+		AddObjectMaterial(material);
+	}
+	m_bRedrawNeeded = true;
+}
+
+/***********************************************************
+ *  SetupSceneLights()
+ *
+ *  This method is called to add and configure the light
+ *  sources for the 3D scene.  There are up to 4 light sources.
+ ***********************************************************/
+void SceneManager::SetupSceneLights()
+{
+	// programs with a light block read the lights from it, so the
+	// light values are only written once for all of them
+	BuildLightBlock(m_lightBlock);
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->UpdateLights(m_lightBlock);
+	}
+	// the clusters take every point light, not only the ones that fit
+	// into the light block
+	if (NULL != m_pLightClusters)
+	{
+		std::vector<LightClusters::POINT_LIGHT> pointLights;
+		BuildClusterLights(pointLights);
+		m_pLightClusters->SetLights(pointLights);
+	}
+
+	ApplyProgramLights();
+	m_bRedrawNeeded = true;
+}
+
+/***********************************************************
+ *  ApplyProgramLights()
+ *
+ *  This method is used for turning the lighting on in the
+ *  lit programs, and for setting the light values into the
+ *  main program when it has no light block.
+ ***********************************************************/
+void SceneManager::ApplyProgramLights()
+{
+	if (m_bMainLightBlock == true)
+	{
+		m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	}
+	else
+	{
+		ApplySceneLights(m_pShaderManager);
+	}
+
+	if (NULL != m_pTransparentShader)
+	{
+		m_pTransparentShader->use();
+		m_pTransparentShader->setBoolValue(g_UseLightingName, true);
+		m_pShaderManager->use();
+	}
+}
+
+/***********************************************************
+ *  BuildLightBlock()
+ *
+ *  This method is used for filling the std140 light block
+ *  from the light sources of the scene file.  Light sources
+ *  that are not in the scene file are left inactive.
+ ***********************************************************/
+void SceneManager::BuildLightBlock(UniformBuffers::LIGHT_BLOCK& lights)
+{
+	const std::vector<SceneFile::SCENE_LIGHT>& sceneLights = m_pSceneFile->GetLights();
+	int pointLightIndex = 0;
+
+	lights = UniformBuffers::LIGHT_BLOCK();
+
+	for (size_t i = 0; i < sceneLights.size(); i++)
+	{
+		const SceneFile::SCENE_LIGHT& light = sceneLights[i];
+
+		if (light.type == SceneFile::LIGHT_POINT)
+		{
+			if (pointLightIndex >= UniformBuffers::MAX_POINT_LIGHTS)
+			{
+				continue;
+			}
+			UniformBuffers::POINT_LIGHT& pointLight = lights.pointLights[pointLightIndex++];
+			pointLight.position = light.vector;
+			pointLight.ambient = light.ambient;
+			pointLight.diffuse = light.diffuse;
+			pointLight.specular = light.specular;
+			pointLight.bActive = true;
+		}
+		else if (light.type == SceneFile::LIGHT_DIRECTIONAL)
+		{
+			lights.directionalLight.direction = light.vector;
+			lights.directionalLight.ambient = light.ambient;
+			lights.directionalLight.diffuse = light.diffuse;
+			lights.directionalLight.specular = light.specular;
+			lights.directionalLight.bActive = true;
+		}
+		else
+		{
+			lights.spotLight.position = light.vector;
+			lights.spotLight.direction = light.direction;
+			lights.spotLight.ambient = light.ambient;
+			lights.spotLight.diffuse = light.diffuse;
+			lights.spotLight.specular = light.specular;
+			lights.spotLight.constant = light.constant;
+			lights.spotLight.linear = light.linear;
+			lights.spotLight.quadratic = light.quadratic;
+			lights.spotLight.cutOff = glm::cos(glm::radians(light.cutOffDegrees));
+			lights.spotLight.outerCutOff = glm::cos(glm::radians(light.outerCutOffDegrees));
+			lights.spotLight.bActive = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildClusterLights()
+ *
+ *  This method is used for collecting the point lights of the
+ *  scene file in the layout the light clusters upload.
+ ***********************************************************/
+void SceneManager::BuildClusterLights(std::vector<LightClusters::POINT_LIGHT>& lights)
+{
+	const std::vector<SceneFile::SCENE_LIGHT>& sceneLights = m_pSceneFile->GetLights();
+
+	lights.clear();
+	for (size_t i = 0; i < sceneLights.size(); i++)
+	{
+		const SceneFile::SCENE_LIGHT& light = sceneLights[i];
+
+		if (light.type == SceneFile::LIGHT_POINT)
+		{
+			LightClusters::POINT_LIGHT pointLight = LightClusters::POINT_LIGHT();
+			pointLight.position = light.vector;
+			pointLight.range = light.range;
+			pointLight.ambient = light.ambient;
+			pointLight.diffuse = light.diffuse;
+			pointLight.specular = light.specular;
+			lights.push_back(pointLight);
+		}
+	}
+}
+
+/***********************************************************
+ *  ConnectLightClusters()
+ *
+ *  This method is used for connecting the cluster block of a
+ *  program and pointing its cluster samplers at the units the
+ *  cluster buffers are bound to.  The program is left in use.
+ ***********************************************************/
+void SceneManager::ConnectLightClusters(ShaderManager* pProgram, ShaderUniforms* pUniforms)
+{
+	pUniforms->BindBlock(UniformBuffers::CLUSTER_BLOCK_NAME, UniformBuffers::CLUSTER_BINDING);
+	pProgram->use();
+	glUniform1i(pUniforms->GetLocation(g_ClusterLightsName), m_lightClusterUnit);
+	glUniform1i(pUniforms->GetLocation(g_ClusterListsName), m_lightClusterUnit + 1);
+}
+
+/***********************************************************
+ *  UpdateLightClusters()
+ *
+ *  This method is used for binning the point lights into the
+ *  clusters of the camera the frame is drawn with, and for
+ *  binding the lists for the draws.  The binning may leave
+ *  its compute program in use, so the main program is put
+ *  back in use.
+ ***********************************************************/
+void SceneManager::UpdateLightClusters()
+{
+	if ((NULL == m_pLightClusters) || (NULL == m_pUniformBuffers))
+	{
+		return;
+	}
+
+	const UniformBuffers::FRAME_BLOCK& frame = m_pUniformBuffers->GetFrame();
+	GLint viewport[4];
+
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	m_pLightClusters->Update(frame.view, frame.projection, m_pJobSystem);
+	m_pUniformBuffers->UpdateClusters(m_pLightClusters->GetClusterBlock(viewport));
+	m_pLightClusters->Bind(m_lightClusterUnit);
+	m_pShaderManager->use();
+}
+
+/***********************************************************
+ *  ConnectShadowMaps()
+ *
+ *  This method is used for connecting the shadow block of a
+ *  program and pointing its shadow sampler at the unit the
+ *  shadow maps are bound to.  The program is left in use.
+ ***********************************************************/
+void SceneManager::ConnectShadowMaps(ShaderManager* pProgram, ShaderUniforms* pUniforms)
+{
+	pUniforms->BindBlock(UniformBuffers::SHADOW_BLOCK_NAME, UniformBuffers::SHADOW_BINDING);
+	pProgram->use();
+	glUniform1i(pUniforms->GetLocation(g_ShadowMapsName), m_shadowUnit);
+}
+
+/***********************************************************
+ *  RenderShadowMaps()
+ *
+ *  This method is used for drawing the shadow maps of the
+ *  frame.  The static nodes are only drawn into the maps
+ *  whose cached static depth no longer fits, the dynamic
+ *  nodes into every map they reach.  The casters of a map
+ *  are found by culling the scene hierarchy against the
+ *  frustum of its light.  The depth programs are left in
+ *  use, so the main program is put back in use.
+ ***********************************************************/
+void SceneManager::RenderShadowMaps()
+{
+	if ((NULL == m_pShadowMaps) || (NULL == m_pUniformBuffers))
+	{
+		return;
+	}
+
+	const UniformBuffers::FRAME_BLOCK& frame = m_pUniformBuffers->GetFrame();
+	m_pShadowMaps->Update(m_lightBlock, frame.view, frame.projection, m_pSceneGraph->GetStaticVersion());
+
+	if (m_pShadowMaps->Begin() == true)
+	{
+		for (int map = 0; map < ShadowMaps::MAP_COUNT; map++)
+		{
+			if (m_pShadowMaps->IsMapActive(map) == false)
+			{
+				continue;
+			}
+
+			Frustum frustum(m_pShadowMaps->GetLightMatrix(map), glm::mat4(1.0f));
+			m_shadowNodes.assign(m_pSceneGraph->GetNodeCount(), 0);
+			m_pSceneBVH->Cull(*m_pSceneGraph, frustum, m_shadowNodes, m_pJobSystem);
+
+			if (m_pShadowMaps->IsStaticCached(map) == false)
+			{
+				DrawShadowCasters(map, false);
+			}
+			DrawShadowCasters(map, true);
+		}
+		m_pShadowMaps->End();
+		m_pShaderManager->use();
+	}
+
+	m_pUniformBuffers->UpdateShadows(m_pShadowMaps->GetShadowBlock());
+	m_pShadowMaps->Bind();
+}
+
+/***********************************************************
+ *  DrawShadowCasters()
+ *
+ *  This method is used for drawing the static or the dynamic
+ *  nodes that reach a shadow map into its static or dynamic
+ *  pass.  Instanced nodes are drawn with one draw per mesh,
+ *  and see-through nodes cast no shadows.
+ ***********************************************************/
+void SceneManager::DrawShadowCasters(int map, bool bDynamic)
+{
+	int casterCount = 0;
+
+	m_shadowCasterNodes.clear();
+	for (int k = 0; k < InstancedMeshes::MESH_KIND_COUNT; k++)
+	{
+		m_shadowCasterInstances[k].clear();
+	}
+	for (int i = 0; i < m_pSceneGraph->GetNodeCount(); i++)
+	{
+		const SceneGraph::SCENE_NODE& node = m_pSceneGraph->GetNode(i);
+		InstancedMeshes::MESH_KIND meshKind;
+
+		if ((m_shadowNodes[i] == 0) || (node.bDynamic != bDynamic) ||
+			((node.textureSlot < 0) && (node.color.a < 1.0f)))
+		{
+			continue;
+		}
+
+		if ((NULL != m_pInstancedMeshes) && (node.bInstanced == true) &&
+			(GetInstancedMeshKind(node, meshKind) == true))
+		{
+			InstancedMeshes::INSTANCE_DATA instance = InstancedMeshes::INSTANCE_DATA();
+			instance.model = node.modelMatrix;
+			m_shadowCasterInstances[meshKind].push_back(instance);
+		}
+		else
+		{
+			m_shadowCasterNodes.push_back(i);
+		}
+		casterCount++;
+	}
+
+	if (bDynamic == true)
+	{
+		if (m_pShadowMaps->BeginDynamicPass(map, casterCount > 0) == false)
+		{
+			return;
+		}
+	}
+	else
+	{
+		m_pShadowMaps->BeginStaticPass(map);
+	}
+
+	if (m_shadowCasterNodes.empty() == false)
+	{
+		m_pShadowMaps->UseNodeProgram();
+		for (size_t i = 0; i < m_shadowCasterNodes.size(); i++)
+		{
+			const SceneGraph::SCENE_NODE& node = m_pSceneGraph->GetNode(m_shadowCasterNodes[i]);
+			m_pShadowMaps->SetModel(node.modelMatrix);
+			DrawNodeMesh(node);
+			m_pRenderQueue->CountDrawCall();
+		}
+	}
+	bool bInstancedProgram = false;
+	for (int k = 0; k < InstancedMeshes::MESH_KIND_COUNT; k++)
+	{
+		if (m_shadowCasterInstances[k].empty() == true)
+		{
+			continue;
+		}
+		if (bInstancedProgram == false)
+		{
+			m_pShadowMaps->UseInstancedProgram();
+			bInstancedProgram = true;
+		}
+		m_pInstancedMeshes->DrawInstanced((InstancedMeshes::MESH_KIND)k, m_shadowCasterInstances[k]);
+		m_pRenderQueue->CountDrawCall();
+	}
+}
+
+/***********************************************************
+ *  ResolveUniformLocations()
+ *
+ *  This method is used for looking up the locations of the
+ *  uniforms that are set for every drawn object, so drawing
+ *  does not pass uniform names to the driver.
+ ***********************************************************/
+void SceneManager::ResolveUniformLocations(const ShaderUniforms& uniforms, UNIFORM_LOCATIONS& locations)
+{
+	locations.model = uniforms.GetLocation(g_ModelName);
+	locations.objectColor = uniforms.GetLocation(g_ColorValueName);
+	locations.objectTexture = uniforms.GetLocation(g_TextureValueName);
+	locations.bUseTexture = uniforms.GetLocation(g_UseTextureName);
+	locations.UVscale = uniforms.GetLocation(g_UVscaleName);
+	locations.diffuseColor = uniforms.GetLocation(g_DiffuseColorName);
+	locations.specularColor = uniforms.GetLocation(g_SpecularColorName);
+	locations.shininess = uniforms.GetLocation(g_ShininessName);
+	locations.objectTextures = uniforms.GetLocation(g_TextureArrayValueName);
+}
+
+/***********************************************************
+ *  ApplySceneLights()
+ *
+ *  This method is used for setting the light sources of the
+ *  3D scene into the passed in shader program, which must be
+ *  the program in use.
+ ***********************************************************/
+void SceneManager::ApplySceneLights(ShaderManager* pShaderManager)
+{
+	// this line of code is NEEDED for telling the shaders to render 
+	// the 3D scene with custom lighting, if no light sources have
+	// been added then the display window will be black - to use the 
+	// default OpenGL lighting then comment out the following line
+	pShaderManager->setBoolValue(g_UseLightingName, true);
+
+	// the light sources are defined by the light lines of the scene
+	// file, point lights fill the shader's array in the order listed
+	const std::vector<SceneFile::SCENE_LIGHT>& lights = m_pSceneFile->GetLights();
+	int pointLightIndex = 0;
+
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const SceneFile::SCENE_LIGHT& light = lights[i];
+		std::string prefix;
+
+		if (light.type == SceneFile::LIGHT_POINT)
+		{
+			prefix = "pointLights[" + std::to_string(pointLightIndex++) + "].";
+			pShaderManager->setVec3Value(prefix + "position", light.vector);
+		}
+		else if (light.type == SceneFile::LIGHT_DIRECTIONAL)
+		{
+			prefix = "directionalLight.";
+			pShaderManager->setVec3Value(prefix + "direction", light.vector);
+		}
+		else
+		{
+			prefix = "spotLight.";
+			pShaderManager->setVec3Value(prefix + "position", light.vector);
+			pShaderManager->setVec3Value(prefix + "direction", light.direction);
+			pShaderManager->setFloatValue(prefix + "constant", light.constant);
+			pShaderManager->setFloatValue(prefix + "linear", light.linear);
+			pShaderManager->setFloatValue(prefix + "quadratic", light.quadratic);
+			pShaderManager->setFloatValue(prefix + "cutOff", glm::cos(glm::radians(light.cutOffDegrees)));
+			pShaderManager->setFloatValue(prefix + "outerCutOff", glm::cos(glm::radians(light.outerCutOffDegrees)));
+		}
+
+		pShaderManager->setVec3Value(prefix + "ambient", light.ambient);
+		pShaderManager->setVec3Value(prefix + "diffuse", light.diffuse);
+		pShaderManager->setVec3Value(prefix + "specular", light.specular);
+		pShaderManager->setBoolValue(prefix + "bActive", true);
+	}
+}
+
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	m_pUniformBuffers = new UniformBuffers();
+	// the point lights are binned on the GPU when the context can
+	m_pLightClusters = new LightClusters();
+	if (LightClusters::IsComputeSupported() == true)
+	{
+		m_pLightClusters->LoadShader("shaders/lightClusterComputeShader.glsl");
+	}
+
+	// the lit programs are built again when their files are edited
+	m_pShaderWatcher = new ShaderWatcher();
+
+	// the variants of the shader program for the objects that are
+	// repeated many times and drawn with instancing are built as the
+	// draws ask for them, and their meshes as the scene uses them
+	m_pInstancedPrograms = new ShaderPermutations(g_InstancedVertexShaderFile, g_InstancedFragmentShaderFile, m_pShaderWatcher);
+	m_pInstancedMeshes = new InstancedMeshes();
+	// cull the instances and write their draws on the GPU when the
+	// context can, otherwise the batches are culled on the CPU
+	if (InstanceCulling::IsSupported() == true)
+	{
+		m_pInstanceCulling = new InstanceCulling();
+		if (m_pInstanceCulling->LoadShader("shaders/instancedCullComputeShader.glsl") == false)
+		{
+			delete m_pInstanceCulling;
+			m_pInstanceCulling = NULL;
+		}
+	}
+	// the GPU culling also skips the instances hidden behind what
+	// the last frame drew in front of them
+	if ((NULL != m_pInstanceCulling) && (DepthPyramid::IsSupported() == true))
+	{
+		m_pDepthPyramid = new DepthPyramid(m_depthPyramidUnit);
+		if (m_pDepthPyramid->LoadShader("shaders/depthPyramidComputeShader.glsl") == false)
+		{
+			delete m_pDepthPyramid;
+			m_pDepthPyramid = NULL;
+		}
+	}
+
+	// load the program the transparent nodes are drawn with and the
+	// pass that composites them without sorting, it reads the values
+	// the main program gets per object from the same uniform names
+	m_pTransparentShader = new ShaderManager();
+	ProgramCache::Load(m_pTransparentShader, g_TransparentVertexShaderFile, g_TransparentFragmentShaderFile);
+
+	// look up the uniform locations of the linked programs, and
+	// connect the uniform blocks they declare
+	ConnectPrograms();
+
+	m_pShaderWatcher->Watch(m_pTransparentShader, g_TransparentVertexShaderFile, g_TransparentFragmentShaderFile);
+
+	m_pTransparencyPass = new TransparencyPass(m_transparencyUnit);
+	if (m_pTransparencyPass->LoadShaders(
+		"shaders/transparentCompositeVertexShader.glsl",
+		"shaders/transparentCompositeFragmentShader.glsl") == false)
+	{
+		delete m_pTransparencyPass;
+		m_pTransparencyPass = NULL;
+	}
+
+	// the shadow maps keep the static depth between frames and only
+	// draw the moving nodes every frame
+	m_pShadowMaps = new ShadowMaps(m_shadowUnit);
+	if ((m_pShadowMaps->LoadShaders(
+		"shaders/shadowDepthVertexShader.glsl",
+		"shaders/shadowDepthInstancedVertexShader.glsl",
+		"shaders/shadowDepthFragmentShader.glsl") == false) ||
+		(m_pShadowMaps->IsAvailable() == false))
+	{
+		delete m_pShadowMaps;
+		m_pShadowMaps = NULL;
+	}
+	m_pShaderManager->use();
+
+	m_pOverdrawCounters = new OverdrawCounters();
+
+	// read the textures, materials, lights and objects of the scene
+	m_pSceneFile->Load(g_SceneFileName);
+
+	// define the materials for objects in the scene
+	DefineObjectMaterials();
+	// add and define the light sources for the scene
+	SetupSceneLights();
+
+	// the instanced shader reads the materials from the material block,
+	// indexed by the position of each material in the defined list
+	UniformBuffers::MATERIAL_BLOCK materials = UniformBuffers::MATERIAL_BLOCK();
+	for (int i = 0; (i < (int)m_objectMaterials.size()) && (i < UniformBuffers::MAX_MATERIALS); i++)
+	{
+		materials.materials[i].diffuseColor = m_objectMaterials[i].diffuseColor;
+		materials.materials[i].specularColor = m_objectMaterials[i].specularColor;
+		materials.materials[i].shininess = m_objectMaterials[i].shininess;
+	}
+	m_pUniformBuffers->UpdateMaterials(materials);
+
+	LoadSceneTextures();
+
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// the texture slots and materials are all known at this point,
+	// so the objects can be added to the retained scene, which also
+	// loads the meshes they are drawn with
+	BuildScene();
+}
+
+/***********************************************************
+ *  ConnectPrograms()
+ *
+ *  This method is used for looking up the uniform locations
+ *  of the main, instanced and transparent programs, and for
+ *  connecting their uniform blocks and samplers.  It runs
+ *  again whenever a program was built again, since the new
+ *  program knows nothing of the old one's state.
+ ***********************************************************/
+void SceneManager::ConnectPrograms()
+{
+	delete m_pUniforms;
+	m_pUniforms = new ShaderUniforms(m_pShaderManager->m_programID);
+	ResolveUniformLocations(*m_pUniforms, m_locations);
+	m_bMainLightBlock = m_pUniforms->BindBlock(UniformBuffers::LIGHT_BLOCK_NAME, UniformBuffers::LIGHT_BINDING);
+
+	// the instanced variants that were built so far
+	for (int features = 0; features < ShaderPermutations::VARIANT_COUNT; features++)
+	{
+		if (NULL != m_pInstancedPrograms->FindProgram(features))
+		{
+			ConnectInstancedVariant(features);
+		}
+	}
+
+	delete m_pTransparentUniforms;
+	m_pTransparentUniforms = new ShaderUniforms(m_pTransparentShader->m_programID);
+	ResolveUniformLocations(*m_pTransparentUniforms, m_transparentLocations);
+	m_pTransparentUniforms->BindBlock(UniformBuffers::FRAME_BLOCK_NAME, UniformBuffers::FRAME_BINDING);
+	m_pTransparentUniforms->BindBlock(UniformBuffers::LIGHT_BLOCK_NAME, UniformBuffers::LIGHT_BINDING);
+	ConnectLightClusters(m_pTransparentShader, m_pTransparentUniforms);
+	ConnectShadowMaps(m_pTransparentShader, m_pTransparentUniforms);
+
+	m_pShaderManager->use();
+	ResetRenderState();
+}
+
+/***********************************************************
+ *  WatchMainShaders()
+ *
+ *  This method is used for building the main program again
+ *  whenever the files it was loaded from are edited.
+ ***********************************************************/
+void SceneManager::WatchMainShaders(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	m_pShaderWatcher->Watch(m_pShaderManager, vertexShaderFile, fragmentShaderFile);
+}
+
+/***********************************************************
+ *  ReloadChangedShaders()
+ *
+ *  This method is used for building the watched programs
+ *  whose files were edited, and for connecting the new
+ *  programs the way PrepareScene() connected the old ones.
+ *  The textures, meshes and scene stay as they are.
+ ***********************************************************/
+bool SceneManager::ReloadChangedShaders()
+{
+	if ((NULL == m_pShaderWatcher) || (m_pShaderWatcher->Poll() == false))
+	{
+		return(false);
+	}
+
+	ConnectPrograms();
+	ApplyProgramLights();
+	m_bRedrawNeeded = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsRedrawNeeded()
+ *
+ *  This method is used for checking whether a frame drawn
+ *  now would differ from the last one, leaving the camera to
+ *  the view manager.  Images that finished decoding count,
+ *  since the next frame uploads them.
+ ***********************************************************/
+bool SceneManager::IsRedrawNeeded()
+{
+	if ((m_bRedrawNeeded == true) || (m_pSceneGraph->HasDirtyNodes() == true))
+	{
+		return(true);
+	}
+
+	return((NULL != m_pTextureLoader) && (m_pTextureLoader->GetDecodedCount() > 0));
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving the per-frame uniform
+ *  blocks and instance uploads on to the buffer regions of
+ *  the next frame.  It only waits when the GPU is still
+ *  drawing the frame that last used those regions.
+ ***********************************************************/
+void SceneManager::BeginFrame()
+{
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->BeginFrame();
+	}
+	if (NULL != m_pInstancedMeshes)
+	{
+		m_pInstancedMeshes->BeginFrame();
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the buffer regions the
+ *  frame wrote, after its last draw.
+ ***********************************************************/
+void SceneManager::EndFrame()
+{
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->EndFrame();
+	}
+	if (NULL != m_pInstancedMeshes)
+	{
+		m_pInstancedMeshes->EndFrame();
+	}
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by drawing
+ *  the nodes of the scene graph with their cached model
+ *  matrices.  Only nodes that moved since the last frame get
+ *  their matrices recomputed.  The transparent draws sort
+ *  after the opaque ones and go through the transparency
+ *  pass, which is composited once they are all drawn.  With
+ *  the depth pre-pass on, the opaque draws are drawn twice,
+ *  first into the depth buffer only and then shaded with an
+ *  equal depth test, so hidden fragments are never shaded.
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	// what changes while the frame is drawn asks for the next frame
+	m_bRedrawNeeded = false;
+
+	// upload any textures that finished decoding since the last frame,
+	// and stream in the texture levels the last frame asked for
+	{
+		FrameProfiler::ScopedSection section(m_pFrameProfiler, m_profileSections.textures);
+		ProcessLoadedTextures();
+		UpdateTextureResidency();
+	}
+
+	// recompute the matrices of moved nodes, then regroup the
+	// instance data if any of the matrices changed or a texture
+	// was added to an array
+	{
+		FrameProfiler::ScopedSection section(m_pFrameProfiler, m_profileSections.transforms);
+		m_pSceneGraph->UpdateTransforms(m_pJobSystem);
+		if ((m_instanceBatchVersion != m_pSceneGraph->GetTransformVersion()) ||
+			(m_instanceBatchTextureVersion != m_textureVersion))
+		{
+			BuildInstanceBatches();
+		}
+		// refit the hierarchy around the moved nodes, it is built
+		// again when the nodes were replaced
+		if (m_sceneBVHVersion != m_pSceneGraph->GetTransformVersion())
+		{
+			m_pSceneBVH->Refit(*m_pSceneGraph, m_pSceneGraph->GetUpdatedNodes());
+			m_sceneBVHVersion = m_pSceneGraph->GetTransformVersion();
+		}
+	}
+
+	// collect the draws of the frame and sort them so draws that
+	// share state are drawn together
+	{
+		FrameProfiler::ScopedSection section(m_pFrameProfiler, m_profileSections.queue);
+		m_pRenderQueue->Clear();
+		m_instancedLightFeatures = GetLightFeatures();
+		QueueSceneDraws();
+		m_pRenderQueue->Sort();
+	}
+
+	{
+		FrameProfiler::ScopedSection section(m_pFrameProfiler, m_profileSections.shadows);
+		RenderShadowMaps();
+	}
+
+	{
+		FrameProfiler::ScopedSection section(m_pFrameProfiler, m_profileSections.lights);
+		UpdateLightClusters();
+	}
+
+	{
+		FrameProfiler::ScopedSection section(m_pFrameProfiler, m_profileSections.draw);
+		int itemCount = m_pRenderQueue->GetItemCount();
+		bool bDepthPrepass = (m_bDepthPrepass == true) && (NULL != m_pOverdrawCounters);
+
+		// the transparent draws sort after all of the opaque ones
+		int opaqueCount = 0;
+		while ((opaqueCount < itemCount) &&
+			(RenderQueue::IsTransparentKey(m_pRenderQueue->GetItem(opaqueCount).sortKey) == false))
+		{
+			opaqueCount++;
+		}
+
+		if (NULL != m_pOverdrawCounters)
+		{
+			GLint viewport[4];
+			glGetIntegerv(GL_VIEWPORT, viewport);
+			m_pOverdrawCounters->BeginFrame();
+			m_pRenderQueue->CountSamples(
+				m_pOverdrawCounters->GetSamples(OverdrawCounters::PASS_DEPTH),
+				m_pOverdrawCounters->GetSamples(OverdrawCounters::PASS_SHADING),
+				viewport[2] * viewport[3]);
+		}
+
+		ResetRenderState();
+		if (bDepthPrepass == true)
+		{
+			DrawDepthPrepass(opaqueCount);
+			// only the nearest fragment of each pixel is shaded, and
+			// the depth is already written
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
+
+		if (NULL != m_pOverdrawCounters)
+		{
+			m_pOverdrawCounters->BeginPass(OverdrawCounters::PASS_SHADING);
+		}
+		DrawQueueItems(0, opaqueCount, m_pShaderManager);
+		if (NULL != m_pOverdrawCounters)
+		{
+			m_pOverdrawCounters->EndPass(OverdrawCounters::PASS_SHADING);
+		}
+
+		if (bDepthPrepass == true)
+		{
+			glDepthFunc(GL_LESS);
+			glDepthMask(GL_TRUE);
+		}
+
+		// the opaque depth hides the instances of the next frame, the
+		// transparent draws do not hide anything
+		if ((NULL != m_pDepthPyramid) && (NULL != m_pUniformBuffers))
+		{
+			if (m_bOcclusionCulling == true)
+			{
+				const UniformBuffers::FRAME_BLOCK& frame = m_pUniformBuffers->GetFrame();
+				m_pDepthPyramid->Build(frame.projection * frame.view);
+				// the pyramid is reduced with its own compute program
+				m_renderState.pProgram->use();
+			}
+			else
+			{
+				m_pDepthPyramid->Invalidate();
+			}
+		}
+
+		// the transparent draws go through the transparency pass, or
+		// are blended back to front with the main program without it
+		if (opaqueCount < itemCount)
+		{
+			if (BeginTransparentDraws() == true)
+			{
+				DrawQueueItems(opaqueCount, itemCount, m_pTransparentShader);
+				EndTransparentDraws();
+			}
+			else
+			{
+				DrawQueueItems(opaqueCount, itemCount, m_pShaderManager);
+			}
+		}
+
+		// leave the main program in use for the view manager
+		UseProgram(m_pShaderManager);
+	}
+
+	m_pRenderQueue->EndFrame();
+}
+
+/***********************************************************
+ *  DrawQueueItems()
+ *
+ *  This method is used for drawing a range of the sorted
+ *  render queue.  The instanced items are drawn with the
+ *  instanced program, and the scene nodes with the passed in
+ *  program.
+ ***********************************************************/
+void SceneManager::DrawQueueItems(int first, int last, ShaderManager* pNodeProgram)
+{
+	for (int i = first; i < last; i++)
+	{
+		const RenderQueue::DRAW_ITEM& item = m_pRenderQueue->GetItem(i);
+
+		if (item.type == RenderQueue::ITEM_INSTANCE_BATCH)
+		{
+			DrawInstancedMeshes(m_instanceBatches[item.index]);
+		}
+		else if (item.type == RenderQueue::ITEM_INDIRECT_GROUP)
+		{
+			DrawIndirectGroup(m_indirectGroups[item.index]);
+		}
+		else
+		{
+			UseProgram(pNodeProgram);
+			DrawSceneNode(m_pSceneGraph->GetNode(item.index));
+		}
+	}
+}
+
+/***********************************************************
+ *  DrawDepthPrepass()
+ *
+ *  This method is used for laying down the depth of the
+ *  opaque draws before they are shaded.  The draws go through
+ *  the same programs as the shading pass, so their depth
+ *  matches exactly and the equal depth test passes, but with
+ *  the color writes and the lighting turned off.  The shader
+ *  values set here are forgotten again afterwards.
+ ***********************************************************/
+void SceneManager::DrawDepthPrepass(int opaqueCount)
+{
+	SetLighting(false);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	m_pOverdrawCounters->BeginPass(OverdrawCounters::PASS_DEPTH);
+
+	ResetRenderState();
+	DrawQueueItems(0, opaqueCount, m_pShaderManager);
+
+	m_pOverdrawCounters->EndPass(OverdrawCounters::PASS_DEPTH);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	SetLighting(true);
+	ResetRenderState();
+}
+
+/***********************************************************
+ *  SetLighting()
+ *
+ *  This method is used for turning the lighting of the main
+ *  and instanced programs on or off, which leaves the main
+ *  program in use.
+ ***********************************************************/
+void SceneManager::SetLighting(bool bLighting)
+{
+	// the instanced draws switch to their unlit variants
+	if (bLighting == true)
+	{
+		m_instancedLightFeatures = GetLightFeatures();
+	}
+	else
+	{
+		m_instancedLightFeatures = 0;
+	}
+	m_pShaderManager->use();
+	m_pShaderManager->setBoolValue(g_UseLightingName, bLighting);
+}
+
+/***********************************************************
+ *  SetShadowQuality()
+ *
+ *  This method is used for setting the filter quality the
+ *  shadows are drawn with.
+ ***********************************************************/
+void SceneManager::SetShadowQuality(ShadowMaps::FILTER_QUALITY quality)
+{
+	if (NULL != m_pShadowMaps)
+	{
+		m_pShadowMaps->SetFilterQuality(quality);
+	}
+	m_bRedrawNeeded = true;
+}
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees, 
-		YrotationDegrees, 
-		ZrotationDegrees, 
-		positionXYZ
-	);
-
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
-
-	// Pork piece B (pyramid)  offset to the back-right
-	scaleXYZ = glm::vec3(0.28f, 0.24f, 0.26f);
-	XrotationDegrees = -6.0f; 
-	YrotationDegrees = 32.0f; 
-	ZrotationDegrees = 10.0f;
-
-	positionXYZ = glm::vec3(5.32f, 2.75f, -0.88f);
-
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
+/***********************************************************
+ *  PickNode()
+ *
+ *  This method is used for finding the nearest scene node
+ *  whose bounding box is hit by a world space ray.
+ ***********************************************************/
+int SceneManager::PickNode(const glm::vec3& origin, const glm::vec3& direction)
+{
+	float hitDistance = 0.0f;
+	int index = m_pSceneBVH->Raycast(*m_pSceneGraph, origin, direction, hitDistance);
 
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+	if (index >= 0)
+	{
+		const SceneGraph::SCENE_NODE& node = m_pSceneGraph->GetNode(index);
+		std::cout << "Picked object " << index << ", mesh:" << node.mesh << ", distance:" << hitDistance << std::endl;
+	}
 
-	// Pork piece C (pyramid)  smaller front-left nub
-	scaleXYZ = glm::vec3(0.54f, 0.50f, 0.52f);
-	XrotationDegrees = 8.0f; 
-	YrotationDegrees = -20.0f; 
-	ZrotationDegrees = -12.0f;
+	return(index);
+}
 
-	positionXYZ = glm::vec3(5.06f, 2.75f, -1.14f);
+/***********************************************************
+ *  SetFrameProfiler()
+ *
+ *  This method is used for timing the sections of the scene
+ *  rendering with the passed in profiler.
+ ***********************************************************/
+void SceneManager::SetFrameProfiler(FrameProfiler* pFrameProfiler)
+{
+	m_pFrameProfiler = pFrameProfiler;
+	if (NULL != m_pFrameProfiler)
+	{
+		m_profileSections.textures = m_pFrameProfiler->AddSection("textures");
+		m_profileSections.transforms = m_pFrameProfiler->AddSection("transforms");
+		m_profileSections.queue = m_pFrameProfiler->AddSection("queue");
+		m_profileSections.shadows = m_pFrameProfiler->AddSection("shadows");
+		m_profileSections.lights = m_pFrameProfiler->AddSection("lights");
+		m_profileSections.draw = m_pFrameProfiler->AddSection("draw");
+	}
+}
 
-	SetTransformations(
-		scaleXYZ, 
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
+/***********************************************************
+ *  QueueSceneDraws()
+ *
+ *  This method is used for adding a draw item for every
+ *  batch of instanced nodes and every other scene node.
+ *  Nodes whose bounds are outside the camera frustum, found
+ *  by walking the scene hierarchy, are left out and batches
+ *  only keep their visible instances.  When the GPU culls
+ *  the batches, one item is added for each group of batches
+ *  sharing a texture instead.
+ *  Nodes drawn with a see-through color sort after the other
+ *  draws.  The transparency pass blends them in any order, so
+ *  they are sorted by their state; without it they are sorted
+ *  by their distance from the camera.
+ *  The culling and the draw items are split into jobs; each
+ *  job fills its own list, and the lists are added to the
+ *  queue in job order so the frame does not depend on which
+ *  thread ran which job.
+ ***********************************************************/
+void SceneManager::QueueSceneDraws()
+{
+	glm::vec3 viewPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::mat4 projection = glm::mat4(1.0f);
+	glm::mat4 view = glm::mat4(1.0f);
+	bool bCull = false;
+	if (NULL != m_pUniformBuffers)
+	{
+		const UniformBuffers::FRAME_BLOCK& frame = m_pUniformBuffers->GetFrame();
+		viewPosition = glm::vec3(frame.viewPosition);
+		projection = frame.projection;
+		view = frame.view;
+		bCull = m_bFrustumCulling;
+	}
+	Frustum frustum(projection, view);
+	int culled = 0;
 
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+	m_visibleNodes.assign(m_pSceneGraph->GetNodeCount(), (bCull == true) ? 0 : 1);
+	if (bCull == true)
+	{
+		m_pSceneBVH->Cull(*m_pSceneGraph, frustum, m_visibleNodes, m_pJobSystem);
+	}
+	RequestTextureLevels(viewPosition, projection[1][1]);
 
-	// Pork piece D (pyramid)
-	scaleXYZ = glm::vec3(0.35f, 0.27f, 0.29f);
-	XrotationDegrees = 12.0f;
-	YrotationDegrees = 18.0f;
-	ZrotationDegrees = -8.0f;
+	// the GPU culls the batches and writes their draws, so the
+	// batches only add one item per group, and the culled instances
+	// are counted a few frames late, when the GPU counts are read
+	if (NULL != m_pInstanceCulling)
+	{
+		const DepthPyramid* pDepthPyramid = (m_bOcclusionCulling == true) ? m_pDepthPyramid : NULL;
+		m_pInstanceCulling->Cull(frustum, bCull, viewPosition, projection[1][1], pDepthPyramid);
+		m_pShaderManager->use();
 
-	positionXYZ = glm::vec3(5.18f, 2.75f, -1.36f);
+		const InstanceCulling::CULL_STATS& stats = m_pInstanceCulling->GetStats();
+		culled += (int)stats.frustumCulled;
+		m_pRenderQueue->CountOccluded((int)stats.occluded);
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
+		for (size_t g = 0; g < m_indirectGroups.size(); g++)
+		{
+			const INDIRECT_GROUP& group = m_indirectGroups[g];
+			int texture = group.textureSlot;
+			if (group.textureArray >= 0)
+			{
+				texture = (int)m_textureIDs.size() + group.textureArray;
+			}
+			// the instanced variants sort after the node draws
+			int program = 1 + GetInstancedFeatures(group.textureSlot, group.textureArray);
+			uint64_t sortKey = RenderQueue::MakeOpaqueKey(program, texture, -1, 0);
+			m_pRenderQueue->Add(sortKey, RenderQueue::ITEM_INDIRECT_GROUP, (int)g);
+		}
+	}
 
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+	// keep the visible instances of each batch, a batch per job,
+	// sorted into the level of detail for their size on the screen
+	if (m_nodeLods.size() != m_visibleNodes.size())
+	{
+		m_nodeLods.assign(m_visibleNodes.size(), 0);
+	}
+	int batchCount = (NULL != m_pInstanceCulling) ? 0 : (int)m_instanceBatches.size();
+	float projectionScale = projection[1][1];
+	m_pJobSystem->ParallelFor(batchCount, 1,
+		[&](int begin, int end, int)
+		{
+			for (int b = begin; b < end; b++)
+			{
+				INSTANCE_BATCH& batch = m_instanceBatches[b];
+
+				for (int lod = 0; lod < InstancedMeshes::LOD_COUNT; lod++)
+				{
+					batch.visibleInstances[lod].clear();
+				}
+				batch.visibleCount = 0;
+				for (size_t k = 0; k < batch.instances.size(); k++)
+				{
+					int index = batch.nodes[k];
+					if (m_visibleNodes[index] == 0)
+					{
+						continue;
+					}
+
+					float screenSize = GetScreenSize(m_pSceneGraph->GetNode(index), viewPosition, projectionScale);
+					int lod = InstancedMeshes::SelectLod(batch.meshKind, screenSize, m_nodeLods[index]);
+					m_nodeLods[index] = (unsigned char)lod;
+					batch.visibleInstances[lod].push_back(batch.instances[k]);
+					batch.visibleCount++;
+				}
+			}
+		});
+
+	for (int b = 0; b < batchCount; b++)
+	{
+		INSTANCE_BATCH& batch = m_instanceBatches[b];
 
-	// Pork piece E (pyramid)
-	scaleXYZ = glm::vec3(0.48f, 0.44f, 0.46f);
-	XrotationDegrees = -6.0f;
-	YrotationDegrees = 32.0f;
-	ZrotationDegrees = 10.0f;
+		culled += (int)batch.instances.size() - batch.visibleCount;
+		if (batch.visibleCount == 0)
+		{
+			continue;
+		}
 
-	positionXYZ = glm::vec3(5.32f, 2.75f, -0.68f);
+		// the materials of instanced draws come with each instance,
+		// batches using an array sort after the single texture ones
+		int texture = m_instanceBatches[b].textureSlot;
+		if (m_instanceBatches[b].textureArray >= 0)
+		{
+			texture = (int)m_textureIDs.size() + m_instanceBatches[b].textureArray;
+		}
+		int program = 1 + GetInstancedFeatures(m_instanceBatches[b].textureSlot, m_instanceBatches[b].textureArray);
+		uint64_t sortKey = RenderQueue::MakeOpaqueKey(
+			program, texture, -1, m_instanceBatches[b].meshKind);
+		m_pRenderQueue->Add(sortKey, RenderQueue::ITEM_INSTANCE_BATCH, b);
+	}
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
+	int nodeCount = m_pSceneGraph->GetNodeCount();
+	int chunkCount = JobSystem::GetChunkCount(nodeCount, g_QueueChunkSize);
+	bool bBlended = (NULL != m_pTransparencyPass) && (m_pTransparencyPass->IsAvailable() == true);
+	if ((int)m_chunkDrawItems.size() < chunkCount)
+	{
+		m_chunkDrawItems.resize(chunkCount);
+	}
+	m_chunkCulled.assign(chunkCount, 0);
 
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+	m_pJobSystem->ParallelFor(nodeCount, g_QueueChunkSize,
+		[&](int begin, int end, int chunk)
+		{
+			std::vector<RenderQueue::DRAW_ITEM>& items = m_chunkDrawItems[chunk];
+
+			items.clear();
+			for (int i = begin; i < end; i++)
+			{
+				const SceneGraph::SCENE_NODE& node = m_pSceneGraph->GetNode(i);
+				InstancedMeshes::MESH_KIND meshKind;
+				uint64_t sortKey = 0;
+
+				// instanced nodes are drawn with their batch
+				if ((node.bInstanced == true) && (GetInstancedMeshKind(node, meshKind) == true))
+				{
+					continue;
+				}
+				if (m_visibleNodes[i] == 0)
+				{
+					m_chunkCulled[chunk]++;
+					continue;
+				}
+
+				if ((node.textureSlot < 0) && (node.color.a < 1.0f))
+				{
+					if (bBlended == true)
+					{
+						sortKey = RenderQueue::MakeBlendedKey(node.textureSlot, node.materialIndex, node.mesh);
+					}
+					else
+					{
+						glm::vec3 position = glm::vec3(node.modelMatrix[3]);
+						sortKey = RenderQueue::MakeTransparentKey(glm::length(position - viewPosition));
+					}
+				}
+				else
+				{
+					sortKey = RenderQueue::MakeOpaqueKey(0, node.textureSlot, node.materialIndex, node.mesh);
+				}
+				items.push_back(RenderQueue::MakeItem(sortKey, RenderQueue::ITEM_NODE, i));
+			}
+		});
+
+	for (int chunk = 0; chunk < chunkCount; chunk++)
+	{
+		m_pRenderQueue->AddItems(m_chunkDrawItems[chunk]);
+		culled += m_chunkCulled[chunk];
+	}
 
-	// Pork piece F (pyramid)
-	scaleXYZ = glm::vec3(0.34f, 0.30f, 0.32f);
-	XrotationDegrees = 8.0f;
-	YrotationDegrees = -20.0f;
-	ZrotationDegrees = -12.0f;
+	m_pRenderQueue->CountCulled(culled);
+}
 
-	positionXYZ = glm::vec3(5.06f, 2.75f, -1.84f);
+/***********************************************************
+ *  ResetRenderState()
+ *
+ *  This method is used for forgetting the shader values set
+ *  while drawing, so the next draw sets all of them.  The
+ *  main program is expected to be in use.
+ ***********************************************************/
+void SceneManager::ResetRenderState()
+{
+	// NaN never compares equal, so the first compare always differs
+	const float unknown = std::numeric_limits<float>::quiet_NaN();
+
+	m_renderState.pProgram = m_pShaderManager;
+	m_renderState.pLocations = &m_locations;
+	m_renderState.texture = -2;
+	m_renderState.color = glm::vec4(unknown);
+	m_renderState.UVscale = glm::vec2(unknown);
+	m_renderState.material = -2;
+}
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ
-	);
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for switching to a shader program if
+ *  it is not the program already in use.
+ ***********************************************************/
+void SceneManager::UseProgram(ShaderManager* pProgram)
+{
+	bool bChanged = (m_renderState.pProgram != pProgram);
+
+	m_pRenderQueue->CountState(m_pRenderQueue->GetCounters().program, bChanged);
+	if (bChanged == true)
+	{
+		pProgram->use();
+		m_renderState.pProgram = pProgram;
+	}
+}
 
-	SetShaderTexture("meat");
-	SetTextureUVScale(1.5f, 1.2f);
-	SetShaderMaterial("clay");
-	m_basicMeshes->DrawPyramid4Mesh();
-	/****************************************************************/
+/***********************************************************
+ *  BeginTransparentDraws()
+ *
+ *  This method is used for redirecting the following node
+ *  draws into the transparency pass.  The transparent program
+ *  keeps uniform values of its own, so the values set in the
+ *  main program are forgotten before switching to it.
+ ***********************************************************/
+bool SceneManager::BeginTransparentDraws()
+{
+	if ((NULL == m_pTransparencyPass) || (m_pTransparencyPass->Begin() == false))
+	{
+		return(false);
+	}
 
-	// set the XYZ scale for the mesh (cup body)
-	scaleXYZ = glm::vec3(1.05f, 3.0f, 1.05f);
+	// the instanced draws may have left their program in use
+	ShaderManager* pProgram = m_renderState.pProgram;
+	ResetRenderState();
+	m_renderState.pProgram = pProgram;
+	UseProgram(m_pTransparentShader);
+	m_renderState.pLocations = &m_transparentLocations;
 
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 180.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
+	return(true);
+}
 
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(5.2f, 3.0f, -1.0f);
+/***********************************************************
+ *  EndTransparentDraws()
+ *
+ *  This method is used for compositing the transparent draws
+ *  over the opaque scene.  The composite leaves a program of
+ *  its own in use, so the next program switch is not skipped.
+ ***********************************************************/
+void SceneManager::EndTransparentDraws()
+{
+	m_pTransparencyPass->End();
+	m_renderState.pProgram = NULL;
+	m_renderState.pLocations = &m_locations;
+}
 
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+/***********************************************************
+ *  BuildInstanceBatches()
+ *
+ *  This method is used for grouping the instanced nodes that
+ *  share a mesh and texture into batches of instance data.
+ *  Nodes whose textures were packed into the same texture
+ *  array share a batch, each instance picking its own layer.
+ ***********************************************************/
+void SceneManager::BuildInstanceBatches()
+{
+	m_instanceBatches.clear();
 
-	// set the color values into the shader
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.35f);
+	for (int i = 0; i < m_pSceneGraph->GetNodeCount(); i++)
+	{
+		const SceneGraph::SCENE_NODE& node = m_pSceneGraph->GetNode(i);
+		InstancedMeshes::MESH_KIND meshKind;
 
-	SetShaderMaterial("glass");
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawCylinderMesh(false, false, true);
-	/****************************************************************/
+		if ((node.bInstanced == false) || (GetInstancedMeshKind(node, meshKind) == false))
+		{
+			continue;
+		}
 
-	// set the XYZ scale for the mesh (lid)
-	scaleXYZ = glm::vec3(1.10f, 0.10f, 1.10f);
-	XrotationDegrees = 0.0f;  YrotationDegrees = 0.0f;  ZrotationDegrees = 0.0f;
-	// y = half the lid height so it rests on the plane (y=0)
-	positionXYZ = glm::vec3(6.8f, 0.05f, 0.7f);
+		// textures still streaming in are not in an array yet
+		int textureArray = -1;
+		int textureLayer = -1;
+		if ((NULL != m_pTextureArrays) && (node.textureSlot >= 0) &&
+			(m_textureIDs[node.textureSlot].bResident == true))
+		{
+			textureArray = m_pTextureArrays->GetArray(node.textureSlot);
+			textureLayer = m_pTextureArrays->GetLayer(node.textureSlot);
+		}
 
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
+		// find the batch for this mesh and texture, or start one
+		size_t b = 0;
+		while ((b < m_instanceBatches.size()) &&
+			   ((m_instanceBatches[b].meshKind != meshKind) ||
+				(m_instanceBatches[b].textureArray != textureArray) ||
+				((textureArray < 0) && (m_instanceBatches[b].textureSlot != node.textureSlot))))
+		{
+			b++;
+		}
+		if (b == m_instanceBatches.size())
+		{
+			INSTANCE_BATCH batch;
+			batch.meshKind = meshKind;
+			batch.textureSlot = (textureArray < 0) ? node.textureSlot : -1;
+			batch.textureArray = textureArray;
+			batch.firstNode = i;
+			batch.visibleCount = 0;
+			m_instanceBatches.push_back(batch);
+		}
+
+		InstancedMeshes::INSTANCE_DATA instance;
+		instance.model = node.modelMatrix;
+		instance.UVscale = node.UVscale;
+		instance.materialIndex = (node.materialIndex >= 0) ? node.materialIndex : 0;
+		instance.textureLayer = textureLayer;
+		m_instanceBatches[b].instances.push_back(instance);
+		m_instanceBatches[b].nodes.push_back(i);
+	}
 
-	// see through plastic
-	SetShaderColor(1.0f, 1.0f, 1.0f, 0.35f);
-	SetShaderMaterial("plasticClear");
+	m_instanceBatchVersion = m_pSceneGraph->GetTransformVersion();
+	m_instanceBatchTextureVersion = m_textureVersion;
 
-	// thin cylinder with caps
-	m_basicMeshes->DrawCylinderMesh();
-	/****************************************************************/
+	if (NULL != m_pInstanceCulling)
+	{
+		BuildIndirectGroups();
+	}
+}
 
-	// Tweezers  left strip 
-	scaleXYZ = glm::vec3(1.80f, 0.05f, 0.02f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 9.5f;                   
-	ZrotationDegrees = 2.0f;
+/***********************************************************
+ *  BuildIndirectGroups()
+ *
+ *  This method is used for uploading every batched instance
+ *  for culling on the GPU, with one draw command for each
+ *  level of detail of a batch.  The batches are ordered by
+ *  their texture state so the commands of batches that share
+ *  it are next to each other and form one group.
+ ***********************************************************/
+void SceneManager::BuildIndirectGroups()
+{
+	std::vector<int> order;
+	std::vector<InstancedMeshes::INSTANCE_DATA> instances;
+	std::vector<InstanceCulling::INSTANCE_BOUNDS> bounds;
+	std::vector<InstancedMeshes::DRAW_COMMAND> commands;
+	// where the visible instances of the next command start, every
+	// level of a batch has room for all the instances of the batch
+	GLuint visibleBase = 0;
+
+	for (size_t b = 0; b < m_instanceBatches.size(); b++)
+	{
+		order.push_back((int)b);
+	}
+	std::sort(order.begin(), order.end(),
+		[this](int a, int b)
+		{
+			const INSTANCE_BATCH& first = m_instanceBatches[a];
+			const INSTANCE_BATCH& second = m_instanceBatches[b];
+			if (first.textureArray != second.textureArray)
+			{
+				return(first.textureArray < second.textureArray);
+			}
+			if (first.textureSlot != second.textureSlot)
+			{
+				return(first.textureSlot < second.textureSlot);
+			}
+			return(first.meshKind < second.meshKind);
+		});
+
+	m_indirectGroups.clear();
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const INSTANCE_BATCH& batch = m_instanceBatches[order[i]];
 
-	positionXYZ = glm::vec3(1.46f, 0.3f, 1.855f);
+		if (m_indirectGroups.empty() ||
+			(m_indirectGroups.back().textureArray != batch.textureArray) ||
+			(m_indirectGroups.back().textureSlot != batch.textureSlot))
+		{
+			INDIRECT_GROUP group;
+			group.textureSlot = batch.textureSlot;
+			group.textureArray = batch.textureArray;
+			group.firstCommand = (int)commands.size();
+			group.commandCount = 0;
+			m_indirectGroups.push_back(group);
+		}
+		int lodCount = InstancedMeshes::GetLodCount(batch.meshKind);
+		GLuint batchSize = (GLuint)batch.instances.size();
+		m_indirectGroups.back().commandCount += lodCount;
 
-	SetTransformations(
-		scaleXYZ, 
-		XrotationDegrees, 
-		YrotationDegrees, 
-		ZrotationDegrees,
-		positionXYZ
-	);
-	SetShaderTexture("metal"); 
-	SetTextureUVScale(2.0, 1.0); 
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawBoxMesh();
-	/****************************************************************/
-
-	// Tweezers  right strip
-	scaleXYZ = glm::vec3(1.80f, 0.05f, 0.02f);
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 12.0f;
-	ZrotationDegrees = 2.0f;
-
-	positionXYZ = glm::vec3(1.48f, 0.30f, 1.915f);
-	SetTransformations(
-		scaleXYZ, 
-		XrotationDegrees, 
-		YrotationDegrees, 
-		ZrotationDegrees, 
-		positionXYZ
-	);
-
-	SetShaderTexture("metal");
-	SetTextureUVScale(2.0, 1.0);
-	SetShaderMaterial("glass");
-	m_basicMeshes->DrawBoxMesh();
-	/****************************************************************/
-
-}
\ No newline at end of file
+		for (size_t k = 0; k < batch.instances.size(); k++)
+		{
+			const SceneGraph::SCENE_NODE& node = m_pSceneGraph->GetNode(batch.nodes[k]);
+			InstanceCulling::INSTANCE_BOUNDS box;
+			box.boundsMin = node.boundsMin;
+			box.command = (int)commands.size();
+			box.boundsMax = node.boundsMax;
+			box.lodCount = lodCount;
+			bounds.push_back(box);
+		}
+		for (int lod = 0; lod < lodCount; lod++)
+		{
+			commands.push_back(m_pInstancedMeshes->MakeDrawCommand(
+				batch.meshKind, visibleBase + lod * batchSize, batchSize, lod));
+		}
+		instances.insert(instances.end(), batch.instances.begin(), batch.instances.end());
+		visibleBase += lodCount * batchSize;
+	}
+
+	m_pInstanceCulling->SetInstances(instances, bounds, commands);
+}
+
+/***********************************************************
+ *  DrawSceneNode()
+ *
+ *  This method is used for setting the shader values of one
+ *  scene node and drawing its mesh.
+ ***********************************************************/
+void SceneManager::DrawSceneNode(const SceneGraph::SCENE_NODE& node)
+{
+	RenderQueue::FRAME_COUNTERS& counters = m_pRenderQueue->GetCounters();
+	bool bChanged = false;
+
+	glUniformMatrix4fv(m_renderState.pLocations->model, 1, GL_FALSE, &node.modelMatrix[0][0]);
+
+	if ((node.textureSlot >= 0) && (m_textureIDs[node.textureSlot].bResident == true))
+	{
+		bChanged = (m_renderState.texture != node.textureSlot);
+		m_pRenderQueue->CountState(counters.texture, bChanged);
+		if (bChanged == true)
+		{
+			SetShaderTexture(node.textureSlot);
+			m_renderState.texture = node.textureSlot;
+		}
+		else
+		{
+			// the shared texture unit may have been rebound since
+			BindTextureUnit(node.textureSlot);
+		}
+
+		// the material picks how the texture is filtered
+		int anisotropy = 0;
+		if ((node.materialIndex >= 0) && (node.materialIndex < (int)m_objectMaterials.size()))
+		{
+			anisotropy = m_objectMaterials[node.materialIndex].anisotropy;
+		}
+		BindSampler(GetTextureUnit(node.textureSlot), m_pTextureSamplers->GetSampler(anisotropy));
+
+		bChanged = (m_renderState.UVscale != node.UVscale);
+		m_pRenderQueue->CountState(counters.UVscale, bChanged);
+		if (bChanged == true)
+		{
+			SetTextureUVScale(node.UVscale.x, node.UVscale.y);
+			m_renderState.UVscale = node.UVscale;
+		}
+	}
+	else
+	{
+		// textures still streaming in are drawn with the placeholder
+		glm::vec4 color = (node.textureSlot >= 0) ? g_PlaceholderColor : node.color;
+
+		bChanged = (m_renderState.texture != -1) || (m_renderState.color != color);
+		m_pRenderQueue->CountState(counters.color, bChanged);
+		if (bChanged == true)
+		{
+			SetShaderColor(color.r, color.g, color.b, color.a);
+			m_renderState.texture = -1;
+			m_renderState.color = color;
+		}
+	}
+
+	// nodes without a material keep the material already set
+	if (node.materialIndex >= 0)
+	{
+		bChanged = (m_renderState.material != node.materialIndex);
+		m_pRenderQueue->CountState(counters.material, bChanged);
+		if (bChanged == true)
+		{
+			SetShaderMaterial(node.materialIndex);
+			m_renderState.material = node.materialIndex;
+		}
+	}
+
+	DrawNodeMesh(node);
+	m_pRenderQueue->CountDrawCall();
+}
+
+/***********************************************************
+ *  DrawNodeMesh()
+ *
+ *  This method is used for drawing the mesh of a scene node
+ *  with whatever program and values are already set.
+ ***********************************************************/
+void SceneManager::DrawNodeMesh(const SceneGraph::SCENE_NODE& node)
+{
+	switch (node.mesh)
+	{
+	case SceneGraph::MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case SceneGraph::MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case SceneGraph::MESH_PYRAMID4:
+		m_basicMeshes->DrawPyramid4Mesh();
+		break;
+	case SceneGraph::MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh(
+			(node.drawFlags & SceneGraph::DRAW_TOP) != 0,
+			(node.drawFlags & SceneGraph::DRAW_BOTTOM) != 0,
+			(node.drawFlags & SceneGraph::DRAW_SIDES) != 0);
+		break;
+	case SceneGraph::MESH_TAPERED_CYLINDER:
+		m_basicMeshes->DrawTaperedCylinderMesh();
+		break;
+	case SceneGraph::MESH_TORUS:
+		m_basicMeshes->DrawTorusMesh();
+		break;
+	case SceneGraph::MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	}
+}
+
+/***********************************************************
+ *  BuildScene()
+ *
+ *  This method is used for adding the objects of the 3D
+ *  scene file to the retained scene graph.  It is called
+ *  once from PrepareScene(), after the textures and
+ *  materials are defined, and RenderScene() draws the
+ *  stored nodes.
+ ***********************************************************/
+void SceneManager::BuildScene()
+{
+	const std::vector<SceneFile::SCENE_TRANSFORM>& transforms = m_pSceneFile->GetTransforms();
+	const std::vector<int32_t>& textureIDs = m_pSceneFile->GetTextureIDs();
+	const std::vector<int32_t>& materialIDs = m_pSceneFile->GetMaterialIDs();
+	const std::vector<SceneFile::SCENE_DRAW>& draws = m_pSceneFile->GetDraws();
+
+	for (int i = 0; i < m_pSceneFile->GetObjectCount(); i++)
+	{
+		// set the transformations into the scene node
+		SceneGraph::SCENE_NODE node = SceneGraph::MakeNode(
+			transforms[i].scaleXYZ,
+			transforms[i].rotationDegrees.x,
+			transforms[i].rotationDegrees.y,
+			transforms[i].rotationDegrees.z,
+			transforms[i].positionXYZ);
+
+		// the scene file refers to textures and materials by their
+		// position in its own lists, look up where they were loaded
+		if (textureIDs[i] >= 0)
+		{
+			node.textureSlot = FindTextureSlot(m_pSceneFile->GetTextures()[textureIDs[i]].tag);
+		}
+		if (materialIDs[i] >= 0)
+		{
+			node.materialIndex = FindMaterialIndex(m_pSceneFile->GetMaterials()[materialIDs[i]].tag);
+		}
+
+		node.mesh = (SceneGraph::MESH_TYPE)draws[i].mesh;
+		node.drawFlags = draws[i].drawFlags;
+		node.bInstanced = (draws[i].bInstanced != 0);
+		node.bDynamic = (draws[i].bDynamic != 0);
+		node.color = draws[i].color;
+		node.UVscale = draws[i].UVscale;
+
+		// add the object to the retained scene
+		m_pSceneGraph->AddNode(node);
+	}
+
+	LoadSceneMeshes();
+}
+
+/***********************************************************
+ *  LoadSceneMeshes()
+ *
+ *  This method is used for generating only the meshes that
+ *  the nodes of the scene graph are drawn with.  Only one
+ *  copy of a particular mesh needs to be loaded in memory no
+ *  matter how many times it is drawn.  The nodes drawn with
+ *  their instanced batch only need the instanced copy, and
+ *  the meshes of an earlier scene are kept.
+ ***********************************************************/
+void SceneManager::LoadSceneMeshes()
+{
+	for (int i = 0; i < m_pSceneGraph->GetNodeCount(); i++)
+	{
+		const SceneGraph::SCENE_NODE& node = m_pSceneGraph->GetNode(i);
+		InstancedMeshes::MESH_KIND meshKind;
+
+		if ((NULL != m_pInstancedMeshes) && (node.bInstanced == true) &&
+			(GetInstancedMeshKind(node, meshKind) == true))
+		{
+			m_pInstancedMeshes->LoadMesh(meshKind);
+		}
+		else
+		{
+			LoadShapeMesh(node.mesh);
+		}
+	}
+}
+
+/***********************************************************
+ *  LoadShapeMesh()
+ *
+ *  This method is used for generating a basic shape mesh in
+ *  GPU memory, the first time a node is drawn with it.
+ ***********************************************************/
+void SceneManager::LoadShapeMesh(SceneGraph::MESH_TYPE mesh)
+{
+	unsigned int meshBit = 1u << (unsigned int)mesh;
+
+	if ((m_loadedShapeMeshes & meshBit) != 0)
+	{
+		return;
+	}
+	m_loadedShapeMeshes |= meshBit;
+
+	switch (mesh)
+	{
+	case SceneGraph::MESH_PLANE:
+		m_basicMeshes->LoadPlaneMesh();
+		break;
+	case SceneGraph::MESH_BOX:
+		m_basicMeshes->LoadBoxMesh();
+		break;
+	case SceneGraph::MESH_PYRAMID4:
+		m_basicMeshes->LoadPyramid4Mesh();
+		break;
+	case SceneGraph::MESH_CYLINDER:
+		m_basicMeshes->LoadCylinderMesh();
+		break;
+	case SceneGraph::MESH_TAPERED_CYLINDER:
+		m_basicMeshes->LoadTaperedCylinderMesh();
+		break;
+	case SceneGraph::MESH_TORUS:
+		m_basicMeshes->LoadTorusMesh();
+		break;
+	case SceneGraph::MESH_SPHERE:
+		m_basicMeshes->LoadSphereMesh();
+		break;
+	}
+}
+
+/***********************************************************
+ *  SetVertexFormat()
+ *
+ *  This method is used for switching the instanced meshes
+ *  between the full and the compact vertex layout.  The
+ *  instanced program variants follow the layout through
+ *  their features.
+ ***********************************************************/
+void SceneManager::SetVertexFormat(InstancedMeshes::VERTEX_FORMAT format)
+{
+	if (NULL != m_pInstancedMeshes)
+	{
+		m_pInstancedMeshes->SetVertexFormat(format);
+		m_bRedrawNeeded = true;
+	}
+}
+
+/***********************************************************
+ *  PrintMeshMemory()
+ *
+ *  This method is used for printing the bytes the vertices
+ *  and indices of the loaded instanced meshes take in the
+ *  full and in the compact layout.
+ ***********************************************************/
+void SceneManager::PrintMeshMemory() const
+{
+	if (NULL == m_pInstancedMeshes)
+	{
+		return;
+	}
+
+	std::cout << "Instanced meshes: " << m_pInstancedMeshes->GetVertexCount() << " vertices, full layout:" <<
+		m_pInstancedMeshes->GetMeshBytes(InstancedMeshes::VERTEX_FULL) << " bytes, compact layout:" <<
+		m_pInstancedMeshes->GetMeshBytes(InstancedMeshes::VERTEX_COMPACT) << " bytes, drawn " <<
+		((m_pInstancedMeshes->GetVertexFormat() == InstancedMeshes::VERTEX_COMPACT) ? "compact" : "full") << std::endl;
+}
+
+/***********************************************************
+ *  BuildBenchmarkScene()
+ *
+ *  This method is used for replacing the scene graph with a
+ *  square grid of objects over a ground plane.  The meshes,
+ *  rotations, colors, textures and materials are picked from
+ *  the object index, so every run draws the same scene.  The
+ *  generated point lights are spread over the grid the same
+ *  way, each reaching only a few objects, and are added to
+ *  the point lights of the scene file.
+ ***********************************************************/
+float SceneManager::BuildBenchmarkScene(int objectCount, int lightCount)
+{
+	int columns = (int)std::ceil(std::sqrt((float)std::max(objectCount, 1)));
+	float halfSize = 0.5f * columns * g_BenchmarkSpacing;
+
+	m_pSceneGraph->Clear();
+
+	// the ground plane under the grid
+	SceneGraph::SCENE_NODE ground = SceneGraph::MakeNode(
+		glm::vec3(halfSize, 1.0f, halfSize), 0.0f, 0.0f, 0.0f, glm::vec3(0.0f, 0.0f, 0.0f));
+	ground.mesh = SceneGraph::MESH_PLANE;
+	ground.color = glm::vec4(0.35f, 0.35f, 0.35f, 1.0f);
+	ground.materialIndex = m_objectMaterials.empty() ? -1 : 0;
+	m_pSceneGraph->AddNode(ground);
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		int row = i / columns;
+		int column = i % columns;
+		glm::vec3 position = glm::vec3(
+			(column + 0.5f) * g_BenchmarkSpacing - halfSize,
+			0.5f,
+			(row + 0.5f) * g_BenchmarkSpacing - halfSize);
+
+		SceneGraph::SCENE_NODE node = SceneGraph::MakeNode(
+			glm::vec3(0.8f, 0.8f, 0.8f), 0.0f, (float)((i * 37) % 360), 0.0f, position);
+
+		node.mesh = g_BenchmarkMeshes[i % g_BenchmarkMeshCount];
+		node.bInstanced = ((i % g_BenchmarkMeshCount) < g_BenchmarkMeshCount - 1);
+		node.color = glm::vec4(
+			0.3f + 0.7f * ((i * 13) % 17) / 16.0f,
+			0.3f + 0.7f * ((i * 7) % 11) / 10.0f,
+			0.3f + 0.7f * ((i * 3) % 7) / 6.0f,
+			1.0f);
+		// every third object is textured
+		if ((i % 3 == 0) && (m_textureIDs.size() > 0))
+		{
+			node.textureSlot = (i / 3) % (int)m_textureIDs.size();
+		}
+		// the instanced shader only sees the materials in the block
+		if (m_objectMaterials.size() > 0)
+		{
+			node.materialIndex = i % std::min((int)m_objectMaterials.size(), UniformBuffers::MAX_MATERIALS);
+		}
+
+		m_pSceneGraph->AddNode(node);
+	}
+
+	if (NULL != m_pLightClusters)
+	{
+		std::vector<LightClusters::POINT_LIGHT> lights;
+		BuildClusterLights(lights);
+		for (int i = 0; i < lightCount; i++)
+		{
+			// golden ratio steps fill the square without clumping
+			float u = std::fmod(0.5f + i * 0.6180340f, 1.0f);
+			float v = (i + 0.5f) / (float)lightCount;
+			LightClusters::POINT_LIGHT light = LightClusters::POINT_LIGHT();
+
+			light.position = glm::vec3(
+				(2.0f * u - 1.0f) * halfSize,
+				g_BenchmarkLightHeight,
+				(2.0f * v - 1.0f) * halfSize);
+			light.range = g_BenchmarkLightRange;
+			light.diffuse = glm::vec3(
+				0.2f + 0.8f * ((i * 5) % 7) / 6.0f,
+				0.2f + 0.8f * ((i * 3) % 5) / 4.0f,
+				0.2f + 0.8f * ((i * 2) % 3) / 2.0f);
+			light.specular = 0.5f * light.diffuse;
+			lights.push_back(light);
+		}
+		m_pLightClusters->SetLights(lights);
+	}
+
+	LoadSceneMeshes();
+
+	return(halfSize);
+}
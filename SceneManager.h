@@ -11,8 +11,32 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "TextureLoader.h"
+#include "InstancedMeshes.h"
+#include "SceneGraph.h"
+#include "SceneFile.h"
+#include "ShaderUniforms.h"
+#include "UniformBuffers.h"
+#include "RenderQueue.h"
+#include "TextureArrays.h"
+#include "FrameProfiler.h"
+#include "Frustum.h"
+#include "SceneBVH.h"
+#include "JobSystem.h"
+#include "InstanceCulling.h"
+#include "DepthPyramid.h"
+#include "TransparencyPass.h"
+#include "LightClusters.h"
+#include "ShadowMaps.h"
+#include "OverdrawCounters.h"
+#include "TextureResidency.h"
+#include "TextureSamplers.h"
+#include "ProgramCache.h"
+#include "ShaderWatcher.h"
+#include "ShaderPermutations.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 /***********************************************************
@@ -33,6 +57,8 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		// false until the image has been decoded and uploaded
+		bool bResident;
 	};
 
 	struct OBJECT_MATERIAL
@@ -41,6 +67,8 @@ public:
 		glm::vec3 specularColor;
 		float shininess;
 		std::string tag;
+		// anisotropic filtering of its textures, 0 for the default
+		int anisotropy;
 	};
 
 private:
@@ -48,24 +76,239 @@ private:
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
 	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
-	// defined object materials
+	// loaded textures info, indexed by texture handle
+	std::vector<TEXTURE_INFO> m_textureIDs;
+	// texture handle of each texture tag
+	std::unordered_map<std::string, int> m_textureHandles;
+	// textures with a handle below this stay bound to the texture
+	// unit of the same number, the others share the next unit
+	int m_boundTextureUnits;
+	// texture handle bound to the shared last unit, -1 for none
+	int m_sharedUnitTexture;
+	// levels of the loaded textures kept in video memory, which owns
+	// the textures of the registry above
+	TextureResidency* m_pTextureResidency;
+	// sampler objects the textures are filtered with, picked by the
+	// material of each draw
+	TextureSamplers* m_pTextureSamplers;
+	// sampler bound to each texture unit, 0 for none
+	std::vector<GLuint> m_unitSamplers;
+	// copies of the loaded textures packed into texture arrays, NULL
+	// when the GL context can not build them
+	TextureArrays* m_pTextureArrays;
+	// unit the texture arrays are bound to, past the shared unit
+	int m_textureArrayUnit;
+	// texture array bound to its unit, -1 for none
+	int m_boundTextureArray;
+	// first of the two units the transparency composite reads
+	int m_transparencyUnit;
+	// first of the two units the light cluster buffers are bound to
+	int m_lightClusterUnit;
+	// unit the shadow map array is bound to
+	int m_shadowUnit;
+	// counts the uploaded textures, so batches can pick up new layers
+	unsigned int m_textureVersion;
+	// defined object materials, indexed by material handle
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// material handle of each material tag
+	std::unordered_map<std::string, int> m_materialHandles;
+	// worker pool decoding the queued texture images
+	TextureLoader* m_pTextureLoader;
+	// pixel buffer object used for streaming texture uploads
+	GLuint m_uploadPBO;
+	// true when textures are stored in and read from the compressed cache
+	bool m_bUseTextureCache;
+	// bit per SceneGraph::MESH_TYPE of the loaded basic shape meshes
+	unsigned int m_loadedShapeMeshes;
+	// meshes and shader program for drawing repeated objects instanced
+	InstancedMeshes* m_pInstancedMeshes;
+	// one program variant per texturing and lighting combination
+	ShaderPermutations* m_pInstancedPrograms;
+	// retained objects of the 3D scene with their cached matrices
+	SceneGraph* m_pSceneGraph;
+	// textures, materials, lights and objects read from the scene file
+	SceneFile* m_pSceneFile;
+	// uniform locations of the main program
+	ShaderUniforms* m_pUniforms;
+	// camera, light and material blocks shared by the programs
+	UniformBuffers* m_pUniformBuffers;
+	// true when the main program reads its lights from the light block
+	bool m_bMainLightBlock;
+	// point lights of the scene binned into view space clusters, read
+	// by the instanced and transparent programs
+	LightClusters* m_pLightClusters;
+	// light block values, kept for fitting the shadow maps
+	UniformBuffers::LIGHT_BLOCK m_lightBlock;
+	// shadows of the directional and spot lights, read by the instanced
+	// and transparent programs, NULL when the maps can not be created
+	ShadowMaps* m_pShadowMaps;
+	// per scene node, whether it reaches the shadow map being drawn
+	std::vector<char> m_shadowNodes;
+	// casters of the shadow pass being drawn, kept between passes so
+	// the lists keep their memory
+	std::vector<int> m_shadowCasterNodes;
+	std::vector<InstancedMeshes::INSTANCE_DATA> m_shadowCasterInstances[InstancedMeshes::MESH_KIND_COUNT];
+	// true when the depth of the opaque draws is laid down before they
+	// are shaded, so each pixel is only shaded once
+	bool m_bDepthPrepass;
+	// samples of the depth and shading passes, NULL until PrepareScene()
+	OverdrawCounters* m_pOverdrawCounters;
+	// true when something the last frame showed has changed since
+	bool m_bRedrawNeeded;
+
+	// locations of the uniforms that are set for every object
+	struct UNIFORM_LOCATIONS
+	{
+		GLint model = -1;
+		GLint objectColor = -1;
+		GLint objectTexture = -1;
+		GLint bUseTexture = -1;
+		GLint UVscale = -1;
+		GLint diffuseColor = -1;
+		GLint specularColor = -1;
+		GLint shininess = -1;
+		GLint objectTextures = -1;
+	};
+	UNIFORM_LOCATIONS m_locations;
+	// uniform locations of each variant of the instanced program, the
+	// uniforms are NULL until the variant was built
+	ShaderUniforms* m_pInstancedUniforms[ShaderPermutations::VARIANT_COUNT];
+	UNIFORM_LOCATIONS m_instancedLocations[ShaderPermutations::VARIANT_COUNT];
+	// lighting features of the instanced variants this frame
+	int m_instancedLightFeatures;
+
+	// program for the transparent nodes and the pass compositing them
+	// order independently, when the pass is not available they are
+	// sorted and blended by the main program instead
+	ShaderManager* m_pTransparentShader;
+	ShaderUniforms* m_pTransparentUniforms;
+	UNIFORM_LOCATIONS m_transparentLocations;
+	TransparencyPass* m_pTransparencyPass;
+	// builds the lit programs again when their files are edited, NULL
+	// until PrepareScene()
+	ShaderWatcher* m_pShaderWatcher;
+
+	// sorted draws of the frame and the state change counters
+	RenderQueue* m_pRenderQueue;
+	// shader values last set while drawing the frame, so setting
+	// the same value again can be skipped
+	struct RENDER_STATE
+	{
+		ShaderManager* pProgram;
+		// per-object uniforms of the program the nodes are drawn with
+		const UNIFORM_LOCATIONS* pLocations;
+		int texture;			// -1 when drawing with a color
+		glm::vec4 color;
+		glm::vec2 UVscale;
+		int material;
+	};
+	RENDER_STATE m_renderState;
+
+	// times the sections of RenderScene(), NULL when not profiling
+	FrameProfiler* m_pFrameProfiler;
+	struct PROFILE_SECTIONS
+	{
+		int textures = -1;
+		int transforms = -1;
+		int queue = -1;
+		int shadows = -1;
+		int lights = -1;
+		int draw = -1;
+	};
+	PROFILE_SECTIONS m_profileSections;
+
+	// nodes sharing a mesh and texture, or a mesh and texture array,
+	// that are drawn as one batch
+	struct INSTANCE_BATCH
+	{
+		InstancedMeshes::MESH_KIND meshKind;
+		int textureSlot;
+		// -1 unless the instances pick their layer of this array
+		int textureArray;
+		int firstNode;
+		std::vector<InstancedMeshes::INSTANCE_DATA> instances;
+		// scene node of each instance
+		std::vector<int> nodes;
+		// the instances inside the view this frame, by level of detail
+		std::vector<InstancedMeshes::INSTANCE_DATA> visibleInstances[InstancedMeshes::LOD_COUNT];
+		int visibleCount;
+	};
+	std::vector<INSTANCE_BATCH> m_instanceBatches;
+	// culls the batched instances on the GPU, NULL when the context
+	// can not, in which case the batches are culled and drawn one
+	// at a time
+	InstanceCulling* m_pInstanceCulling;
+	// farthest depth of the opaque draws of the last frame, which the
+	// GPU culling tests the instances against, NULL when the GPU does
+	// not cull the instances
+	DepthPyramid* m_pDepthPyramid;
+	// unit the depth pyramid is read from while culling
+	int m_depthPyramidUnit;
+	// true when the instances hidden behind nearer objects are skipped
+	bool m_bOcclusionCulling;
+	// batches sharing their texture state, whose draw commands are
+	// next to each other and drawn with one multi draw
+	struct INDIRECT_GROUP
+	{
+		int textureSlot;
+		int textureArray;
+		int firstCommand;
+		int commandCount;
+	};
+	std::vector<INDIRECT_GROUP> m_indirectGroups;
+	// true when objects outside the view are skipped
+	bool m_bFrustumCulling;
+	// hierarchy of the scene node bounds, for culling and picking
+	SceneBVH* m_pSceneBVH;
+	// scene graph transform version the hierarchy was fitted to
+	unsigned int m_sceneBVHVersion;
+	// per scene node, whether it may be visible this frame
+	std::vector<char> m_visibleNodes;
+	// per scene node, the level of detail it was last drawn with
+	std::vector<unsigned char> m_nodeLods;
+	// worker threads the scene updates, culling and draw lists are
+	// split over, the GL calls stay on the calling thread
+	JobSystem* m_pJobSystem;
+	// draw items and culled nodes of each job of QueueSceneDraws(),
+	// kept between frames so the lists keep their memory
+	std::vector<std::vector<RenderQueue::DRAW_ITEM>> m_chunkDrawItems;
+	std::vector<int> m_chunkCulled;
+	// scene graph transform and texture versions the batches were built from
+	unsigned int m_instanceBatchVersion;
+	unsigned int m_instanceBatchTextureVersion;
 
 	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	bool CreateGLTexture(const char* filename, const std::string& tag);
+	// queue a texture image to be decoded in the background
+	bool QueueGLTexture(const char* filename, const std::string& tag);
+	// reserve the next texture handle for the passed in tag
+	int ReserveTextureSlot(const std::string& tag);
+	// get the texture unit a texture handle is sampled from
+	int GetTextureUnit(int textureSlot) const;
+	// make sure a texture is bound to its unit, returns the unit
+	int BindTextureUnit(int textureSlot);
+	// upload decoded image data into the reserved texture slot, the
+	// bytes the GL thread moved for it are added to uploadBytes
+	bool UploadGLTexture(TextureLoader::DECODED_IMAGE& image, size_t& uploadBytes);
+	// copy an uploaded texture into its texture array
+	void AddToTextureArray(int textureSlot, GLuint textureID);
+	void AddToTextureArray(int textureSlot, const TextureCache::COMPRESSED_IMAGE& chain);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
 	void DestroyGLTextures();
+	// stream the texture levels asked for by the last frame
+	void UpdateTextureResidency();
+	// ask for the texture levels the visible nodes are seen at
+	void RequestTextureLevels(const glm::vec3& viewPosition, float projectionScale);
 	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
+	int FindTextureID(const std::string& tag);
+	int FindTextureSlot(const std::string& tag);
 	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(const std::string& tag);
+	// add a material and intern its tag
+	void AddObjectMaterial(const OBJECT_MATERIAL& material);
 
 	// set the transformation values 
 	// into the transform buffer
@@ -85,7 +328,9 @@ private:
 
 	// set the texture data into the shader
 	void SetShaderTexture(
-		std::string textureTag);
+		const std::string& textureTag);
+	void SetShaderTexture(
+		int textureSlot);
 
 	// set the UV scale for the texture mapping
 	void SetTextureUVScale(
@@ -93,7 +338,89 @@ private:
 
 	// set the object material into the shader
 	void SetShaderMaterial(
-		std::string materialTag);
+		const std::string& materialTag);
+	void SetShaderMaterial(
+		int materialIndex);
+
+	// look up the locations of the per-object uniforms
+	void ResolveUniformLocations(const ShaderUniforms& uniforms, UNIFORM_LOCATIONS& locations);
+
+	// set the light source values into a shader program
+	void ApplySceneLights(ShaderManager* pShaderManager);
+	// turn the lighting on in the lit programs
+	void ApplyProgramLights();
+	// look up the uniforms and connect the blocks of the lit programs
+	void ConnectPrograms();
+	// fill the light block from the scene file lights
+	void BuildLightBlock(UniformBuffers::LIGHT_BLOCK& lights);
+	// collect every point light of the scene file for the clusters
+	void BuildClusterLights(std::vector<LightClusters::POINT_LIGHT>& lights);
+	// let a program read the point lights from the light clusters
+	void ConnectLightClusters(ShaderManager* pProgram, ShaderUniforms* pUniforms);
+	// bin the point lights for the camera of the frame
+	void UpdateLightClusters();
+	// let a program read the shadows from the shadow maps
+	void ConnectShadowMaps(ShaderManager* pProgram, ShaderUniforms* pUniforms);
+	// draw the shadow maps that changed for the camera of the frame
+	void RenderShadowMaps();
+	// draw the static or the dynamic scene nodes reaching a shadow map
+	// into it
+	void DrawShadowCasters(int map, bool bDynamic);
+
+	// draw all the passed in instances of a mesh with one draw call
+	void DrawInstancedMeshes(
+		InstancedMeshes::MESH_KIND meshKind,
+		int textureSlot,
+		const std::vector<InstancedMeshes::INSTANCE_DATA>& instances,
+		int lod = 0);
+	void DrawInstancedMeshes(const INSTANCE_BATCH& batch);
+	// draw the batches of a group with the commands the GPU culled
+	void DrawIndirectGroup(const INDIRECT_GROUP& group);
+	// switch to the instanced program variant for what the instanced
+	// draws sample and bind their texture or texture array, false is
+	// returned when the variant does not build
+	bool UseInstancedProgram(int textureSlot, int textureArray);
+	// get the features of the instanced program variant for a draw
+	int GetInstancedFeatures(int textureSlot, int textureArray) const;
+	// get the lighting features of the lights of the frame
+	int GetLightFeatures() const;
+	// look up the uniforms and connect the blocks of one instanced
+	// program variant, which is left in use
+	void ConnectInstancedVariant(int features);
+	// bind a sampler to a texture unit when it is not already bound
+	void BindSampler(int textureUnit, GLuint sampler);
+
+	// group the instanced scene nodes into batches
+	void BuildInstanceBatches();
+	// upload the batches for culling on the GPU, grouped by texture
+	void BuildIndirectGroups();
+	// add the draws of the frame that are inside the view to the
+	// render queue
+	void QueueSceneDraws();
+	// forget the shader values set in the last frame
+	void ResetRenderState();
+	// switch shader programs when not already in use
+	void UseProgram(ShaderManager* pProgram);
+	// draw one scene node with its cached model matrix
+	void DrawSceneNode(const SceneGraph::SCENE_NODE& node);
+	// draw the mesh of a scene node with the shader values already set
+	void DrawNodeMesh(const SceneGraph::SCENE_NODE& node);
+	// generate the meshes the nodes of the scene graph are drawn with
+	void LoadSceneMeshes();
+	// generate a basic shape mesh the first time a node uses it
+	void LoadShapeMesh(SceneGraph::MESH_TYPE mesh);
+	// draw the items of the render queue from first up to last, the
+	// scene nodes with the passed in program
+	void DrawQueueItems(int first, int last, ShaderManager* pNodeProgram);
+	// draw the opaque items into the depth buffer only
+	void DrawDepthPrepass(int opaqueCount);
+	// turn the lighting of the main and instanced programs on or off
+	void SetLighting(bool bLighting);
+	// switch the node draws over to the transparency pass, false when
+	// the pass is not available
+	bool BeginTransparentDraws();
+	// composite the transparent draws and go back to the main program
+	void EndTransparentDraws();
 
 public:
 
@@ -102,6 +429,19 @@ public:
 	void PrepareScene();
 	void RenderScene();
 
+	// start a frame before any of its values are set, and end it after
+	// its last draw, so its per-frame buffers can be written while the
+	// GPU still draws the frames before it
+	void BeginFrame();
+	void EndFrame();
+
+	// add the objects of the scene file to the scene graph
+	void BuildScene();
+	// replace the scene with a grid of generated objects lit by the
+	// passed in number of generated point lights, returns the distance
+	// from the center of the grid to its edges
+	float BuildBenchmarkScene(int objectCount, int lightCount = 0);
+
 	// pre-set light sources for 3D scene
 	void SetupSceneLights();
 	// pre-define the object materials for lighting
@@ -109,5 +449,48 @@ public:
 
 	// loads textures from image files
 	void LoadSceneTextures();
+	// upload textures that finished decoding since the last call
+	void ProcessLoadedTextures();
+	// check whether a texture is ready to be sampled
+	bool IsTextureResident(const std::string& tag);
+	// check whether every queued texture has been uploaded
+	bool AreTexturesLoaded();
+
+	// uniform blocks shared with the view manager, valid after PrepareScene()
+	UniformBuffers* GetUniformBuffers() { return(m_pUniformBuffers); }
+	// find the scene node hit by a world space ray, -1 for none
+	int PickNode(const glm::vec3& origin, const glm::vec3& direction);
+	// turn skipping the objects outside the view on or off
+	void SetFrustumCulling(bool bFrustumCulling) { m_bFrustumCulling = bFrustumCulling; }
+	// turn skipping the instances hidden in the last frame's depth on or off
+	void SetOcclusionCulling(bool bOcclusionCulling) { m_bOcclusionCulling = bOcclusionCulling; }
+	// trade shadow quality for fill rate, FILTER_OFF skips the shadows
+	void SetShadowQuality(ShadowMaps::FILTER_QUALITY quality);
+	// set the anisotropic filtering of the materials that do not
+	// pick their own
+	void SetAnisotropy(int anisotropy);
+	// set the video memory the textures may use, in megabytes
+	void SetTextureBudget(int megabytes);
+	// print the video memory used by each texture
+	void PrintTextureResidency() const;
+	// hold the instanced meshes in the full or the compact vertex layout
+	void SetVertexFormat(InstancedMeshes::VERTEX_FORMAT format);
+	// print the bytes the instanced meshes take in each vertex layout
+	void PrintMeshMemory() const;
+	// turn the depth only pass before the opaque draws on or off
+	void SetDepthPrepass(bool bDepthPrepass) { m_bDepthPrepass = bDepthPrepass; m_bRedrawNeeded = true; }
+	bool IsDepthPrepassEnabled() const { return(m_bDepthPrepass); }
+	// also rebuild the main program when its files are edited
+	void WatchMainShaders(const char* vertexShaderFile, const char* fragmentShaderFile);
+	// rebuild the programs whose files were edited, true when one was
+	bool ReloadChangedShaders();
+	// time the sections of RenderScene() with the passed in profiler
+	void SetFrameProfiler(FrameProfiler* pFrameProfiler);
+	// check whether the scene looks different from the last frame drawn,
+	// from moved nodes, edited lights or materials, changed settings or
+	// textures that finished streaming in
+	bool IsRedrawNeeded();
+	// draw calls and state changes made and skipped in the last frame
+	const RenderQueue::FRAME_COUNTERS& GetRenderCounters() const { return(m_pRenderQueue->GetLastFrameCounters()); }
 
 };
\ No newline at end of file
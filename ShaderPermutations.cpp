@@ -0,0 +1,158 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.cpp
+// ============
+// build variants of a shader program specialized with #define lines for the
+// texturing and lighting features a draw uses
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderPermutations.h"
+#include "ProgramCache.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// #define names of the features, in the order of their bits
+	const char* g_FeatureNames[ShaderPermutations::FEATURE_COUNT] =
+	{
+		"TEXTURE",
+		"TEXTURE_ARRAY",
+		"LIGHTING",
+		"DIRECTIONAL_LIGHT",
+		"POINT_LIGHTS",
+		"SPOT_LIGHT",
+		"PACKED_NORMALS"
+	};
+}
+
+/***********************************************************
+ *  ShaderPermutations()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderPermutations::ShaderPermutations(const char* vertexShaderFile, const char* fragmentShaderFile, ShaderWatcher* pShaderWatcher)
+{
+	m_vertexShaderFile = vertexShaderFile;
+	m_fragmentShaderFile = fragmentShaderFile;
+	m_pShaderWatcher = pShaderWatcher;
+	for (int i = 0; i < VARIANT_COUNT; i++)
+	{
+		m_pPrograms[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~ShaderPermutations()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderPermutations::~ShaderPermutations()
+{
+	for (int i = 0; i < VARIANT_COUNT; i++)
+	{
+		if (NULL != m_pPrograms[i])
+		{
+			delete m_pPrograms[i];
+			m_pPrograms[i] = NULL;
+		}
+	}
+	m_pShaderWatcher = NULL;
+}
+
+/***********************************************************
+ *  GetDefines()
+ *
+ *  This method is used for making the #define lines of a
+ *  combination of features, one line per feature.
+ ***********************************************************/
+std::string ShaderPermutations::GetDefines(int features)
+{
+	std::string defines;
+
+	for (int i = 0; i < FEATURE_COUNT; i++)
+	{
+		if ((features & (1 << i)) != 0)
+		{
+			defines += "#define ";
+			defines += g_FeatureNames[i];
+			defines += "\n";
+		}
+	}
+
+	return(defines);
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the program of a variant,
+ *  building it when it is asked for the first time.  The
+ *  variant is watched even when it does not build, so the
+ *  watcher builds it once its files are fixed.
+ ***********************************************************/
+ShaderManager* ShaderPermutations::GetProgram(int features, bool& bBuilt)
+{
+	bBuilt = false;
+	if ((features < 0) || (features >= VARIANT_COUNT))
+	{
+		return(NULL);
+	}
+
+	if (NULL == m_pPrograms[features])
+	{
+		std::string defines = GetDefines(features);
+
+		m_pPrograms[features] = new ShaderManager();
+		bBuilt = ProgramCache::Load(m_pPrograms[features], m_vertexShaderFile.c_str(), m_fragmentShaderFile.c_str(), defines);
+		if (bBuilt == false)
+		{
+			std::cout << "Could not build the shader variant " << m_fragmentShaderFile << " with features:" << features << std::endl;
+		}
+		if (NULL != m_pShaderWatcher)
+		{
+			m_pShaderWatcher->Watch(m_pPrograms[features], m_vertexShaderFile.c_str(), m_fragmentShaderFile.c_str(), defines);
+		}
+	}
+
+	return(FindProgram(features));
+}
+
+/***********************************************************
+ *  FindProgram()
+ *
+ *  This method is used for getting the program of a variant
+ *  that was already built.
+ ***********************************************************/
+ShaderManager* ShaderPermutations::FindProgram(int features) const
+{
+	if ((features < 0) || (features >= VARIANT_COUNT) ||
+		(NULL == m_pPrograms[features]) || (0 == m_pPrograms[features]->m_programID))
+	{
+		return(NULL);
+	}
+
+	return(m_pPrograms[features]);
+}
+
+/***********************************************************
+ *  GetBuiltCount()
+ *
+ *  This method is used for counting the variants that have
+ *  a program.
+ ***********************************************************/
+int ShaderPermutations::GetBuiltCount() const
+{
+	int count = 0;
+
+	for (int i = 0; i < VARIANT_COUNT; i++)
+	{
+		if (NULL != FindProgram(i))
+		{
+			count++;
+		}
+	}
+
+	return(count);
+}
@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderpermutations.h
+// ============
+// build variants of a shader program specialized with #define lines for the
+// texturing and lighting features a draw uses
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderWatcher.h"
+
+#include <string>
+
+/***********************************************************
+ *  ShaderPermutations
+ *
+ *  Each combination of features gets a program of its own,
+ *  built from the same files with a #define for every
+ *  feature it has, so the shader tests the features at
+ *  compile time instead of branching on uniforms.  Variants
+ *  are built the first time a draw asks for them, and come
+ *  from the program cache on later launches.
+ *
+ *  Every variant is watched by the shader watcher, so a
+ *  variant whose files do not build keeps no program until
+ *  they are fixed, and is not tried again in the meantime.
+ ***********************************************************/
+class ShaderPermutations
+{
+public:
+	// features a variant is specialized for, the #define names are
+	// the names without the FEATURE_ prefix
+	enum FEATURE
+	{
+		FEATURE_TEXTURE = 1 << 0,			// one texture for the draw
+		FEATURE_TEXTURE_ARRAY = 1 << 1,		// a texture array layer per instance
+		FEATURE_LIGHTING = 1 << 2,			// lit, otherwise the base color
+		FEATURE_DIRECTIONAL_LIGHT = 1 << 3,	// the directional light is on
+		FEATURE_POINT_LIGHTS = 1 << 4,		// the light clusters have lights
+		FEATURE_SPOT_LIGHT = 1 << 5,		// the spot light is on
+		FEATURE_PACKED_NORMALS = 1 << 6		// octahedral normals of compact vertices
+	};
+	static const int FEATURE_COUNT = 7;
+	static const int VARIANT_COUNT = 1 << FEATURE_COUNT;
+
+	// constructor, the variants are built from the passed in files and
+	// watched by the passed in watcher
+	ShaderPermutations(const char* vertexShaderFile, const char* fragmentShaderFile, ShaderWatcher* pShaderWatcher);
+	// destructor, which deletes the variants
+	~ShaderPermutations();
+
+	// get the #define lines of a combination of features
+	static std::string GetDefines(int features);
+
+	// get the program of a combination of features, building it the
+	// first time it is asked for, in which case bBuilt is set so the
+	// caller can connect it.  NULL is returned while it does not build
+	ShaderManager* GetProgram(int features, bool& bBuilt);
+	// get the program of a variant without building it, NULL when it
+	// was never built or does not build
+	ShaderManager* FindProgram(int features) const;
+
+	// count the variants that have a program
+	int GetBuiltCount() const;
+
+private:
+	std::string m_vertexShaderFile;
+	std::string m_fragmentShaderFile;
+	ShaderWatcher* m_pShaderWatcher;
+	// NULL until a variant was asked for
+	ShaderManager* m_pPrograms[VARIANT_COUNT];
+};
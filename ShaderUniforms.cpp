@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.cpp
+// ============
+// look up every uniform location of a linked shader program once, so the
+// per-object uniform updates need no string lookups in the driver
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUniforms.h"
+
+#include <vector>
+
+/***********************************************************
+ *  ShaderUniforms()
+ *
+ *  The constructor for the class.  The program must already
+ *  be linked.
+ ***********************************************************/
+ShaderUniforms::ShaderUniforms(GLuint programID)
+{
+	GLint uniformCount = 0;
+	GLint maxNameLength = 0;
+
+	m_programID = programID;
+
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(programID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::vector<GLchar> nameBuffer(maxNameLength + 1);
+
+	for (GLint i = 0; i < uniformCount; i++)
+	{
+		GLsizei nameLength = 0;
+		GLint arraySize = 0;
+		GLenum type = 0;
+
+		glGetActiveUniform(programID, (GLuint)i, (GLsizei)nameBuffer.size(), &nameLength, &arraySize, &type, nameBuffer.data());
+		std::string name(nameBuffer.data(), nameLength);
+
+		// members of uniform blocks have no location
+		GLint location = glGetUniformLocation(programID, name.c_str());
+		if (location < 0)
+		{
+			continue;
+		}
+		m_locations[name] = location;
+
+		// arrays of basic types are reported once as "name[0]", so
+		// add the plain name and every other element as well
+		size_t bracket = name.rfind("[0]");
+		if ((bracket != std::string::npos) && (bracket + 3 == name.size()))
+		{
+			std::string baseName = name.substr(0, bracket);
+			m_locations[baseName] = location;
+			for (GLint element = 1; element < arraySize; element++)
+			{
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				m_locations[elementName] = glGetUniformLocation(programID, elementName.c_str());
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GetLocation()
+ *
+ *  This method is used for getting the cached location of
+ *  the uniform with the passed in name.
+ ***********************************************************/
+GLint ShaderUniforms::GetLocation(const std::string& name) const
+{
+	std::unordered_map<std::string, GLint>::const_iterator found = m_locations.find(name);
+	if (found == m_locations.end())
+	{
+		return(-1);
+	}
+	return(found->second);
+}
+
+/***********************************************************
+ *  BindBlock()
+ *
+ *  This method is used for connecting a uniform block of the
+ *  program to the uniform buffer binding point it reads from.
+ ***********************************************************/
+bool ShaderUniforms::BindBlock(const char* blockName, GLuint bindingPoint)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(m_programID, blockName);
+	if (blockIndex == GL_INVALID_INDEX)
+	{
+		return(false);
+	}
+
+	glUniformBlockBinding(m_programID, blockIndex, bindingPoint);
+	return(true);
+}
@@ -0,0 +1,44 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.h
+// ============
+// look up every uniform location of a linked shader program once, so the
+// per-object uniform updates need no string lookups in the driver
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <unordered_map>
+
+/***********************************************************
+ *  ShaderUniforms
+ *
+ *  This class is created right after a shader program is
+ *  linked.  It enumerates the active uniforms of the program
+ *  and stores their locations by name.  Callers resolve the
+ *  locations they use every frame once, then pass them to
+ *  glUniform*() directly while the program is in use.
+ ***********************************************************/
+class ShaderUniforms
+{
+public:
+	// constructor
+	ShaderUniforms(GLuint programID);
+
+	// get the location of a uniform, -1 when the program does
+	// not use it (glUniform*() ignores location -1)
+	GLint GetLocation(const std::string& name) const;
+
+	// connect a uniform block of the program to a binding point,
+	// false is returned if the program has no such block
+	bool BindBlock(const char* blockName, GLuint bindingPoint);
+
+	GLuint GetProgramID() const { return(m_programID); }
+
+private:
+	GLuint m_programID;
+	std::unordered_map<std::string, GLint> m_locations;
+};
@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderwatcher.cpp
+// ============
+// watch the shader files of the programs and rebuild the programs whose
+// files were edited, while the application keeps running
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderWatcher.h"
+#include "ProgramCache.h"
+
+#include <iostream>
+#include <sys/stat.h>
+
+/***********************************************************
+ *  ShaderWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderWatcher::ShaderWatcher()
+{
+	m_lastPoll = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  Watch()
+ *
+ *  This method is used for adding a program to the watched
+ *  programs, with the files it was just built from.
+ ***********************************************************/
+void ShaderWatcher::Watch(ShaderManager* pShader, const char* vertexShaderFile, const char* fragmentShaderFile, const std::string& defines)
+{
+	WATCHED_PROGRAM program;
+	program.pShader = pShader;
+	program.vertexShaderFile = vertexShaderFile;
+	program.fragmentShaderFile = fragmentShaderFile;
+	program.defines = defines;
+	program.stamp = GetStamp(program.vertexShaderFile, program.fragmentShaderFile);
+	m_programs.push_back(program);
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used for rebuilding the programs whose
+ *  files changed since the last look.  Files that can not be
+ *  read, for example while an editor saves them, are looked
+ *  at again on the next poll.
+ ***********************************************************/
+bool ShaderWatcher::Poll()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_lastPoll < std::chrono::milliseconds(POLL_INTERVAL_MS))
+	{
+		return(false);
+	}
+	m_lastPoll = now;
+
+	bool bReloaded = false;
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		WATCHED_PROGRAM& program = m_programs[i];
+		int64_t stamp = GetStamp(program.vertexShaderFile, program.fragmentShaderFile);
+		if ((0 == stamp) || (stamp == program.stamp))
+		{
+			continue;
+		}
+
+		program.stamp = stamp;
+		if (ProgramCache::Load(program.pShader, program.vertexShaderFile.c_str(), program.fragmentShaderFile.c_str(), program.defines) == true)
+		{
+			std::cout << "Reloaded shaders " << program.vertexShaderFile << ", " << program.fragmentShaderFile << std::endl;
+			bReloaded = true;
+		}
+		else
+		{
+			std::cout << "Keeping the old program of " << program.vertexShaderFile << ", " << program.fragmentShaderFile << std::endl;
+		}
+	}
+
+	return(bReloaded);
+}
+
+/***********************************************************
+ *  GetStamp()
+ *
+ *  This method is used for combining the size and the
+ *  modification time of two files into one value that
+ *  changes whenever either file is written.
+ ***********************************************************/
+int64_t ShaderWatcher::GetStamp(const std::string& vertexShaderFile, const std::string& fragmentShaderFile)
+{
+	struct stat vertexInfo;
+	struct stat fragmentInfo;
+
+	if ((stat(vertexShaderFile.c_str(), &vertexInfo) != 0) ||
+		(stat(fragmentShaderFile.c_str(), &fragmentInfo) != 0))
+	{
+		return(0);
+	}
+
+	int64_t stamp = (int64_t)vertexInfo.st_mtime * 31 + (int64_t)vertexInfo.st_size;
+	stamp = stamp * 31 + (int64_t)fragmentInfo.st_mtime;
+	stamp = stamp * 31 + (int64_t)fragmentInfo.st_size;
+
+	return(stamp);
+}
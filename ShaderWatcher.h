@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderwatcher.h
+// ============
+// watch the shader files of the programs and rebuild the programs whose
+// files were edited, while the application keeps running
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderWatcher
+ *
+ *  Poll() looks at the size and modification time of the
+ *  watched files at most every POLL_INTERVAL_MS, and builds
+ *  the programs of the changed files again through the
+ *  program cache.  A program that does not build keeps its
+ *  old program until its files change again, so a typo in a
+ *  shader never leaves the scene without a program.
+ *
+ *  The uniform locations of a replaced program are gone, so
+ *  the owner looks them up again whenever Poll() returns
+ *  true.
+ ***********************************************************/
+class ShaderWatcher
+{
+public:
+	// constructor
+	ShaderWatcher();
+
+	// time between two looks at the files
+	static const int POLL_INTERVAL_MS = 500;
+
+	// watch the files the program of a shader manager was built from,
+	// with the defines it was built with
+	void Watch(ShaderManager* pShader, const char* vertexShaderFile, const char* fragmentShaderFile, const std::string& defines = std::string());
+
+	// rebuild the programs whose files changed, true is returned when
+	// at least one program was replaced
+	bool Poll();
+
+private:
+	struct WATCHED_PROGRAM
+	{
+		ShaderManager* pShader;
+		std::string vertexShaderFile;
+		std::string fragmentShaderFile;
+		std::string defines;
+		// size and modification time of both files, combined
+		int64_t stamp;
+	};
+
+	std::vector<WATCHED_PROGRAM> m_programs;
+	std::chrono::steady_clock::time_point m_lastPoll;
+
+	// get the combined size and modification time of two files, 0
+	// when one of them can not be read
+	static int64_t GetStamp(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
+};
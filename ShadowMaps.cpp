@@ -0,0 +1,622 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmaps.cpp
+// ============
+// cascaded shadow maps for the directional light and a shadow map for the
+// spot light, with the depth of the static objects cached between frames
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowMaps.h"
+#include "ProgramCache.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// names of the uniforms in the depth shaders
+	const char* g_LightMatrixName = "lightMatrix";
+	const char* g_ModelName = "model";
+
+	// the cascades cover the view up to this distance, and split it
+	// between even and logarithmic steps by this share
+	const float g_ShadowDistance = 40.0f;
+	const float g_LogarithmicSplit = 0.75f;
+	// distance behind a cascade that objects still cast into it from
+	const float g_CasterReach = 50.0f;
+
+	// near plane of the spot light map, and its far plane when the
+	// attenuation of the light never fades out
+	const float g_SpotNearPlane = 0.1f;
+	const float g_SpotFarPlane = 50.0f;
+	// attenuation the spot light map reaches out to
+	const float g_SpotFadeOut = 256.0f;
+	// widening of the spot light map past the outer cone
+	const float g_SpotConeMargin = 1.1f;
+
+	// slope scaled and constant depth bias of the shadow passes
+	const float g_DepthBiasSlope = 2.0f;
+	const float g_DepthBiasUnits = 4.0f;
+
+	// depth compared outside of the maps, which is never in shadow
+	const GLfloat g_BorderDepth[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	/***********************************************************
+	 *  GetLightUp()
+	 *
+	 *  Get an up direction for looking along a light direction
+	 *  that is never parallel to it.
+	 ***********************************************************/
+	glm::vec3 GetLightUp(const glm::vec3& direction)
+	{
+		if (std::fabs(direction.y) > 0.99f)
+		{
+			return(glm::vec3(0.0f, 0.0f, 1.0f));
+		}
+		return(glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	/***********************************************************
+	 *  SnapToStep()
+	 *
+	 *  Round a value to the nearest whole number of steps.
+	 ***********************************************************/
+	float SnapToStep(float value, float step)
+	{
+		return(std::floor(value / step + 0.5f) * step);
+	}
+}
+
+/***********************************************************
+ *  ShadowMaps()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowMaps::ShadowMaps(int textureUnit)
+{
+	m_pNodeShader = NULL;
+	m_pInstancedShader = NULL;
+	m_nodeMatrixLocation = -1;
+	m_nodeModelLocation = -1;
+	m_instancedMatrixLocation = -1;
+	m_textureUnit = textureUnit;
+	m_filterQuality = FILTER_MEDIUM;
+	m_mapTexture = 0;
+	m_staticTexture = 0;
+	m_mapFramebuffer = 0;
+	m_staticFramebuffer = 0;
+	m_staticVersion = 0;
+	m_currentMap = 0;
+	m_targetFramebuffer = 0;
+	m_viewport[0] = 0;
+	m_viewport[1] = 0;
+	m_viewport[2] = 0;
+	m_viewport[3] = 0;
+
+	for (int i = 0; i < MAP_COUNT; i++)
+	{
+		m_bActive[i] = false;
+		m_matrices[i] = glm::mat4(1.0f);
+		m_bStaticValid[i] = false;
+		m_staticMatrices[i] = glm::mat4(1.0f);
+		m_staticVersions[i] = 0;
+		m_bMapStale[i] = false;
+	}
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		m_cascadeSplits[i] = 0.0f;
+	}
+
+	if (CreateMaps() == false)
+	{
+		DestroyMaps();
+	}
+}
+
+/***********************************************************
+ *  ~ShadowMaps()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowMaps::~ShadowMaps()
+{
+	DestroyMaps();
+	if (NULL != m_pNodeShader)
+	{
+		delete m_pNodeShader;
+		m_pNodeShader = NULL;
+	}
+	if (NULL != m_pInstancedShader)
+	{
+		delete m_pInstancedShader;
+		m_pInstancedShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  GetFilterTaps()
+ *
+ *  This method is used for getting the number of taps
+ *  across and down the shadows are filtered with.
+ ***********************************************************/
+int ShadowMaps::GetFilterTaps(FILTER_QUALITY quality)
+{
+	switch (quality)
+	{
+	case FILTER_HARD:
+		return(1);
+	case FILTER_LOW:
+		return(2);
+	case FILTER_MEDIUM:
+		return(3);
+	case FILTER_HIGH:
+		return(5);
+	default:
+		return(0);
+	}
+}
+
+/***********************************************************
+ *  ParseFilterQuality()
+ *
+ *  This method is used for finding the filter quality with
+ *  the passed in name.
+ ***********************************************************/
+bool ShadowMaps::ParseFilterQuality(const char* name, FILTER_QUALITY& quality)
+{
+	const char* names[FILTER_COUNT] = { "off", "hard", "low", "medium", "high" };
+
+	for (int i = 0; i < FILTER_COUNT; i++)
+	{
+		if (strcmp(name, names[i]) == 0)
+		{
+			quality = (FILTER_QUALITY)i;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for loading the depth only programs
+ *  the shadow passes draw with.
+ ***********************************************************/
+bool ShadowMaps::LoadShaders(const char* vertexShaderFile, const char* instancedVertexShaderFile, const char* fragmentShaderFile)
+{
+	if (NULL != m_pNodeShader)
+	{
+		delete m_pNodeShader;
+	}
+	if (NULL != m_pInstancedShader)
+	{
+		delete m_pInstancedShader;
+	}
+	m_pNodeShader = new ShaderManager();
+	ProgramCache::Load(m_pNodeShader, vertexShaderFile, fragmentShaderFile);
+	m_pInstancedShader = new ShaderManager();
+	ProgramCache::Load(m_pInstancedShader, instancedVertexShaderFile, fragmentShaderFile);
+	if ((0 == m_pNodeShader->m_programID) || (0 == m_pInstancedShader->m_programID))
+	{
+		std::cout << "Could not load the shadow depth shaders" << std::endl;
+		delete m_pNodeShader;
+		m_pNodeShader = NULL;
+		delete m_pInstancedShader;
+		m_pInstancedShader = NULL;
+		return(false);
+	}
+
+	m_nodeMatrixLocation = glGetUniformLocation(m_pNodeShader->m_programID, g_LightMatrixName);
+	m_nodeModelLocation = glGetUniformLocation(m_pNodeShader->m_programID, g_ModelName);
+	m_instancedMatrixLocation = glGetUniformLocation(m_pInstancedShader->m_programID, g_LightMatrixName);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateMaps()
+ *
+ *  This method is used for creating the sampled and the
+ *  cached depth texture arrays.  The sampled maps compare
+ *  with linear filtering, and report everything past their
+ *  edges as lit.
+ ***********************************************************/
+bool ShadowMaps::CreateMaps()
+{
+	GLuint* textures[2] = { &m_mapTexture, &m_staticTexture };
+	GLuint* framebuffers[2] = { &m_mapFramebuffer, &m_staticFramebuffer };
+
+	for (int i = 0; i < 2; i++)
+	{
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, *textures[i]);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, MAP_SIZE, MAP_SIZE, MAP_COUNT, 0,
+			GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, (i == 0) ? GL_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, (i == 0) ? GL_LINEAR : GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, g_BorderDepth);
+		if (i == 0)
+		{
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		}
+
+		glGenFramebuffers(1, framebuffers[i]);
+		glBindFramebuffer(GL_FRAMEBUFFER, *framebuffers[i]);
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, *textures[i], 0, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (bComplete == false)
+		{
+			std::cout << "Could not create the shadow map framebuffer" << std::endl;
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+			return(false);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyMaps()
+ *
+ *  This method is used for freeing the texture arrays and
+ *  their framebuffers.
+ ***********************************************************/
+void ShadowMaps::DestroyMaps()
+{
+	if (0 != m_mapFramebuffer)
+	{
+		glDeleteFramebuffers(1, &m_mapFramebuffer);
+		m_mapFramebuffer = 0;
+	}
+	if (0 != m_staticFramebuffer)
+	{
+		glDeleteFramebuffers(1, &m_staticFramebuffer);
+		m_staticFramebuffer = 0;
+	}
+	if (0 != m_mapTexture)
+	{
+		glDeleteTextures(1, &m_mapTexture);
+		m_mapTexture = 0;
+	}
+	if (0 != m_staticTexture)
+	{
+		glDeleteTextures(1, &m_staticTexture);
+		m_staticTexture = 0;
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for fitting the maps of the active
+ *  lights to the camera of the frame.  Lights without a
+ *  direction cast no shadows.
+ ***********************************************************/
+void ShadowMaps::Update(const UniformBuffers::LIGHT_BLOCK& lights, const glm::mat4& view, const glm::mat4& projection, unsigned int staticVersion)
+{
+	const UniformBuffers::DIRECTIONAL_LIGHT& sun = lights.directionalLight;
+	const UniformBuffers::SPOT_LIGHT& spotLight = lights.spotLight;
+	bool bShadows = (m_filterQuality != FILTER_OFF) && (IsAvailable() == true);
+	bool bSun = bShadows && (sun.bActive != 0) && (glm::length(sun.direction) > 0.0f);
+	bool bSpot = bShadows && (spotLight.bActive != 0) && (glm::length(spotLight.direction) > 0.0f);
+
+	m_staticVersion = staticVersion;
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		m_bActive[i] = bSun;
+	}
+	m_bActive[SPOT_MAP] = bSpot;
+
+	if (bSun == true)
+	{
+		FitCascades(glm::normalize(sun.direction), view, projection);
+	}
+	if (bSpot == true)
+	{
+		FitSpotLight(spotLight);
+	}
+}
+
+/***********************************************************
+ *  FitCascades()
+ *
+ *  This method is used for splitting the view into the depth
+ *  ranges of the cascades and fitting a map around each.  A
+ *  cascade is sized to the sphere around its slice of the
+ *  view, which does not change with the camera direction,
+ *  and its center is snapped to steps of CACHE_SNAP_TEXELS
+ *  texels in light space.  The map covers one more step on
+ *  every side than the sphere, so the slice stays inside it
+ *  in between steps.
+ ***********************************************************/
+void ShadowMaps::FitCascades(const glm::vec3& lightDirection, const glm::mat4& view, const glm::mat4& projection)
+{
+	float nearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+	float farPlane = std::min(projection[3][2] / (projection[2][2] + 1.0f), g_ShadowDistance);
+	// squared slope of the frustum corners away from the view axis
+	float tanX = 1.0f / projection[0][0];
+	float tanY = 1.0f / projection[1][1];
+	float cornerSlope = tanX * tanX + tanY * tanY;
+
+	glm::mat4 inverseView = glm::inverse(view);
+	glm::vec3 up = GetLightUp(lightDirection);
+	glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), lightDirection, up);
+	glm::mat4 inverseRotation = glm::transpose(lightRotation);
+	float sliceNear = nearPlane;
+
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		float share = (float)(i + 1) / (float)CASCADE_COUNT;
+		float logSplit = nearPlane * std::pow(farPlane / nearPlane, share);
+		float evenSplit = nearPlane + (farPlane - nearPlane) * share;
+		float sliceFar = g_LogarithmicSplit * logSplit + (1.0f - g_LogarithmicSplit) * evenSplit;
+		m_cascadeSplits[i] = sliceFar;
+
+		// the center along the view axis that is as far from the near
+		// corners as from the far corners, or the far plane when the
+		// far corners alone set the size
+		float centerDepth = std::min(0.5f * (sliceNear + sliceFar) * (1.0f + cornerSlope), sliceFar);
+		float nearOffset = centerDepth - sliceNear;
+		float radius = std::sqrt(sliceNear * sliceNear * cornerSlope + nearOffset * nearOffset);
+		radius = std::max(radius, std::sqrt(sliceFar * sliceFar * cornerSlope +
+			(sliceFar - centerDepth) * (sliceFar - centerDepth)));
+
+		// the step is CACHE_SNAP_TEXELS texels of a map covering the
+		// radius and one more step
+		float step = 2.0f * CACHE_SNAP_TEXELS * radius / (float)(MAP_SIZE - 2 * CACHE_SNAP_TEXELS);
+		float halfSize = radius + step;
+
+		glm::vec3 center = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+		glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+		lightCenter = glm::vec3(
+			SnapToStep(lightCenter.x, step),
+			SnapToStep(lightCenter.y, step),
+			SnapToStep(lightCenter.z, step));
+		center = glm::vec3(inverseRotation * glm::vec4(lightCenter, 1.0f));
+
+		glm::vec3 eye = center - lightDirection * (halfSize + g_CasterReach);
+		glm::mat4 lightView = glm::lookAt(eye, center, up);
+		glm::mat4 lightProjection = glm::ortho(-halfSize, halfSize, -halfSize, halfSize,
+			0.0f, 2.0f * halfSize + g_CasterReach);
+		m_matrices[i] = lightProjection * lightView;
+
+		sliceNear = sliceFar;
+	}
+}
+
+/***********************************************************
+ *  FitSpotLight()
+ *
+ *  This method is used for fitting the spot light map to a
+ *  perspective around the outer cone of the light, reaching
+ *  as far as the attenuation leaves any light.
+ ***********************************************************/
+void ShadowMaps::FitSpotLight(const UniformBuffers::SPOT_LIGHT& spotLight)
+{
+	float farPlane = g_SpotFarPlane;
+	if (spotLight.quadratic > 0.0f)
+	{
+		float c = spotLight.constant - g_SpotFadeOut;
+		farPlane = (-spotLight.linear + std::sqrt(spotLight.linear * spotLight.linear - 4.0f * spotLight.quadratic * c)) /
+			(2.0f * spotLight.quadratic);
+	}
+	else if (spotLight.linear > 0.0f)
+	{
+		farPlane = (g_SpotFadeOut - spotLight.constant) / spotLight.linear;
+	}
+	farPlane = std::max(farPlane, 2.0f * g_SpotNearPlane);
+
+	float cone = std::acos(glm::clamp(spotLight.outerCutOff, 0.0f, 1.0f));
+	float fieldOfView = std::min(2.0f * cone * g_SpotConeMargin, glm::radians(170.0f));
+	glm::vec3 direction = glm::normalize(spotLight.direction);
+	glm::mat4 lightView = glm::lookAt(spotLight.position, spotLight.position + direction, GetLightUp(direction));
+
+	m_matrices[SPOT_MAP] = glm::perspective(fieldOfView, 1.0f, g_SpotNearPlane, farPlane) * lightView;
+}
+
+/***********************************************************
+ *  IsStaticCached()
+ *
+ *  This method is used for checking whether the static cache
+ *  of a map was drawn with the matrix of this frame and the
+ *  static objects the scene has now.
+ ***********************************************************/
+bool ShadowMaps::IsStaticCached(int map) const
+{
+	return((m_bStaticValid[map] == true) &&
+		(m_staticVersions[map] == m_staticVersion) &&
+		(m_staticMatrices[map] == m_matrices[map]));
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for starting the shadow passes of the
+ *  frame.  The depth bias is applied while drawing the maps,
+ *  so lit surfaces do not shadow themselves.
+ ***********************************************************/
+bool ShadowMaps::Begin()
+{
+	bool bActive = false;
+	for (int i = 0; i < MAP_COUNT; i++)
+	{
+		bActive = bActive || m_bActive[i];
+	}
+	if (bActive == false)
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_targetFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_viewport);
+	glViewport(0, 0, MAP_SIZE, MAP_SIZE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(g_DepthBiasSlope, g_DepthBiasUnits);
+	glDepthMask(GL_TRUE);
+
+	return(true);
+}
+
+/***********************************************************
+ *  BindLayer()
+ *
+ *  This method is used for attaching a layer of a texture
+ *  array to its framebuffer and drawing into it.
+ ***********************************************************/
+void ShadowMaps::BindLayer(GLuint framebuffer, GLuint texture, int map)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, map);
+	m_currentMap = map;
+}
+
+/***********************************************************
+ *  BeginStaticPass()
+ *
+ *  This method is used for clearing the static cache of a
+ *  map for drawing the static objects into it.  The cache is
+ *  valid for this matrix from here on.
+ ***********************************************************/
+void ShadowMaps::BeginStaticPass(int map)
+{
+	BindLayer(m_staticFramebuffer, m_staticTexture, map);
+	glClear(GL_DEPTH_BUFFER_BIT);
+
+	m_bStaticValid[map] = true;
+	m_staticMatrices[map] = m_matrices[map];
+	m_staticVersions[map] = m_staticVersion;
+	m_bMapStale[map] = true;
+}
+
+/***********************************************************
+ *  BeginDynamicPass()
+ *
+ *  This method is used for bringing the sampled map back to
+ *  the cached static depth, and pointing the following draws
+ *  at it when there are dynamic objects to draw.  A map that
+ *  is already a copy of the cache is not copied again.
+ ***********************************************************/
+bool ShadowMaps::BeginDynamicPass(int map, bool bDynamicCasters)
+{
+	if (m_bMapStale[map] == true)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_staticFramebuffer);
+		glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_staticTexture, 0, map);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_mapFramebuffer);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_mapTexture, 0, map);
+		glBlitFramebuffer(0, 0, MAP_SIZE, MAP_SIZE, 0, 0, MAP_SIZE, MAP_SIZE, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		m_bMapStale[map] = false;
+	}
+	if (bDynamicCasters == false)
+	{
+		return(false);
+	}
+
+	// the dynamic depth has to be copied over next frame
+	BindLayer(m_mapFramebuffer, m_mapTexture, map);
+	m_bMapStale[map] = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for finishing the shadow passes and
+ *  going back to the framebuffer the scene is drawn into.
+ ***********************************************************/
+void ShadowMaps::End()
+{
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_targetFramebuffer);
+	glViewport(m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3]);
+}
+
+/***********************************************************
+ *  UseNodeProgram()
+ *
+ *  This method is used for switching to the depth program
+ *  for the scene nodes, set to the map being drawn.
+ ***********************************************************/
+void ShadowMaps::UseNodeProgram()
+{
+	m_pNodeShader->use();
+	glUniformMatrix4fv(m_nodeMatrixLocation, 1, GL_FALSE, &m_matrices[m_currentMap][0][0]);
+}
+
+/***********************************************************
+ *  UseInstancedProgram()
+ *
+ *  This method is used for switching to the depth program
+ *  for the instanced meshes, set to the map being drawn.
+ ***********************************************************/
+void ShadowMaps::UseInstancedProgram()
+{
+	m_pInstancedShader->use();
+	glUniformMatrix4fv(m_instancedMatrixLocation, 1, GL_FALSE, &m_matrices[m_currentMap][0][0]);
+}
+
+/***********************************************************
+ *  SetModel()
+ *
+ *  This method is used for setting the model matrix of the
+ *  next scene node drawn with the node depth program.
+ ***********************************************************/
+void ShadowMaps::SetModel(const glm::mat4& model)
+{
+	glUniformMatrix4fv(m_nodeModelLocation, 1, GL_FALSE, &model[0][0]);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding the sampled maps to the
+ *  texture unit of the shadows.
+ ***********************************************************/
+void ShadowMaps::Bind() const
+{
+	glActiveTexture(GL_TEXTURE0 + m_textureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_mapTexture);
+}
+
+/***********************************************************
+ *  GetShadowBlock()
+ *
+ *  This method is used for getting the values the shaders
+ *  look up the shadows with.  A light whose maps were not
+ *  drawn this frame is reported without shadows.
+ ***********************************************************/
+UniformBuffers::SHADOW_BLOCK ShadowMaps::GetShadowBlock() const
+{
+	UniformBuffers::SHADOW_BLOCK shadows = UniformBuffers::SHADOW_BLOCK();
+
+	for (int i = 0; i < MAP_COUNT; i++)
+	{
+		shadows.matrices[i] = m_matrices[i];
+	}
+	for (int i = 0; i < CASCADE_COUNT; i++)
+	{
+		shadows.cascadeSplits[i] = m_cascadeSplits[i];
+	}
+	shadows.settings = glm::ivec4(
+		GetFilterTaps(m_filterQuality),
+		m_bActive[0] ? 1 : 0,
+		m_bActive[SPOT_MAP] ? 1 : 0,
+		0);
+
+	return(shadows);
+}
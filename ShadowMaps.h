@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmaps.h
+// ============
+// cascaded shadow maps for the directional light and a shadow map for the
+// spot light, with the depth of the static objects cached between frames
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "UniformBuffers.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ShadowMaps
+ *
+ *  The maps are the layers of one depth texture array: a
+ *  cascade for each of the depth ranges the view is split
+ *  into for the directional light, then the spot light.
+ *
+ *  Each map is drawn in two passes.  The static pass draws
+ *  the objects that never move into a second texture array
+ *  that is kept between frames, and only runs again when the
+ *  map moves or the static objects change.  The dynamic pass
+ *  copies the cached depth into the sampled map and draws
+ *  the moving objects over it; when no moving object reaches
+ *  the map the copy is left as it is.
+ *
+ *  A cascade only moves when the camera has moved a step of
+ *  CACHE_SNAP_TEXELS texels, and covers that step past its
+ *  slice of the view, so a slowly moving camera keeps the
+ *  static cascades for many frames.  Snapping to whole texels
+ *  also keeps the shadow edges from crawling.
+ *
+ *  The shaders compare against the maps through a shadow
+ *  sampler with linear filtering, so every tap already blends
+ *  four texels.  The filter quality sets how many taps across
+ *  and down are averaged.
+ ***********************************************************/
+class ShadowMaps
+{
+public:
+	// constructor, the maps are sampled from the passed in unit
+	ShadowMaps(int textureUnit);
+	// destructor
+	~ShadowMaps();
+
+	// layers of the map array
+	static const int CASCADE_COUNT = UniformBuffers::SHADOW_CASCADES;
+	static const int MAP_COUNT = UniformBuffers::SHADOW_MAPS;
+	static const int SPOT_MAP = CASCADE_COUNT;
+	// texels across and down every map
+	static const int MAP_SIZE = 2048;
+	// texels a cascade moves by at once
+	static const int CACHE_SNAP_TEXELS = 64;
+
+	// filter taps the shadows are sampled with, from the cheapest
+	enum FILTER_QUALITY
+	{
+		FILTER_OFF = 0,		// no shadow passes and no shadows
+		FILTER_HARD,		// 1 tap
+		FILTER_LOW,			// 2 x 2 taps
+		FILTER_MEDIUM,		// 3 x 3 taps
+		FILTER_HIGH,		// 5 x 5 taps
+		FILTER_COUNT
+	};
+
+	// taps across and down a filter quality samples
+	static int GetFilterTaps(FILTER_QUALITY quality);
+	// find a filter quality by its name, "off", "hard", "low",
+	// "medium" or "high", false is returned for other names
+	static bool ParseFilterQuality(const char* name, FILTER_QUALITY& quality);
+
+	// compile the depth programs for the scene nodes and for the
+	// instanced meshes, which share the fragment shader
+	bool LoadShaders(const char* vertexShaderFile, const char* instancedVertexShaderFile, const char* fragmentShaderFile);
+	// false once the programs or the maps could not be created
+	bool IsAvailable() const { return((NULL != m_pNodeShader) && (NULL != m_pInstancedShader) && (0 != m_mapTexture)); }
+
+	void SetFilterQuality(FILTER_QUALITY quality) { m_filterQuality = quality; }
+	FILTER_QUALITY GetFilterQuality() const { return(m_filterQuality); }
+
+	// fit the maps to the lights and the camera of the frame, the
+	// static version of the scene graph tells when the static depth
+	// has to be drawn again
+	void Update(const UniformBuffers::LIGHT_BLOCK& lights, const glm::mat4& view, const glm::mat4& projection, unsigned int staticVersion);
+
+	// whether a map is drawn this frame, valid after Update()
+	bool IsMapActive(int map) const { return(m_bActive[map]); }
+	// whether the cached static depth of a map is still valid
+	bool IsStaticCached(int map) const;
+	// world space to map clip space matrix of a map
+	const glm::mat4& GetLightMatrix(int map) const { return(m_matrices[map]); }
+
+	// start drawing the shadow maps of the frame, false is returned
+	// and nothing is changed when no map is drawn
+	bool Begin();
+	// draw the following draws into the static cache of a map
+	void BeginStaticPass(int map);
+	// copy the static cache into the sampled map when needed, and
+	// draw the following draws over it when there are dynamic
+	// objects to draw, which returns true
+	bool BeginDynamicPass(int map, bool bDynamicCasters);
+	// go back to the framebuffer and viewport bound at Begin()
+	void End();
+
+	// switch to the depth program for the scene nodes, or for the
+	// instanced meshes, with the matrix of the map being drawn
+	void UseNodeProgram();
+	void UseInstancedProgram();
+	// set the model matrix of the next node draw
+	void SetModel(const glm::mat4& model);
+
+	// bind the sampled maps to their texture unit
+	void Bind() const;
+	int GetTextureUnit() const { return(m_textureUnit); }
+
+	// the shadow block values, valid after Update()
+	UniformBuffers::SHADOW_BLOCK GetShadowBlock() const;
+
+private:
+	ShaderManager* m_pNodeShader;
+	ShaderManager* m_pInstancedShader;
+	GLint m_nodeMatrixLocation;
+	GLint m_nodeModelLocation;
+	GLint m_instancedMatrixLocation;
+	int m_textureUnit;
+	FILTER_QUALITY m_filterQuality;
+
+	// the sampled maps and the cached static depth, with a
+	// framebuffer for drawing into a layer of each
+	GLuint m_mapTexture;
+	GLuint m_staticTexture;
+	GLuint m_mapFramebuffer;
+	GLuint m_staticFramebuffer;
+
+	// fitted this frame
+	bool m_bActive[MAP_COUNT];
+	glm::mat4 m_matrices[MAP_COUNT];
+	float m_cascadeSplits[CASCADE_COUNT];
+	unsigned int m_staticVersion;
+	// what the static cache of each map was drawn with
+	bool m_bStaticValid[MAP_COUNT];
+	glm::mat4 m_staticMatrices[MAP_COUNT];
+	unsigned int m_staticVersions[MAP_COUNT];
+	// true while a sampled map is not a copy of its static cache
+	bool m_bMapStale[MAP_COUNT];
+	// map the depth programs draw into
+	int m_currentMap;
+
+	// framebuffer and viewport to go back to
+	GLint m_targetFramebuffer;
+	GLint m_viewport[4];
+
+	// create the texture arrays and their framebuffers, false is
+	// returned when the framebuffers are not complete
+	bool CreateMaps();
+	// free the texture arrays and their framebuffers
+	void DestroyMaps();
+	// fit the cascades around the slices of the view
+	void FitCascades(const glm::vec3& lightDirection, const glm::mat4& view, const glm::mat4& projection);
+	// fit the spot light map to the cone of the light
+	void FitSpotLight(const UniformBuffers::SPOT_LIGHT& spotLight);
+	// point the framebuffer at a layer and set up the depth drawing
+	void BindLayer(GLuint framebuffer, GLuint texture, int map);
+};
@@ -0,0 +1,334 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.cpp
+// ============
+// pack loaded textures that share a size and format into texture arrays, so
+// draws using different textures can be batched without rebinding
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureArrays.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// layers allocated when an array is first created
+	const GLint g_InitialLayerCapacity = 4;
+}
+
+/***********************************************************
+ *  TextureArrays()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureArrays::TextureArrays()
+{
+}
+
+/***********************************************************
+ *  ~TextureArrays()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureArrays::~TextureArrays()
+{
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		glDeleteTextures(1, &m_arrays[i].textureID);
+	}
+	m_arrays.clear();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the current GL
+ *  context supports the immutable storage and image copies
+ *  that the arrays are built with.
+ ***********************************************************/
+bool TextureArrays::IsSupported()
+{
+	return((GLEW_ARB_texture_storage && GLEW_ARB_copy_image) ? true : false);
+}
+
+/***********************************************************
+ *  CreateStorage()
+ *
+ *  This method is used for allocating the immutable storage
+ *  of an array texture.  The sampling parameters match the
+ *  ones used for the scene textures.
+ ***********************************************************/
+GLuint TextureArrays::CreateStorage(const TEXTURE_ARRAY& textureArray, GLint layerCapacity)
+{
+	GLuint textureID = 0;
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glTexStorage3D(
+		GL_TEXTURE_2D_ARRAY,
+		textureArray.levels,
+		(GLenum)textureArray.internalFormat,
+		textureArray.width,
+		textureArray.height,
+		layerCapacity);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return(textureID);
+}
+
+/***********************************************************
+ *  Grow()
+ *
+ *  This method is used for doubling the layer capacity of an
+ *  array.  The existing layers are copied on the GPU.
+ ***********************************************************/
+void TextureArrays::Grow(TEXTURE_ARRAY& textureArray)
+{
+	GLint layerCapacity = textureArray.layerCapacity * 2;
+	GLuint textureID = CreateStorage(textureArray, layerCapacity);
+
+	for (GLint level = 0; level < textureArray.levels; level++)
+	{
+		glCopyImageSubData(
+			textureArray.textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+			std::max(textureArray.width >> level, 1),
+			std::max(textureArray.height >> level, 1),
+			textureArray.layerCount);
+	}
+
+	glDeleteTextures(1, &textureArray.textureID);
+	textureArray.textureID = textureID;
+	textureArray.layerCapacity = layerCapacity;
+}
+
+/***********************************************************
+ *  FindArray()
+ *
+ *  This method is used for finding the array that holds the
+ *  textures of the passed in size, format and mip count, and
+ *  making sure it has a free layer.  A new array is started
+ *  when there is none yet.
+ ***********************************************************/
+size_t TextureArrays::FindArray(const TEXTURE_ARRAY& format)
+{
+	size_t arrayIndex = 0;
+	while ((arrayIndex < m_arrays.size()) &&
+		   ((m_arrays[arrayIndex].width != format.width) ||
+			(m_arrays[arrayIndex].height != format.height) ||
+			(m_arrays[arrayIndex].internalFormat != format.internalFormat) ||
+			(m_arrays[arrayIndex].levels != format.levels)))
+	{
+		arrayIndex++;
+	}
+	if (arrayIndex == m_arrays.size())
+	{
+		TEXTURE_ARRAY textureArray = format;
+		textureArray.layerCount = 0;
+		textureArray.layerCapacity = g_InitialLayerCapacity;
+		textureArray.textureID = CreateStorage(textureArray, textureArray.layerCapacity);
+		m_arrays.push_back(textureArray);
+	}
+
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+	if (textureArray.layerCount == textureArray.layerCapacity)
+	{
+		Grow(textureArray);
+	}
+
+	return(arrayIndex);
+}
+
+/***********************************************************
+ *  SetLayer()
+ *
+ *  This method is used for recording the array and layer the
+ *  texture of a slot was added to.
+ ***********************************************************/
+void TextureArrays::SetLayer(int textureSlot, int arrayIndex, int layer)
+{
+	if (textureSlot >= (int)m_layers.size())
+	{
+		TEXTURE_LAYER none;
+		none.arrayIndex = -1;
+		none.layer = -1;
+		m_layers.resize(textureSlot + 1, none);
+	}
+	m_layers[textureSlot].arrayIndex = arrayIndex;
+	m_layers[textureSlot].layer = layer;
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for copying every mip level of the
+ *  texture bound to GL_TEXTURE_2D into the next free layer
+ *  of the array matching its size, format and mip count.
+ ***********************************************************/
+bool TextureArrays::AddTexture(int textureSlot, GLuint textureID)
+{
+	TEXTURE_ARRAY format;
+
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &format.width);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &format.height);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format.internalFormat);
+	if ((format.width <= 0) || (format.height <= 0))
+	{
+		return(false);
+	}
+
+	// count the defined mip levels and their bytes, cached compressed
+	// textures can stop before reaching 1x1
+	GLint compressed = GL_FALSE;
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &compressed);
+	format.levels = 0;
+	format.layerBytes = 0;
+	for (int size = std::max(format.width, format.height); ; size >>= 1)
+	{
+		GLint levelWidth = 0;
+		GLint levelHeight = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, format.levels, GL_TEXTURE_WIDTH, &levelWidth);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, format.levels, GL_TEXTURE_HEIGHT, &levelHeight);
+		if ((levelWidth <= 0) || (levelHeight <= 0))
+		{
+			break;
+		}
+
+		if (compressed == GL_TRUE)
+		{
+			GLint levelBytes = 0;
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, format.levels, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &levelBytes);
+			format.layerBytes += (size_t)levelBytes;
+		}
+		else
+		{
+			// drivers store RGB8 texels in 4 bytes as well
+			format.layerBytes += (size_t)levelWidth * levelHeight * 4;
+		}
+		format.levels++;
+
+		if (size <= 1)
+		{
+			break;
+		}
+	}
+
+	size_t arrayIndex = FindArray(format);
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+
+	GLint layer = textureArray.layerCount++;
+	for (GLint level = 0; level < textureArray.levels; level++)
+	{
+		glCopyImageSubData(
+			textureID, GL_TEXTURE_2D, level, 0, 0, 0,
+			textureArray.textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+			std::max(textureArray.width >> level, 1),
+			std::max(textureArray.height >> level, 1),
+			1);
+	}
+	SetLayer(textureSlot, (int)arrayIndex, layer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddChain()
+ *
+ *  This method is used for uploading every level of a
+ *  compressed mip chain straight into the next free layer of
+ *  the array matching its size, format and mip count, so no
+ *  2D texture has to hold the whole chain to copy it from.
+ ***********************************************************/
+bool TextureArrays::AddChain(int textureSlot, const TextureCache::COMPRESSED_IMAGE& chain)
+{
+	if (chain.levels.empty() == true)
+	{
+		return(false);
+	}
+
+	TEXTURE_ARRAY format;
+	format.width = chain.levels[0].width;
+	format.height = chain.levels[0].height;
+	format.internalFormat = (GLint)chain.internalFormat;
+	format.levels = (GLint)chain.levels.size();
+	format.layerBytes = TextureCache::GetChainBytes(chain);
+
+	size_t arrayIndex = FindArray(format);
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+
+	GLint layer = textureArray.layerCount++;
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray.textureID);
+	for (GLint level = 0; level < textureArray.levels; level++)
+	{
+		glCompressedTexSubImage3D(
+			GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+			chain.levels[level].width,
+			chain.levels[level].height,
+			1,
+			chain.internalFormat,
+			(GLsizei)chain.levels[level].data.size(),
+			chain.levels[level].data.data());
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	SetLayer(textureSlot, (int)arrayIndex, layer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetAllocatedBytes()
+ *
+ *  This method is used for adding up the video memory of the
+ *  arrays, counting every allocated layer whether it is used
+ *  yet or not.
+ ***********************************************************/
+size_t TextureArrays::GetAllocatedBytes() const
+{
+	size_t bytes = 0;
+
+	for (size_t i = 0; i < m_arrays.size(); i++)
+	{
+		bytes += m_arrays[i].layerBytes * (size_t)m_arrays[i].layerCapacity;
+	}
+
+	return(bytes);
+}
+
+/***********************************************************
+ *  GetArray()
+ *
+ *  This method is used for getting the array that holds the
+ *  texture of the passed in slot.
+ ***********************************************************/
+int TextureArrays::GetArray(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= (int)m_layers.size()))
+	{
+		return(-1);
+	}
+	return(m_layers[textureSlot].arrayIndex);
+}
+
+/***********************************************************
+ *  GetLayer()
+ *
+ *  This method is used for getting the array layer that holds
+ *  the texture of the passed in slot.
+ ***********************************************************/
+int TextureArrays::GetLayer(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= (int)m_layers.size()))
+	{
+		return(-1);
+	}
+	return(m_layers[textureSlot].layer);
+}
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.h
+// ============
+// pack loaded textures that share a size and format into texture arrays, so
+// draws using different textures can be batched without rebinding
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+#include <vector>
+
+/***********************************************************
+ *  TextureArrays
+ *
+ *  Every texture added is copied, with all of its mip levels,
+ *  into a layer of the GL_TEXTURE_2D_ARRAY holding textures
+ *  of the same size, internal format and mip count.  An array grows by
+ *  doubling its layer count when it is full.  A shader then
+ *  samples any of those textures through one sampler, picked
+ *  by a layer index that can come with each instance.
+ *
+ *  The layers always hold the whole chain, so the memory of
+ *  the arrays is reported for the texture budget to count.
+ ***********************************************************/
+class TextureArrays
+{
+public:
+	// constructor
+	TextureArrays();
+	// destructor
+	~TextureArrays();
+
+	// check whether the GL context can build the arrays
+	static bool IsSupported();
+
+	// copy the texture bound to GL_TEXTURE_2D into an array layer,
+	// recorded against the passed in texture slot
+	bool AddTexture(int textureSlot, GLuint textureID);
+	// upload a compressed mip chain into an array layer, recorded
+	// against the passed in texture slot
+	bool AddChain(int textureSlot, const TextureCache::COMPRESSED_IMAGE& chain);
+
+	// get the array and layer a texture slot was copied to, -1
+	// when the texture is not in an array
+	int GetArray(int textureSlot) const;
+	int GetLayer(int textureSlot) const;
+	// get the GL texture of an array
+	GLuint GetArrayTexture(int arrayIndex) const { return(m_arrays[arrayIndex].textureID); }
+	// video memory allocated for the layers of every array
+	size_t GetAllocatedBytes() const;
+
+private:
+	struct TEXTURE_ARRAY
+	{
+		GLuint textureID;
+		GLint internalFormat;
+		GLint width;
+		GLint height;
+		GLint levels;
+		GLint layerCount;
+		GLint layerCapacity;
+		// bytes of the whole mip chain of one layer
+		size_t layerBytes;
+	};
+
+	struct TEXTURE_LAYER
+	{
+		int arrayIndex;
+		int layer;
+	};
+
+	std::vector<TEXTURE_ARRAY> m_arrays;
+	// array layer of each texture slot
+	std::vector<TEXTURE_LAYER> m_layers;
+
+	// allocate an array texture with room for the passed in layers
+	static GLuint CreateStorage(const TEXTURE_ARRAY& textureArray, GLint layerCapacity);
+	// double the layer capacity of an array, keeping its layers
+	void Grow(TEXTURE_ARRAY& textureArray);
+	// get the array matching the passed in size, format and mip
+	// count with a free layer, creating or growing it as needed
+	size_t FindArray(const TEXTURE_ARRAY& format);
+	// record the array layer a texture slot was added to
+	void SetLayer(int textureSlot, int arrayIndex, int layer);
+};
@@ -0,0 +1,359 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.cpp
+// ============
+// store block-compressed, pre-mipmapped copies of texture images on disk so
+// later launches can skip the image decode and mipmap generation
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+// declaration of global variables
+namespace
+{
+	// cache files sit next to the source image with this extension
+	const char* g_CacheExtension = ".texcache";
+
+	// identifies the cache file layout, bump the version on change
+	const uint32_t g_CacheMagic = 0x31435854;	// "TXC1"
+	const uint32_t g_CacheVersion = 1;
+
+	// S3TC formats, not part of the core GL headers
+	const GLenum g_FormatBC1 = 0x83F0;			// GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+	const GLenum g_FormatBC3 = 0x83F3;			// GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+
+	// bytes of one 4x4 block in each format
+	const uint32_t g_BlockBytesBC1 = 8;
+	const uint32_t g_BlockBytesBC3 = 16;
+	// largest first level and most levels a chain can have
+	const uint32_t g_MaxLevelSize = 32768;
+	const uint32_t g_MaxLevelCount = 16;
+
+	// fixed size header written at the start of every cache file
+	struct CACHE_HEADER
+	{
+		uint32_t magic;
+		uint32_t version;
+		int64_t sourceModifiedTime;
+		int64_t sourceFileSize;
+		uint32_t internalFormat;
+		uint32_t levelCount;
+	};
+
+	// written before the data of each mip level
+	struct LEVEL_HEADER
+	{
+		uint32_t width;
+		uint32_t height;
+		uint32_t byteSize;
+		uint32_t reserved;
+	};
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the current GL
+ *  context supports the S3TC formats the cache stores.
+ ***********************************************************/
+bool TextureCache::IsSupported()
+{
+	return(GLEW_EXT_texture_compression_s3tc ? true : false);
+}
+
+/***********************************************************
+ *  GetCompressedFormat()
+ *
+ *  This method is used for getting the block compressed
+ *  internal format to store an image with.
+ ***********************************************************/
+GLenum TextureCache::GetCompressedFormat(int colorChannels)
+{
+	// BC1 packs opaque color at 4 bits per texel, images with an
+	// alpha channel need BC3 to keep their transparency
+	if (colorChannels == 4)
+	{
+		return(g_FormatBC3);
+	}
+	return(g_FormatBC1);
+}
+
+/***********************************************************
+ *  GetChainBytes()
+ *
+ *  This method is used for adding up the bytes of the levels
+ *  of a compressed mip chain.
+ ***********************************************************/
+size_t TextureCache::GetChainBytes(const COMPRESSED_IMAGE& image)
+{
+	size_t bytes = 0;
+
+	for (size_t i = 0; i < image.levels.size(); i++)
+	{
+		bytes += image.levels[i].data.size();
+	}
+
+	return(bytes);
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for getting the cache file path for
+ *  the passed in image file.
+ ***********************************************************/
+std::string TextureCache::GetCachePath(const std::string& filename)
+{
+	return(filename + g_CacheExtension);
+}
+
+/***********************************************************
+ *  GetSourceStamp()
+ *
+ *  This method is used for reading the size and modification
+ *  time of an image file, which together key its cache file.
+ ***********************************************************/
+bool TextureCache::GetSourceStamp(const std::string& filename, int64_t& modifiedTime, int64_t& fileSize)
+{
+	struct stat fileInfo;
+
+	if (stat(filename.c_str(), &fileInfo) != 0)
+	{
+		return(false);
+	}
+
+	modifiedTime = (int64_t)fileInfo.st_mtime;
+	fileSize = (int64_t)fileInfo.st_size;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for reading the compressed mip chain
+ *  of an image from its cache file.  False is returned if
+ *  there is no cache file, if it is out of date, or if it
+ *  does not hold a chain in one of the cached formats with
+ *  each level half the size of the one before.
+ ***********************************************************/
+bool TextureCache::Load(const std::string& filename, COMPRESSED_IMAGE& image)
+{
+	int64_t modifiedTime = 0;
+	int64_t fileSize = 0;
+
+	if (GetSourceStamp(filename, modifiedTime, fileSize) == false)
+	{
+		return(false);
+	}
+
+	std::ifstream cacheFile(GetCachePath(filename).c_str(), std::ios::binary);
+	if (!cacheFile)
+	{
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	cacheFile.read((char*)&header, sizeof(header));
+	if (!cacheFile ||
+		(header.magic != g_CacheMagic) ||
+		(header.version != g_CacheVersion) ||
+		(header.sourceModifiedTime != modifiedTime) ||
+		(header.sourceFileSize != fileSize) ||
+		((header.internalFormat != g_FormatBC1) && (header.internalFormat != g_FormatBC3)) ||
+		(header.levelCount == 0) ||
+		(header.levelCount > g_MaxLevelCount))
+	{
+		return(false);
+	}
+	uint32_t blockBytes = (header.internalFormat == g_FormatBC1) ? g_BlockBytesBC1 : g_BlockBytesBC3;
+
+	// the levels must fit in the rest of the file, so a truncated file
+	// is caught before its data is allocated
+	std::streamoff dataStart = cacheFile.tellg();
+	cacheFile.seekg(0, std::ios::end);
+	uint64_t cacheSize = (uint64_t)cacheFile.tellg();
+	cacheFile.seekg(dataStart);
+
+	image.internalFormat = header.internalFormat;
+	image.levels.resize(header.levelCount);
+	for (uint32_t i = 0; i < header.levelCount; i++)
+	{
+		LEVEL_HEADER level;
+		cacheFile.read((char*)&level, sizeof(level));
+		if (!cacheFile)
+		{
+			image.levels.clear();
+			return(false);
+		}
+
+		// the first level can be any size up to the largest, every
+		// other one halves the level before it, and the data fills
+		// exactly the blocks covering the level
+		bool bSizeValid =
+			(level.width > 0) && (level.width <= g_MaxLevelSize) &&
+			(level.height > 0) && (level.height <= g_MaxLevelSize);
+		if (i > 0)
+		{
+			bSizeValid =
+				(level.width == std::max((uint32_t)image.levels[i - 1].width / 2, 1u)) &&
+				(level.height == std::max((uint32_t)image.levels[i - 1].height / 2, 1u));
+		}
+		uint64_t blockCount = (uint64_t)((level.width + 3) / 4) * ((level.height + 3) / 4);
+		if ((bSizeValid == false) ||
+			((uint64_t)level.byteSize != blockCount * blockBytes) ||
+			((uint64_t)cacheFile.tellg() + level.byteSize > cacheSize))
+		{
+			image.levels.clear();
+			return(false);
+		}
+
+		image.levels[i].width = (int)level.width;
+		image.levels[i].height = (int)level.height;
+		image.levels[i].data.resize(level.byteSize);
+		cacheFile.read((char*)image.levels[i].data.data(), level.byteSize);
+		if (!cacheFile)
+		{
+			image.levels.clear();
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadBack()
+ *
+ *  This method is used for reading back every mip level of
+ *  the currently bound GL_TEXTURE_2D, which the driver has
+ *  already compressed.
+ ***********************************************************/
+bool TextureCache::ReadBack(COMPRESSED_IMAGE& image)
+{
+	GLint bCompressed = GL_FALSE;
+	GLint internalFormat = 0;
+
+	image.levels.clear();
+
+	// the driver may have fallen back to an uncompressed format
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_COMPRESSED, &bCompressed);
+	glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+	if (bCompressed == GL_FALSE)
+	{
+		return(false);
+	}
+
+	// walk the mip chain down to the 1x1 level
+	std::vector<MIP_LEVEL>& levels = image.levels;
+	int levelIndex = 0;
+	while (true)
+	{
+		MIP_LEVEL level;
+		GLint byteSize = 0;
+
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levelIndex, GL_TEXTURE_WIDTH, &level.width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levelIndex, GL_TEXTURE_HEIGHT, &level.height);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, levelIndex, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &byteSize);
+		if ((level.width == 0) || (level.height == 0) || (byteSize == 0))
+		{
+			break;
+		}
+
+		level.data.resize(byteSize);
+		glGetCompressedTexImage(GL_TEXTURE_2D, levelIndex, level.data.data());
+		levels.push_back(level);
+
+		if ((level.width == 1) && (level.height == 1))
+		{
+			break;
+		}
+		levelIndex++;
+	}
+	image.internalFormat = (uint32_t)internalFormat;
+
+	return(levels.empty() == false);
+}
+
+/***********************************************************
+ *  Save()
+ *
+ *  This method is used for writing the read back mip chain
+ *  of an image to its cache file.
+ ***********************************************************/
+bool TextureCache::Save(const std::string& filename, const COMPRESSED_IMAGE& image)
+{
+	int64_t modifiedTime = 0;
+	int64_t fileSize = 0;
+	const std::vector<MIP_LEVEL>& levels = image.levels;
+
+	if (GetSourceStamp(filename, modifiedTime, fileSize) == false)
+	{
+		return(false);
+	}
+
+	std::ofstream cacheFile(GetCachePath(filename).c_str(), std::ios::binary | std::ios::trunc);
+	if (!cacheFile)
+	{
+		std::cout << "Could not write texture cache for:" << filename << std::endl;
+		return(false);
+	}
+
+	CACHE_HEADER header;
+	header.magic = g_CacheMagic;
+	header.version = g_CacheVersion;
+	header.sourceModifiedTime = modifiedTime;
+	header.sourceFileSize = fileSize;
+	header.internalFormat = image.internalFormat;
+	header.levelCount = (uint32_t)levels.size();
+	cacheFile.write((const char*)&header, sizeof(header));
+
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		LEVEL_HEADER level;
+		level.width = (uint32_t)levels[i].width;
+		level.height = (uint32_t)levels[i].height;
+		level.byteSize = (uint32_t)levels[i].data.size();
+		level.reserved = 0;
+		cacheFile.write((const char*)&level, sizeof(level));
+		cacheFile.write((const char*)levels[i].data.data(), levels[i].data.size());
+	}
+
+	std::cout << "Wrote texture cache:" << GetCachePath(filename) << ", levels:" << levels.size() << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Upload()
+ *
+ *  This method is used for defining every mip level of the
+ *  currently bound GL_TEXTURE_2D from a cached image, so no
+ *  glGenerateMipmap() call is needed afterwards.  Levels
+ *  before the first level are left out, which shrinks the
+ *  texture without changing how it maps.
+ ***********************************************************/
+void TextureCache::Upload(const COMPRESSED_IMAGE& image, int firstLevel)
+{
+	for (size_t i = (size_t)firstLevel; i < image.levels.size(); i++)
+	{
+		glCompressedTexImage2D(
+			GL_TEXTURE_2D,
+			(GLint)(i - firstLevel),
+			image.internalFormat,
+			image.levels[i].width,
+			image.levels[i].height,
+			0,
+			(GLsizei)image.levels[i].data.size(),
+			image.levels[i].data.data());
+	}
+
+	// tell GL the chain is complete even if it stops short of 1x1
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1 - firstLevel);
+}
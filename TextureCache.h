@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecache.h
+// ============
+// store block-compressed, pre-mipmapped copies of texture images on disk so
+// later launches can skip the image decode and mipmap generation
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCache
+ *
+ *  Each texture image file gets a companion cache file next
+ *  to it holding every mip level in the GPU's block
+ *  compressed format (BC1 for RGB, BC3 for RGBA).  The cache
+ *  is keyed by the image file's size and modification time,
+ *  so editing the image invalidates it automatically.
+ ***********************************************************/
+class TextureCache
+{
+public:
+	struct MIP_LEVEL
+	{
+		int width;
+		int height;
+		std::vector<unsigned char> data;
+	};
+
+	struct COMPRESSED_IMAGE
+	{
+		uint32_t internalFormat;
+		std::vector<MIP_LEVEL> levels;
+	};
+
+	// check whether the GL context can use the cached formats
+	static bool IsSupported();
+	// pick the compressed internal format for an image
+	static GLenum GetCompressedFormat(int colorChannels);
+	// get the bytes of every level of a compressed mip chain
+	static size_t GetChainBytes(const COMPRESSED_IMAGE& image);
+
+	// read the cache file for an image, there is no GL access so
+	// this can be called from the texture loader worker threads
+	static bool Load(const std::string& filename, COMPRESSED_IMAGE& image);
+	// read back the mip chain of the bound GL_TEXTURE_2D, false is
+	// returned when the driver did not compress it
+	static bool ReadBack(COMPRESSED_IMAGE& image);
+	// write the cache file for an image from its read back mip chain
+	static bool Save(const std::string& filename, const COMPRESSED_IMAGE& image);
+	// define the mip levels of the bound GL_TEXTURE_2D, starting with
+	// the passed in level of the chain as the base level
+	static void Upload(const COMPRESSED_IMAGE& image, int firstLevel = 0);
+
+private:
+	// get the path of the cache file for an image
+	static std::string GetCachePath(const std::string& filename);
+	// get the size and modification time that key the cache
+	static bool GetSourceStamp(const std::string& filename, int64_t& modifiedTime, int64_t& fileSize);
+};
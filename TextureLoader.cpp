@@ -0,0 +1,247 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture image files on worker threads so they can be streamed
+// into OpenGL from the main thread without blocking the first frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+
+#include "stb_image.h"
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class - starts the worker threads
+ ***********************************************************/
+TextureLoader::TextureLoader(unsigned int numWorkers, bool bReadCache)
+{
+	m_pendingCount = 0;
+	m_bShutdown = false;
+	m_bReadCache = bReadCache;
+
+	// leave one core for the GL thread when picking the pool size
+	if (numWorkers == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		numWorkers = (cores > 1) ? cores - 1 : 1;
+	}
+
+	// images are always flipped vertically, this is global stb_image
+	// state so it is set once here before any worker starts reading it
+	stbi_set_flip_vertically_on_load(true);
+
+	for (unsigned int i = 0; i < numWorkers; i++)
+	{
+		m_workers.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class - stops the worker threads
+ *  and frees any decoded images that were never collected
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bShutdown = true;
+		m_jobs.clear();
+		m_cacheWrites.clear();
+	}
+	m_jobReady.notify_all();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+
+	for (size_t i = 0; i < m_results.size(); i++)
+	{
+		FreeImage(m_results[i]);
+	}
+	m_results.clear();
+}
+
+/***********************************************************
+ *  QueueImage()
+ *
+ *  This method is used for adding an image file to the list
+ *  of files waiting to be decoded by the worker threads.
+ ***********************************************************/
+void TextureLoader::QueueImage(const char* filename, std::string tag, int slot)
+{
+	DECODED_IMAGE job;
+	job.filename = filename;
+	job.tag = tag;
+	job.slot = slot;
+	job.width = 0;
+	job.height = 0;
+	job.colorChannels = 0;
+	job.pixels = NULL;
+	job.compressed.internalFormat = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_jobs.push_back(job);
+		m_pendingCount++;
+	}
+	m_jobReady.notify_one();
+}
+
+/***********************************************************
+ *  QueueCacheWrite()
+ *
+ *  This method is used for handing a read back mip chain to
+ *  the worker threads to be written to its cache file.  The
+ *  write counts as pending until it is done, so the loader
+ *  is not released with cache files still to write.
+ ***********************************************************/
+void TextureLoader::QueueCacheWrite(const std::string& filename, const TextureCache::COMPRESSED_IMAGE& chain)
+{
+	CACHE_WRITE write;
+	write.filename = filename;
+	write.chain = chain;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_cacheWrites.push_back(std::move(write));
+		m_pendingCount++;
+	}
+	m_jobReady.notify_one();
+}
+
+/***********************************************************
+ *  PopDecodedImage()
+ *
+ *  This method is used for collecting the next image that a
+ *  worker has finished with.  Failed decodes are returned
+ *  too, with NULL pixels, so the caller can report them.
+ ***********************************************************/
+bool TextureLoader::PopDecodedImage(DECODED_IMAGE& image)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_results.empty())
+	{
+		return(false);
+	}
+
+	image = std::move(m_results.front());
+	m_results.pop_front();
+	m_pendingCount--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FreeImage()
+ *
+ *  This method is used for freeing the decoded pixel data.
+ ***********************************************************/
+void TextureLoader::FreeImage(DECODED_IMAGE& image)
+{
+	if (NULL != image.pixels)
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+	}
+	image.compressed.levels.clear();
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of queued
+ *  images that have not yet been collected.
+ ***********************************************************/
+int TextureLoader::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return(m_pendingCount);
+}
+
+/***********************************************************
+ *  GetDecodedCount()
+ *
+ *  This method is used for getting the number of decoded
+ *  images that are ready to be taken.
+ ***********************************************************/
+int TextureLoader::GetDecodedCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return((int)m_results.size());
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method runs on each worker thread, decoding queued
+ *  image files and writing queued cache files until the
+ *  loader is destroyed.  The decodes go first, since the
+ *  frames wait on them.
+ ***********************************************************/
+void TextureLoader::WorkerLoop()
+{
+	while (true)
+	{
+		DECODED_IMAGE job;
+		CACHE_WRITE write;
+		bool bWrite = false;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_jobReady.wait(lock, [this] { return m_bShutdown || !m_jobs.empty() || !m_cacheWrites.empty(); });
+			if (m_bShutdown)
+			{
+				return;
+			}
+			if (m_jobs.empty())
+			{
+				write = std::move(m_cacheWrites.front());
+				m_cacheWrites.pop_front();
+				bWrite = true;
+			}
+			else
+			{
+				job = std::move(m_jobs.front());
+				m_jobs.pop_front();
+			}
+		}
+
+		if (bWrite == true)
+		{
+			TextureCache::Save(write.filename, write.chain);
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_pendingCount--;
+			continue;
+		}
+
+		// a current compressed copy makes decoding the image unnecessary
+		if ((m_bReadCache == true) &&
+			(TextureCache::Load(job.filename, job.compressed) == true))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_results.push_back(std::move(job));
+			continue;
+		}
+
+		// try to parse the image data from the specified image file,
+		// this is the expensive part that is kept off the GL thread
+		job.pixels = stbi_load(
+			job.filename.c_str(),
+			&job.width,
+			&job.height,
+			&job.colorChannels,
+			0);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_results.push_back(std::move(job));
+		}
+	}
+}
@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture image files on worker threads so they can be streamed
+// into OpenGL from the main thread without blocking the first frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class owns a small pool of worker threads that read
+ *  and decode image files with stb_image.  It never touches
+ *  OpenGL - decoded images are handed back to the caller on
+ *  the GL thread, which is responsible for the upload.  The
+ *  workers also write the texture cache files of the chains
+ *  the GL thread read back, so the disk writes stay off it.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor - zero worker threads means "pick from the CPU count",
+	// when reading the cache is enabled the compressed copy of each
+	// image is used instead of decoding the image file if it is current
+	TextureLoader(unsigned int numWorkers = 0, bool bReadCache = false);
+	// destructor
+	~TextureLoader();
+
+	struct DECODED_IMAGE
+	{
+		std::string filename;
+		std::string tag;
+		int slot;
+		int width;
+		int height;
+		int colorChannels;
+		unsigned char* pixels;
+		// filled instead of the pixels when read from the texture cache
+		TextureCache::COMPRESSED_IMAGE compressed;
+	};
+
+	// queue an image file to be decoded on a worker thread
+	void QueueImage(const char* filename, std::string tag, int slot);
+	// take the next decoded image, returns false if none is ready
+	bool PopDecodedImage(DECODED_IMAGE& image);
+	// free the pixel data of an image returned by PopDecodedImage()
+	static void FreeImage(DECODED_IMAGE& image);
+
+	// write the cache file of an image from a copy of its read back
+	// mip chain on a worker thread
+	void QueueCacheWrite(const std::string& filename, const TextureCache::COMPRESSED_IMAGE& chain);
+
+	// number of queued images that have not been handed back yet, and
+	// of queued cache files that have not been written yet
+	int GetPendingCount();
+	// number of decoded images waiting to be taken
+	int GetDecodedCount();
+
+private:
+	// a cache file waiting to be written
+	struct CACHE_WRITE
+	{
+		std::string filename;
+		TextureCache::COMPRESSED_IMAGE chain;
+	};
+
+	// worker pool and the queues shared with it
+	std::vector<std::thread> m_workers;
+	std::deque<DECODED_IMAGE> m_jobs;
+	std::deque<DECODED_IMAGE> m_results;
+	std::deque<CACHE_WRITE> m_cacheWrites;
+	std::mutex m_mutex;
+	std::condition_variable m_jobReady;
+	int m_pendingCount;
+	bool m_bShutdown;
+	bool m_bReadCache;
+
+	// thread entry point for the decode workers
+	void WorkerLoop();
+};
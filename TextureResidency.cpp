@@ -0,0 +1,475 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.cpp
+// ============
+// keep the mip levels of the loaded textures within a video memory budget,
+// streaming in the detailed levels of the textures that are seen up close
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureResidency.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// bytes uploaded by one update, so streaming the levels in
+	// does not cause a visible hitch in the frame rate
+	const size_t g_MaxUpdateUploadBytes = 16 * 1024 * 1024;
+
+	/***********************************************************
+	 *  ToMegabytes()
+	 *
+	 *  Convert a byte count to megabytes for printing.
+	 ***********************************************************/
+	float ToMegabytes(size_t bytes)
+	{
+		return((float)((double)bytes / (1024.0 * 1024.0)));
+	}
+}
+
+/***********************************************************
+ *  TextureResidency()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureResidency::TextureResidency()
+{
+	m_budgetBytes = DEFAULT_BUDGET_BYTES;
+	m_residentBytes = 0;
+	m_arrayBytes = 0;
+	m_plannedBytes = 0;
+	m_updateCount = 0;
+}
+
+/***********************************************************
+ *  ~TextureResidency()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureResidency::~TextureResidency()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  GetEntry()
+ *
+ *  This method is used for getting the entry of a texture
+ *  slot.  The textures finish decoding in any order, so the
+ *  slots are not added in order.
+ ***********************************************************/
+TextureResidency::TEXTURE& TextureResidency::GetEntry(int textureSlot)
+{
+	if (textureSlot >= (int)m_textures.size())
+	{
+		TEXTURE empty;
+		empty.textureID = 0;
+		empty.fixedBytes = 0;
+		empty.residentLevel = 0;
+		empty.tailLevel = 0;
+		empty.requestedLevel = 0;
+		m_textures.resize(textureSlot + 1, empty);
+	}
+
+	return(m_textures[textureSlot]);
+}
+
+/***********************************************************
+ *  IsStreamed()
+ *
+ *  This method is used for checking whether a slot holds a
+ *  texture whose levels can be streamed.
+ ***********************************************************/
+bool TextureResidency::IsStreamed(int textureSlot) const
+{
+	return((textureSlot >= 0) && (textureSlot < (int)m_textures.size()) &&
+		(m_textures[textureSlot].chain.levels.empty() == false));
+}
+
+/***********************************************************
+ *  AddTexture()
+ *
+ *  This method is used for taking over the texture of a
+ *  slot.  The levels it starts with are the ones of the tail,
+ *  so a texture only takes more memory once it is seen.  An
+ *  empty texture gets the tail uploaded straight into it,
+ *  instead of the whole chain being uploaded and replaced.
+ ***********************************************************/
+void TextureResidency::AddTexture(int textureSlot, const std::string& tag, GLuint textureID, TextureCache::COMPRESSED_IMAGE& chain, bool bUploaded)
+{
+	TEXTURE& texture = GetEntry(textureSlot);
+	int levelCount = (int)chain.levels.size();
+
+	texture.tag = tag;
+	texture.textureID = textureID;
+	texture.chain.internalFormat = chain.internalFormat;
+	texture.chain.levels.swap(chain.levels);
+	texture.fixedBytes = 0;
+
+	texture.chainBytes.assign(levelCount + 1, 0);
+	for (int level = levelCount - 1; level >= 0; level--)
+	{
+		texture.chainBytes[level] = texture.chainBytes[level + 1] + texture.chain.levels[level].data.size();
+	}
+
+	texture.tailLevel = levelCount - 1;
+	while ((texture.tailLevel > 0) &&
+		(texture.chain.levels[texture.tailLevel - 1].width <= TAIL_SIZE) &&
+		(texture.chain.levels[texture.tailLevel - 1].height <= TAIL_SIZE))
+	{
+		texture.tailLevel--;
+	}
+	texture.requestedLevel = levelCount;
+	texture.lastUsed.assign(levelCount, 0);
+
+	if (bUploaded == false)
+	{
+		TextureCache::Upload(texture.chain, texture.tailLevel);
+		texture.residentLevel = texture.tailLevel;
+		m_residentBytes += texture.chainBytes[texture.tailLevel];
+		return;
+	}
+
+	// the uploaded texture holds the whole chain
+	texture.residentLevel = 0;
+	m_residentBytes += texture.chainBytes[0];
+	SetResidentLevel(textureSlot, texture.tailLevel);
+}
+
+/***********************************************************
+ *  AddFixedTexture()
+ *
+ *  This method is used for taking over a texture that is
+ *  kept whole, and counting its memory.
+ ***********************************************************/
+void TextureResidency::AddFixedTexture(int textureSlot, const std::string& tag, GLuint textureID, size_t bytes)
+{
+	TEXTURE& texture = GetEntry(textureSlot);
+
+	texture.tag = tag;
+	texture.textureID = textureID;
+	texture.chain.levels.clear();
+	texture.chainBytes.clear();
+	texture.fixedBytes = bytes;
+	texture.residentLevel = 0;
+	texture.tailLevel = 0;
+	texture.requestedLevel = 0;
+	texture.lastUsed.clear();
+
+	m_residentBytes += bytes;
+}
+
+/***********************************************************
+ *  Request()
+ *
+ *  This method is used for asking for the level of detail a
+ *  texture is seen at.  The level is the one with about one
+ *  texel for each pixel one repeat of the texture covers.
+ ***********************************************************/
+void TextureResidency::Request(int textureSlot, float repeatPixels)
+{
+	if (IsStreamed(textureSlot) == false)
+	{
+		return;
+	}
+
+	TEXTURE& texture = m_textures[textureSlot];
+	const TextureCache::MIP_LEVEL& base = texture.chain.levels[0];
+	float texels = (float)std::max(base.width, base.height);
+
+	int level = 0;
+	if (repeatPixels <= 0.0f)
+	{
+		level = texture.tailLevel;
+	}
+	else if (repeatPixels < texels)
+	{
+		level = std::min((int)std::floor(std::log2(texels / repeatPixels)), texture.tailLevel);
+	}
+	texture.requestedLevel = std::min(texture.requestedLevel, level);
+}
+
+/***********************************************************
+ *  EvictLevel()
+ *
+ *  This method is used for planning to drop the most detailed
+ *  level of the texture whose level was asked for the least
+ *  recently.  The tail levels and the levels asked for in the
+ *  current update are kept.
+ ***********************************************************/
+bool TextureResidency::EvictLevel(int keepSlot)
+{
+	int victim = -1;
+	unsigned int oldest = m_updateCount;
+
+	for (int t = 0; t < (int)m_textures.size(); t++)
+	{
+		if ((t == keepSlot) || (IsStreamed(t) == false))
+		{
+			continue;
+		}
+
+		const TEXTURE& texture = m_textures[t];
+		int level = m_targetLevels[t];
+		if ((level < texture.tailLevel) && (texture.lastUsed[level] < oldest))
+		{
+			victim = t;
+			oldest = texture.lastUsed[level];
+		}
+	}
+
+	if (victim < 0)
+	{
+		return(false);
+	}
+
+	const TEXTURE& texture = m_textures[victim];
+	int level = m_targetLevels[victim];
+	m_plannedBytes -= texture.chainBytes[level] - texture.chainBytes[level + 1];
+	m_targetLevels[victim] = level + 1;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for moving the textures to the levels
+ *  asked for.  The levels are planned first: the textures that
+ *  gain the most levels are streamed first, each as far as
+ *  the budget allows after dropping the least recently used
+ *  levels of other textures.  The memory of the texture
+ *  arrays is taken off the budget up front.  The planned
+ *  textures are then replaced.
+ ***********************************************************/
+void TextureResidency::Update()
+{
+	int textureCount = (int)m_textures.size();
+
+	m_updateCount++;
+	m_changedSlots.clear();
+	m_streamSlots.clear();
+	m_targetLevels.assign(textureCount, 0);
+	m_plannedBytes = m_residentBytes + m_arrayBytes;
+
+	for (int t = 0; t < textureCount; t++)
+	{
+		TEXTURE& texture = m_textures[t];
+
+		m_targetLevels[t] = texture.residentLevel;
+		if (IsStreamed(t) == false)
+		{
+			continue;
+		}
+
+		// asking for a level also uses the levels below it
+		for (int level = texture.requestedLevel; level < (int)texture.lastUsed.size(); level++)
+		{
+			texture.lastUsed[level] = m_updateCount;
+		}
+		if (texture.requestedLevel < texture.residentLevel)
+		{
+			m_streamSlots.push_back(t);
+		}
+	}
+
+	// the budget may have been lowered
+	while ((m_plannedBytes > m_budgetBytes) && (EvictLevel(-1) == true))
+	{
+	}
+
+	std::sort(m_streamSlots.begin(), m_streamSlots.end(),
+		[&](int a, int b)
+		{
+			int gainA = m_textures[a].residentLevel - m_textures[a].requestedLevel;
+			int gainB = m_textures[b].residentLevel - m_textures[b].requestedLevel;
+			if (gainA != gainB)
+			{
+				return(gainA > gainB);
+			}
+			return(a < b);
+		});
+
+	size_t uploadBytes = 0;
+	for (size_t s = 0; s < m_streamSlots.size(); s++)
+	{
+		int slot = m_streamSlots[s];
+		const TEXTURE& texture = m_textures[slot];
+		int target = m_targetLevels[slot];
+
+		// try the asked for level first, then coarser ones
+		for (int level = texture.requestedLevel; level < target; level++)
+		{
+			size_t growth = texture.chainBytes[level] - texture.chainBytes[target];
+			// one texture is always streamed, however large it is
+			if ((uploadBytes > 0) && (uploadBytes + texture.chainBytes[level] > g_MaxUpdateUploadBytes))
+			{
+				continue;
+			}
+			while ((m_plannedBytes + growth > m_budgetBytes) && (EvictLevel(slot) == true))
+			{
+			}
+			if (m_plannedBytes + growth <= m_budgetBytes)
+			{
+				m_plannedBytes += growth;
+				m_targetLevels[slot] = level;
+				uploadBytes += texture.chainBytes[level];
+				break;
+			}
+		}
+	}
+
+	for (int t = 0; t < textureCount; t++)
+	{
+		TEXTURE& texture = m_textures[t];
+
+		if (IsStreamed(t) == false)
+		{
+			continue;
+		}
+		texture.requestedLevel = (int)texture.chain.levels.size();
+		if (m_targetLevels[t] != texture.residentLevel)
+		{
+			SetResidentLevel(t, m_targetLevels[t]);
+			m_changedSlots.push_back(t);
+		}
+	}
+}
+
+/***********************************************************
+ *  SetResidentLevel()
+ *
+ *  This method is used for replacing the texture of a slot
+ *  with a new one holding the levels of the chain from the
+ *  passed in level down, mapped with the same parameters.
+ *  The old texture is deleted, which frees its memory.
+ ***********************************************************/
+void TextureResidency::SetResidentLevel(int textureSlot, int level)
+{
+	TEXTURE& texture = m_textures[textureSlot];
+	GLint wrapS = GL_REPEAT;
+	GLint wrapT = GL_REPEAT;
+	GLint minFilter = GL_LINEAR;
+	GLint magFilter = GL_LINEAR;
+	GLuint textureID = 0;
+
+	glBindTexture(GL_TEXTURE_2D, texture.textureID);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, &wrapS);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, &wrapT);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, &minFilter);
+	glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, &magFilter);
+
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrapS);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrapT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+	TextureCache::Upload(texture.chain, level);
+
+	glDeleteTextures(1, &texture.textureID);
+	texture.textureID = textureID;
+
+	m_residentBytes -= texture.chainBytes[texture.residentLevel];
+	m_residentBytes += texture.chainBytes[level];
+	texture.residentLevel = level;
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method is used for getting the current GL texture of
+ *  a slot.
+ ***********************************************************/
+GLuint TextureResidency::GetTexture(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= (int)m_textures.size()))
+	{
+		return(0);
+	}
+
+	return(m_textures[textureSlot].textureID);
+}
+
+/***********************************************************
+ *  GetResidentBytes()
+ *
+ *  This method is used for getting the video memory used by
+ *  the texture of a slot.
+ ***********************************************************/
+size_t TextureResidency::GetResidentBytes(int textureSlot) const
+{
+	if ((textureSlot < 0) || (textureSlot >= (int)m_textures.size()))
+	{
+		return(0);
+	}
+
+	const TEXTURE& texture = m_textures[textureSlot];
+	if (IsStreamed(textureSlot) == false)
+	{
+		return(texture.fixedBytes);
+	}
+
+	return(texture.chainBytes[texture.residentLevel]);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method is used for printing the resident size and
+ *  memory of every texture against the budget.
+ ***********************************************************/
+void TextureResidency::PrintReport() const
+{
+	std::cout << "Texture residency - resident:" << ToMegabytes(m_residentBytes + m_arrayBytes)
+			  << " MB, budget:" << ToMegabytes(m_budgetBytes) << " MB" << std::endl;
+	std::cout << "  textures:" << ToMegabytes(m_residentBytes)
+			  << " MB, texture arrays:" << ToMegabytes(m_arrayBytes) << " MB" << std::endl;
+
+	for (int t = 0; t < (int)m_textures.size(); t++)
+	{
+		const TEXTURE& texture = m_textures[t];
+
+		if (0 == texture.textureID)
+		{
+			continue;
+		}
+		if (IsStreamed(t) == false)
+		{
+			std::cout << "  " << texture.tag << " - fixed, resident:" << ToMegabytes(texture.fixedBytes) << " MB" << std::endl;
+			continue;
+		}
+
+		const TextureCache::MIP_LEVEL& resident = texture.chain.levels[texture.residentLevel];
+		const TextureCache::MIP_LEVEL& base = texture.chain.levels[0];
+		std::cout << "  " << texture.tag << " - level:" << texture.residentLevel
+				  << ", size:" << resident.width << "x" << resident.height
+				  << " of " << base.width << "x" << base.height
+				  << ", resident:" << ToMegabytes(texture.chainBytes[texture.residentLevel])
+				  << " MB of " << ToMegabytes(texture.chainBytes[0]) << " MB" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for deleting every texture, which
+ *  frees their memory, and the mip chains kept for them.
+ ***********************************************************/
+void TextureResidency::Clear()
+{
+	for (size_t t = 0; t < m_textures.size(); t++)
+	{
+		if (0 != m_textures[t].textureID)
+		{
+			glDeleteTextures(1, &m_textures[t].textureID);
+		}
+	}
+	m_textures.clear();
+	m_residentBytes = 0;
+	// the texture arrays are not owned here, so their bytes stay
+	m_changedSlots.clear();
+}
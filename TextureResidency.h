@@ -0,0 +1,142 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureresidency.h
+// ============
+// keep the mip levels of the loaded textures within a video memory budget,
+// streaming in the detailed levels of the textures that are seen up close
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureCache.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureResidency
+ *
+ *  A copy of the whole compressed mip chain of every texture
+ *  stays in system memory, while the GL texture only holds
+ *  the levels from its resident level down.  Textures start
+ *  with the small tail levels only.
+ *
+ *  While drawing, Request() asks for the level a texture is
+ *  seen at, from how many pixels one repeat of it covers on
+ *  the screen.  Update() then moves each asked for texture to
+ *  its level, as far as the budget and the upload limit of a
+ *  frame allow.  To make room, the detailed level of the
+ *  texture whose level was least recently asked for is
+ *  dropped, one level at a time; levels asked for in the
+ *  frame are never dropped.
+ *
+ *  Changing the levels of a texture replaces it with a new
+ *  texture holding the kept levels, so the memory of the
+ *  dropped levels is really released.  Textures the driver
+ *  could not compress have no chain to stream from, and are
+ *  kept whole and only counted.  The texture arrays keep a
+ *  whole copy of every texture too, which can not be streamed,
+ *  so their memory is counted against the budget first.
+ ***********************************************************/
+class TextureResidency
+{
+public:
+	// constructor
+	TextureResidency();
+	// destructor, which deletes the textures
+	~TextureResidency();
+
+	// video memory the textures may use unless told otherwise
+	static const size_t DEFAULT_BUDGET_BYTES = 128 * 1024 * 1024;
+	// levels of this size and smaller always stay resident
+	static const int TAIL_SIZE = 64;
+
+	void SetBudget(size_t budgetBytes) { m_budgetBytes = budgetBytes; }
+	size_t GetBudget() const { return(m_budgetBytes); }
+
+	// take over the texture of a slot with its whole mip chain, which
+	// is moved out of the passed in image.  The texture, bound to
+	// GL_TEXTURE_2D, either holds the whole chain and shrinks to its
+	// tail right away, leaving a new texture bound, or is empty and
+	// gets the tail levels uploaded into it
+	void AddTexture(int textureSlot, const std::string& tag, GLuint textureID, TextureCache::COMPRESSED_IMAGE& chain, bool bUploaded);
+	// take over a texture that can not be streamed, of the passed in size
+	void AddFixedTexture(int textureSlot, const std::string& tag, GLuint textureID, size_t bytes);
+
+	// ask for the level of a texture that covers the passed in
+	// number of pixels with one repeat of the texture
+	void Request(int textureSlot, float repeatPixels);
+
+	// move the textures to the levels asked for since the last call,
+	// every replaced texture is bound to GL_TEXTURE_2D of the active
+	// texture unit in turn, so the unit has to be bound again after
+	void Update();
+	// slots whose texture was replaced by the last Update()
+	const std::vector<int>& GetChangedSlots() const { return(m_changedSlots); }
+
+	// the current GL texture of a slot, 0 when it has none
+	GLuint GetTexture(int textureSlot) const;
+	// video memory used by the texture of a slot, and by all of them
+	size_t GetResidentBytes(int textureSlot) const;
+	size_t GetResidentBytes() const { return(m_residentBytes + m_arrayBytes); }
+	// video memory held by the texture arrays
+	void SetArrayBytes(size_t bytes) { m_arrayBytes = bytes; }
+	size_t GetArrayBytes() const { return(m_arrayBytes); }
+
+	// print the resident size and bytes of every texture
+	void PrintReport() const;
+
+	// delete every texture and forget the slots
+	void Clear();
+
+private:
+	struct TEXTURE
+	{
+		std::string tag;
+		GLuint textureID;
+		// every level, empty for a texture that can not be streamed
+		TextureCache::COMPRESSED_IMAGE chain;
+		// bytes of the chain from each level down, with a 0 past the end
+		std::vector<size_t> chainBytes;
+		// bytes of a texture that can not be streamed
+		size_t fixedBytes;
+		// first level held by the GL texture, and the first level of
+		// the levels that always stay
+		int residentLevel;
+		int tailLevel;
+		// finest level asked for since the last update, the level
+		// count when none was
+		int requestedLevel;
+		// update each level was last asked for in
+		std::vector<unsigned int> lastUsed;
+	};
+
+	std::vector<TEXTURE> m_textures;
+	size_t m_budgetBytes;
+	size_t m_residentBytes;
+	// bytes of the texture arrays, outside of the textures
+	size_t m_arrayBytes;
+	// resident bytes with the levels planned by the update
+	size_t m_plannedBytes;
+	// counts the updates, for the least recently used levels
+	unsigned int m_updateCount;
+	// slots replaced by the last update, and the planned levels, kept
+	// between updates so they keep their memory
+	std::vector<int> m_changedSlots;
+	std::vector<int> m_targetLevels;
+	std::vector<int> m_streamSlots;
+
+	// get the entry of a slot, growing the list when needed
+	TEXTURE& GetEntry(int textureSlot);
+	// whether a slot has a texture that can be streamed
+	bool IsStreamed(int textureSlot) const;
+	// lower the planned level of the least recently used texture by
+	// one, other than the passed in slot, false when none can be
+	bool EvictLevel(int keepSlot);
+	// replace the texture of a slot with one holding the levels from
+	// the passed in level down
+	void SetResidentLevel(int textureSlot, int level);
+};
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturesamplers.cpp
+// ============
+// sampler objects shared by the scene textures, with trilinear filtering and
+// a choice of anisotropic filtering levels
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureSamplers.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// anisotropic filtering values, from the extension or GL 4.6
+	const GLenum g_MaxAnisotropyName = 0x84FF;		// GL_MAX_TEXTURE_MAX_ANISOTROPY
+	const GLenum g_AnisotropyName = 0x84FE;			// GL_TEXTURE_MAX_ANISOTROPY
+}
+
+/***********************************************************
+ *  TextureSamplers()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureSamplers::TextureSamplers(int defaultAnisotropy)
+{
+	GLfloat maxAnisotropy = 1.0f;
+
+	if (IsAnisotropySupported() == true)
+	{
+		glGetFloatv(g_MaxAnisotropyName, &maxAnisotropy);
+	}
+
+	glGenSamplers(LEVEL_COUNT, m_samplers);
+	for (int level = 0; level < LEVEL_COUNT; level++)
+	{
+		GLuint sampler = m_samplers[level];
+
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (IsAnisotropySupported() == true)
+		{
+			GLfloat anisotropy = std::min((GLfloat)(1 << level), maxAnisotropy);
+			glSamplerParameterf(sampler, g_AnisotropyName, anisotropy);
+		}
+	}
+
+	m_defaultAnisotropy = defaultAnisotropy;
+}
+
+/***********************************************************
+ *  ~TextureSamplers()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureSamplers::~TextureSamplers()
+{
+	glDeleteSamplers(LEVEL_COUNT, m_samplers);
+}
+
+/***********************************************************
+ *  IsAnisotropySupported()
+ *
+ *  This method is used for checking whether the current GL
+ *  context supports anisotropic texture filtering.
+ ***********************************************************/
+bool TextureSamplers::IsAnisotropySupported()
+{
+	return((GLEW_EXT_texture_filter_anisotropic || GLEW_ARB_texture_filter_anisotropic) ? true : false);
+}
+
+/***********************************************************
+ *  GetSampler()
+ *
+ *  This method is used for getting the sampler of the
+ *  highest anisotropy level that is not above the passed in
+ *  one.
+ ***********************************************************/
+GLuint TextureSamplers::GetSampler(int anisotropy) const
+{
+	if (anisotropy <= 0)
+	{
+		anisotropy = m_defaultAnisotropy;
+	}
+
+	int level = 0;
+	while ((level < LEVEL_COUNT - 1) && ((1 << (level + 1)) <= anisotropy))
+	{
+		level++;
+	}
+
+	return(m_samplers[level]);
+}
@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturesamplers.h
+// ============
+// sampler objects shared by the scene textures, with trilinear filtering and
+// a choice of anisotropic filtering levels
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  TextureSamplers
+ *
+ *  One sampler object is made for each anisotropy level, all
+ *  of them repeating and filtering trilinearly between the
+ *  mip levels.  A sampler bound to a texture unit overrides
+ *  the filtering of the texture bound there, so the same
+ *  texture can be sampled with more anisotropy by one
+ *  material than by another.  Levels past what the driver
+ *  supports fall back to the highest one it does.
+ ***********************************************************/
+class TextureSamplers
+{
+public:
+	// constructor, textures are sampled with the passed in default
+	// anisotropy when their material does not pick one
+	TextureSamplers(int defaultAnisotropy = DEFAULT_ANISOTROPY);
+	// destructor
+	~TextureSamplers();
+
+	// anisotropy levels there is a sampler for, 1, 2, 4, 8 and 16
+	static const int LEVEL_COUNT = 5;
+	static const int MAX_ANISOTROPY = 1 << (LEVEL_COUNT - 1);
+	// anisotropy used when nothing else is asked for
+	static const int DEFAULT_ANISOTROPY = 4;
+
+	// check whether the GL context can filter anisotropically
+	static bool IsAnisotropySupported();
+
+	// get the sampler for an anisotropy level, rounded down to a level
+	// there is a sampler for, 0 picks the default level
+	GLuint GetSampler(int anisotropy) const;
+	GLuint GetDefaultSampler() const { return(GetSampler(m_defaultAnisotropy)); }
+
+	void SetDefaultAnisotropy(int anisotropy) { m_defaultAnisotropy = anisotropy; }
+	int GetDefaultAnisotropy() const { return(m_defaultAnisotropy); }
+
+private:
+	GLuint m_samplers[LEVEL_COUNT];
+	int m_defaultAnisotropy;
+};
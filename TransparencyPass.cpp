@@ -0,0 +1,266 @@
+///////////////////////////////////////////////////////////////////////////////
+// transparencypass.cpp
+// ============
+// weighted blended order independent transparency - the transparent draws
+// are accumulated in any order into offscreen targets and composited over
+// the opaque scene in one full screen draw
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransparencyPass.h"
+#include "ProgramCache.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// nothing accumulated yet, and all of the background showing
+	const GLfloat g_AccumulationClear[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	const GLfloat g_WeightClear[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	// names of the uniforms in the composite fragment shader
+	const char* g_AccumulationName = "accumulationTexture";
+	const char* g_WeightName = "weightTexture";
+	const char* g_ViewportOriginName = "viewportOrigin";
+}
+
+/***********************************************************
+ *  TransparencyPass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TransparencyPass::TransparencyPass(int firstTextureUnit)
+{
+	m_pCompositeShader = NULL;
+	m_viewportOriginLocation = -1;
+	m_firstTextureUnit = firstTextureUnit;
+	m_framebuffer = 0;
+	m_accumulationTexture = 0;
+	m_weightTexture = 0;
+	m_depthBuffer = 0;
+	m_width = 0;
+	m_height = 0;
+	m_targetFramebuffer = 0;
+	m_viewport[0] = 0;
+	m_viewport[1] = 0;
+	m_viewport[2] = 0;
+	m_viewport[3] = 0;
+
+	glGenVertexArrays(1, &m_compositeVao);
+}
+
+/***********************************************************
+ *  ~TransparencyPass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TransparencyPass::~TransparencyPass()
+{
+	DestroyTargets();
+	glDeleteVertexArrays(1, &m_compositeVao);
+	if (NULL != m_pCompositeShader)
+	{
+		delete m_pCompositeShader;
+		m_pCompositeShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  LoadShaders()
+ *
+ *  This method is used for loading the program that blends
+ *  the transparency targets over the framebuffer.  The
+ *  samplers always read the two units of the pass, so they
+ *  are set once here.
+ ***********************************************************/
+bool TransparencyPass::LoadShaders(const char* vertexShaderFile, const char* fragmentShaderFile)
+{
+	if (NULL != m_pCompositeShader)
+	{
+		delete m_pCompositeShader;
+	}
+	m_pCompositeShader = new ShaderManager();
+	ProgramCache::Load(m_pCompositeShader, vertexShaderFile, fragmentShaderFile);
+	if (0 == m_pCompositeShader->m_programID)
+	{
+		std::cout << "Could not load the transparency composite shaders" << std::endl;
+		delete m_pCompositeShader;
+		m_pCompositeShader = NULL;
+		return(false);
+	}
+
+	GLuint program = m_pCompositeShader->m_programID;
+	m_viewportOriginLocation = glGetUniformLocation(program, g_ViewportOriginName);
+	m_pCompositeShader->use();
+	glUniform1i(glGetUniformLocation(program, g_AccumulationName), m_firstTextureUnit);
+	glUniform1i(glGetUniformLocation(program, g_WeightName), m_firstTextureUnit + 1);
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateTargets()
+ *
+ *  This method is used for creating the framebuffer of the
+ *  pass, with a half float accumulation texture, a single
+ *  channel weight texture and a depth renderbuffer that the
+ *  opaque depth is copied into.
+ ***********************************************************/
+bool TransparencyPass::CreateTargets(int width, int height)
+{
+	DestroyTargets();
+	m_width = width;
+	m_height = height;
+
+	glGenTextures(1, &m_accumulationTexture);
+	glBindTexture(GL_TEXTURE_2D, m_accumulationTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_HALF_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenTextures(1, &m_weightTexture);
+	glBindTexture(GL_TEXTURE_2D, m_weightTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_HALF_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_accumulationTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_weightTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	glDrawBuffers(2, drawBuffers);
+
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_targetFramebuffer);
+	if (bComplete == false)
+	{
+		std::cout << "Could not create the transparency framebuffer" << std::endl;
+		DestroyTargets();
+		delete m_pCompositeShader;
+		m_pCompositeShader = NULL;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTargets()
+ *
+ *  This method is used for freeing the framebuffer of the
+ *  pass and its attachments.
+ ***********************************************************/
+void TransparencyPass::DestroyTargets()
+{
+	if (0 != m_framebuffer)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (0 != m_accumulationTexture)
+	{
+		glDeleteTextures(1, &m_accumulationTexture);
+		m_accumulationTexture = 0;
+	}
+	if (0 != m_weightTexture)
+	{
+		glDeleteTextures(1, &m_weightTexture);
+		m_weightTexture = 0;
+	}
+	if (0 != m_depthBuffer)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+	m_width = 0;
+	m_height = 0;
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for starting the transparent draws.
+ *  The targets follow the size of the viewport, the opaque
+ *  depth is copied in, and the depth writes are turned off
+ *  so transparent fragments do not hide each other.
+ ***********************************************************/
+bool TransparencyPass::Begin()
+{
+	if (IsAvailable() == false)
+	{
+		return(false);
+	}
+
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_targetFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, m_viewport);
+	int width = m_viewport[2];
+	int height = m_viewport[3];
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	if ((0 == m_framebuffer) || (width != m_width) || (height != m_height))
+	{
+		if (CreateTargets(width, height) == false)
+		{
+			return(false);
+		}
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_targetFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_framebuffer);
+	glBlitFramebuffer(
+		m_viewport[0], m_viewport[1], m_viewport[0] + width, m_viewport[1] + height,
+		0, 0, width, height,
+		GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, width, height);
+	glClearBufferfv(GL_COLOR, 0, g_AccumulationClear);
+	glClearBufferfv(GL_COLOR, 1, g_WeightClear);
+
+	// color channels add up, the alpha of the accumulation target
+	// multiplies by (1 - alpha) of every fragment
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+
+	return(true);
+}
+
+/***********************************************************
+ *  End()
+ *
+ *  This method is used for finishing the transparent draws
+ *  and blending their average color over the framebuffer
+ *  that was bound when they began.  The depth writes and
+ *  the blending used by the other draws are restored.
+ ***********************************************************/
+void TransparencyPass::End()
+{
+	glDepthMask(GL_TRUE);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_targetFramebuffer);
+	glViewport(m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3]);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	glActiveTexture(GL_TEXTURE0 + m_firstTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, m_accumulationTexture);
+	glActiveTexture(GL_TEXTURE0 + m_firstTextureUnit + 1);
+	glBindTexture(GL_TEXTURE_2D, m_weightTexture);
+
+	m_pCompositeShader->use();
+	glUniform2i(m_viewportOriginLocation, m_viewport[0], m_viewport[1]);
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(m_compositeVao);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+}
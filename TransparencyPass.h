@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// transparencypass.h
+// ============
+// weighted blended order independent transparency - the transparent draws
+// are accumulated in any order into offscreen targets and composited over
+// the opaque scene in one full screen draw
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  TransparencyPass
+ *
+ *  Begin() copies the depth of the opaque draws into the
+ *  offscreen framebuffer, so opaque objects still hide the
+ *  transparent fragments behind them, and sets up blending
+ *  for the two targets the transparent program writes:
+ *
+ *    accumulation  rgb  sum of color * alpha * weight
+ *                  a    product of (1 - alpha), the share of
+ *                       the background that shows through
+ *    weight        r    sum of alpha * weight
+ *
+ *  The weight falls off with depth, so nearer fragments
+ *  count for more in the average color.  Because the sums and
+ *  the product do not depend on the order of the fragments,
+ *  the transparent draws need no sorting.  One blend function
+ *  serves both targets, so the pass works without per target
+ *  blending.  End() draws the average color over the target
+ *  framebuffer with the coverage left by the product.
+ *
+ *  The depth is copied with a blit, so the depth buffer of
+ *  the framebuffer the scene is drawn into must be 24 bit
+ *  depth with 8 bit stencil, as the window and the benchmark
+ *  framebuffer are.
+ ***********************************************************/
+class TransparencyPass
+{
+public:
+	// constructor, the composite reads the targets from the passed
+	// in texture unit and the one after it
+	TransparencyPass(int firstTextureUnit);
+	// destructor
+	~TransparencyPass();
+
+	// compile the full screen composite program
+	bool LoadShaders(const char* vertexShaderFile, const char* fragmentShaderFile);
+	// false once the program or the targets could not be created,
+	// the transparent draws then have to be sorted instead
+	bool IsAvailable() const { return(NULL != m_pCompositeShader); }
+
+	// redirect the following draws into the transparency targets,
+	// false is returned and nothing is changed when the targets can
+	// not be created
+	bool Begin();
+	// composite the transparent draws over the framebuffer that was
+	// bound when Begin() was called, which leaves the composite
+	// program in use
+	void End();
+
+private:
+	ShaderManager* m_pCompositeShader;
+	GLint m_viewportOriginLocation;
+	// the composite draws a triangle without vertex data, but
+	// core profile draws still need a vertex array bound
+	GLuint m_compositeVao;
+	int m_firstTextureUnit;
+
+	// offscreen targets, sized to the viewport
+	GLuint m_framebuffer;
+	GLuint m_accumulationTexture;
+	GLuint m_weightTexture;
+	GLuint m_depthBuffer;
+	int m_width;
+	int m_height;
+
+	// framebuffer and viewport to composite into
+	GLint m_targetFramebuffer;
+	GLint m_viewport[4];
+
+	// create the targets at the passed in size, false is returned
+	// and the pass is no longer available when the framebuffer is
+	// not complete
+	bool CreateTargets(int width, int height);
+	// free the targets
+	void DestroyTargets();
+};
@@ -0,0 +1,233 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffers.cpp
+// ============
+// std140 uniform buffers holding the camera, light and material values that
+// every shader program shares, updated once instead of per program
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "UniformBuffers.h"
+
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// starting size of the region of one frame, a few updates of each
+	// per-frame block at the largest range alignment
+	const size_t g_FrameRingSize = 16 * 1024;
+}
+
+const char* UniformBuffers::FRAME_BLOCK_NAME = "FrameBlock";
+const char* UniformBuffers::LIGHT_BLOCK_NAME = "LightBlock";
+const char* UniformBuffers::MATERIAL_BLOCK_NAME = "MaterialBlock";
+const char* UniformBuffers::CLUSTER_BLOCK_NAME = "ClusterBlock";
+const char* UniformBuffers::SHADOW_BLOCK_NAME = "ShadowBlock";
+
+// the std140 rules round every struct up to 16 bytes
+static_assert(sizeof(UniformBuffers::FRAME_BLOCK) == 144, "FRAME_BLOCK does not match std140");
+static_assert(sizeof(UniformBuffers::POINT_LIGHT) == 64, "POINT_LIGHT does not match std140");
+static_assert(sizeof(UniformBuffers::SPOT_LIGHT) == 96, "SPOT_LIGHT does not match std140");
+static_assert(sizeof(UniformBuffers::MATERIAL) == 32, "MATERIAL does not match std140");
+static_assert(sizeof(UniformBuffers::CLUSTER_BLOCK) == 48, "CLUSTER_BLOCK does not match std140");
+static_assert(sizeof(UniformBuffers::SHADOW_BLOCK) == 64 * UniformBuffers::SHADOW_MAPS + 32, "SHADOW_BLOCK does not match std140");
+
+/***********************************************************
+ *  UniformBuffers()
+ *
+ *  The constructor for the class.  The buffers are created
+ *  at full size and bound to their binding points, which
+ *  they keep for the life of the context.
+ ***********************************************************/
+UniformBuffers::UniformBuffers()
+{
+	const size_t blockSizes[BINDING_COUNT] =
+	{
+		sizeof(FRAME_BLOCK),
+		sizeof(LIGHT_BLOCK),
+		sizeof(MATERIAL_BLOCK),
+		sizeof(CLUSTER_BLOCK),
+		sizeof(SHADOW_BLOCK)
+	};
+
+	m_frame.view = glm::mat4(1.0f);
+	m_frame.projection = glm::mat4(1.0f);
+	m_frame.viewPosition = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	m_clusters.depthSlicing = glm::vec4(0.0f);
+	m_clusters.viewport = glm::vec4(0.0f);
+	m_clusters.grid = glm::ivec4(0, 0, 0, 0);
+	for (int i = 0; i < SHADOW_MAPS; i++)
+	{
+		m_shadows.matrices[i] = glm::mat4(1.0f);
+	}
+	m_shadows.cascadeSplits = glm::vec4(0.0f);
+	m_shadows.settings = glm::ivec4(0, 0, 0, 0);
+
+	glGenBuffers(BINDING_COUNT, m_buffers);
+	for (int i = 0; i < BINDING_COUNT; i++)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffers[i]);
+		glBufferData(GL_UNIFORM_BUFFER, blockSizes[i], NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, (GLuint)i, m_buffers[i]);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_pFrameRing = NULL;
+	m_offsetAlignment = 1;
+	if (FrameRing::IsSupported() == true)
+	{
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		m_offsetAlignment = (alignment > 0) ? (size_t)alignment : 256;
+		m_pFrameRing = new FrameRing(GL_UNIFORM_BUFFER, g_FrameRingSize);
+	}
+}
+
+/***********************************************************
+ *  ~UniformBuffers()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+UniformBuffers::~UniformBuffers()
+{
+	if (NULL != m_pFrameRing)
+	{
+		delete m_pFrameRing;
+		m_pFrameRing = NULL;
+	}
+	glDeleteBuffers(BINDING_COUNT, m_buffers);
+}
+
+/***********************************************************
+ *  IsPerFrame()
+ *
+ *  This method is used for checking whether a block gets new
+ *  values every frame, which puts it in the frame ring.
+ ***********************************************************/
+bool UniformBuffers::IsPerFrame(BINDING_POINT binding)
+{
+	return((FRAME_BINDING == binding) || (CLUSTER_BINDING == binding) || (SHADOW_BINDING == binding));
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving the per-frame blocks into
+ *  the region of the next frame, carrying over their last
+ *  values.
+ ***********************************************************/
+void UniformBuffers::BeginFrame()
+{
+	if (NULL == m_pFrameRing)
+	{
+		return;
+	}
+
+	m_pFrameRing->BeginFrame();
+	Update(FRAME_BINDING, &m_frame, sizeof(m_frame));
+	Update(CLUSTER_BINDING, &m_clusters, sizeof(m_clusters));
+	Update(SHADOW_BINDING, &m_shadows, sizeof(m_shadows));
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the region of the frame
+ *  after its last draw.
+ ***********************************************************/
+void UniformBuffers::EndFrame()
+{
+	if (NULL != m_pFrameRing)
+	{
+		m_pFrameRing->EndFrame();
+	}
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for copying the passed in block
+ *  values into the buffer of a binding point.  A per-frame
+ *  block goes into the frame ring and its binding point is
+ *  moved to the copy, when the region of the frame is full
+ *  it goes back to its own buffer for the rest of the frame.
+ ***********************************************************/
+void UniformBuffers::Update(BINDING_POINT binding, const void* pData, size_t size)
+{
+	if ((NULL != m_pFrameRing) && (IsPerFrame(binding) == true))
+	{
+		GLintptr offset = 0;
+		void* pBlock = m_pFrameRing->Allocate(size, m_offsetAlignment, offset);
+		if (NULL != pBlock)
+		{
+			memcpy(pBlock, pData, size);
+			glBindBufferRange(GL_UNIFORM_BUFFER, (GLuint)binding, m_pFrameRing->GetBuffer(), offset, (GLsizeiptr)size);
+			return;
+		}
+		glBindBufferBase(GL_UNIFORM_BUFFER, (GLuint)binding, m_buffers[binding]);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_buffers[binding]);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, size, pData);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  UpdateFrame()
+ *
+ *  This method is used for setting the camera values of the
+ *  frame that is about to be drawn.
+ ***********************************************************/
+void UniformBuffers::UpdateFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition)
+{
+	m_frame.view = view;
+	m_frame.projection = projection;
+	m_frame.viewPosition = glm::vec4(viewPosition, 1.0f);
+
+	Update(FRAME_BINDING, &m_frame, sizeof(m_frame));
+}
+
+/***********************************************************
+ *  UpdateLights()
+ *
+ *  This method is used for setting the light sources.
+ ***********************************************************/
+void UniformBuffers::UpdateLights(const LIGHT_BLOCK& lights)
+{
+	Update(LIGHT_BINDING, &lights, sizeof(lights));
+}
+
+/***********************************************************
+ *  UpdateMaterials()
+ *
+ *  This method is used for setting the object materials.
+ ***********************************************************/
+void UniformBuffers::UpdateMaterials(const MATERIAL_BLOCK& materials)
+{
+	Update(MATERIAL_BINDING, &materials, sizeof(materials));
+}
+
+/***********************************************************
+ *  UpdateClusters()
+ *
+ *  This method is used for setting the light cluster grid of
+ *  the frame that is about to be drawn.
+ ***********************************************************/
+void UniformBuffers::UpdateClusters(const CLUSTER_BLOCK& clusters)
+{
+	m_clusters = clusters;
+	Update(CLUSTER_BINDING, &clusters, sizeof(clusters));
+}
+
+/***********************************************************
+ *  UpdateShadows()
+ *
+ *  This method is used for setting the shadow map matrices
+ *  and filter settings of the frame that is about to be
+ *  drawn.
+ ***********************************************************/
+void UniformBuffers::UpdateShadows(const SHADOW_BLOCK& shadows)
+{
+	m_shadows = shadows;
+	Update(SHADOW_BINDING, &shadows, sizeof(shadows));
+}
@@ -0,0 +1,194 @@
+///////////////////////////////////////////////////////////////////////////////
+// uniformbuffers.h
+// ============
+// std140 uniform buffers holding the camera, light and material values that
+// every shader program shares, updated once instead of per program
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameRing.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/***********************************************************
+ *  UniformBuffers
+ *
+ *  This class owns one uniform buffer per block.  The block
+ *  structs below are laid out by the std140 rules, matching
+ *  the blocks declared in the shaders, so each update is a
+ *  single buffer copy.  Programs connect their blocks to the
+ *  binding points with ShaderUniforms::BindBlock().
+ *
+ *  The blocks that change every frame are written into a
+ *  frame ring when the context has one, and bound at their
+ *  place in it, so an update never waits for the draws of
+ *  an earlier frame.  Every frame starts with the last
+ *  values of those blocks, so a block that is not updated
+ *  in a frame still reads from the frame's own region.
+ ***********************************************************/
+class UniformBuffers
+{
+public:
+	// constructor
+	UniformBuffers();
+	// destructor
+	~UniformBuffers();
+
+	// binding points of the blocks, shared by every program
+	enum BINDING_POINT
+	{
+		FRAME_BINDING = 0,
+		LIGHT_BINDING,
+		MATERIAL_BINDING,
+		CLUSTER_BINDING,
+		SHADOW_BINDING,
+		BINDING_COUNT
+	};
+
+	// names of the blocks in the shader code
+	static const char* FRAME_BLOCK_NAME;
+	static const char* LIGHT_BLOCK_NAME;
+	static const char* MATERIAL_BLOCK_NAME;
+	static const char* CLUSTER_BLOCK_NAME;
+	static const char* SHADOW_BLOCK_NAME;
+
+	// array sizes of the blocks, must match the shader code
+	static const int MAX_POINT_LIGHTS = 5;
+	static const int MAX_MATERIALS = 16;
+	// cascades of the directional light shadow, followed by the
+	// shadow of the spot light
+	static const int SHADOW_CASCADES = 3;
+	static const int SHADOW_MAPS = SHADOW_CASCADES + 1;
+
+	// camera values, updated once per frame
+	struct FRAME_BLOCK
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 viewPosition;		// w unused
+	};
+
+	struct DIRECTIONAL_LIGHT
+	{
+		glm::vec3 direction;
+		int32_t bActive;
+		glm::vec3 ambient;
+		float reserved0;
+		glm::vec3 diffuse;
+		float reserved1;
+		glm::vec3 specular;
+		float reserved2;
+	};
+
+	struct POINT_LIGHT
+	{
+		glm::vec3 position;
+		int32_t bActive;
+		glm::vec3 ambient;
+		float reserved0;
+		glm::vec3 diffuse;
+		float reserved1;
+		glm::vec3 specular;
+		float reserved2;
+	};
+
+	struct SPOT_LIGHT
+	{
+		glm::vec3 position;
+		float cutOff;
+		glm::vec3 direction;
+		float outerCutOff;
+		glm::vec3 ambient;
+		float constant;
+		glm::vec3 diffuse;
+		float linear;
+		glm::vec3 specular;
+		float quadratic;
+		int32_t bActive;
+		int32_t reserved[3];
+	};
+
+	// light sources, updated when the lights change
+	struct LIGHT_BLOCK
+	{
+		DIRECTIONAL_LIGHT directionalLight;
+		POINT_LIGHT pointLights[MAX_POINT_LIGHTS];
+		SPOT_LIGHT spotLight;
+	};
+
+	struct MATERIAL
+	{
+		glm::vec3 diffuseColor;
+		float shininess;
+		glm::vec3 specularColor;
+		float reserved;
+	};
+
+	// object materials, updated when the materials change
+	struct MATERIAL_BLOCK
+	{
+		MATERIAL materials[MAX_MATERIALS];
+	};
+
+	// how the fragments find their light cluster, see LightClusters,
+	// updated once per frame
+	struct CLUSTER_BLOCK
+	{
+		// near and far plane, and the depth slices per log(depth / near)
+		glm::vec4 depthSlicing;
+		// x, y, width and height of the viewport
+		glm::vec4 viewport;
+		// clusters across, down and deep, w unused
+		glm::ivec4 grid;
+	};
+
+	// how the fragments look up their shadows, see ShadowMaps,
+	// updated once per frame
+	struct SHADOW_BLOCK
+	{
+		// world space to shadow map clip space of every map
+		glm::mat4 matrices[SHADOW_MAPS];
+		// view space depth each cascade reaches, w unused
+		glm::vec4 cascadeSplits;
+		// filter taps across and down, whether the directional light
+		// and the spot light cast shadows, w unused
+		glm::ivec4 settings;
+	};
+
+	// start and end the writes of a frame to the per-frame blocks
+	void BeginFrame();
+	void EndFrame();
+
+	// copy new values into the blocks
+	void UpdateFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPosition);
+	void UpdateLights(const LIGHT_BLOCK& lights);
+	void UpdateMaterials(const MATERIAL_BLOCK& materials);
+	void UpdateClusters(const CLUSTER_BLOCK& clusters);
+	void UpdateShadows(const SHADOW_BLOCK& shadows);
+
+	// camera values of the frame being drawn
+	const FRAME_BLOCK& GetFrame() const { return(m_frame); }
+
+private:
+	GLuint m_buffers[BINDING_COUNT];
+	// copy of the last frame block values
+	FRAME_BLOCK m_frame;
+	// copies of the last values of the other per-frame blocks
+	CLUSTER_BLOCK m_clusters;
+	SHADOW_BLOCK m_shadows;
+	// regions for the per-frame blocks, NULL when the context can not
+	// map buffers persistently
+	FrameRing* m_pFrameRing;
+	// offsets of the ring ranges must be multiples of this
+	size_t m_offsetAlignment;
+
+	// copy a block into its buffer
+	void Update(BINDING_POINT binding, const void* pData, size_t size);
+	// check whether a block is written again every frame
+	static bool IsPerFrame(BINDING_POINT binding);
+};
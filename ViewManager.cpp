@@ -14,6 +14,8 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <algorithm>
+
 // declaration of the global variables and defines
 namespace
 {
@@ -22,6 +24,11 @@ namespace
 	const int WINDOW_HEIGHT = 800;
 	const char* g_ViewName = "view";
 	const char* g_ProjectionName = "projection";
+	const char* g_ViewPositionName = "viewPosition";
+
+	// clipping plane distances of the perspective projection
+	const float g_NearPlane = 0.1f;
+	const float g_DefaultFarPlane = 100.0f;
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -32,14 +39,50 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	// the camera moves in fixed steps, so its motion does not depend
+	// on the frame times, and is drawn between its last two steps
+	const double g_CameraStep = 1.0 / 120.0;
+	// most time caught up on in one frame, a longer hitch slows the
+	// camera down instead of running many steps at once
+	const double g_MaxCatchUp = 0.25;
+	// time of the last frame, negative before the first one, and the
+	// time not yet covered by steps
+	double gLastFrameTime = -1.0;
+	double gStepAccumulator = 0.0;
+	// true when the view did not change in the last update, the time
+	// until the next one may have been spent waiting for input
+	bool gCameraResting = false;
+	// set when the window contents were lost, until the next update
+	bool gRefreshRequested = false;
+
+	// mouse movement and scrolling since the last step
+	float gPendingMouseX = 0.0f;
+	float gPendingMouseY = 0.0f;
+	float gPendingScroll = 0.0f;
+
+	// the camera pose before the last step, and whether the camera
+	// jumped since, so it is drawn where it is without blending
+	glm::vec3 gPreviousPos;
+	glm::vec3 gPreviousFront;
+	glm::vec3 gPreviousUp;
+	bool gSnapCamera = true;
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
 	bool bOrthographicProjection = false;
 
+	// set when the left mouse button is clicked, until the pick ray
+	// is taken with GetPickRay()
+	bool gPickRequested = false;
+
+	// set when Z is pressed, until the press is taken with
+	// GetDepthPrepassToggle()
+	bool gDepthPrepassToggled = false;
+
+	// set when T is pressed, until the press is taken with
+	// GetTextureReportRequest()
+	bool gTextureReportRequested = false;
+
 	float gMoveSpeed = 1.0f;          // scroll-controlled travel speed
 	const float gMinSpeed = 0.25f;
 	const float gMaxSpeed = 6.0f;
@@ -62,6 +105,7 @@ namespace
 		g_pCamera->Up = kDefaultUp;
 		g_pCamera->Zoom = kDefaultZoom;
 		// If the Camera caches Right/Up via angles, call a recalc here.
+		gSnapCamera = true;
 	}
 }
 
@@ -76,6 +120,18 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_pUniforms = NULL;
+	m_viewLocation = -1;
+	m_projectionLocation = -1;
+	m_viewPositionLocation = -1;
+	m_bFrameBlock = false;
+	m_pUniformBuffers = NULL;
+	m_farPlane = g_DefaultFarPlane;
+	m_view = glm::mat4(1.0f);
+	m_projection = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_bViewValid = false;
+	m_bViewUpdated = false;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -95,6 +151,12 @@ ViewManager::~ViewManager()
 	// free up allocated memory
 	m_pShaderManager = NULL;
 	m_pWindow = NULL;
+	m_pUniformBuffers = NULL;
+	if (NULL != m_pUniforms)
+	{
+		delete m_pUniforms;
+		m_pUniforms = NULL;
+	}
 	if (NULL != g_pCamera)
 	{
 		delete g_pCamera;
@@ -131,6 +193,9 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	// this callback is used to receive mouse moving events
 	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
 	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Callback);
+	glfwSetMouseButtonCallback(window, &ViewManager::Mouse_Button_Callback);
+	// this callback is used to draw the window again after it was covered
+	glfwSetWindowRefreshCallback(window, &ViewManager::Window_Refresh_Callback);
 
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
@@ -141,11 +206,62 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 	return(window);
 }
 
+/***********************************************************
+ *  CreateOffscreenWindow()
+ *
+ *  This method is used to create a hidden window of the same
+ *  size as the display window.  It only provides the OpenGL
+ *  context, so the mouse is not captured and the frames are
+ *  drawn into a framebuffer object instead of the window.
+ ***********************************************************/
+GLFWwindow* ViewManager::CreateOffscreenWindow(const char* windowTitle)
+{
+	GLFWwindow* window = nullptr;
+
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	window = glfwCreateWindow(
+		WINDOW_WIDTH,
+		WINDOW_HEIGHT,
+		windowTitle,
+		NULL, NULL);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create offscreen GLFW window" << std::endl;
+		glfwTerminate();
+		return NULL;
+	}
+	glfwMakeContextCurrent(window);
+
+	// enable blending for supporting tranparent rendering
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_pWindow = window;
+
+	return(window);
+}
+
+/***********************************************************
+ *  SetCameraPose()
+ *
+ *  This method is used to place the camera at a position,
+ *  looking at a target point, for scripted camera paths.
+ ***********************************************************/
+void ViewManager::SetCameraPose(const glm::vec3& position, const glm::vec3& target)
+{
+	g_pCamera->Position = position;
+	g_pCamera->Front = glm::normalize(target - position);
+	g_pCamera->Up = kDefaultUp;
+	gSnapCamera = true;
+}
+
 /***********************************************************
  *  Mouse_Position_Callback()
  *
  *  This method is automatically called from GLFW whenever
  *  the mouse is moved within the active GLFW display window.
+ *  The movement is kept until the next camera step.
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
@@ -167,8 +283,9 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	// the next camera step turns the camera by the offsets
+	gPendingMouseX += xOffset;
+	gPendingMouseY += yOffset;
 }
 
 /***********************************************************
@@ -179,10 +296,106 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
  ***********************************************************/
 void ViewManager::Mouse_Scroll_Callback(GLFWwindow*, double, double yoffset)
 {
-	float factor = 1.0f + static_cast<float>(yoffset) * 0.1f; // each notch changes speed ~10%
-	gMoveSpeed *= factor;
-	if (gMoveSpeed < gMinSpeed) gMoveSpeed = gMinSpeed;
-	if (gMoveSpeed > gMaxSpeed) gMoveSpeed = gMaxSpeed;
+	// the next camera step changes the speed by the notches
+	gPendingScroll += static_cast<float>(yoffset);
+}
+
+/***********************************************************
+ *  Mouse_Button_Callback()
+ *
+ *  This method is automatically called from GLFW whenever a
+ *  mouse button is pressed or released within the window.
+ ***********************************************************/
+void ViewManager::Mouse_Button_Callback(GLFWwindow*, int button, int action, int)
+{
+	if ((button == GLFW_MOUSE_BUTTON_LEFT) && (action == GLFW_PRESS))
+	{
+		gPickRequested = true;
+	}
+}
+
+/***********************************************************
+ *  Window_Refresh_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the contents of the window were damaged, such as after it
+ *  was uncovered or resized.
+ ***********************************************************/
+void ViewManager::Window_Refresh_Callback(GLFWwindow*)
+{
+	gRefreshRequested = true;
+}
+
+/***********************************************************
+ *  GetPickRay()
+ *
+ *  This method is used for getting the ray of a mouse click.
+ *  The cursor is captured to steer the camera, so the tracked
+ *  mouse position does not map to the window, and the ray is
+ *  cast through the center of the view where the camera is
+ *  pointing.
+ ***********************************************************/
+bool ViewManager::GetPickRay(glm::vec3& origin, glm::vec3& direction)
+{
+	if ((gPickRequested == false) || (NULL == g_pCamera))
+	{
+		return(false);
+	}
+	gPickRequested = false;
+
+	// unproject the point on the far plane in the middle of the view
+	glm::mat4 inverseClip = glm::inverse(GetProjection() * g_pCamera->GetViewMatrix());
+	glm::vec4 farPoint = inverseClip * glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+	origin = g_pCamera->Position;
+	direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetDepthPrepassToggle()
+ *
+ *  This method is used for checking whether the depth
+ *  pre-pass key was pressed since the last call.
+ ***********************************************************/
+bool ViewManager::GetDepthPrepassToggle()
+{
+	if (gDepthPrepassToggled == false)
+	{
+		return(false);
+	}
+	gDepthPrepassToggled = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetTextureReportRequest()
+ *
+ *  This method is used for checking whether the texture
+ *  report key was pressed since the last call.
+ ***********************************************************/
+bool ViewManager::GetTextureReportRequest()
+{
+	if (gTextureReportRequested == false)
+	{
+		return(false);
+	}
+	gTextureReportRequested = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetProjection()
+ *
+ *  This method is used for building the perspective
+ *  projection matrix from the camera zoom and window size.
+ ***********************************************************/
+glm::mat4 ViewManager::GetProjection() const
+{
+	return(glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, g_NearPlane, m_farPlane));
 }
 
 /***********************************************************
@@ -214,9 +427,26 @@ void ViewManager::ProcessKeyboardEvents()
 	}
 	rLast = rNow;
 
+	// Toggle the depth pre-pass with Z
+	static bool zLast = false;
+	bool zNow = glfwGetKey(m_pWindow, GLFW_KEY_Z) == GLFW_PRESS;
+	if (zNow && !zLast) {
+		gDepthPrepassToggled = true;
+	}
+	zLast = zNow;
+
+	// Report the texture memory with T
+	static bool tLast = false;
+	bool tNow = glfwGetKey(m_pWindow, GLFW_KEY_T) == GLFW_PRESS;
+	if (tNow && !tLast) {
+		gTextureReportRequested = true;
+	}
+	tLast = tNow;
+
 
 	if (pNow && !pLast) {
 		bOrthographicProjection = false;
+		gSnapCamera = true;
 		if (gSavedPoseValid) {
 			g_pCamera->Position = gSavedPos;
 			g_pCamera->Front = gSavedFront;
@@ -225,6 +455,7 @@ void ViewManager::ProcessKeyboardEvents()
 	}
 	if (oNow && !oLast) {
 		gSavedPoseValid = true;
+		gSnapCamera = true;
 		gSavedPos = g_pCamera->Position;
 		gSavedFront = g_pCamera->Front;
 		gSavedUp = g_pCamera->Up;
@@ -236,9 +467,37 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	}
 	pLast = pNow; oLast = oNow;
+}
+
+/***********************************************************
+ *  StepCamera()
+ *
+ *  This method is used for moving the camera by one fixed
+ *  step.  The held keys move it for the step time, and the
+ *  mouse movement and scrolling since the last step are
+ *  applied all at once.
+ ***********************************************************/
+void ViewManager::StepCamera(float stepTime)
+{
+	if (!g_pCamera) return;
+
+	if ((gPendingMouseX != 0.0f) || (gPendingMouseY != 0.0f))
+	{
+		g_pCamera->ProcessMouseMovement(gPendingMouseX, gPendingMouseY);
+		gPendingMouseX = 0.0f;
+		gPendingMouseY = 0.0f;
+	}
+	if (gPendingScroll != 0.0f)
+	{
+		float factor = 1.0f + gPendingScroll * 0.1f; // each notch changes speed ~10%
+		gMoveSpeed *= factor;
+		if (gMoveSpeed < gMinSpeed) gMoveSpeed = gMinSpeed;
+		if (gMoveSpeed > gMaxSpeed) gMoveSpeed = gMaxSpeed;
+		gPendingScroll = 0.0f;
+	}
 
 	// wheel-scaled movement for ALL keys
-	const float dt = gDeltaTime * gMoveSpeed;
+	const float dt = stepTime * gMoveSpeed;
 
 	// WASD
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS) g_pCamera->ProcessKeyboard(FORWARD, dt);
@@ -254,40 +513,129 @@ void ViewManager::ProcessKeyboardEvents()
 }
 
 /***********************************************************
- *  PrepareSceneView()
+ *  UpdateCamera()
  *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  This method is used for moving the camera by the time
+ *  since the last frame.  The camera takes as many fixed
+ *  steps as the time holds, and the view is placed between
+ *  the poses of the last two steps by the time left over, so
+ *  a slow frame does not make the camera jump.  A camera at
+ *  rest only catches up on one step, since the time since
+ *  the last frame may have been spent waiting for the input
+ *  that moves it.
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+bool ViewManager::UpdateCamera()
 {
-	glm::mat4 view;
-	glm::mat4 projection;
-
 	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	double currentFrame = glfwGetTime();
+	if (gLastFrameTime < 0.0)
+	{
+		gLastFrameTime = currentFrame;
+	}
+	double catchUp = (gCameraResting == true) ? g_CameraStep : g_MaxCatchUp;
+	gStepAccumulator += std::min(currentFrame - gLastFrameTime, catchUp);
+	gLastFrameTime = currentFrame;
 
 	// process any keyboard events that may be waiting in the 
 	// event queue
 	ProcessKeyboardEvents();
 
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
+	while (gStepAccumulator >= g_CameraStep)
+	{
+		gPreviousPos = g_pCamera->Position;
+		gPreviousFront = g_pCamera->Front;
+		gPreviousUp = g_pCamera->Up;
+		StepCamera((float)g_CameraStep);
+		gStepAccumulator -= g_CameraStep;
+	}
+	if (gSnapCamera == true)
+	{
+		gPreviousPos = g_pCamera->Position;
+		gPreviousFront = g_pCamera->Front;
+		gPreviousUp = g_pCamera->Up;
+		gSnapCamera = false;
+	}
+
+	// get the view matrix of the pose between the last two steps, a
+	// camera the last step did not move is not blended, since blending
+	// equal poses can round differently as the time left over changes
+	glm::vec3 viewPosition = g_pCamera->Position;
+	glm::vec3 viewFront = g_pCamera->Front;
+	glm::vec3 viewUp = g_pCamera->Up;
+	if ((gPreviousPos != viewPosition) || (gPreviousFront != viewFront) || (gPreviousUp != viewUp))
+	{
+		float blend = (float)(gStepAccumulator / g_CameraStep);
+		viewPosition = glm::mix(gPreviousPos, g_pCamera->Position, blend);
+		viewFront = glm::mix(gPreviousFront, g_pCamera->Front, blend);
+		viewUp = glm::mix(gPreviousUp, g_pCamera->Up, blend);
+	}
+	glm::mat4 view = glm::lookAt(viewPosition, viewPosition + viewFront, viewUp);
 
 	// define the current projection matrix
-	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	glm::mat4 projection = GetProjection();
+
+	bool bChanged = (m_bViewValid == false) || (gRefreshRequested == true) ||
+		(view != m_view) || (projection != m_projection);
+	m_view = view;
+	m_projection = projection;
+	m_viewPosition = viewPosition;
+	m_bViewValid = true;
+	m_bViewUpdated = true;
+	gCameraResting = (bChanged == false);
+	gRefreshRequested = false;
+
+	return(bChanged);
+}
+
+/***********************************************************
+ *  PrepareSceneView()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering.  The camera is moved first unless the frame
+ *  already did so with UpdateCamera().
+ ***********************************************************/
+void ViewManager::PrepareSceneView()
+{
+	if (m_bViewUpdated == false)
+	{
+		UpdateCamera();
+	}
+	m_bViewUpdated = false;
+
+	const glm::mat4& view = m_view;
+	const glm::mat4& projection = m_projection;
+	const glm::vec3& viewPosition = m_viewPosition;
+
+	// the shared frame block feeds every program that declares it
+	if (NULL != m_pUniformBuffers)
+	{
+		m_pUniformBuffers->UpdateFrame(view, projection, viewPosition);
+	}
 
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		// the shaders are linked by now, so look up the locations once,
+		// and again after the program was rebuilt from edited files
+		if ((NULL == m_pUniforms) || (m_pUniforms->GetProgramID() != m_pShaderManager->m_programID))
+		{
+			delete m_pUniforms;
+			m_pUniforms = new ShaderUniforms(m_pShaderManager->m_programID);
+			m_viewLocation = m_pUniforms->GetLocation(g_ViewName);
+			m_projectionLocation = m_pUniforms->GetLocation(g_ProjectionName);
+			m_viewPositionLocation = m_pUniforms->GetLocation(g_ViewPositionName);
+			m_bFrameBlock = m_pUniforms->BindBlock(UniformBuffers::FRAME_BLOCK_NAME, UniformBuffers::FRAME_BINDING);
+		}
+
+		if ((m_bFrameBlock == false) || (NULL == m_pUniformBuffers))
+		{
+			// set the view matrix into the shader for proper rendering
+			glUniformMatrix4fv(m_viewLocation, 1, GL_FALSE, &view[0][0]);
+			// set the projection matrix into the shader for proper rendering
+			glUniformMatrix4fv(m_projectionLocation, 1, GL_FALSE, &projection[0][0]);
+			// set the view position of the camera into the shader for proper rendering
+			glUniform3fv(m_viewPositionLocation, 1, &viewPosition[0]);
+		}
 	}
 }
\ No newline at end of file
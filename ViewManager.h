@@ -10,6 +10,8 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "ShaderUniforms.h"
+#include "UniformBuffers.h"
 #include "camera.h"
 
 // GLFW library
@@ -27,20 +29,70 @@ public:
 	// mouse position callback for mouse interaction with the 3D scene
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
 	static void Mouse_Scroll_Callback(GLFWwindow* window, double xoffset, double yoffset);
+	// mouse button callback for picking objects in the 3D scene
+	static void Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods);
+	// refresh callback for when the window contents have to be drawn again
+	static void Window_Refresh_Callback(GLFWwindow* window);
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// uniform locations of the main program, looked up on first use
+	ShaderUniforms* m_pUniforms;
+	GLint m_viewLocation;
+	GLint m_projectionLocation;
+	GLint m_viewPositionLocation;
+	// true when the main program reads the camera from the frame block
+	bool m_bFrameBlock;
+	// shared uniform blocks, owned by the scene manager
+	UniformBuffers* m_pUniformBuffers;
+	// distance to the far clipping plane of the perspective projection
+	float m_farPlane;
+	// camera values of the frame, built by UpdateCamera()
+	glm::mat4 m_view;
+	glm::mat4 m_projection;
+	glm::vec3 m_viewPosition;
+	// false until the camera values were first built
+	bool m_bViewValid;
+	// true when UpdateCamera() ran since the last PrepareSceneView()
+	bool m_bViewUpdated;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
+	// move the camera by one fixed step of the held keys and the mouse
+	// movement since the last step
+	void StepCamera(float stepTime);
+	// build the perspective projection matrix of the camera
+	glm::mat4 GetProjection() const;
 
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+	// create a hidden window that only provides the OpenGL context
+	GLFWwindow* CreateOffscreenWindow(const char* windowTitle);
 	
-	// prepare the conversion from 3D object display to 2D scene display
+	// move the camera in fixed steps by the time since the last frame,
+	// true when the view differs from the last one or the window has to
+	// be drawn again
+	bool UpdateCamera();
+	// prepare the conversion from 3D object display to 2D scene display,
+	// the camera is moved in fixed steps and drawn between the last two
 	void PrepareSceneView();
+
+	// set the uniform blocks that receive the camera values
+	void SetUniformBuffers(UniformBuffers* pUniformBuffers) { m_pUniformBuffers = pUniformBuffers; }
+
+	// place the camera at a position looking at a target point
+	void SetCameraPose(const glm::vec3& position, const glm::vec3& target);
+	// get the world space ray of a click since the last call, false
+	// when the scene has not been clicked
+	bool GetPickRay(glm::vec3& origin, glm::vec3& direction);
+	// true once for each press of the depth pre-pass key
+	bool GetDepthPrepassToggle();
+	// true once for each press of the texture report key
+	bool GetTextureReportRequest();
+	// set how far the camera sees, for scenes larger than the kitchen
+	void SetFarPlane(float farPlane) { m_farPlane = farPlane; }
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+///////////////////////////////////////////////////////////////////////////////
+// depthpyramidcomputeshader.glsl
+// ============
+// compute shader for DepthPyramid - copies the scene depth into the first
+// level, and reduces each level into the next one by keeping the farthest
+// depth of the texels under every texel
+///////////////////////////////////////////////////////////////////////////////
+
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// the level before the one written, and the level written
+layout (binding = 0, r32f) readonly uniform image2D sourceLevel;
+layout (binding = 1, r32f) writeonly uniform image2D targetLevel;
+
+// the depth copied out of the scene framebuffer
+uniform sampler2D depthTexture;
+// true for the first level, which is copied from the depth texture
+uniform bool bCopyDepth;
+uniform ivec2 sourceSize;
+uniform ivec2 targetSize;
+
+void main()
+{
+	ivec2 target = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(target, targetSize)))
+	{
+		return;
+	}
+
+	if (bCopyDepth)
+	{
+		imageStore(targetLevel, target, vec4(texelFetch(depthTexture, target, 0).r));
+		return;
+	}
+
+	// the last texel of a level of odd size also covers the row or
+	// column that is left over by the halving
+	ivec2 source = 2 * target;
+	ivec2 extent = ivec2(2);
+	if ((target.x == targetSize.x - 1) && ((sourceSize.x & 1) == 1))
+	{
+		extent.x = 3;
+	}
+	if ((target.y == targetSize.y - 1) && ((sourceSize.y & 1) == 1))
+	{
+		extent.y = 3;
+	}
+
+	float farthest = 0.0f;
+	for (int y = 0; y < extent.y; y++)
+	{
+		for (int x = 0; x < extent.x; x++)
+		{
+			ivec2 texel = min(source + ivec2(x, y), sourceSize - 1);
+			farthest = max(farthest, imageLoad(sourceLevel, texel).r);
+		}
+	}
+	imageStore(targetLevel, target, vec4(farthest));
+}
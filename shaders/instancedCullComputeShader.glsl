@@ -0,0 +1,209 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedcullcomputeshader.glsl
+// ============
+// compute shader for InstanceCulling - tests the box of every instance against
+// the view frustum and the depth pyramid of the last frame, picks the level of
+// detail of the visible ones and writes them into the draw commands of their
+// level
+///////////////////////////////////////////////////////////////////////////////
+
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+#define LOD_COUNT 3
+
+// the struct members match the structs in InstancedMeshes.h and
+// InstanceCulling.h under the std430 layout
+struct InstanceData
+{
+	mat4 model;
+	vec2 UVscale;
+	int materialIndex;
+	int textureLayer;
+};
+
+struct InstanceBounds
+{
+	vec3 boundsMin;
+	int command;
+	vec3 boundsMax;
+	int lodCount;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer InstanceBuffer
+{
+	InstanceData instances[];
+};
+
+layout (std430, binding = 1) readonly buffer BoundsBuffer
+{
+	InstanceBounds bounds[];
+};
+
+layout (std430, binding = 2) writeonly buffer VisibleBuffer
+{
+	InstanceData visibleInstances[];
+};
+
+layout (std430, binding = 3) buffer CommandBuffer
+{
+	DrawCommand commands[];
+};
+
+layout (std430, binding = 4) buffer LodBuffer
+{
+	uint instanceLods[];
+};
+
+// instances left out by the frustum and by the depth pyramid, must
+// match InstanceCulling::CULL_STATS
+layout (std430, binding = 5) buffer StatsBuffer
+{
+	uint frustumCulled;
+	uint occluded;
+};
+
+// xyz is the plane normal pointing into the frustum, w the distance
+uniform vec4 frustumPlanes[6];
+uniform bool bCull;
+uniform uint instanceCount;
+
+// occlusion test against the farthest depth of the last frame, with
+// the view projection that frame was drawn with
+uniform bool bOcclusion;
+uniform mat4 occlusionViewProjection;
+uniform sampler2D depthPyramid;
+uniform int pyramidLevels;
+// a few steps of the 24 bit depth buffer, so a box whose faces are the
+// faces of its mesh is not hidden by the rounded depth of its own mesh
+const float depthTolerance = 4.0f / 16777215.0f;
+
+// level of detail selection, the same as InstancedMeshes::SelectLod()
+uniform vec3 viewPosition;
+uniform float projectionScale;
+uniform float lodScreenSizes[LOD_COUNT - 1];
+uniform float lodHysteresis;
+
+int SelectLod(InstanceBounds box, int currentLod)
+{
+	vec3 center = 0.5f * (box.boundsMin + box.boundsMax);
+	float radius = 0.5f * length(box.boundsMax - box.boundsMin);
+	float distance = length(center - viewPosition);
+
+	// the finest level while the camera is inside the bounds
+	if (distance <= radius)
+	{
+		return(0);
+	}
+
+	float screenSize = radius * projectionScale / distance;
+	int lod = 0;
+	while (lod < box.lodCount - 1)
+	{
+		float margin = (currentLod > lod) ? (1.0f + lodHysteresis) : (1.0f - lodHysteresis);
+		if (screenSize >= lodScreenSizes[lod] * margin)
+		{
+			break;
+		}
+		lod++;
+	}
+	return(lod);
+}
+
+// the box is hidden when its nearest point is farther than the
+// farthest depth of every pixel its screen rectangle covers, a box
+// that reaches past the screen or behind the camera of the last frame
+// is never hidden, since the pyramid knows nothing about it
+bool IsOccluded(InstanceBounds box)
+{
+	vec3 ndcMin = vec3(1.0f);
+	vec3 ndcMax = vec3(-1.0f);
+	for (int i = 0; i < 8; i++)
+	{
+		vec3 corner = mix(box.boundsMin, box.boundsMax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+		vec4 clip = occlusionViewProjection * vec4(corner, 1.0f);
+		if (clip.w <= 0.0f)
+		{
+			return(false);
+		}
+		vec3 ndc = clip.xyz / clip.w;
+		ndcMin = min(ndcMin, ndc);
+		ndcMax = max(ndcMax, ndc);
+	}
+	if (any(lessThan(ndcMin, vec3(-1.0f))) || any(greaterThan(ndcMax.xy, vec2(1.0f))))
+	{
+		return(false);
+	}
+
+	// the level where the rectangle spans at most 2 x 2 texels
+	ivec2 size = textureSize(depthPyramid, 0);
+	ivec2 texelMin = clamp(ivec2((0.5f * ndcMin.xy + 0.5f) * vec2(size)), ivec2(0), size - 1);
+	ivec2 texelMax = clamp(ivec2((0.5f * ndcMax.xy + 0.5f) * vec2(size)), ivec2(0), size - 1);
+	ivec2 extent = texelMax - texelMin + 1;
+	int level = int(ceil(log2(float(max(extent.x, extent.y)))));
+	level = clamp(level, 0, pyramidLevels - 1);
+
+	// a texel of a level covers the texels below it at twice its
+	// coordinates, and the last one also covers what is left over
+	ivec2 levelSize = textureSize(depthPyramid, level);
+	ivec2 levelMin = min(texelMin >> level, levelSize - 1);
+	ivec2 levelMax = min(texelMax >> level, levelSize - 1);
+	float farthest = 0.0f;
+	for (int y = levelMin.y; y <= levelMax.y; y++)
+	{
+		for (int x = levelMin.x; x <= levelMax.x; x++)
+		{
+			farthest = max(farthest, texelFetch(depthPyramid, ivec2(x, y), level).r);
+		}
+	}
+
+	return(0.5f * ndcMin.z + 0.5f > farthest + depthTolerance);
+}
+
+void main()
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= instanceCount)
+	{
+		return;
+	}
+
+	InstanceBounds box = bounds[index];
+
+	// the box is outside when its corner farthest along the normal
+	// of a plane is still behind that plane
+	if (bCull)
+	{
+		for (int i = 0; i < 6; i++)
+		{
+			vec3 farthest = mix(box.boundsMin, box.boundsMax, greaterThanEqual(frustumPlanes[i].xyz, vec3(0.0f)));
+			if (dot(frustumPlanes[i].xyz, farthest) + frustumPlanes[i].w < 0.0f)
+			{
+				atomicAdd(frustumCulled, 1u);
+				return;
+			}
+		}
+	}
+	if (bOcclusion && IsOccluded(box))
+	{
+		atomicAdd(occluded, 1u);
+		return;
+	}
+
+	int lod = SelectLod(box, int(instanceLods[index]));
+	instanceLods[index] = uint(lod);
+
+	int command = box.command + lod;
+	uint slot = atomicAdd(commands[command].instanceCount, 1u);
+	visibleInstances[commands[command].baseInstance + slot] = instances[index];
+}
@@ -0,0 +1,298 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedfragmentshader.glsl
+// ============
+// fragment shader for InstancedMeshes - same lighting as the main fragment
+// shader, read from uniform blocks, with the material picked per instance
+// and the point lights looked up in the light clusters, the directional and
+// spot lights are shadowed by the shadow maps
+//
+// built as variants by ShaderPermutations, which puts a #define after the
+// #version line for every feature of a variant: TEXTURE, TEXTURE_ARRAY,
+// LIGHTING, DIRECTIONAL_LIGHT, POINT_LIGHTS and SPOT_LIGHT
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+#define MAX_MATERIALS 16
+#define TOTAL_POINT_LIGHTS 5
+#define SHADOW_CASCADES 3
+#define SHADOW_MAPS 4
+
+// the struct members are ordered so the std140 layout of the
+// blocks matches the structs in UniformBuffers.h
+struct Material
+{
+	vec3 diffuseColor;
+	float shininess;
+	vec3 specularColor;
+};
+
+struct DirectionalLight
+{
+	vec3 direction;
+	bool bActive;
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct PointLight
+{
+	vec3 position;
+	bool bActive;
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct SpotLight
+{
+	vec3 position;
+	float cutOff;
+	vec3 direction;
+	float outerCutOff;
+	vec3 ambient;
+	float constant;
+	vec3 diffuse;
+	float linear;
+	vec3 specular;
+	float quadratic;
+	bool bActive;
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+flat in int fragmentMaterial;
+flat in int fragmentTextureLayer;
+
+out vec4 outFragmentColor;
+
+uniform vec4 objectColor;
+#if defined(TEXTURE)
+uniform sampler2D objectTexture;
+#elif defined(TEXTURE_ARRAY)
+// textures packed by TextureArrays, the layer comes with each instance
+uniform sampler2DArray objectTextures;
+#endif
+
+layout (std140) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+layout (std140) uniform LightBlock
+{
+	DirectionalLight directionalLight;
+	// read by the main program, the point lights here come from the
+	// light clusters
+	PointLight pointLights[TOTAL_POINT_LIGHTS];
+	SpotLight spotLight;
+};
+
+// the point lights binned into view space clusters by LightClusters,
+// four texels per light: position and range, ambient, diffuse, specular
+uniform samplerBuffer clusterLights;
+// first light index and light count of every cluster, then the indices
+uniform usamplerBuffer clusterLightLists;
+
+layout (std140) uniform ClusterBlock
+{
+	vec4 clusterDepthSlicing;		// near, far, slices / log(far / near)
+	vec4 clusterViewport;
+	ivec4 clusterGrid;
+};
+
+// the maps drawn by ShadowMaps, the cascades of the directional light
+// followed by the map of the spot light
+uniform sampler2DArrayShadow shadowMaps;
+
+layout (std140) uniform ShadowBlock
+{
+	mat4 shadowMatrices[SHADOW_MAPS];
+	vec4 shadowCascadeSplits;		// view space depth each cascade reaches
+	ivec4 shadowSettings;			// filter taps, sun shadows, spot shadows
+};
+
+layout (std140) uniform MaterialBlock
+{
+	Material materials[MAX_MATERIALS];
+};
+
+// the share of a light reaching this fragment past one shadow map,
+// averaged over the filter taps around it, every tap comparing and
+// blending four texels
+float CalcShadow(int map)
+{
+	vec4 lightPosition = shadowMatrices[map] * vec4(fragmentPosition, 1.0f);
+	if (lightPosition.w <= 0.0f)
+	{
+		return 1.0f;
+	}
+	vec3 coordinates = lightPosition.xyz / lightPosition.w * 0.5f + 0.5f;
+	if (coordinates.z >= 1.0f)
+	{
+		return 1.0f;
+	}
+
+	vec2 texelSize = 1.0f / vec2(textureSize(shadowMaps, 0).xy);
+	int taps = shadowSettings.x;
+	float firstOffset = -0.5f * float(taps - 1);
+	float lit = 0.0f;
+	for (int y = 0; y < taps; y++)
+	{
+		for (int x = 0; x < taps; x++)
+		{
+			vec2 offset = (vec2(float(x), float(y)) + firstOffset) * texelSize;
+			lit += texture(shadowMaps, vec4(coordinates.xy + offset, float(map), coordinates.z));
+		}
+	}
+	return lit / float(taps * taps);
+}
+
+// the directional light shadow from the cascade covering the view
+// depth of this fragment, fragments past the last cascade are lit
+float CalcDirectionalShadow()
+{
+	if ((shadowSettings.x == 0) || (shadowSettings.y == 0))
+	{
+		return 1.0f;
+	}
+
+	float depth = -(view * vec4(fragmentPosition, 1.0f)).z;
+	for (int i = 0; i < SHADOW_CASCADES; i++)
+	{
+		if (depth < shadowCascadeSplits[i])
+		{
+			return CalcShadow(i);
+		}
+	}
+	return 1.0f;
+}
+
+float CalcSpotShadow()
+{
+	if ((shadowSettings.x == 0) || (shadowSettings.z == 0))
+	{
+		return 1.0f;
+	}
+	return CalcShadow(SHADOW_CASCADES);
+}
+
+// the shadow only darkens the diffuse and specular light
+vec3 CalcDirectionalLight(DirectionalLight light, Material material, vec3 normal, vec3 viewDirection, vec3 baseColor, float shadow)
+{
+	vec3 lightDirection = normalize(-light.direction);
+	float diffuseImpact = max(dot(normal, lightDirection), 0.0f);
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float specularImpact = pow(max(dot(viewDirection, reflectDirection), 0.0f), material.shininess);
+
+	vec3 ambient = light.ambient * baseColor;
+	vec3 diffuse = light.diffuse * diffuseImpact * material.diffuseColor * baseColor;
+	vec3 specular = light.specular * specularImpact * material.specularColor;
+	return ambient + (diffuse + specular) * shadow;
+}
+
+vec3 CalcSpotLight(SpotLight light, Material material, vec3 normal, vec3 viewDirection, vec3 baseColor, float shadow)
+{
+	vec3 lightDirection = normalize(light.position - fragmentPosition);
+	float diffuseImpact = max(dot(normal, lightDirection), 0.0f);
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float specularImpact = pow(max(dot(viewDirection, reflectDirection), 0.0f), material.shininess);
+
+	float distance = length(light.position - fragmentPosition);
+	float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	float theta = dot(lightDirection, normalize(-light.direction));
+	float epsilon = light.cutOff - light.outerCutOff;
+	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0f, 1.0f);
+
+	vec3 ambient = light.ambient * baseColor;
+	vec3 diffuse = light.diffuse * diffuseImpact * material.diffuseColor * baseColor;
+	vec3 specular = light.specular * specularImpact * material.specularColor;
+	return (ambient + (diffuse + specular) * intensity * shadow) * attenuation;
+}
+
+// find the cluster of this fragment from its place on the screen
+// and its view space depth
+int GetClusterIndex()
+{
+	vec2 screen = (gl_FragCoord.xy - clusterViewport.xy) / clusterViewport.zw;
+	ivec2 tile = clamp(ivec2(screen * vec2(clusterGrid.xy)), ivec2(0), clusterGrid.xy - 1);
+	float depth = max(-(view * vec4(fragmentPosition, 1.0f)).z, clusterDepthSlicing.x);
+	int slice = clamp(int(log(depth / clusterDepthSlicing.x) * clusterDepthSlicing.z), 0, clusterGrid.z - 1);
+
+	return tile.x + clusterGrid.x * (tile.y + clusterGrid.y * slice);
+}
+
+// a light with a range fades out smoothly before it, so it has no
+// effect outside of the clusters it was binned into
+vec3 CalcClusterLight(int lightIndex, Material material, vec3 normal, vec3 viewDirection, vec3 baseColor)
+{
+	vec4 positionRange = texelFetch(clusterLights, lightIndex * 4);
+	vec3 lightAmbient = texelFetch(clusterLights, lightIndex * 4 + 1).rgb;
+	vec3 lightDiffuse = texelFetch(clusterLights, lightIndex * 4 + 2).rgb;
+	vec3 lightSpecular = texelFetch(clusterLights, lightIndex * 4 + 3).rgb;
+
+	vec3 lightDirection = normalize(positionRange.xyz - fragmentPosition);
+	float diffuseImpact = max(dot(normal, lightDirection), 0.0f);
+	vec3 reflectDirection = reflect(-lightDirection, normal);
+	float specularImpact = pow(max(dot(viewDirection, reflectDirection), 0.0f), material.shininess);
+
+	float attenuation = 1.0f;
+	if (positionRange.w > 0.0f)
+	{
+		float ratio = length(positionRange.xyz - fragmentPosition) / positionRange.w;
+		float window = clamp(1.0f - ratio * ratio * ratio * ratio, 0.0f, 1.0f);
+		attenuation = window * window;
+	}
+
+	vec3 ambient = lightAmbient * baseColor;
+	vec3 diffuse = lightDiffuse * diffuseImpact * material.diffuseColor * baseColor;
+	vec3 specular = lightSpecular * specularImpact * material.specularColor;
+	return (ambient + diffuse + specular) * attenuation;
+}
+
+void main()
+{
+#if defined(TEXTURE)
+	vec4 baseColor = texture(objectTexture, fragmentTextureCoordinate);
+#elif defined(TEXTURE_ARRAY)
+	vec4 baseColor = objectColor;
+	if (fragmentTextureLayer >= 0)
+	{
+		baseColor = texture(objectTextures, vec3(fragmentTextureCoordinate, float(fragmentTextureLayer)));
+	}
+#else
+	vec4 baseColor = objectColor;
+#endif
+
+#if !defined(LIGHTING)
+	outFragmentColor = baseColor;
+#else
+	Material material = materials[fragmentMaterial];
+	vec3 normal = normalize(fragmentVertexNormal);
+	vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+	vec3 phongResult = vec3(0.0f);
+
+#if defined(DIRECTIONAL_LIGHT)
+	phongResult += CalcDirectionalLight(directionalLight, material, normal, viewDirection, baseColor.rgb, CalcDirectionalShadow());
+#endif
+#if defined(POINT_LIGHTS)
+	int cluster = GetClusterIndex();
+	int firstLight = int(texelFetch(clusterLightLists, cluster * 2).r);
+	int lightCount = int(texelFetch(clusterLightLists, cluster * 2 + 1).r);
+	for (int i = 0; i < lightCount; i++)
+	{
+		int lightIndex = int(texelFetch(clusterLightLists, firstLight + i).r);
+		phongResult += CalcClusterLight(lightIndex, material, normal, viewDirection, baseColor.rgb);
+	}
+#endif
+#if defined(SPOT_LIGHT)
+	phongResult += CalcSpotLight(spotLight, material, normal, viewDirection, baseColor.rgb, CalcSpotShadow());
+#endif
+
+	outFragmentColor = vec4(phongResult, baseColor.a);
+#endif
+}
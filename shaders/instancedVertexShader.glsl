@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// instancedvertexshader.glsl
+// ============
+// vertex shader for InstancedMeshes - the model matrix, UV scale, material
+// index and texture layer come from per-instance attributes instead of uniforms
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;		// two packed values with PACKED_NORMALS
+layout (location = 2) in vec2 inTextureCoordinate;
+layout (location = 3) in mat4 inInstanceModel;		// locations 3 to 6
+layout (location = 7) in vec2 inInstanceUVscale;
+layout (location = 8) in int inInstanceMaterial;
+layout (location = 9) in int inInstanceTextureLayer;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out int fragmentMaterial;
+flat out int fragmentTextureLayer;
+
+// the lit and unlit variants of the program write the same depth, so
+// the depth pre-pass and the shading pass pass the equal depth test
+invariant gl_Position;
+
+// camera values shared by every program, see UniformBuffers
+layout (std140) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+#if defined(PACKED_NORMALS)
+// unfold a normal packed onto the octahedron, the lower half of it is
+// folded over the corners of the square
+vec3 UnpackNormal(vec2 folded)
+{
+	vec3 normal = vec3(folded, 1.0f - abs(folded.x) - abs(folded.y));
+	float fold = max(-normal.z, 0.0f);
+
+	normal.x += (normal.x >= 0.0f) ? -fold : fold;
+	normal.y += (normal.y >= 0.0f) ? -fold : fold;
+	return(normalize(normal));
+}
+#endif
+
+void main()
+{
+#if defined(PACKED_NORMALS)
+	vec3 vertexNormal = UnpackNormal(inVertexNormal.xy);
+#else
+	vec3 vertexNormal = inVertexNormal;
+#endif
+	vec4 worldPosition = inInstanceModel * vec4(inVertexPosition, 1.0f);
+
+	gl_Position = projection * view * worldPosition;
+
+	fragmentPosition = vec3(worldPosition);
+	fragmentVertexNormal = mat3(transpose(inverse(inInstanceModel))) * vertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate * inInstanceUVscale;
+	fragmentMaterial = inInstanceMaterial;
+	fragmentTextureLayer = inInstanceTextureLayer;
+}
@@ -0,0 +1,119 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightclustercomputeshader.glsl
+// ============
+// compute shader for LightClusters - tests the point lights against the view
+// space box of every cluster and writes the list of lights of each cluster
+///////////////////////////////////////////////////////////////////////////////
+
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+// must match LightClusters::MAX_CLUSTER_LIGHTS
+#define MAX_CLUSTER_LIGHTS 64
+
+// the struct members match the structs in LightClusters.h under
+// the std430 layout
+struct PointLight
+{
+	vec4 positionRange;
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+};
+
+struct ClusterBounds
+{
+	vec4 boundsMin;
+	vec4 boundsMax;
+};
+
+layout (std430, binding = 0) readonly buffer LightBuffer
+{
+	PointLight lights[];
+};
+
+layout (std430, binding = 1) readonly buffer BoundsBuffer
+{
+	ClusterBounds clusterBounds[];
+};
+
+// the first index and count of every cluster, then the light indices
+layout (std430, binding = 2) writeonly buffer ListBuffer
+{
+	uint lists[];
+};
+
+layout (std430, binding = 3) buffer CounterBuffer
+{
+	uint listCount;
+};
+
+uniform mat4 view;
+uniform uint lightCount;
+uniform uint clusterCount;
+// where the light indices start, and how many of them fit
+uniform uint listStart;
+uniform uint listCapacity;
+
+// view space spheres of the lights the work group is testing
+shared vec4 sharedLights[gl_WorkGroupSize.x];
+
+void main()
+{
+	uint cluster = gl_GlobalInvocationID.x;
+	bool bActive = (cluster < clusterCount);
+	vec3 boundsMin = vec3(0.0f);
+	vec3 boundsMax = vec3(0.0f);
+	uint found[MAX_CLUSTER_LIGHTS];
+	uint count = 0u;
+
+	if (bActive == true)
+	{
+		boundsMin = clusterBounds[cluster].boundsMin.xyz;
+		boundsMax = clusterBounds[cluster].boundsMax.xyz;
+	}
+
+	// the group moves the lights into shared memory a batch at a
+	// time, so each light is read and transformed only once
+	for (uint batch = 0u; batch < lightCount; batch += gl_WorkGroupSize.x)
+	{
+		uint index = batch + gl_LocalInvocationIndex;
+		if (index < lightCount)
+		{
+			vec4 light = lights[index].positionRange;
+			sharedLights[gl_LocalInvocationIndex] = vec4((view * vec4(light.xyz, 1.0f)).xyz, light.w);
+		}
+		barrier();
+
+		uint batchCount = min(gl_WorkGroupSize.x, lightCount - batch);
+		for (uint i = 0u; (bActive == true) && (i < batchCount) && (count < MAX_CLUSTER_LIGHTS); i++)
+		{
+			vec4 sphere = sharedLights[i];
+			vec3 offset = sphere.xyz - clamp(sphere.xyz, boundsMin, boundsMax);
+
+			// lights without a range reach every cluster
+			if ((sphere.w <= 0.0f) || (dot(offset, offset) <= sphere.w * sphere.w))
+			{
+				found[count] = batch + i;
+				count++;
+			}
+		}
+		barrier();
+	}
+
+	if (bActive == false)
+	{
+		return;
+	}
+
+	uint offset = atomicAdd(listCount, count);
+	uint kept = (offset < listCapacity) ? min(count, listCapacity - offset) : 0u;
+
+	lists[2u * cluster] = listStart + offset;
+	lists[2u * cluster + 1u] = kept;
+	for (uint i = 0u; i < kept; i++)
+	{
+		lists[listStart + offset + i] = found[i];
+	}
+}
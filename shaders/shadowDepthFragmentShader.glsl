@@ -0,0 +1,12 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowdepthfragmentshader.glsl
+// ============
+// fragment shader for the shadow maps - they only keep the depth, so
+// nothing is written
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+void main()
+{
+}
@@ -0,0 +1,19 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowdepthinstancedvertexshader.glsl
+// ============
+// vertex shader for drawing InstancedMeshes into the shadow maps - the model
+// matrix comes from the per-instance attributes
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 3) in mat4 inInstanceModel;		// locations 3 to 6
+
+// world space to the clip space of the shadow map being drawn
+uniform mat4 lightMatrix;
+
+void main()
+{
+	gl_Position = lightMatrix * inInstanceModel * vec4(inVertexPosition, 1.0f);
+}
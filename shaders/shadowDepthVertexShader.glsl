@@ -0,0 +1,19 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowdepthvertexshader.glsl
+// ============
+// vertex shader for drawing the scene nodes into the shadow maps - only the
+// positions of the main program's vertex layout are read
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+
+uniform mat4 model;
+// world space to the clip space of the shadow map being drawn
+uniform mat4 lightMatrix;
+
+void main()
+{
+	gl_Position = lightMatrix * model * vec4(inVertexPosition, 1.0f);
+}
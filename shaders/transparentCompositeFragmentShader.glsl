@@ -0,0 +1,34 @@
+///////////////////////////////////////////////////////////////////////////////
+// transparentcompositefragmentshader.glsl
+// ============
+// fragment shader for the TransparencyPass composite - the average color of
+// the transparent fragments, blended with the share of them that covers
+// the background
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+out vec4 outFragmentColor;
+
+uniform sampler2D accumulationTexture;
+uniform sampler2D weightTexture;
+// lower left corner of the viewport the targets were sized to
+uniform ivec2 viewportOrigin;
+
+void main()
+{
+	ivec2 texel = ivec2(gl_FragCoord.xy) - viewportOrigin;
+	vec4 accumulation = texelFetch(accumulationTexture, texel, 0);
+	float revealage = accumulation.a;
+
+	// nothing transparent was drawn over this pixel
+	if (revealage >= 1.0f)
+	{
+		discard;
+	}
+
+	float weight = texelFetch(weightTexture, texel, 0).r;
+	vec3 averageColor = accumulation.rgb / max(weight, 1e-5f);
+
+	outFragmentColor = vec4(averageColor, 1.0f - revealage);
+}
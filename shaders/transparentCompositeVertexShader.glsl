@@ -0,0 +1,15 @@
+///////////////////////////////////////////////////////////////////////////////
+// transparentcompositevertexshader.glsl
+// ============
+// vertex shader for the TransparencyPass composite - one triangle covering
+// the screen, made from the vertex index without any vertex data
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+void main()
+{
+	vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+
+	gl_Position = vec4(position * 2.0f - 1.0f, 0.0f, 1.0f);
+}
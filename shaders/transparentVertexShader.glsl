@@ -0,0 +1,38 @@
+///////////////////////////////////////////////////////////////////////////////
+// transparentvertexshader.glsl
+// ============
+// vertex shader for the transparent scene nodes - the vertex layout and the
+// per-object uniforms of the main program, with the camera from FrameBlock
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+
+uniform mat4 model;
+uniform vec2 UVscale;
+
+// camera values shared by every program, see UniformBuffers
+layout (std140) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+void main()
+{
+	vec4 worldPosition = model * vec4(inVertexPosition, 1.0f);
+
+	gl_Position = projection * view * worldPosition;
+
+	fragmentPosition = vec3(worldPosition);
+	fragmentVertexNormal = mat3(transpose(inverse(model))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate * UVscale;
+}